@@ -1,11 +1,14 @@
 import logging
 import pytest
 import os
+import shutil
+import threading
 from datetime import datetime
-from lib389._constants import DEFAULT_SUFFIX, INSTALL_LATEST_CONFIG
+from lib389._constants import DEFAULT_SUFFIX, DEFAULT_BENAME, INSTALL_LATEST_CONFIG
 from lib389.properties import BACKEND_SAMPLE_ENTRIES, TASK_WAIT
 from lib389.topologies import topology_st as topo
 from lib389.backend import Backend
+from lib389.idm.user import UserAccounts
 from lib389.tasks import BackupTask, RestoreTask
 from lib389.config import BDB_LDBMConfig
 from lib389 import DSEldif
@@ -99,6 +102,127 @@ def test_db_home_dir_online_backup(topo):
         assert topo.standalone.ds_error_log.match(f".*Failed renaming {backup_dir}.bak back to {backup_dir}")
 
 
+@pytest.mark.skipif(get_default_db_lib() != "mdb", reason="Incremental backups are only supported over mdb")
+def test_incremental_backup(topo):
+    """Test that an incremental backup only saves the changed pages
+    and restores the changes made after its base backup
+
+    :id: 6f0a7c5e-3b52-4d8e-9a61-2c4f8b1d7e93
+    :setup: Standalone Instance
+    :steps:
+        1. Add some users and perform a full backup
+        2. Modify a few users and perform an incremental backup based on it
+        3. Check the size of the delta
+        4. Verify the incremental backup with dbverify
+        5. Modify the users again and restore the incremental backup
+        6. Check the users have the values of the incremental backup
+    :expectedresults:
+        1. Success
+        2. Success
+        3. The delta is smaller than the database
+        4. Success
+        5. Success
+        6. Success
+    """
+    inst = topo.standalone
+    users = UserAccounts(inst, DEFAULT_SUFFIX)
+    for i in range(200):
+        users.create_test_user(uid=2000 + i)
+    tnow = datetime.now().strftime("%Y_%m_%d_%H_%M_%S")
+    full = os.path.join(inst.ds_paths.backup_dir, f"full-{tnow}")
+    incr = os.path.join(inst.ds_paths.backup_dir, f"incr-{tnow}")
+
+    task = inst.backup_online(archive=full)
+    task.wait()
+    assert task.get_exit_code() == 0
+
+    modified = [users.get(f"test_user_{2000 + i}") for i in range(5)]
+    for user in modified:
+        user.replace("description", "incremental")
+
+    task = inst.backup_online(archive=incr, base=full)
+    task.wait()
+    assert task.get_exit_code() == 0
+    assert os.path.exists(os.path.join(incr, "data.mdb.delta"))
+    assert not os.path.exists(os.path.join(incr, "data.mdb"))
+    db_size = os.path.getsize(os.path.join(full, "data.mdb"))
+    delta_size = os.path.getsize(os.path.join(incr, "data.mdb.delta"))
+    log.info(f"data.mdb: {db_size} bytes, data.mdb.delta: {delta_size} bytes")
+    assert delta_size < db_size
+    assert inst.ds_error_log.match(".*Incremental backup: .* pages changed since .*")
+
+    inst.stop()
+    assert inst.dbverify(DEFAULT_BENAME, backup_dir=incr)
+    inst.start()
+
+    for user in modified:
+        user.replace("description", "after backup")
+
+    task = inst.restore_online(archive=incr)
+    task.wait()
+    assert task.get_exit_code() == 0
+    for user in modified:
+        assert user.present("description", "incremental")
+
+
+@pytest.mark.skipif(get_default_db_lib() != "mdb", reason="Streamed backups are only supported over mdb")
+def test_streamed_backup(topo):
+    """Test that a backup can be streamed in a named pipe and restored from it
+
+    :id: 0c8e5d3a-7f41-4b6e-b2d9-5a1e3c7f9b24
+    :setup: Standalone Instance
+    :steps:
+        1. Stream a compacted backup in a named pipe and save it in a file
+        2. Check the stream format
+        3. Modify an entry
+        4. Restore the backup streamed from the file through the named pipe
+        5. Check the entry has the value of the backup
+    :expectedresults:
+        1. Success
+        2. Success
+        3. Success
+        4. Success
+        5. Success
+    """
+    inst = topo.standalone
+    users = UserAccounts(inst, DEFAULT_SUFFIX)
+    user = users.create_test_user(uid=3000)
+    user.replace("description", "streamed")
+    fifo = os.path.join(inst.ds_paths.backup_dir, "stream.fifo")
+    saved = os.path.join(inst.ds_paths.backup_dir, "stream.bak")
+    os.mkfifo(fifo)
+    os.chmod(fifo, 0o666)
+
+    def copy(src, dst):
+        with open(src, 'rb') as fsrc, open(dst, 'wb') as fdst:
+            shutil.copyfileobj(fsrc, fdst)
+
+    try:
+        reader = threading.Thread(target=copy, args=(fifo, saved), daemon=True)
+        reader.start()
+        task = inst.backup_online(archive=fifo, compact=True)
+        task.wait()
+        reader.join(timeout=60)
+        assert task.get_exit_code() == 0
+        with open(saved, 'rb') as f:
+            assert f.read(8) == b'DSBKSTRM'
+        assert not os.path.isdir(fifo)
+
+        user.replace("description", "after backup")
+
+        writer = threading.Thread(target=copy, args=(saved, fifo), daemon=True)
+        writer.start()
+        task = inst.restore_online(archive=fifo)
+        task.wait()
+        writer.join(timeout=60)
+        assert task.get_exit_code() == 0
+        assert user.present("description", "streamed")
+    finally:
+        for path in (fifo, saved):
+            if os.path.exists(path):
+                os.remove(path)
+
+
 if __name__ == '__main__':
     # Run isolated
     # -s for DEBUG mode
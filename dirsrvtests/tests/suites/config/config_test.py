@@ -12,7 +12,7 @@ import pytest
 from lib389.tasks import *
 from lib389.topologies import topology_m2, topology_st as topo
 from lib389.utils import *
-from lib389._constants import DN_CONFIG, DEFAULT_SUFFIX, DEFAULT_BENAME
+from lib389._constants import DN_CONFIG, DN_DM, PW_DM, DEFAULT_SUFFIX, DEFAULT_BENAME
 from lib389.idm.user import UserAccounts, TEST_USER_PROPERTIES
 from lib389.idm.group import Groups
 from lib389.backend import *
@@ -520,6 +520,51 @@ def test_ndn_cache_enabled(topo):
         topo.standalone.config.set('nsslapd-ndn-cache-max-size', 'invalid_value')
 
 
+def test_ndn_cache_shared_stats(topo):
+    """Check the NDN cache is shared by the worker threads and stays bounded
+
+    :id: 6c1f2d8e-4b7a-4e39-9d05-3a8e7b2c1f64
+    :setup: Standalone instance
+    :steps:
+        1. Enable the NDN cache with its minimal size and restart
+        2. Search the same entries from several connections
+        3. Check the NDN cache statistics in the monitor
+    :expectedresults:
+        1. Success
+        2. Success
+        3. There are hits, and the cache size is within its maximum size
+    """
+
+    topo.standalone.config.set('nsslapd-ndn-cache-enabled', 'on')
+    topo.standalone.config.set('nsslapd-ndn-cache-max-size', '1048576')
+    topo.standalone.restart()
+
+    users = UserAccounts(topo.standalone, DEFAULT_SUFFIX)
+    user_dns = [users.create_test_user(uid=7000 + i).dn for i in range(10)]
+
+    conns = []
+    for _ in range(4):
+        conn = ldap.initialize(topo.standalone.ldapuri)
+        conn.simple_bind_s(DN_DM, PW_DM)
+        conns.append(conn)
+    for _ in range(100):
+        for conn in conns:
+            for dn in user_dns:
+                conn.search_s(dn, ldap.SCOPE_BASE, '(objectclass=*)', ['uid'])
+
+    monitor = MonitorLDBM(topo.standalone)
+    assert int(monitor.get_attr_val_utf8('normalizedDnCacheHits')) > 0
+    assert int(monitor.get_attr_val_utf8('currentNormalizedDnCacheCount')) > 0
+    assert int(monitor.get_attr_val_utf8('currentNormalizedDnCacheSize')) <= \
+           int(monitor.get_attr_val_utf8('maxNormalizedDnCacheSize'))
+
+    for conn in conns:
+        conn.unbind_s()
+    for dn in user_dns:
+        users.get(dn=dn).delete()
+    topo.standalone.config.remove_all('nsslapd-ndn-cache-max-size')
+
+
 def test_require_index(topo):
     """Test nsslapd-ignore-virtual-attrs configuration attribute
 
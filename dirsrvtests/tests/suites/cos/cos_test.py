@@ -144,6 +144,121 @@ def test_vattr_on_cos_definition(topo, reset_ignore_vattr):
     topo.standalone.restart()
     assert topo.standalone.config.get_attr_val_utf8('nsslapd-ignore-virtual-attrs') == "on"
 
+def test_template_change_updates_cache(topo):
+    """Check that adding or modifying a CoS template is taken into
+       account without touching the definition
+
+    :id: 0d4b8f6e-2c5a-4d8e-9a51-7e3f1c9b6a20
+    :setup: Standalone instance
+    :steps:
+         1. Create a template container with a 'gold' template
+         2. Create a classic definition on departmentNumber
+         3. Add a user with departmentNumber 'gold'
+         4. Modify the gold template value
+         5. Add a 'silver' template and move the user to silver
+         6. Delete the silver template
+    :expectedresults:
+         1. This should be successful
+         2. This should be successful
+         3. The user gets the gold employeeType
+         4. The user gets the new gold employeeType
+         5. The user gets the silver employeeType
+         6. The user has no employeeType anymore
+    """
+    tmpl_parent = 'cn=cosTemplatesIncremental,{}'.format(DEFAULT_SUFFIX)
+    nsContainer(topo.standalone, tmpl_parent).create(properties={'cn': 'cosTemplatesIncremental'})
+    gold = CosTemplate(topo.standalone, 'cn=gold,{}'.format(tmpl_parent))
+    gold.create(properties={'cn': 'gold', 'employeeType': 'goldType'})
+
+    cosdef = CosClassicDefinition(topo.standalone, 'cn=cosIncremental,{}'.format(DEFAULT_SUFFIX))
+    cosdef.create(properties={'cn': 'cosIncremental',
+                              'cosTemplateDn': tmpl_parent,
+                              'cosAttribute': 'employeeType',
+                              'cosSpecifier': 'departmentNumber'})
+
+    user = UserAccount(topo.standalone, 'uid=cosincruser,{}'.format(DEFAULT_SUFFIX))
+    user.create(properties={'uid': 'cosincruser',
+                            'cn': 'cosincruser',
+                            'sn': 'user',
+                            'uidNumber': '1001',
+                            'gidNumber': '2001',
+                            'homeDirectory': '/home/cosincruser',
+                            'departmentNumber': 'gold'})
+    time.sleep(1)
+    assert user.get_attr_val_utf8('employeeType') == 'goldType'
+
+    log.info("Modify the gold template")
+    gold.replace('employeeType', 'newGoldType')
+    time.sleep(1)
+    assert user.get_attr_val_utf8('employeeType') == 'newGoldType'
+
+    log.info("Add a silver template and move the user to it")
+    silver = CosTemplate(topo.standalone, 'cn=silver,{}'.format(tmpl_parent))
+    silver.create(properties={'cn': 'silver', 'employeeType': 'silverType'})
+    user.replace('departmentNumber', 'silver')
+    time.sleep(1)
+    assert user.get_attr_val_utf8('employeeType') == 'silverType'
+
+    log.info("Delete the silver template")
+    silver.delete()
+    time.sleep(1)
+    assert not user.present('employeeType')
+
+    user.delete()
+    cosdef.delete()
+    gold.delete()
+
+
+def test_template_added_after_definition(topo):
+    """Check that a CoS definition without templates is activated by its
+       first template
+
+    :id: 6a1e9c3f-4b7d-4e25-8f0a-2d9b5c7e1a43
+    :setup: Standalone instance
+    :steps:
+         1. Create an empty template container
+         2. Create a classic definition on departmentNumber
+         3. Add a user with departmentNumber 'bronze'
+         4. Add the 'bronze' template
+    :expectedresults:
+         1. This should be successful
+         2. This should be successful
+         3. The user has no employeeType
+         4. The user gets the bronze employeeType
+    """
+    tmpl_parent = 'cn=cosTemplatesLate,{}'.format(DEFAULT_SUFFIX)
+    container = nsContainer(topo.standalone, tmpl_parent)
+    container.create(properties={'cn': 'cosTemplatesLate'})
+
+    cosdef = CosClassicDefinition(topo.standalone, 'cn=cosLate,{}'.format(DEFAULT_SUFFIX))
+    cosdef.create(properties={'cn': 'cosLate',
+                              'cosTemplateDn': tmpl_parent,
+                              'cosAttribute': 'employeeType',
+                              'cosSpecifier': 'departmentNumber'})
+
+    user = UserAccount(topo.standalone, 'uid=coslateuser,{}'.format(DEFAULT_SUFFIX))
+    user.create(properties={'uid': 'coslateuser',
+                            'cn': 'coslateuser',
+                            'sn': 'user',
+                            'uidNumber': '1002',
+                            'gidNumber': '2002',
+                            'homeDirectory': '/home/coslateuser',
+                            'departmentNumber': 'bronze'})
+    time.sleep(1)
+    assert not user.present('employeeType')
+
+    log.info("Add the first template of the definition")
+    bronze = CosTemplate(topo.standalone, 'cn=bronze,{}'.format(tmpl_parent))
+    bronze.create(properties={'cn': 'bronze', 'employeeType': 'bronzeType'})
+    time.sleep(1)
+    assert user.get_attr_val_utf8('employeeType') == 'bronzeType'
+
+    user.delete()
+    cosdef.delete()
+    bronze.delete()
+    container.delete()
+
+
 if __name__ == "__main__":
     CURRENT_FILE = os.path.realpath(__file__)
     pytest.main("-s -v %s" % CURRENT_FILE)
@@ -8,6 +8,8 @@
 
 
 import os
+import ldap
+import ldif
 import pytest
 import subprocess
 
@@ -17,6 +19,8 @@ from lib389.utils import *
 from lib389.paths import Paths
 from lib389.cli_base import FakeArgs
 from lib389.cli_ctl.dbtasks import dbtasks_db2ldif
+from lib389.idm.user import UserAccounts
+from lib389.idm.organizationalunit import OrganizationalUnits
 
 pytestmark = pytest.mark.tier1
 
@@ -153,3 +157,54 @@ def test_dbtasks_db2ldif_with_non_accessible_ldif_file_path_output(topo):
     log.info("Restarting the instance...")
     topo.standalone.start()
 
+
+def test_db2ldif_entries_order(topo):
+    """Check that an export lists the parents before their children
+
+    :id: 3e0c5f7a-9b21-4d8e-a6f4-1c7d2b9e8a53
+    :setup: Standalone Instance
+    :steps:
+        1. Add users, then an organizational unit
+        2. Move some users under the organizational unit
+        3. Export the backend with db2ldif
+        4. Check the exported entries
+    :expectedresults:
+        1. Operation successful
+        2. Operation successful
+        3. Operation successful
+        4. All the entries are exported with their dn, and each entry
+           is after its parent
+    """
+    inst = topo.standalone
+    users = UserAccounts(inst, DEFAULT_SUFFIX)
+    user_list = [users.create_test_user(uid=3000 + num) for num in range(2000)]
+    ou = OrganizationalUnits(inst, DEFAULT_SUFFIX).create(properties={'ou': 'export_order'})
+    moved = []
+    for user in user_list[::200]:
+        user.rename(f"uid={user.get_attr_val_utf8('uid')}", newsuperior=ou.dn)
+        moved.append(user.dn.lower())
+    entry_count = len(inst.search_s(DEFAULT_SUFFIX, ldap.SCOPE_SUBTREE, '(objectclass=*)', ['dn']))
+
+    export_ldif = os.path.join(inst.get_ldif_dir(), 'export_order.ldif')
+    inst.stop()
+    assert inst.db2ldif(bename=DEFAULT_BENAME, suffixes=None, excludeSuffixes=None,
+                        encrypt=False, repl_data=False, outputfile=export_ldif)
+    inst.start()
+
+    with open(export_ldif, 'r') as f:
+        records = ldif.LDIFRecordList(f)
+        records.parse()
+    dns = [dn.lower() for dn, entry in records.all_records]
+    os.remove(export_ldif)
+
+    assert len(dns) == entry_count
+    assert set(moved) <= set(dns)
+    seen = set()
+    for dn in dns:
+        if dn != DEFAULT_SUFFIX.lower():
+            assert dn.split(',', 1)[1] in seen
+        seen.add(dn)
+
+    for user in user_list:
+        user.delete()
+    ou.delete()
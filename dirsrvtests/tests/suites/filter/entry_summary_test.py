@@ -0,0 +1,110 @@
+# --- BEGIN COPYRIGHT BLOCK ---
+# Copyright (C) 2026 Red Hat, Inc.
+# All rights reserved.
+#
+# License: GPL (version 3 or any later version).
+# See LICENSE for details.
+# --- END COPYRIGHT BLOCK ---
+#
+import os
+import logging
+import pytest
+import ldap
+from lib389._constants import DEFAULT_SUFFIX
+from lib389.backend import DatabaseConfig
+from lib389.idm.user import UserAccounts
+from lib389.topologies import topology_st as topo
+
+pytestmark = pytest.mark.tier1
+
+log = logging.getLogger(__name__)
+
+# description, roomNumber and l are not indexed
+USERS = [
+    {'description': 'First Floor', 'roomNumber': '101', 'l': 'Brisbane'},
+    {'description': 'first  floor', 'roomNumber': '102', 'l': 'Paris'},
+    {'description': 'Second Floor', 'roomNumber': '201', 'l': 'Paris'},
+    {'description': 'Third Floor', 'roomNumber': '301', 'l;lang-fr': 'Lyon'},
+]
+
+FILTERS = [
+    '(description=first floor)',
+    '(description=FIRST FLOOR)',
+    '(description=fourth floor)',
+    '(roomNumber=201)',
+    '(l=Paris)',
+    '(l=lyon)',
+    '(l;lang-fr=Lyon)',
+    '(&(uid=summary_user_*)(description=second floor))',
+    '(&(uid=summary_user_*)(description=fourth floor))',
+    '(&(uid=summary_user_*)(!(description=first floor)))',
+    '(!(&(uid=summary_user_*)(l=Paris)))',
+    '(|(roomNumber=101)(roomNumber=301))',
+]
+
+
+@pytest.fixture(scope="function")
+def add_users(request, topo):
+    users = UserAccounts(topo.standalone, DEFAULT_SUFFIX, rdn=None)
+    users_list = []
+    for num, attrs in enumerate(USERS):
+        properties = {
+            'uid': f'summary_user_{num}',
+            'cn': f'summary_user_{num}',
+            'sn': f'summary_user_{num}',
+            'uidNumber': f'{num}',
+            'gidNumber': f'{num}',
+            'homeDirectory': f'/home/summary_user_{num}'
+        }
+        properties.update(attrs)
+        users_list.append(users.create(properties=properties))
+
+    def fin():
+        for user in users_list:
+            user.delete()
+        DatabaseConfig(topo.standalone).set([('nsslapd-search-entry-summary', 'off')])
+
+    request.addfinalizer(fin)
+
+
+def _search_uids(inst, filterstr):
+    result = inst.search_s(DEFAULT_SUFFIX, ldap.SCOPE_SUBTREE, filterstr, ['uid'])
+    return sorted(entry.getValue('uid').decode() for entry in result)
+
+
+def test_entry_summary(topo, add_users):
+    """Check that the entry summaries do not change the search results
+
+    :id: 3f9b1c52-8e4d-4a7b-b06e-5c2d9a7e1f84
+    :setup: Standalone instance
+    :steps:
+        1. Add users
+        2. Run searches with unindexed equality components
+        3. Enable nsslapd-search-entry-summary and restart to empty the entry cache
+        4. Run the searches again, twice to use the cached entries
+    :expectedresults:
+        1. Success
+        2. Success
+        3. Success
+        4. The results are the same as without the summaries
+    """
+    inst = topo.standalone
+    expected = {f: _search_uids(inst, f) for f in FILTERS}
+    log.info('Results without summaries: %s' % expected)
+    assert expected['(description=first floor)'] == ['summary_user_0', 'summary_user_1']
+    assert expected['(description=FIRST FLOOR)'] == ['summary_user_0', 'summary_user_1']
+    assert expected['(l=lyon)'] == ['summary_user_3']
+
+    DatabaseConfig(inst).set([('nsslapd-search-entry-summary', 'on')])
+    inst.restart()
+
+    for i in range(2):
+        for f in FILTERS:
+            assert _search_uids(inst, f) == expected[f], f
+
+
+if __name__ == "__main__":
+    # Run isolated
+    # -s for DEBUG mode
+    CURRENT_FILE = os.path.realpath(__file__)
+    pytest.main("-s %s" % CURRENT_FILE)
@@ -0,0 +1,103 @@
+# --- BEGIN COPYRIGHT BLOCK ---
+# Copyright (C) 2026 Red Hat, Inc.
+# All rights reserved.
+#
+# License: GPL (version 3 or any later version).
+# See LICENSE for details.
+# --- END COPYRIGHT BLOCK ---
+#
+import os
+import logging
+import pytest
+import ldap
+from lib389._constants import DEFAULT_SUFFIX, DEFAULT_BENAME
+from lib389.backend import Backends, DatabaseConfig
+from lib389.idm.user import UserAccounts
+from lib389.topologies import topology_st as topo
+
+pytestmark = pytest.mark.tier1
+
+log = logging.getLogger(__name__)
+
+USERS_NUM = 5
+
+# Same shape, other assertion values
+SHAPE = '(&(objectClass=posixAccount)(|(uid=%s)(cn=%s))(sn=*%s*))'
+
+
+@pytest.fixture(scope="function")
+def add_users(request, topo):
+    users = UserAccounts(topo.standalone, DEFAULT_SUFFIX, rdn=None)
+    users_list = []
+    for num in range(USERS_NUM):
+        users_list.append(users.create(properties={
+            'uid': f'plan_user_{num}',
+            'cn': f'Plan User {num}',
+            'sn': f'Plan  SN {num}',
+            'uidNumber': f'{num}',
+            'gidNumber': f'{num}',
+            'homeDirectory': f'/home/plan_user_{num}'
+        }))
+
+    def fin():
+        for user in users_list:
+            user.delete()
+        DatabaseConfig(topo.standalone).set([('nsslapd-search-filter-plans', '1024')])
+
+    request.addfinalizer(fin)
+
+
+def _search_uids(inst, filterstr):
+    result = inst.search_s(DEFAULT_SUFFIX, ldap.SCOPE_SUBTREE, filterstr, ['uid'])
+    return sorted(entry.getValue('uid').decode() for entry in result)
+
+
+def _plan_monitor(inst):
+    monitor = Backends(inst).get(DEFAULT_BENAME).get_monitor()
+    return (monitor.get_attr_val_int('filterPlans'),
+            monitor.get_attr_val_int('filterPlanHits'),
+            monitor.get_attr_val_int('filterPlanMisses'))
+
+
+def test_filter_plan(topo, add_users):
+    """Check that the searches with filters of the same shape reuse a plan
+
+    :id: 8c4e2a17-5b3d-4f60-a9e1-7d2c6b0f3e58
+    :setup: Standalone instance
+    :steps:
+        1. Add users
+        2. Run searches with filters of the same shape and other values
+        3. Check the plan monitor
+        4. Disable the plans and run the searches again
+    :expectedresults:
+        1. Success
+        2. Each search returns its user
+        3. The searches after the first one used the plan
+        4. The results are the same
+    """
+    inst = topo.standalone
+    filters = {}
+    for num in range(USERS_NUM):
+        filters[SHAPE % (f'plan_user_{num}', 'nobody', f'sn {num}')] = [f'plan_user_{num}']
+        filters[SHAPE % ('nobody', f'PLAN USER {num}', f'SN  {num}')] = [f'plan_user_{num}']
+    filters[SHAPE % ('plan_user_0', 'nobody', 'sn 1')] = []
+
+    nplans, hits, misses = _plan_monitor(inst)
+    for f, expected in filters.items():
+        assert _search_uids(inst, f) == expected, f
+    nplans_after, hits_after, misses_after = _plan_monitor(inst)
+    log.info('Filter plans: %d hits: %d misses: %d' % (nplans_after, hits_after, misses_after))
+    assert nplans_after >= 1
+    assert hits_after - hits >= len(filters) - 1
+
+    DatabaseConfig(inst).set([('nsslapd-search-filter-plans', '0')])
+    for f, expected in filters.items():
+        assert _search_uids(inst, f) == expected, f
+    assert _plan_monitor(inst)[1] == hits_after
+
+
+if __name__ == "__main__":
+    # Run isolated
+    # -s for DEBUG mode
+    CURRENT_FILE = os.path.realpath(__file__)
+    pytest.main("-s %s" % CURRENT_FILE)
@@ -0,0 +1,134 @@
+# --- BEGIN COPYRIGHT BLOCK ---
+# Copyright (C) 2026 Red Hat, Inc.
+# All rights reserved.
+#
+# License: GPL (version 3 or any later version).
+# See LICENSE for details.
+# --- END COPYRIGHT BLOCK ---
+#
+import os
+import logging
+import pytest
+import ldap
+from lib389._constants import DEFAULT_SUFFIX, DEFAULT_BENAME
+from lib389.backend import Backends
+from lib389.idm.user import UserAccounts
+from lib389.topologies import topology_st as topo
+
+pytestmark = pytest.mark.tier1
+
+log = logging.getLogger(__name__)
+
+USERS_NUM = 4
+
+
+# The equality filters on indexed types: the candidates of the unindexed
+# searches are not cached
+def _filter(num):
+    return f'(&(objectClass=posixAccount)(uid=cache_user_{num}))'
+
+
+def _not_filter(num):
+    return f'(&(uid=cache_user_{num})(!(l=Paris)))'
+
+
+def _user_properties(num):
+    return {
+        'uid': f'cache_user_{num}',
+        'cn': f'cache_user_{num}',
+        'sn': f'cache_user_{num}',
+        'uidNumber': f'{num}',
+        'gidNumber': f'{num}',
+        'homeDirectory': f'/home/cache_user_{num}'
+    }
+
+
+@pytest.fixture(scope="function")
+def add_users(request, topo):
+    users = UserAccounts(topo.standalone, DEFAULT_SUFFIX, rdn=None)
+    for num in range(USERS_NUM):
+        users.create(properties=_user_properties(num))
+    backend = Backends(topo.standalone).get(DEFAULT_BENAME)
+    backend.replace('nsslapd-search-result-cache-size', '1048576')
+
+    def fin():
+        backend.replace('nsslapd-search-result-cache-size', '0')
+        for user in users.list():
+            if user.get_attr_val_utf8('cn').startswith('cache_user_'):
+                user.delete()
+
+    request.addfinalizer(fin)
+    return users
+
+
+def _search_uids(inst, filterstr):
+    result = inst.search_s(DEFAULT_SUFFIX, ldap.SCOPE_SUBTREE, filterstr, ['uid'])
+    return sorted(entry.getValue('uid').decode() for entry in result)
+
+
+def _cache_hits(inst):
+    monitor = Backends(inst).get(DEFAULT_BENAME).get_monitor()
+    return monitor.get_attr_val_int('searchResultCacheHits')
+
+
+def test_search_cache(topo, add_users):
+    """Check that the cached candidates of the searches follow the updates
+
+    :id: 5d7e3b90-2c41-4f8a-b6d3-9e0a1c4f7b26
+    :setup: Standalone instance
+    :steps:
+        1. Add users and enable the search result cache
+        2. Run the same searches twice
+        3. Modify, add and delete entries matching the filters
+        4. Run the searches again
+        5. Disable the cache and run the searches again
+    :expectedresults:
+        1. Success
+        2. The second searches use the cache
+        3. Success
+        4. The results have the updates
+        5. The results are the same
+    """
+    inst = topo.standalone
+    users = add_users
+
+    hits = _cache_hits(inst)
+    for i in range(2):
+        for num in range(USERS_NUM):
+            assert _search_uids(inst, _filter(num)) == [f'cache_user_{num}']
+        assert _search_uids(inst, _not_filter(1)) == ['cache_user_1']
+    assert _cache_hits(inst) - hits >= USERS_NUM
+
+    # The filter type is modified
+    users.get('cache_user_0').replace('uid', 'other_user_0')
+    assert _search_uids(inst, _filter(0)) == []
+
+    # Added entry
+    assert _search_uids(inst, _filter(USERS_NUM)) == []
+    users.create(properties=_user_properties(USERS_NUM))
+    assert _search_uids(inst, _filter(USERS_NUM)) == [f'cache_user_{USERS_NUM}']
+
+    # A type that is not in the filter under a NOT
+    users.get('cache_user_1').replace('l', 'Paris')
+    assert _search_uids(inst, _not_filter(1)) == []
+
+    # Deleted entry
+    users.get('cache_user_2').delete()
+    assert _search_uids(inst, _filter(2)) == []
+
+    hits = _cache_hits(inst)
+    assert _search_uids(inst, _filter(3)) == ['cache_user_3']
+    assert _cache_hits(inst) > hits
+
+    Backends(inst).get(DEFAULT_BENAME).replace('nsslapd-search-result-cache-size', '0')
+    assert _search_uids(inst, _filter(0)) == []
+    assert _search_uids(inst, _filter(2)) == []
+    assert _search_uids(inst, _filter(3)) == ['cache_user_3']
+    assert _search_uids(inst, _filter(USERS_NUM)) == [f'cache_user_{USERS_NUM}']
+    assert _search_uids(inst, _not_filter(1)) == []
+
+if __name__ == "__main__":
+    # Run isolated
+    # -s for DEBUG mode
+    CURRENT_FILE = os.path.realpath(__file__)
+    pytest.main("-s %s" % CURRENT_FILE)
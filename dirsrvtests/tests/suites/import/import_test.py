@@ -16,7 +16,7 @@ import time
 import glob
 import logging
 from lib389.topologies import topology_st as topo
-from lib389._constants import DEFAULT_SUFFIX, TaskWarning
+from lib389._constants import DEFAULT_SUFFIX, DEFAULT_BENAME, TaskWarning
 from lib389.dbgen import dbgen_users
 from lib389.tasks import ImportTask
 from lib389.index import Indexes
@@ -330,6 +330,103 @@ def test_ldif2db_syntax_check(topo, _import_clean):
     topo.standalone.start()
 
 
+def test_ldif2db_entry_boundaries(topo, _import_clean):
+    """Entries are split correctly whatever the line endings and folding
+
+    :id: 0d6c2a3e-5b71-4c1f-9a0e-6f3b8e2d7c41
+    :setup: Standalone Instance
+    :steps:
+        1. Create an ldif file with CRLF line endings, folded lines,
+           several blank lines between entries and no final newline
+        2. Stop the server and import ldif file with ldif2db
+        3. Check the imported entries
+    :expectedresults:
+        1. Success
+        2. Success
+        3. All entries are imported with their unfolded values
+    """
+    ldif_dir = topo.standalone.get_ldif_dir()
+    import_ldif = ldif_dir + '/basic_import.ldif'
+    long_desc = 'a long description ' * 10
+    entries = [
+        ['version: 1'],
+        ['dn: {}'.format(DEFAULT_SUFFIX), 'objectClass: top', 'objectClass: domain', 'dc: example'],
+        ['dn: ou=people,{}'.format(DEFAULT_SUFFIX), 'objectClass: top',
+         'objectClass: organizationalUnit', 'ou: people'],
+    ]
+    for i in range(5):
+        desc = 'description: ' + long_desc
+        # Fold the description every 40 characters
+        folded = [desc[j:j + 40] for j in range(0, len(desc), 40)]
+        entries.append(['dn: uid=boundary{},ou=people,{}'.format(i, DEFAULT_SUFFIX),
+                        'objectClass: top', 'objectClass: account', 'uid: boundary{}'.format(i),
+                        folded[0]] + [' ' + line for line in folded[1:]])
+    with open(import_ldif, 'w', newline='') as f:
+        for i, entry in enumerate(entries):
+            eol = '\r\n' if i % 2 else '\n'
+            f.write(eol.join(entry))
+            if i < len(entries) - 1:
+                f.write(eol * (i % 3 + 2))
+
+    topo.standalone.stop()
+    assert topo.standalone.ldif2db(DEFAULT_BENAME, None, None, None, import_ldif)
+    topo.standalone.start()
+
+    accounts = Accounts(topo.standalone, DEFAULT_SUFFIX)
+    users = accounts.filter('(uid=boundary*)')
+    assert len(users) == 5
+    for user in users:
+        assert user.get_attr_val_utf8('description').strip() == long_desc.strip()
+
+
+def test_indexes_after_import_and_reindex(topo, _import_clean):
+    """Indexes built during import and reindex match the imported data
+
+    :id: 7a4f3c2e-1d5b-4e8a-b6f0-2c9d8e1a3b57
+    :setup: Standalone Instance
+    :steps:
+        1. Generate and import an ldif file offline
+        2. Search using the uid and cn indexes
+        3. Reindex uid and cn offline
+        4. Search using the uid and cn indexes
+    :expectedresults:
+        1. Success
+        2. The indexed searches return the imported entries
+        3. Success
+        4. The indexed searches return the imported entries
+    """
+    nb_users = 3000
+    ldif_dir = topo.standalone.get_ldif_dir()
+    import_ldif = ldif_dir + '/basic_import.ldif'
+    dbgen_users(topo.standalone, nb_users, import_ldif, DEFAULT_SUFFIX, generic=True)
+    with open(import_ldif) as f:
+        uids = [line.split(':', 1)[1].strip() for line in f if line.lower().startswith('uid:')]
+    assert len(uids) == nb_users
+
+    def _check_indexes():
+        accounts = Accounts(topo.standalone, DEFAULT_SUFFIX)
+        assert len(accounts.filter('(uid=*)')) == nb_users
+        for uid in uids[::500] + uids[-1:]:
+            assert len(accounts.filter(f'(uid={uid})')) == 1
+        prefix = uids[0][:-2]
+        expected = len([uid for uid in uids if uid.startswith(prefix)])
+        assert len(accounts.filter(f'(cn={prefix}*)')) == expected
+
+    topo.standalone.stop()
+    assert topo.standalone.ldif2db(DEFAULT_BENAME, None, None, None, import_ldif)
+    topo.standalone.start()
+    _check_indexes()
+
+    topo.standalone.stop()
+    assert topo.standalone.db2index(DEFAULT_BENAME, attrs=['uid', 'cn'])
+    topo.standalone.start()
+    _check_indexes()
+
+    if get_default_db_lib() == "mdb":
+        # Attribute indexes are written by merging the sorted keys
+        assert topo.standalone.searchErrorsLog('Merging .* sorted runs of index keys')
+
+
 @pytest.mark.skipif(get_default_db_lib() == "mdb", reason="Not cache size over mdb")
 def test_issue_a_warning_if_the_cache_size_is_smaller(topo, _import_clean):
     """Report during startup if nsslapd-cachememsize is too small
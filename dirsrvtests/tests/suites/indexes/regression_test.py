@@ -16,7 +16,8 @@ from lib389.backend import Backends, DatabaseConfig
 from lib389.idm.user import UserAccounts
 from lib389.idm.group import Groups, Group
 from lib389.topologies import topology_st as topo
-from lib389.utils import ds_is_older
+from lib389.utils import ds_is_older, get_default_db_lib
+from lib389.tasks import Task
 from lib389.plugins import MemberOfPlugin
 
 pytestmark = pytest.mark.tier1
@@ -215,6 +216,65 @@ def test_unindexed_internal_search_crashes_server(topo, add_a_group_with_users,
     assert inst.status()
 
 
+@pytest.mark.skipif(get_default_db_lib() != "mdb", reason="Online reindex is only done with lmdb")
+def test_online_reindex_keeps_serving(topo):
+    """Check that an attribute reindex task does not block the updates
+
+    :id: 6a1d8b52-3c4e-4f0b-9d7a-2e5f1c8b4a71
+    :setup: Standalone instance
+    :steps:
+        1. Index description and add users with a description
+        2. Start a reindex task of description
+        3. Modify, add and delete users while the task runs
+        4. Wait for the task to complete
+        5. Search on description
+        6. Check the error log
+    :expectedresults:
+        1. Should succeed
+        2. Should succeed
+        3. Updates are not refused
+        4. Task exit code is 0
+        5. The index reflects the updates done during the reindex
+        6. The index was rebuilt online
+    """
+    inst = topo.standalone
+    backend = Backends(inst).get(DEFAULT_BENAME)
+    backend.get_indexes().create(properties={
+        'cn': 'description',
+        'nsSystemIndex': 'false',
+        'nsIndexType': ['eq']
+        })
+    users = UserAccounts(inst, DEFAULT_SUFFIX)
+    for num in range(500):
+        users.create_test_user(uid=5000 + num).replace('description', 'before')
+
+    task = Task(inst, f'cn=online_reindex_{int(time.time())},cn=index,cn=tasks,cn=config')
+    task.create(properties={'nsIndexAttribute': 'description', 'nsInstance': DEFAULT_BENAME})
+
+    # Do the updates once the task has started the rebuild of the index
+    for _ in range(300):
+        task_log = task.get_attr_val_utf8('nsTaskLog') or ''
+        if 'Indexing attribute: description' in task_log or task.is_complete():
+            break
+        time.sleep(0.1)
+    assert 'Indexing attribute: description' in (task.get_attr_val_utf8('nsTaskLog') or '')
+
+    modified = users.get('test_user_5000')
+    modified.replace('description', 'after')
+    users.create_test_user(uid=6000).replace('description', 'after')
+    users.get('test_user_5001').delete()
+
+    task.wait()
+    assert task.get_exit_code() == 0
+
+    assert len(users.filter('(description=after)')) == 2
+    assert len(users.filter('(description=before)')) == 498
+    assert inst.ds_error_log.match('.*Index description rebuilt.*')
+
+    for user in users.filter('(|(description=before)(description=after))'):
+        user.delete()
+
+
 if __name__ == "__main__":
     # Run isolated
     # -s for DEBUG mode
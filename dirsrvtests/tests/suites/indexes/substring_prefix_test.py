@@ -0,0 +1,101 @@
+# --- BEGIN COPYRIGHT BLOCK ---
+# Copyright (C) 2026 Red Hat, Inc.
+# All rights reserved.
+#
+# License: GPL (version 3 or any later version).
+# See LICENSE for details.
+# --- END COPYRIGHT BLOCK ---
+#
+import os
+import logging
+import pytest
+import ldap
+from lib389._constants import DEFAULT_SUFFIX, DEFAULT_BENAME
+from lib389.backend import Backends
+from lib389.idm.user import UserAccounts
+from lib389.topologies import topology_st as topo
+
+pytestmark = pytest.mark.tier1
+
+log = logging.getLogger(__name__)
+
+SN_VALUES = ['a', 'ab', 'abc', 'abcd', 'b', 'smith', 'smithson', 'jsmithsonian', 'asmith']
+
+
+@pytest.fixture(scope="function")
+def add_users(request, topo):
+    users = UserAccounts(topo.standalone, DEFAULT_SUFFIX, rdn=None)
+    users_list = []
+    for num, sn in enumerate(SN_VALUES):
+        user = users.create(properties={
+            'uid': f'prefix_user_{num}',
+            'sn': sn,
+            'cn': sn,
+            'uidNumber': f'{num}',
+            'gidNumber': f'{num}',
+            'homeDirectory': f'/home/prefix_user_{num}'
+        })
+        users_list.append(user)
+
+    def fin():
+        for user in users_list:
+            user.delete()
+
+    request.addfinalizer(fin)
+
+
+def _search_sn(inst, filterstr):
+    result = inst.search_s(DEFAULT_SUFFIX, ldap.SCOPE_SUBTREE, filterstr, ['sn'])
+    return sorted(entry.getValue('sn').decode() for entry in result)
+
+
+def test_substring_prefix_index(topo, add_users):
+    """Check that nsSubStrPrefix indexes the short initial substrings
+
+    :id: 6a0d3e84-1f2b-4c7e-9d85-2b7f4c1e9a30
+    :setup: Standalone instance
+    :steps:
+        1. Add users
+        2. Search (sn=a*) with the default substring index
+        3. Set nsSubStrPrefix: 1 on the sn index and reindex sn
+        4. Search (sn=a*) and (sn=ab*)
+        5. Search (sn=*smithson*) and (sn=sm*son)
+        6. Remove nsSubStrPrefix and reindex sn
+    :expectedresults:
+        1. Success
+        2. The search is unindexed
+        3. Success
+        4. The searches are indexed and return the right entries
+        5. The searches return the right entries
+        6. Success
+    """
+    inst = topo.standalone
+    backend = Backends(inst).get(DEFAULT_BENAME)
+    index = backend.get_index('sn')
+
+    inst.deleteLog(inst.accesslog)
+    assert _search_sn(inst, '(sn=a*)') == ['a', 'ab', 'abc', 'abcd', 'asmith']
+    assert inst.searchAccessLog('notes=U')
+
+    index.add('objectClass', 'extensibleObject')
+    index.replace('nsSubStrPrefix', '1')
+    backend.reindex(attrs=['sn'], wait=True)
+
+    inst.deleteLog(inst.accesslog)
+    assert _search_sn(inst, '(sn=a*)') == ['a', 'ab', 'abc', 'abcd', 'asmith']
+    assert _search_sn(inst, '(sn=ab*)') == ['ab', 'abc', 'abcd']
+    assert not inst.searchAccessLog('notes=U')
+
+    assert _search_sn(inst, '(sn=*smithson*)') == ['jsmithsonian', 'smithson']
+    assert _search_sn(inst, '(sn=sm*son)') == ['smithson']
+
+    index.remove('nsSubStrPrefix', '1')
+    index.remove('objectClass', 'extensibleObject')
+    backend.reindex(attrs=['sn'], wait=True)
+
+
+if __name__ == "__main__":
+    # Run isolated
+    # -s for DEBUG mode
+    CURRENT_FILE = os.path.realpath(__file__)
+    pytest.main("-s %s" % CURRENT_FILE)
@@ -1,11 +1,14 @@
 import logging
+import ldap
 import pytest
 import os
+import threading
 from lib389.monitor import *
 from lib389.backend import Backends, DatabaseConfig
 from lib389._constants import *
 from lib389.topologies import topology_st as topo
 from lib389._mapped_object import DSLdapObjects
+from lib389.idm.user import UserAccounts
 
 pytestmark = pytest.mark.tier1
 
@@ -146,6 +149,89 @@ def test_monitor_backend(topo):
         assert False
 
 
+def test_monitor_mdb_rotxn_renew(topo):
+    """Check that the read-only txns of the searches are renewed from the thread pools
+
+    :id: 0d4c6a6e-6b0e-4f8a-9a43-5f3b9e2a7c11
+    :setup: Single instance
+    :steps:
+        1. Get the database monitor
+        2. Run some searches
+        3. Get the database monitor again
+    :expectedresults:
+        1. Success
+        2. Success
+        3. renewROtxn has increased
+    """
+
+    if topo.standalone.get_db_lib() != 'mdb':
+        pytest.skip('Read-only txn pools are specific to lmdb')
+
+    monitor = MonitorDatabase(topo.standalone)
+    before = int(monitor.get_status()['renewrotxn'][0])
+    for _ in range(20):
+        topo.standalone.search_s(DEFAULT_SUFFIX, ldap.SCOPE_SUBTREE, '(objectclass=*)', ['dn'])
+    after = int(monitor.get_status()['renewrotxn'][0])
+    assert after > before
+
+
+def test_monitor_mdb_group_commit(topo):
+    """Check that the write txns are synced by batches when group commit is enabled
+
+    :id: 5b0f8e52-3c1d-4c0e-8f5e-2d7c9a41b6e3
+    :setup: Single instance
+    :steps:
+        1. Set nsslapd-db-transaction-batch-val and restart the instance
+        2. Modify some users from several threads
+        3. Check the database monitor
+        4. Restart the instance and check the modifications
+        5. Disable the group commit
+    :expectedresults:
+        1. Success
+        2. Success
+        3. groupSyncRWtxn has increased and is lower than the number of commits
+        4. The modifications are there
+        5. Success
+    """
+
+    inst = topo.standalone
+    if inst.get_db_lib() != 'mdb':
+        pytest.skip('This group commit is specific to lmdb')
+
+    db_config = DatabaseConfig(inst)
+    db_config.set([('nsslapd-db-transaction-batch-val', '10')])
+    inst.restart()
+
+    users = UserAccounts(inst, DEFAULT_SUFFIX)
+    accounts = [users.create_test_user(uid=2000 + i) for i in range(10)]
+    monitor = MonitorDatabase(inst)
+    before = monitor.get_status()
+
+    def modify(user):
+        for i in range(20):
+            user.replace('description', f'group commit {i}')
+
+    threads = [threading.Thread(target=modify, args=(user,)) for user in accounts]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    after = monitor.get_status()
+    syncs = int(after['groupsyncrwtxn'][0]) - int(before['groupsyncrwtxn'][0])
+    commits = int(after['commitrwtxn'][0]) - int(before['commitrwtxn'][0])
+    log.info(f'{commits} commits in {syncs} syncs')
+    # The modifications of the same backend share the syncs
+    assert 0 < syncs < commits
+
+    inst.restart()
+    for user in accounts:
+        assert user.get_attr_val_utf8('description') == 'group commit 19'
+        user.delete()
+    db_config.set([('nsslapd-db-transaction-batch-val', '0')])
+    inst.restart()
+
+
 @pytest.mark.bz1843550
 @pytest.mark.ds4153
 @pytest.mark.bz1903539
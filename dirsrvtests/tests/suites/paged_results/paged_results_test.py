@@ -393,6 +393,61 @@ def test_search_sort_success(topology_st, create_user):
         del_users(users_list)
 
 
+def test_search_sort_filtered(topology_st, create_user):
+    """Verify that a sorted search, limited by a page size or a size limit,
+    returns the entries in order when most of the candidates do not match
+    the filter
+
+    :id: 5c2b8e61-0f4a-4a37-9d1e-7b8f3a6c2e94
+    :setup: Standalone instance, test user for binding,
+            varying number of users for the search base
+    :steps:
+        1. Add users, only a third of them have a description
+        2. Search the users with a description with a simple paged
+           control and a server side sort control
+        3. Search the users with a description with a server side
+           sort control and a size limit
+    :expectedresults:
+        1. Success
+        2. All the users with a description should be found and sorted
+        3. The first users with a description should be returned, sorted
+    """
+
+    users_num = 30
+    users_list = add_users(topology_st, users_num, DEFAULT_SUFFIX)
+    kept = sorted(user.get_attr_val_utf8('sn') for user in users_list[::3])
+    for user in users_list[::3]:
+        user.replace('description', 'keep')
+    # description is not indexed, so the candidates are all the test users
+    search_flt = r'(&(uid=test*)(description=keep))'
+    searchreq_attrlist = ['dn', 'sn']
+
+    try:
+        conn = create_user.bind(TEST_USER_PWD)
+
+        log.info('Collect the paged results with sorting')
+        req_ctrl = SimplePagedResultsControl(True, size=2, cookie='')
+        sort_ctrl = SSSRequestControl(True, ['sn'])
+        results = paged_search(conn, DEFAULT_SUFFIX, [req_ctrl, sort_ctrl],
+                               search_flt, searchreq_attrlist)
+        assert [ensure_str(attrs['sn'][0]) for dn, attrs in results] == kept
+
+        log.info('Collect the first results with sorting and a size limit')
+        sort_ctrl = SSSRequestControl(True, ['-sn'])
+        msgid = conn.search_ext(DEFAULT_SUFFIX, ldap.SCOPE_SUBTREE, search_flt,
+                                searchreq_attrlist, serverctrls=[sort_ctrl], sizelimit=3)
+        results = []
+        with pytest.raises(ldap.SIZELIMIT_EXCEEDED):
+            while True:
+                rtype, rdata, rmsgid, rctrls = conn.result3(msgid, all=0)
+                if rtype == ldap.RES_SEARCH_RESULT:
+                    break
+                results.extend(rdata)
+        assert [ensure_str(attrs['sn'][0]) for dn, attrs in results] == kept[::-1][:3]
+    finally:
+        del_users(users_list)
+
+
 def test_search_abandon(topology_st, create_user):
     """Verify that search with simple paged results control
     can be abandon
@@ -14,6 +14,7 @@ Importing necessary Modules.
 import logging
 import time
 import os
+import ldap
 import pytest
 
 from lib389._constants import PW_DM, DEFAULT_SUFFIX
@@ -23,6 +24,7 @@ from lib389.idm.organizationalunit import OrganizationalUnit
 from lib389.topologies import topology_st as topo
 from lib389.idm.role import FilteredRoles, ManagedRoles, NestedRoles
 from lib389.idm.domain import Domain
+from lib389.backend import Backends
 
 logging.getLogger(__name__).setLevel(logging.INFO)
 log = logging.getLogger(__name__)
@@ -504,6 +506,118 @@ def test_vattr_on_managed_role(topo, request):
 
     request.addfinalizer(fin)
 
+def test_role_membership_follows_writes(topo, request):
+    """Test the nsRole values stay accurate once they have been computed
+
+    :id: 3f0d7a52-5c0b-4d8e-9a61-7e2b1f4c6d90
+    :setup: Standalone instance
+    :steps:
+         1. Create a filtered role and a managed role
+         2. Create a user matching the filtered role
+         3. Read nsRole twice
+         4. Modify the user so it no longer matches the filter
+         5. Add the managed role to the user
+         6. Change the role filter so the user matches again
+         7. Search with a nsRole filter
+    :expectedresults:
+         1. This should be successful
+         2. This should be successful
+         3. nsRole contains the filtered role both times
+         4. nsRole no longer contains the filtered role
+         5. nsRole contains the managed role
+         6. nsRole contains both roles
+         7. The user is returned
+    """
+
+    filtered = FilteredRoles(topo.standalone, DEFAULT_SUFFIX).create(
+        properties={'cn': 'INDEXFILTERROLE', 'nsRoleFilter': '(description=indexed)'})
+    managed = ManagedRoles(topo.standalone, DEFAULT_SUFFIX).create(properties={'cn': 'INDEXMANAGEDROLE'})
+    user = UserAccounts(topo.standalone, DEFAULT_SUFFIX).create_test_user(uid=4242)
+    user.replace('description', 'indexed')
+
+    def roles_of(account):
+        return [r.lower() for r in account.get_attr_vals_utf8('nsRole')]
+
+    for _ in range(2):
+        assert filtered.dn.lower() in roles_of(user)
+
+    user.replace('description', 'not indexed')
+    assert filtered.dn.lower() not in roles_of(user)
+
+    user.add('nsRoleDN', managed.dn)
+    assert managed.dn.lower() in roles_of(user)
+    assert filtered.dn.lower() not in roles_of(user)
+
+    filtered.replace('nsRoleFilter', '(description=not indexed)')
+    assert filtered.dn.lower() in roles_of(user)
+    assert managed.dn.lower() in roles_of(user)
+
+    found = UserAccounts(topo.standalone, DEFAULT_SUFFIX).filter('(nsRole={})'.format(filtered.dn))
+    assert user.dn.lower() in [u.dn.lower() for u in found]
+
+    def fin():
+        user.delete()
+        filtered.delete()
+        managed.delete()
+        topo.standalone.config.set('nsslapd-ignore-virtual-attrs', 'on')
+
+    request.addfinalizer(fin)
+
+
+def test_nsrole_search_is_indexed(topo, request):
+    """Test a nsRole search is resolved from the nsRoleDN index
+
+    :id: 9b3e6c1d-2f47-4a85-b0d8-5e1c7a4f2b63
+    :setup: Standalone instance
+    :steps:
+         1. Index nsRoleDN for equality and require indexed searches
+         2. Create two managed roles and a nested role containing them
+         3. Create users member of each managed role, and one without role
+         4. Search (nsRole=<managed role>)
+         5. Search (nsRole=<nested role>)
+    :expectedresults:
+         1. This should be successful
+         2. This should be successful
+         3. This should be successful
+         4. The search is not rejected and returns the member only
+         5. The search is not rejected and returns the members of both roles
+    """
+
+    backend = Backends(topo.standalone).get('userRoot')
+    backend.add_index('nsRoleDN', ['eq'])
+    backend.set('nsslapd-require-index', 'on')
+
+    managed_roles = ManagedRoles(topo.standalone, DEFAULT_SUFFIX)
+    managed1 = managed_roles.create(properties={'cn': 'CANDIDATEMANAGEDROLE1'})
+    managed2 = managed_roles.create(properties={'cn': 'CANDIDATEMANAGEDROLE2'})
+    nested = NestedRoles(topo.standalone, DEFAULT_SUFFIX).create(
+        properties={'cn': 'CANDIDATENESTEDROLE', 'nsRoleDN': [managed1.dn, managed2.dn]})
+
+    users = UserAccounts(topo.standalone, DEFAULT_SUFFIX)
+    user1 = users.create_test_user(uid=5001)
+    user1.set('nsRoleDN', managed1.dn)
+    user2 = users.create_test_user(uid=5002)
+    user2.set('nsRoleDN', managed2.dn)
+    user3 = users.create_test_user(uid=5003)
+
+    def members_of(role):
+        entries = topo.standalone.search_s(DEFAULT_SUFFIX, ldap.SCOPE_SUBTREE,
+                                           '(nsRole={})'.format(role.dn), ['uid'])
+        # the nested role definition itself holds nsRoleDN values
+        return sorted(e.dn.lower() for e in entries if e.dn.lower().startswith('uid='))
+
+    assert members_of(managed1) == [user1.dn.lower()]
+    assert members_of(nested) == sorted([user1.dn.lower(), user2.dn.lower()])
+
+    def fin():
+        backend.set('nsslapd-require-index', 'off')
+        for entry in (user1, user2, user3, nested, managed1, managed2):
+            entry.delete()
+        backend.get_index('nsRoleDN').delete()
+
+    request.addfinalizer(fin)
+
+
 if __name__ == "__main__":
     CURRENT_FILE = os.path.realpath(__file__)
     pytest.main("-s -v %s" % CURRENT_FILE)
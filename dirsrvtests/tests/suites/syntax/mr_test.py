@@ -15,6 +15,7 @@ from lib389.dbgen import dbgen_users
 from lib389._constants import *
 from lib389.topologies import topology_st as topo
 from lib389._controls import SSSRequestControl
+from lib389.idm.user import UserAccounts
 
 pytestmark = pytest.mark.tier1
 
@@ -62,6 +63,47 @@ def test_sss_mr(topo):
     log.info("Test PASSED")
 
 
+def test_sss_order(topo):
+    """Test the order of the entries returned with server side sorting
+
+    :id: 0b3f4c2e-6d55-4d8e-a7a4-3c1e9f2b7d61
+    :setup: Standalone Instance
+    :steps:
+        1. Add users with different descriptions, and users without description
+        2. Sort on description, ascending and descending
+        3. Sort on description with the caseIgnoreOrderingMatch matching rule
+    :expectedresults:
+        1. Success
+        2. The users are sorted and the ones without description are last
+        3. The users are sorted and the ones without description are last
+    """
+
+    inst = topo.standalone
+    users = UserAccounts(inst, DEFAULT_SUFFIX)
+    descriptions = ['delta', 'Alpha', 'charlie', None, 'Bravo', 'echo', None]
+    for i, desc in enumerate(descriptions):
+        user = users.create_test_user(uid=3100 + i)
+        if desc:
+            user.replace('description', desc)
+
+    def sorted_descriptions(key):
+        ctrl = SSSRequestControl(True, [key])
+        msg_id = inst.search_ext(DEFAULT_SUFFIX, ldap.SCOPE_SUBTREE, "(uid=test_user_310*)",
+                                 ['description'], serverctrls=[ctrl])
+        rtype, rdata, rmsgid, response_ctrl = inst.result3(msg_id)
+        return [attrs.get('description', [b''])[0].decode() for dn, attrs in rdata]
+
+    expected = ['Alpha', 'Bravo', 'charlie', 'delta', 'echo', '', '']
+    assert sorted_descriptions('description') == expected
+    assert sorted_descriptions('-description') == expected[4::-1] + ['', '']
+    assert sorted_descriptions('description:2.5.13.3') == expected
+    assert sorted_descriptions('-description:2.5.13.3') == expected[4::-1] + ['', '']
+
+    for user in users.list():
+        if user.get_attr_val_utf8('uid').startswith('test_user_310'):
+            user.delete()
+
+
 if __name__ == '__main__':
     # Run isolated
     # -s for DEBUG mode
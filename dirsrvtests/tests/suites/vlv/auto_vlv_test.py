@@ -0,0 +1,119 @@
+# --- BEGIN COPYRIGHT BLOCK ---
+# Copyright (C) 2026 Red Hat, Inc.
+# All rights reserved.
+#
+# License: GPL (version 3 or any later version).
+# See LICENSE for details.
+# --- END COPYRIGHT BLOCK ---
+#
+import logging
+import os
+import time
+import ldap
+import pytest
+from lib389.topologies import topology_st
+from lib389._constants import DEFAULT_SUFFIX
+from lib389._controls import SSSRequestControl
+from lib389.backend import Backends, DatabaseConfig
+from lib389.idm.user import UserAccounts
+from lib389.utils import ensure_str
+
+pytestmark = pytest.mark.tier1
+
+log = logging.getLogger(__name__)
+
+USERS_NUM = 20
+SEARCH_FILTER = '(uid=test_user_*)'
+
+
+def _sorted_search(inst):
+    sort_ctrl = SSSRequestControl(True, ['sn'])
+    msgid = inst.search_ext(DEFAULT_SUFFIX, ldap.SCOPE_SUBTREE, SEARCH_FILTER,
+                            ['sn'], serverctrls=[sort_ctrl])
+    rtype, rdata, rmsgid, rctrls = inst.result3(msgid)
+    return [ensure_str(attrs['sn'][0]) for dn, attrs in rdata]
+
+
+def _auto_index_monitor(inst):
+    monitor = Backends(inst).get('userRoot').get_monitor()
+    if monitor.get_attr_val_int('autoVlvIndexes') == 0:
+        return None
+    return (monitor.get_attr_val_utf8('autoVlvIndexName-0'),
+            monitor.get_attr_val_utf8('autoVlvIndexEnabled-0'),
+            monitor.get_attr_val_int('autoVlvIndexUses-0'))
+
+
+def test_auto_vlv_index(topology_st, request):
+    """Check that a frequent sorted search gets a vlv index of its own
+
+    :id: 0b6f2c4e-7d1a-4e59-9a3c-5f8e2d1b7c46
+    :setup: Standalone instance
+    :steps:
+        1. Enable the automatic vlv indexes with a threshold of 3 searches
+        2. Add users
+        3. Run the same sorted search 3 times
+        4. Wait for the automatic vlv index to be built
+        5. Run the sorted search again
+        6. Add a user and run the sorted search again
+    :expectedresults:
+        1. Success
+        2. Success
+        3. The entries are sorted
+        4. The monitor lists an enabled automatic vlv index
+        5. The entries are sorted and the index is used
+        6. The new user is returned at its place
+    """
+    inst = topology_st.standalone
+    db_cfg = DatabaseConfig(inst)
+    db_cfg.set([('nsslapd-vlv-auto-threshold', '3'),
+                ('nsslapd-vlv-auto-min-candidates', '10')])
+
+    users = UserAccounts(inst, DEFAULT_SUFFIX)
+
+    def fin():
+        db_cfg.set([('nsslapd-vlv-auto-threshold', '0')])
+        for user in users.list():
+            if user.get_attr_val_utf8('uid').startswith('test_user_'):
+                user.delete()
+        for vlv_search in Backends(inst).get('userRoot').get_vlv_searches():
+            if vlv_search.get_attr_val_utf8('cn').startswith('autoVlv'):
+                vlv_search.delete(recursive=True)
+
+    request.addfinalizer(fin)
+
+    # Create them out of order
+    for i in reversed(range(USERS_NUM)):
+        user = users.create_test_user(uid=4000 + i)
+        user.replace('sn', 'sn%03d' % ((i * 7) % USERS_NUM))
+    expected = sorted('sn%03d' % i for i in range(USERS_NUM))
+
+    assert _auto_index_monitor(inst) is None
+    for i in range(3):
+        assert _sorted_search(inst) == expected
+
+    for i in range(30):
+        auto = _auto_index_monitor(inst)
+        if auto is not None and auto[1] == 'on':
+            break
+        time.sleep(1)
+    assert auto is not None
+    log.info('Automatic vlv index: %s' % (auto,))
+    name, enabled, uses = auto
+    assert name.startswith('autoVlv')
+    assert enabled == 'on'
+
+    assert _sorted_search(inst) == expected
+    assert _auto_index_monitor(inst)[2] == uses + 1
+
+    user = users.create_test_user(uid=4100)
+    user.replace('sn', 'sn0105')
+    expected = sorted(expected + ['sn0105'])
+    assert _sorted_search(inst) == expected
+    assert _auto_index_monitor(inst)[2] == uses + 2
+
+
+if __name__ == '__main__':
+    # Run isolated
+    # -s for DEBUG mode
+    CURRENT_FILE = os.path.realpath(__file__)
+    pytest.main("-s %s" % CURRENT_FILE)
@@ -109,9 +109,16 @@ void *cos_get_plugin_identity(void);
 #define COSTYPE_INDIRECT 3
 #define COS_DEF_ERROR_NO_TEMPLATES -2
 
-/* both variables are protected by change_lock */
+/* these variables are protected by change_lock */
 static int cos_cache_notify_flag = 0;
 static PRBool cos_cache_at_work = PR_FALSE;
+/*
+ * DNs of the cosTemplate entries changed since the last rebuild. As long as
+ * only templates changed, the change thread rebuilds only the definitions
+ * those templates belong to, cos_cache_full_rebuild forces a full rebuild.
+ */
+static char **cos_cache_pending_tmpl_dns = NULL;
+static int cos_cache_full_rebuild = 0;
 
 /* service definition cache structs */
 
@@ -149,6 +156,7 @@ struct _cosAttribute
     int attr_operational_default;
     int attr_cos_merge;
     void *pParent;
+    Slapi_ValueSet *pValues; /* pAttrValue as a value set, built at index time */
 };
 typedef struct _cosAttribute cosAttributes;
 
@@ -180,9 +188,15 @@ struct _cosDefinition
     cosAttrValue *pCosOpDefault;
     cosAttrValue *pCosMerge;
     cosTemplates *pCosTmps;
+    Slapi_DN **ppTargetSdns; /* pCosTargetTree as sdns, same order, built at index time */
 };
 typedef struct _cosDefinition cosDefinitions;
 
+/*
+    A cosCache is an immutable snapshot: once published in pCache it
+    is never modified, only replaced as a whole by the change thread.
+    Readers pin it with an atomic reference count, see cos_cache_getref.
+*/
 struct _cos_cache
 {
     cosDefinitions *pDefs;
@@ -190,17 +204,40 @@ struct _cos_cache
     int attrCount;
     char **ppTemplateList;
     int templateCount;
-    int refCount;
+    int32_t refCount;
     int vattr_cacheable;
 };
 typedef struct _cos_cache cosCache;
 
+/* specifier values of the entry read by a single cos_cache_query_attr */
+#define COS_SPEC_MEMO_SIZE 8
+struct _cosSpecMemo
+{
+    cosAttrValue *pSpec;
+    Slapi_ValueSet *pValues;
+};
+typedef struct _cosSpecMemo cosSpecMemo;
+
 /* cache manipulation function prototypes*/
 static cosCache *pCache; /* always the current global cache, only use getref to get */
 
+/*
+    Grace period tracking for the lock free pCache read path.
+    Readers register in the slot of the current epoch while they load
+    pCache and take their reference. The publisher bumps the epoch after
+    swapping pCache and waits for the previous slot to drain before it
+    drops its own reference to the old snapshot.
+*/
+static uint64_t cos_cache_epoch = 0;
+static int32_t cos_cache_readers[2] = {0, 0};
+static int cos_cache_vattr_cacheable = 0; /* vattr_cacheable of the published snapshot */
+
 /* the place to start if you want a new cache */
-static int cos_cache_create_unlock(void);
-static int cos_cache_creation_lock(void);
+static int cos_cache_create_unlock(char **ppTmplDns);
+static int cos_cache_creation_lock(char **ppTmplDns);
+static cosCache *cos_cache_publish(cosCache *pNewCache);
+static cosCache *cos_cache_pin(void);
+static int cos_cache_build_incremental(cosCache *pOldCache, char **ppTmplDns, cosDefinitions **pDefs);
 
 /* cache index related functions */
 static int cos_cache_index_all(cosCache *pCache);
@@ -217,6 +254,7 @@ static void cos_cache_add_ll_entry(void **attrval, void *theVal, int (*compare)(
 static int cos_cache_add_attrval(cosAttrValue **attrval, char *val);
 static void cos_cache_del_attrval_list(cosAttrValue **pVal);
 static int cos_cache_attrval_exists(cosAttrValue *pAttrs, const char *val);
+static cosAttrValue *cos_cache_dup_attrval_list(cosAttrValue *pVal);
 
 /* cosAttributes manipulation */
 static int cos_cache_add_attr(cosAttributes **pAttrs, char *name, cosAttrValue *val);
@@ -229,12 +267,18 @@ static int cos_cache_cmp_attr(cosAttributes *pAttr, Slapi_Value *test_this, int
 /* cosTemplates manipulation */
 static int cos_cache_add_dn_tmpls(char *dn, cosAttrValue *pCosSpecifier, cosAttrValue *pAttrs, cosTemplates **pTmpls);
 static int cos_cache_add_tmpl(cosTemplates **pTemplates, cosAttrValue *dn, cosAttrValue *objclasses, cosAttrValue *pCosSpecifier, cosAttributes *pAttrs, cosAttrValue *cosPriority);
+static cosTemplates *cos_cache_dup_tmpl_list(cosTemplates *pTmpls);
+static void cos_cache_del_tmpl_list(cosTemplates **pTmpls);
 
 /* cosDefinitions manipulation */
 static int cos_cache_build_definition_list(cosDefinitions **pDefs, int *vattr_cacheable);
 static int cos_cache_add_dn_defs(char *dn, cosDefinitions **pDefs);
 static int cos_cache_add_defn(cosDefinitions **pDefs, cosAttrValue **dn, int cosType, cosAttrValue **tree, cosAttrValue **tmpDn, cosAttrValue **spec, cosAttrValue **pAttrs, cosAttrValue **pOverrides, cosAttrValue **pOperational, cosAttrValue **pCosMerge, cosAttrValue **pCosOpDefault);
 static int cos_cache_entry_is_cos_related(Slapi_Entry *e);
+static int cos_cache_entry_is_cos_template(Slapi_Entry *e);
+static void cos_cache_del_defn_list(cosDefinitions **pDefs);
+static cosDefinitions *cos_cache_dup_defn(cosDefinitions *pDef, int with_templates);
+static int cos_cache_defn_uses_templates(cosDefinitions *pDef, char **ppTmplDns);
 
 /* schema checking */
 static int cos_cache_schema_check(cosCache *pCache, int cache_attr_index, Slapi_Attr *pObjclasses);
@@ -269,7 +313,6 @@ static int cos_cache_backwards_stricmp_and_clip(char *s1, char *s2);
 static int keeprunning = 0;
 static int started = 0;
 
-static Slapi_Mutex *cache_lock;
 static Slapi_Mutex *change_lock;
 static Slapi_Mutex *start_lock;
 static Slapi_Mutex *stop_lock;
@@ -292,7 +335,6 @@ cos_cache_init(void)
     slapi_log_err(SLAPI_LOG_TRACE, COS_PLUGIN_SUBSYSTEM, "--> cos_cache_init\n");
 
     slapi_vattrcache_cache_none();
-    cache_lock = slapi_new_mutex();
     change_lock = slapi_new_mutex();
     stop_lock = slapi_new_mutex();
     something_changed = slapi_new_condvar(change_lock);
@@ -303,7 +345,6 @@ cos_cache_init(void)
 
     if (stop_lock == NULL ||
         change_lock == NULL ||
-        cache_lock == NULL ||
         stop_lock == NULL ||
         start_lock == NULL ||
         start_cond == NULL ||
@@ -384,7 +425,7 @@ cos_cache_wait_on_change(void *arg __attribute__((unused)))
     pCache = 0;
 
     /* create initial cache */
-    cos_cache_creation_lock();
+    cos_cache_creation_lock(NULL);
 
     slapi_lock_mutex(start_lock);
     started = 1;
@@ -416,10 +457,25 @@ cos_cache_wait_on_change(void *arg __attribute__((unused)))
          * before we go running off doing lots of stuff lets check if we should stop
         */
         if (keeprunning) {
-            cos_cache_creation_lock();
+            /*
+             * Take the pending template changes, anything else
+             * (definition change, backend state change) means
+             * a full rebuild
+             */
+            char **ppTmplDns = cos_cache_pending_tmpl_dns;
+
+            cos_cache_pending_tmpl_dns = NULL;
+            if (cos_cache_full_rebuild) {
+                slapi_ch_array_free(ppTmplDns);
+                ppTmplDns = NULL;
+            }
+            cos_cache_full_rebuild = 0;
+            /* changes notified while we rebuild set the flag again */
+            cos_cache_notify_flag = 0; /* Dealt with it */
+            cos_cache_creation_lock(ppTmplDns);
+            slapi_ch_array_free(ppTmplDns);
         }
-        cos_cache_notify_flag = 0; /* Dealt with it */
-    }                              /* while */
+    } /* while */
 
     /* shut down the cache */
     slapi_unlock_mutex(change_lock);
@@ -429,6 +485,51 @@ cos_cache_wait_on_change(void *arg __attribute__((unused)))
 }
 
 
+/*
+    cos_cache_publish
+    -----------------
+    Makes pNewCache (which may be NULL) the current cache and returns
+    the previous one. Readers never block on the swap, instead we wait
+    here until every reader that might still have loaded the old pointer
+    has taken its reference. The caller then owns the global reference
+    to the old cache and must release it.
+
+        called by the change thread, or at shutdown once it has exited
+*/
+static cosCache *
+cos_cache_publish(cosCache *pNewCache)
+{
+    cosCache *pOldCache;
+    uint64_t epoch;
+
+    /* turn off caching until the old cache is done */
+    pOldCache = __atomic_load_n(&pCache, __ATOMIC_SEQ_CST);
+    if (pOldCache || !pNewCache) {
+        slapi_vattrcache_cache_none();
+
+        /*
+         * be sure not to uncache other stuff
+         * like roles if there is no change in
+         * state
+         */
+        if (pOldCache && pOldCache->vattr_cacheable)
+            slapi_entrycache_vattrcache_watermark_invalidate();
+    } else if (pNewCache->vattr_cacheable) {
+        slapi_vattrcache_cache_all();
+    }
+
+    pOldCache = __atomic_exchange_n(&pCache, pNewCache, __ATOMIC_SEQ_CST);
+    slapi_atomic_store_32(&cos_cache_vattr_cacheable, pNewCache ? pNewCache->vattr_cacheable : 0, __ATOMIC_SEQ_CST);
+
+    /* wait for the readers of the previous epoch to be done with pCache */
+    epoch = slapi_atomic_incr_64(&cos_cache_epoch, __ATOMIC_SEQ_CST) - 1;
+    while (slapi_atomic_load_32(&cos_cache_readers[epoch & 1], __ATOMIC_SEQ_CST) != 0) {
+        DS_Sleep(PR_MillisecondsToInterval(1));
+    }
+
+    return pOldCache;
+}
+
 /*
     cos_cache_create_unlock
     ---------------------
@@ -437,10 +538,15 @@ cos_cache_wait_on_change(void *arg __attribute__((unused)))
     releasing its refcount to the old cache and allowing it
     to be destroyed.
 
+    If ppTmplDns is set, only cosTemplate entries changed since
+    the current cache was built: the new cache is then a copy of
+    the current one where only the definitions using those
+    templates are read again from the DIT.
+
         called while change_lock is NOT held
 */
 static int
-cos_cache_create_unlock(void)
+cos_cache_create_unlock(char **ppTmplDns)
 {
     int ret = -1;
     cosCache *pNewCache;
@@ -454,8 +560,29 @@ cos_cache_create_unlock(void)
         pNewCache->pDefs = 0;
         pNewCache->refCount = 1;        /* 1 is for us */
         pNewCache->vattr_cacheable = 0; /* default is not cacheable */
+        pNewCache->ppAttrIndex = 0;
+        pNewCache->ppTemplateList = 0;
+        pNewCache->attrCount = 0;
+        pNewCache->templateCount = 0;
+
+        ret = -1;
+        if (ppTmplDns) {
+            cosCache *pOldCache = NULL;
 
-        ret = cos_cache_build_definition_list(&(pNewCache->pDefs), &(pNewCache->vattr_cacheable));
+            if ((pOldCache = cos_cache_pin()) != NULL) {
+                ret = cos_cache_build_incremental(pOldCache, ppTmplDns, &(pNewCache->pDefs));
+                pNewCache->vattr_cacheable = pOldCache->vattr_cacheable;
+                cos_cache_release(pOldCache);
+            }
+            if (ret) {
+                /* could not patch the current cache, go for a full rebuild */
+                cos_cache_del_defn_list(&(pNewCache->pDefs));
+                pNewCache->vattr_cacheable = 0;
+            }
+        }
+        if (ret) {
+            ret = cos_cache_build_definition_list(&(pNewCache->pDefs), &(pNewCache->vattr_cacheable));
+        }
         if (!ret) {
             /* OK, we have a cache, lets add indexing for
             that faster than slow feeling */
@@ -467,31 +594,7 @@ cos_cache_create_unlock(void)
                 ret = cos_cache_schema_build(pNewCache);
                 if (ret == 0) {
                     /* now to swap the new cache for the old cache */
-                    cosCache *pOldCache;
-
-                    slapi_lock_mutex(cache_lock);
-
-                    /* turn off caching until the old cache is done */
-                    if (pCache) {
-                        slapi_vattrcache_cache_none();
-
-                        /*
-                         * be sure not to uncache other stuff
-                         * like roles if there is no change in
-                         * state
-                         */
-                        if (pCache->vattr_cacheable)
-                            slapi_entrycache_vattrcache_watermark_invalidate();
-                    } else {
-                        if (pNewCache && pNewCache->vattr_cacheable) {
-                            slapi_vattrcache_cache_all();
-                        }
-                    }
-
-                    pOldCache = pCache;
-                    pCache = pNewCache;
-
-                    slapi_unlock_mutex(cache_lock);
+                    cosCache *pOldCache = cos_cache_publish(pNewCache);
 
                     if (pOldCache)
                         cos_cache_release(pOldCache);
@@ -522,25 +625,7 @@ cos_cache_create_unlock(void)
     /* make sure we have a new cache */
     if (!cache_built) {
         /* we do not have a new cache, must make sure the old cache is destroyed */
-
-        cosCache *pOldCache;
-
-        slapi_lock_mutex(cache_lock);
-
-        slapi_vattrcache_cache_none();
-
-        /*
-         * be sure not to uncache other stuff
-         * like roles if there is no change in
-         * state
-         */
-        if (pCache && pCache->vattr_cacheable)
-            slapi_entrycache_vattrcache_watermark_invalidate();
-
-        pOldCache = pCache;
-        pCache = NULL;
-
-        slapi_unlock_mutex(cache_lock);
+        cosCache *pOldCache = cos_cache_publish(NULL);
 
         if (pOldCache)
             cos_cache_release(pOldCache); /* release our reference to the old cache */
@@ -563,11 +648,15 @@ cos_cache_create_unlock(void)
  * A solution is to use a flag 'cos_cache_at_work' protected by change_lock,
  * release change_lock, recreate the cos_cache, acquire change_lock reset the flag.
  *
+ * ppTmplDns is passed to cos_cache_create_unlock, NULL requests a full rebuild.
+ * If the rebuild is skipped, the template dns are moved back to
+ * cos_cache_pending_tmpl_dns (the caller still frees the array).
+ *
  * returned value: result of cos_cache_create_unlock
  *
  */
 static int
-cos_cache_creation_lock(void)
+cos_cache_creation_lock(char **ppTmplDns)
 {
     int ret = -1;
     int max_tries = 10;
@@ -583,13 +672,29 @@ cos_cache_creation_lock(void)
         }
         cos_cache_at_work = PR_TRUE;
         slapi_unlock_mutex(change_lock);
-        ret = cos_cache_create_unlock();
+        ret = cos_cache_create_unlock(ppTmplDns);
         slapi_lock_mutex(change_lock);
         cos_cache_at_work = PR_FALSE;
         break;
     }
     if (!max_tries) {
         slapi_log_err(SLAPI_LOG_FATAL, COS_PLUGIN_SUBSYSTEM, "--> cos_cache_creation_lock  rebuilt was to long, skip this rebuild\n");
+        /* keep the changes for the next rebuild, and ask for one */
+        if (ppTmplDns) {
+            int i;
+
+            for (i = 0; ppTmplDns[i]; i++) {
+                slapi_ch_array_add(&cos_cache_pending_tmpl_dns, ppTmplDns[i]);
+                ppTmplDns[i] = NULL;
+            }
+        } else {
+            cos_cache_full_rebuild = 1;
+        }
+        slapi_notify_condvar(something_changed, 1);
+        cos_cache_notify_flag = 1;
+    } else if (ret) {
+        /* there is no current cache any more, the next rebuild can't be incremental */
+        cos_cache_full_rebuild = 1;
     }
 
     return ret;
@@ -1350,6 +1455,7 @@ cos_cache_add_defn(
         theDef = (cosDefinitions *)slapi_ch_malloc(sizeof(cosDefinitions));
         if (theDef) {
             theDef->pCosTmps = NULL;
+            theDef->ppTargetSdns = NULL;
 
             /* process each template in turn */
 
@@ -1435,6 +1541,140 @@ out:
     return ret;
 }
 
+/*
+    cos_cache_defn_uses_templates
+    -----------------------------
+    returns non-zero if one of the template dns in ppTmplDns
+    is (classic scheme) or is a child of (pointer scheme) one
+    of the cosTemplateDn of this definition
+*/
+static int
+cos_cache_defn_uses_templates(cosDefinitions *pDef, char **ppTmplDns)
+{
+    int ret = 0;
+    cosAttrValue *pTmplDn;
+    int i;
+
+    for (pTmplDn = pDef->pCosTemplateDn; pTmplDn && !ret; pTmplDn = pTmplDn->list.pNext) {
+        Slapi_DN *tmplSdn = slapi_sdn_new_dn_byref(pTmplDn->val);
+
+        for (i = 0; ppTmplDns[i] && !ret; i++) {
+            Slapi_DN *changedSdn = slapi_sdn_new_ndn_byref(ppTmplDns[i]);
+
+            if (slapi_sdn_compare(tmplSdn, changedSdn) == 0 ||
+                slapi_sdn_isparent(tmplSdn, changedSdn)) {
+                ret = 1;
+            }
+            slapi_sdn_free(&changedSdn);
+        }
+        slapi_sdn_free(&tmplSdn);
+    }
+
+    return ret;
+}
+
+/*
+    cos_cache_dup_defn
+    ------------------
+    deep copy of a cached definition, the copy is not indexed.
+    If with_templates is zero the template list is left empty.
+*/
+static cosDefinitions *
+cos_cache_dup_defn(cosDefinitions *pDef, int with_templates)
+{
+    cosDefinitions *theDef = (cosDefinitions *)slapi_ch_calloc(1, sizeof(cosDefinitions));
+
+    theDef->cosType = pDef->cosType;
+    theDef->pDn = cos_cache_dup_attrval_list(pDef->pDn);
+    theDef->pCosTargetTree = cos_cache_dup_attrval_list(pDef->pCosTargetTree);
+    theDef->pCosTemplateDn = cos_cache_dup_attrval_list(pDef->pCosTemplateDn);
+    theDef->pCosSpecifier = cos_cache_dup_attrval_list(pDef->pCosSpecifier);
+    theDef->pCosAttrs = cos_cache_dup_attrval_list(pDef->pCosAttrs);
+    theDef->pCosOverrides = cos_cache_dup_attrval_list(pDef->pCosOverrides);
+    theDef->pCosOperational = cos_cache_dup_attrval_list(pDef->pCosOperational);
+    theDef->pCosOpDefault = cos_cache_dup_attrval_list(pDef->pCosOpDefault);
+    theDef->pCosMerge = cos_cache_dup_attrval_list(pDef->pCosMerge);
+    if (with_templates)
+        theDef->pCosTmps = cos_cache_dup_tmpl_list(pDef->pCosTmps);
+
+    return theDef;
+}
+
+/*
+    cos_cache_build_incremental
+    ---------------------------
+    builds in pDefs a copy of the definitions of pOldCache where
+    the definitions using one of the templates in ppTmplDns get their
+    templates read again from the DIT, the other ones are copied
+    without any search.  A definition left without templates is
+    dropped, as cos_cache_add_defn would do.
+
+    A template that no cached definition uses may belong to a
+    definition that was dropped because it had no templates, only
+    a full rebuild can bring that definition back.
+
+    returns 0 on success, -1 if a full rebuild is needed.
+*/
+static int
+cos_cache_build_incremental(cosCache *pOldCache, char **ppTmplDns, cosDefinitions **pDefs)
+{
+    cosDefinitions *pDef;
+    int i;
+
+    slapi_log_err(SLAPI_LOG_TRACE, COS_PLUGIN_SUBSYSTEM, "--> cos_cache_build_incremental\n");
+
+    for (i = 0; ppTmplDns[i]; i++) {
+        char *ppOneDn[2] = {ppTmplDns[i], NULL};
+        int used = 0;
+
+        for (pDef = pOldCache->pDefs; pDef && !used; pDef = pDef->list.pNext) {
+            if (pDef->cosType != COSTYPE_INDIRECT && cos_cache_defn_uses_templates(pDef, ppOneDn))
+                used = 1;
+        }
+        if (!used) {
+            slapi_log_err(SLAPI_LOG_PLUGIN, COS_PLUGIN_SUBSYSTEM, "cos_cache_build_incremental - "
+                                                                  "Template %s is not used by a cached cos definition\n",
+                          ppTmplDns[i]);
+            slapi_log_err(SLAPI_LOG_TRACE, COS_PLUGIN_SUBSYSTEM, "<-- cos_cache_build_incremental\n");
+            return -1;
+        }
+    }
+
+    for (pDef = pOldCache->pDefs; pDef; pDef = pDef->list.pNext) {
+        cosDefinitions *theDef;
+
+        if (pDef->cosType != COSTYPE_INDIRECT && cos_cache_defn_uses_templates(pDef, ppTmplDns)) {
+            cosAttrValue *pTmpTmplDn;
+            int tmplCount = 0;
+
+            slapi_log_err(SLAPI_LOG_PLUGIN, COS_PLUGIN_SUBSYSTEM, "cos_cache_build_incremental - "
+                                                                  "Reloading templates of cosDefinition %s\n",
+                          pDef->pDn->val);
+
+            theDef = cos_cache_dup_defn(pDef, 0);
+            for (pTmpTmplDn = theDef->pCosTemplateDn; pTmpTmplDn; pTmpTmplDn = pTmpTmplDn->list.pNext) {
+                if (!cos_cache_add_dn_tmpls(pTmpTmplDn->val, theDef->pCosSpecifier, theDef->pCosAttrs, &(theDef->pCosTmps)))
+                    tmplCount++;
+            }
+
+            if (tmplCount == 0) {
+                slapi_log_err(SLAPI_LOG_ERR, COS_PLUGIN_SUBSYSTEM, "cos_cache_build_incremental - Skipping CoS Definition %s"
+                                                                   "--no CoS Templates found, which should be added before the CoS Definition.\n",
+                              theDef->pDn->val);
+                cos_cache_del_defn_list(&theDef);
+                continue;
+            }
+        } else {
+            theDef = cos_cache_dup_defn(pDef, 1);
+        }
+
+        cos_cache_add_ll_entry((void **)pDefs, theDef, NULL);
+    }
+
+    slapi_log_err(SLAPI_LOG_TRACE, COS_PLUGIN_SUBSYSTEM, "<-- cos_cache_build_incremental\n");
+    return *pDefs ? 0 : -1;
+}
+
 /*
     cos_cache_del_attrval_list
     --------------------------
@@ -1457,6 +1697,28 @@ cos_cache_del_attrval_list(cosAttrValue **pVal)
 }
 
 
+/*
+    cos_cache_dup_attrval_list
+    --------------------------
+    returns a copy of the list, in the same order
+*/
+static cosAttrValue *
+cos_cache_dup_attrval_list(cosAttrValue *pVal)
+{
+    cosAttrValue *pHead = NULL;
+    cosAttrValue **ppTail = &pHead;
+
+    for (; pVal; pVal = pVal->list.pNext) {
+        cosAttrValue *theVal = (cosAttrValue *)slapi_ch_calloc(1, sizeof(cosAttrValue));
+
+        theVal->val = slapi_ch_strdup(pVal->val);
+        *ppTail = theVal;
+        ppTail = (cosAttrValue **)&(theVal->list.pNext);
+    }
+
+    return pHead;
+}
+
 /*
     cos_cache_add_attrval
     ---------------------
@@ -1585,6 +1847,44 @@ cos_cache_add_ll_entry(void **attrval, void *theVal, int (*compare)(const void *
 }
 
 
+/*
+    cos_cache_pin
+    -------------
+    lock free acquisition of a reference to the current cache,
+    returns NULL if there is no cache.
+    We register in the reader slot of the epoch we read, then check
+    that the epoch did not move: cos_cache_publish bumps the epoch
+    after the swap and waits for the slot of the previous epoch to
+    drain, so while we are registered in the slot of the current
+    epoch the snapshot we load keeps the reference of the publisher
+    until we have taken our own. If the epoch moved, a publisher may
+    not wait for our slot any more, start again.
+*/
+static cosCache *
+cos_cache_pin(void)
+{
+    cosCache *pCurrent;
+    int32_t *pReaders;
+    uint64_t epoch;
+
+    for (;;) {
+        epoch = slapi_atomic_load_64(&cos_cache_epoch, __ATOMIC_SEQ_CST);
+        pReaders = &cos_cache_readers[epoch & 1];
+        slapi_atomic_incr_32(pReaders, __ATOMIC_SEQ_CST);
+        if (slapi_atomic_load_64(&cos_cache_epoch, __ATOMIC_SEQ_CST) == epoch)
+            break;
+        slapi_atomic_decr_32(pReaders, __ATOMIC_SEQ_CST);
+    }
+
+    pCurrent = __atomic_load_n(&pCache, __ATOMIC_SEQ_CST);
+    if (pCurrent)
+        slapi_atomic_incr_32(&(pCurrent->refCount), __ATOMIC_ACQ_REL);
+
+    slapi_atomic_decr_32(pReaders, __ATOMIC_SEQ_CST);
+
+    return pCurrent;
+}
+
 /*
     cos_cache_getref
     ----------------
@@ -1603,8 +1903,8 @@ cos_cache_getref(cos_cache **pptheCache)
         first_time = 0;
         /* first customer, create the cache */
         slapi_lock_mutex(change_lock);
-        if (pCache == NULL) {
-            if (cos_cache_creation_lock()) {
+        if (__atomic_load_n(&pCache, __ATOMIC_SEQ_CST) == NULL) {
+            if (cos_cache_creation_lock(NULL)) {
                 /* there was a problem or no COS definitions were found */
                 slapi_log_err(SLAPI_LOG_PLUGIN, COS_PLUGIN_SUBSYSTEM, "cos_cache_getref - No cos cache created\n");
             }
@@ -1612,15 +1912,9 @@ cos_cache_getref(cos_cache **pptheCache)
         slapi_unlock_mutex(change_lock);
     }
 
-    slapi_lock_mutex(cache_lock);
-
-    *ppCache = pCache;
-
-    if (pCache)
-        ret = ++((*ppCache)->refCount);
-
-    slapi_unlock_mutex(cache_lock);
-
+    *ppCache = cos_cache_pin();
+    if (*ppCache)
+        ret = slapi_atomic_load_32(&((*ppCache)->refCount), __ATOMIC_ACQUIRE);
 
     slapi_log_err(SLAPI_LOG_TRACE, COS_PLUGIN_SUBSYSTEM, "<-- cos_cache_getref\n");
     return ret;
@@ -1635,16 +1929,13 @@ int
 cos_cache_addref(cos_cache *ptheCache)
 {
     int ret = 0;
-    cosCache *pCache = (cosCache *)ptheCache;
+    cosCache *pTheCache = (cosCache *)ptheCache;
 
     slapi_log_err(SLAPI_LOG_TRACE, COS_PLUGIN_SUBSYSTEM, "--> cos_cache_addref\n");
 
-    slapi_lock_mutex(cache_lock);
-
-    if (pCache)
-        ret = ++(pCache->refCount);
-
-    slapi_unlock_mutex(cache_lock);
+    /* the caller holds a reference to this cache, it can not go away */
+    if (pTheCache)
+        ret = slapi_atomic_incr_32(&(pTheCache->refCount), __ATOMIC_ACQ_REL);
 
     slapi_log_err(SLAPI_LOG_TRACE, COS_PLUGIN_SUBSYSTEM, "<-- cos_cache_addref\n");
 
@@ -1662,66 +1953,28 @@ int
 cos_cache_release(cos_cache *ptheCache)
 {
     int ret = 0;
-    int destroy = 0;
     cosCache *pOldCache = (cosCache *)ptheCache;
 
     slapi_log_err(SLAPI_LOG_TRACE, COS_PLUGIN_SUBSYSTEM, "--> cos_cache_release\n");
 
-    slapi_lock_mutex(cache_lock);
-
-    if (pOldCache) {
-        ret = --(pOldCache->refCount);
-        if (ret == 0)
-            destroy = 1;
-    }
-
-    slapi_unlock_mutex(cache_lock);
-
-    if (destroy) {
-        cosDefinitions *pDef = pOldCache->pDefs;
+    if (pOldCache)
+        ret = slapi_atomic_decr_32(&(pOldCache->refCount), __ATOMIC_ACQ_REL);
 
+    if (pOldCache && ret == 0) {
         /* now is the first time it is
          * safe to assess whether
          * vattr caching can be turned on
          */
-        if (pCache && pCache->vattr_cacheable) {
+        if (slapi_atomic_load_32(&cos_cache_vattr_cacheable, __ATOMIC_ACQUIRE)) {
             slapi_vattrcache_cache_all();
         }
 
         /* destroy the cache here - no locking required, no references outstanding */
 
-        if (pDef)
+        if (pOldCache->pDefs)
             cos_cache_del_schema(pOldCache);
 
-        while (pDef) {
-            cosDefinitions *pTmpD = pDef;
-            cosTemplates *pCosTmps = pDef->pCosTmps;
-
-            while (pCosTmps) {
-                cosTemplates *pTmpT = pCosTmps;
-
-                pCosTmps = pCosTmps->list.pNext;
-
-                cos_cache_del_attr_list(&(pTmpT->pAttrs));
-                cos_cache_del_attrval_list(&(pTmpT->pObjectclasses));
-                cos_cache_del_attrval_list(&(pTmpT->pDn));
-                slapi_ch_free((void **)&(pTmpT->cosGrade));
-                slapi_ch_free((void **)&pTmpT);
-            }
-
-            pDef = pDef->list.pNext;
-
-            cos_cache_del_attrval_list(&(pTmpD->pDn));
-            cos_cache_del_attrval_list(&(pTmpD->pCosTargetTree));
-            cos_cache_del_attrval_list(&(pTmpD->pCosTemplateDn));
-            cos_cache_del_attrval_list(&(pTmpD->pCosSpecifier));
-            cos_cache_del_attrval_list(&(pTmpD->pCosAttrs));
-            cos_cache_del_attrval_list(&(pTmpD->pCosOverrides));
-            cos_cache_del_attrval_list(&(pTmpD->pCosOperational));
-            cos_cache_del_attrval_list(&(pTmpD->pCosMerge));
-            cos_cache_del_attrval_list(&(pTmpD->pCosOpDefault));
-            slapi_ch_free((void **)&pTmpD);
-        }
+        cos_cache_del_defn_list(&(pOldCache->pDefs));
 
         if (pOldCache->ppAttrIndex)
             slapi_ch_free((void **)&(pOldCache->ppAttrIndex));
@@ -1736,6 +1989,65 @@ cos_cache_release(cos_cache *ptheCache)
 }
 
 
+/*
+    cos_cache_del_tmpl_list
+    -----------------------
+    walk the template list deleting as we go
+*/
+static void
+cos_cache_del_tmpl_list(cosTemplates **pTmpls)
+{
+    while (*pTmpls) {
+        cosTemplates *pTmpT = *pTmpls;
+
+        *pTmpls = pTmpT->list.pNext;
+
+        cos_cache_del_attr_list(&(pTmpT->pAttrs));
+        cos_cache_del_attrval_list(&(pTmpT->pObjectclasses));
+        cos_cache_del_attrval_list(&(pTmpT->pDn));
+        slapi_ch_free((void **)&(pTmpT->cosGrade));
+        slapi_ch_free((void **)&pTmpT);
+    }
+}
+
+/*
+    cos_cache_del_defn_list
+    -----------------------
+    walk the definition list deleting the definitions
+    and their templates as we go
+*/
+static void
+cos_cache_del_defn_list(cosDefinitions **pDefs)
+{
+    while (*pDefs) {
+        cosDefinitions *pTmpD = *pDefs;
+
+        *pDefs = pTmpD->list.pNext;
+
+        cos_cache_del_tmpl_list(&(pTmpD->pCosTmps));
+
+        if (pTmpD->ppTargetSdns) {
+            int i;
+
+            for (i = 0; pTmpD->ppTargetSdns[i]; i++) {
+                slapi_sdn_free(&(pTmpD->ppTargetSdns[i]));
+            }
+            slapi_ch_free((void **)&(pTmpD->ppTargetSdns));
+        }
+        cos_cache_del_attrval_list(&(pTmpD->pDn));
+        cos_cache_del_attrval_list(&(pTmpD->pCosTargetTree));
+        cos_cache_del_attrval_list(&(pTmpD->pCosTemplateDn));
+        cos_cache_del_attrval_list(&(pTmpD->pCosSpecifier));
+        cos_cache_del_attrval_list(&(pTmpD->pCosAttrs));
+        cos_cache_del_attrval_list(&(pTmpD->pCosOverrides));
+        cos_cache_del_attrval_list(&(pTmpD->pCosOperational));
+        cos_cache_del_attrval_list(&(pTmpD->pCosMerge));
+        cos_cache_del_attrval_list(&(pTmpD->pCosOpDefault));
+        slapi_ch_free((void **)&pTmpD);
+    }
+}
+
+
 /*
     cos_cache_del_attr_list
     -----------------------
@@ -1750,6 +2062,7 @@ cos_cache_del_attr_list(cosAttributes **pAttrs)
         cosAttributes *pTmp = (*pAttrs)->list.pNext;
 
         cos_cache_del_attrval_list(&((*pAttrs)->pAttrValue));
+        slapi_valueset_free((*pAttrs)->pValues);
         slapi_ch_free((void **)&((*pAttrs)->pAttrName));
         slapi_ch_free((void **)&(*pAttrs));
         *pAttrs = pTmp;
@@ -1811,6 +2124,7 @@ cos_cache_add_attr(cosAttributes **pAttrs, char *name, cosAttrValue *val)
     if (theAttr) {
         theAttr->pAttrValue = val;
         theAttr->pObjectclasses = 0; /* schema issues come later */
+        theAttr->pValues = NULL;     /* so do the precomputed values */
         theAttr->pAttrName = slapi_ch_strdup(name);
         if (theAttr->pAttrName) {
             cos_cache_add_ll_entry((void **)pAttrs, theAttr, NULL);
@@ -1978,6 +2292,47 @@ done:
     return ret;
 }
 
+/*
+    cos_cache_dup_tmpl_list
+    -----------------------
+    returns a copy of the template list, in the same order.
+    The copies are not indexed: parent pointers, attribute flags,
+    objectclasses and precomputed values are set by cos_cache_index_all
+    and cos_cache_schema_build.
+*/
+static cosTemplates *
+cos_cache_dup_tmpl_list(cosTemplates *pTmpls)
+{
+    cosTemplates *pHead = NULL;
+    cosTemplates **ppTail = &pHead;
+
+    for (; pTmpls; pTmpls = pTmpls->list.pNext) {
+        cosTemplates *theTemp = (cosTemplates *)slapi_ch_calloc(1, sizeof(cosTemplates));
+        cosAttributes **ppAttrTail = &(theTemp->pAttrs);
+        cosAttributes *pAttr;
+
+        theTemp->pDn = cos_cache_dup_attrval_list(pTmpls->pDn);
+        theTemp->pObjectclasses = cos_cache_dup_attrval_list(pTmpls->pObjectclasses);
+        theTemp->cosGrade = slapi_ch_strdup(pTmpls->cosGrade);
+        theTemp->template_default = pTmpls->template_default;
+        theTemp->cosPriority = pTmpls->cosPriority;
+
+        for (pAttr = pTmpls->pAttrs; pAttr; pAttr = pAttr->list.pNext) {
+            cosAttributes *theAttr = (cosAttributes *)slapi_ch_calloc(1, sizeof(cosAttributes));
+
+            theAttr->pAttrName = slapi_ch_strdup(pAttr->pAttrName);
+            theAttr->pAttrValue = cos_cache_dup_attrval_list(pAttr->pAttrValue);
+            *ppAttrTail = theAttr;
+            ppAttrTail = (cosAttributes **)&(theAttr->list.pNext);
+        }
+
+        *ppTail = theTemp;
+        ppTail = (cosTemplates **)&(theTemp->list.pNext);
+    }
+
+    return pHead;
+}
+
 /*
     cos_cache_attrval_exists
     ------------------------
@@ -2177,6 +2532,10 @@ cos_cache_query_attr(cos_cache *ptheCache, vattr_context *context, Slapi_Entry *
     int using_default = 0;
     int entry_has_value = 0;
     int merge_mode = 0;
+    const Slapi_DN *pSdn = NULL;
+    cosSpecMemo specMemo[COS_SPEC_MEMO_SIZE];
+    int specMemoCount = 0;
+    int i;
 
     slapi_log_err(SLAPI_LOG_TRACE, COS_PLUGIN_SUBSYSTEM, "--> cos_cache_query_attr\n");
 
@@ -2236,7 +2595,8 @@ cos_cache_query_attr(cos_cache *ptheCache, vattr_context *context, Slapi_Entry *
         entry_has_value = 1;
 
     /** dn **/
-    pDn = slapi_entry_get_dn(e);
+    pSdn = slapi_entry_get_sdn_const(e);
+    pDn = (char *)slapi_sdn_get_dn(pSdn);
 
     if (pDn == 0) {
         slapi_log_err(SLAPI_LOG_ERR, COS_PLUGIN_SUBSYSTEM, "cos_cache_query_attr - Failed to get entry dn\n");
@@ -2244,8 +2604,6 @@ cos_cache_query_attr(cos_cache *ptheCache, vattr_context *context, Slapi_Entry *
         goto bail;
     }
 
-    slapi_dn_normalize(pDn);
-
     /** objectclasses **/
     if (pCache->ppAttrIndex[attr_index]->attr_operational == 0 && config_get_schemacheck() &&
         pCache->ppAttrIndex[attr_index]->attr_operational_default == 0) {
@@ -2275,6 +2633,7 @@ cos_cache_query_attr(cos_cache *ptheCache, vattr_context *context, Slapi_Entry *
         cosTemplates *pTemplate = (cosTemplates *)pAttr->pParent;
         cosDefinitions *pDef = (cosDefinitions *)pTemplate->pParent;
         cosAttrValue *pTargetTree = pDef->pCosTargetTree;
+        Slapi_DN **ppTargetSdn = pDef->ppTargetSdns;
 
         /* now for the tests */
 
@@ -2296,11 +2655,12 @@ cos_cache_query_attr(cos_cache *ptheCache, vattr_context *context, Slapi_Entry *
          * hits.  We only check if this entry is a child of the target tree(s). */
         while ((hit == 0 || merge_mode) && pTargetTree) {
             if (pTargetTree->val == 0 ||
-                slapi_dn_issuffix(pDn, pTargetTree->val) != 0 ||
+                slapi_sdn_issuffix(pSdn, *ppTargetSdn) != 0 ||
                 (views_api && views_entry_exists(views_api, pTargetTree->val, e)) /* might be in a view */
                 ) {
                 cosAttrValue *pSpec = pDef->pCosSpecifier;
                 Slapi_ValueSet *pAttrSpecs = 0;
+                int pAttrSpecsMemoized = 0;
 
 
                 /* Does this entry have a correct cosSpecifier? */
@@ -2310,10 +2670,30 @@ cos_cache_query_attr(cos_cache *ptheCache, vattr_context *context, Slapi_Entry *
                     int free_flags = 0;
 
                     if (pSpec && pSpec->val) {
-                        ret = slapi_vattr_values_get_sp(context, e, pSpec->val, &pAttrSpecs, &type_name_disposition, &actual_type_name, 0, &free_flags);
-                        /* MAB: We need to free actual_type_name here !!!
-                        XXX BAD--should use slapi_vattr_values_free() */
-                        slapi_ch_free((void **)&actual_type_name);
+                        /*
+                            the templates of a definition are spread over the
+                            attribute index, only read the specifier of the
+                            entry the first time we meet the definition
+                        */
+                        for (i = 0; i < specMemoCount && specMemo[i].pSpec != pSpec; i++)
+                            ;
+                        if (i < specMemoCount) {
+                            pAttrSpecs = specMemo[i].pValues;
+                        } else {
+                            if (pAttrSpecs && !pAttrSpecsMemoized)
+                                slapi_valueset_free(pAttrSpecs);
+                            pAttrSpecs = NULL;
+                            ret = slapi_vattr_values_get_sp(context, e, pSpec->val, &pAttrSpecs, &type_name_disposition, &actual_type_name, 0, &free_flags);
+                            /* MAB: We need to free actual_type_name here !!!
+                            XXX BAD--should use slapi_vattr_values_free() */
+                            slapi_ch_free((void **)&actual_type_name);
+                            if (specMemoCount < COS_SPEC_MEMO_SIZE) {
+                                specMemo[specMemoCount].pSpec = pSpec;
+                                specMemo[specMemoCount].pValues = pAttrSpecs;
+                                specMemoCount++;
+                            }
+                        }
+                        pAttrSpecsMemoized = (i < COS_SPEC_MEMO_SIZE);
                     }
 
                     if (pAttrSpecs || pDef->cosType == COSTYPE_POINTER) {
@@ -2443,7 +2823,8 @@ cos_cache_query_attr(cos_cache *ptheCache, vattr_context *context, Slapi_Entry *
 
                 /* MAB: We need to free pAttrSpecs here !!!
                 XXX BAD--should use slapi_vattr_values_free()*/
-                slapi_valueset_free(pAttrSpecs);
+                if (!pAttrSpecsMemoized)
+                    slapi_valueset_free(pAttrSpecs);
 
                 /* is the cosTemplate the default template? */
                 if (hit == 0 && pTemplate->template_default && !pDefAttr) {
@@ -2453,6 +2834,7 @@ cos_cache_query_attr(cos_cache *ptheCache, vattr_context *context, Slapi_Entry *
             }
 
             pTargetTree = pTargetTree->list.pNext;
+            ppTargetSdn++;
 
         } /* while(hit == 0 && pTargetTree) */
 
@@ -2517,6 +2899,9 @@ cos_cache_query_attr(cos_cache *ptheCache, vattr_context *context, Slapi_Entry *
     }
 
 bail:
+    for (i = 0; i < specMemoCount; i++) {
+        slapi_valueset_free(specMemo[i].pValues);
+    }
 
     slapi_log_err(SLAPI_LOG_TRACE, COS_PLUGIN_SUBSYSTEM, "<-- cos_cache_query_attr\n");
     return ret;
@@ -2752,6 +3137,22 @@ cos_cache_index_all(cosCache *pCache)
                         else
                             pAttrs->attr_operational_default = 0;
 
+                        /*
+                            the template values are returned for every entry
+                            the attribute is computed for, convert them once
+                            here rather than on each query (indirect schemes
+                            only have dummy values)
+                        */
+                        if (pAttrs->pValues == NULL && pDef->cosType != COSTYPE_INDIRECT) {
+                            cosAttrValue *pVal = pAttrs->pAttrValue;
+
+                            pAttrs->pValues = slapi_valueset_new();
+                            while (pVal) {
+                                slapi_valueset_add_value_ext(pAttrs->pValues, slapi_value_new_string(pVal->val), SLAPI_VALUE_FLAG_PASSIN);
+                                pVal = pVal->list.pNext;
+                            }
+                        }
+
                         attrcount++;
 
                         pAttrs = pAttrs->list.pNext;
@@ -2771,6 +3172,23 @@ cos_cache_index_all(cosCache *pCache)
                     this function however - right now we'll just
                     slap them in the list
                 */
+                /*
+                    and the target trees, so that an entry is matched
+                    against them without normalizing anything
+                */
+                if (pDef->ppTargetSdns == NULL) {
+                    int treeCount = 0;
+
+                    for (pAttrVal = pDef->pCosTargetTree; pAttrVal; pAttrVal = pAttrVal->list.pNext)
+                        treeCount++;
+
+                    pDef->ppTargetSdns = (Slapi_DN **)slapi_ch_calloc(treeCount + 1, sizeof(Slapi_DN *));
+                    treeCount = 0;
+                    for (pAttrVal = pDef->pCosTargetTree; pAttrVal; pAttrVal = pAttrVal->list.pNext) {
+                        pDef->ppTargetSdns[treeCount++] = pAttrVal->val ? slapi_sdn_new_dn_byval(pAttrVal->val) : slapi_sdn_new();
+                    }
+                }
+
                 pAttrVal = pDef->pCosTemplateDn;
 
                 while (pAttrVal) {
@@ -3109,6 +3527,12 @@ cos_cache_cos_2_slapi_valueset(cosAttributes *pAttr, Slapi_ValueSet **out_vs)
         if (!add_mode)
             slapi_valueset_init(*out_vs);
 
+        if (!add_mode && pAttr->pValues) {
+            /* the usual case, copy the values prepared at index time */
+            slapi_valueset_set_valueset(*out_vs, pAttr->pValues);
+            goto bail;
+        }
+
         while (pAttrVal) {
             Slapi_Value *val = slapi_value_new_string(pAttrVal->val);
             if (val) {
@@ -3171,6 +3595,8 @@ cos_cache_change_notify(Slapi_PBlock *pb)
     Slapi_Backend *be = NULL;
     int rc = 0;
     int optype = -1;
+    char **ppTmplDns = NULL;
+    int full_rebuild = 0;
 
     slapi_log_err(SLAPI_LOG_TRACE, COS_PLUGIN_SUBSYSTEM, "--> cos_cache_change_notify\n");
 
@@ -3199,7 +3625,9 @@ cos_cache_change_notify(Slapi_PBlock *pb)
      * For DELETE, MODIFY, MODRDN: see if the pre-op entry was cos significant.
      * For ADD, MODIFY, MODRDN: see if the post-op was cos significant.
      * Touching a cos significant entry triggers the update
-     * of the whole cache.
+     * of the cache: only the definitions using the template
+     * if the entry is a cosTemplate, the whole cache otherwise.
+     * A renamed template is noted under both dns.
     */
     slapi_pblock_get(pb, SLAPI_OPERATION_TYPE, &optype);
     if (optype == SLAPI_OPERATION_DELETE ||
@@ -3209,9 +3637,13 @@ cos_cache_change_notify(Slapi_PBlock *pb)
         slapi_pblock_get(pb, SLAPI_ENTRY_PRE_OP, &e);
         if (cos_cache_entry_is_cos_related(e)) {
             do_update = 1;
+            if (cos_cache_entry_is_cos_template(e))
+                slapi_ch_array_add(&ppTmplDns, slapi_ch_strdup(slapi_entry_get_ndn(e)));
+            else
+                full_rebuild = 1;
         }
     }
-    if (!do_update &&
+    if ((!do_update || optype == SLAPI_OPERATION_MODRDN) &&
         (optype == SLAPI_OPERATION_ADD ||
          optype == SLAPI_OPERATION_MODIFY ||
          optype == SLAPI_OPERATION_MODRDN)) {
@@ -3220,6 +3652,10 @@ cos_cache_change_notify(Slapi_PBlock *pb)
         slapi_pblock_get(pb, SLAPI_ENTRY_POST_OP, &e);
         if (cos_cache_entry_is_cos_related(e)) {
             do_update = 1;
+            if (cos_cache_entry_is_cos_template(e))
+                slapi_ch_array_add(&ppTmplDns, slapi_ch_strdup(slapi_entry_get_ndn(e)));
+            else
+                full_rebuild = 1;
         }
     }
 
@@ -3242,17 +3678,29 @@ cos_cache_change_notify(Slapi_PBlock *pb)
                                                               "Updating due to indirect template change(%s)\n",
                       dn);
         do_update = 1;
+        full_rebuild = 1;
     }
 
     /* Do the update if required */
     if (do_update) {
         slapi_lock_mutex(change_lock);
+        if (full_rebuild || ppTmplDns == NULL) {
+            cos_cache_full_rebuild = 1;
+        } else {
+            int i;
+
+            for (i = 0; ppTmplDns[i]; i++) {
+                slapi_ch_array_add(&cos_cache_pending_tmpl_dns, ppTmplDns[i]);
+                ppTmplDns[i] = NULL;
+            }
+        }
         slapi_notify_condvar(something_changed, 1);
         cos_cache_notify_flag = 1;
         slapi_unlock_mutex(change_lock);
     }
 
 bail:
+    slapi_ch_array_free(ppTmplDns);
     slapi_log_err(SLAPI_LOG_TRACE, COS_PLUGIN_SUBSYSTEM, "<-- cos_cache_change_notify\n");
 }
 
@@ -3278,9 +3726,9 @@ cos_cache_stop(void)
     slapi_lock_mutex(stop_lock);
 
     /* release the caches reference to the cache */
-    cos_cache_release(pCache);
-    slapi_destroy_mutex(cache_lock);
-    cache_lock = NULL;
+    cos_cache_release(cos_cache_publish(NULL));
+    slapi_ch_array_free(cos_cache_pending_tmpl_dns);
+    cos_cache_pending_tmpl_dns = NULL;
     slapi_destroy_mutex(change_lock);
     change_lock = NULL;
     slapi_destroy_condvar(something_changed);
@@ -3433,6 +3881,8 @@ cos_cache_backend_state_change(void *handle __attribute__((unused)),
                                int new_be_state __attribute__((unused)))
 {
     slapi_lock_mutex(change_lock);
+    cos_cache_full_rebuild = 1;
+    cos_cache_notify_flag = 1;
     slapi_notify_condvar(something_changed, 1);
     slapi_unlock_mutex(change_lock);
 }
@@ -3484,3 +3934,36 @@ cos_cache_entry_is_cos_related(Slapi_Entry *e)
     }
     return (rc);
 }
+
+/*
+ * returns non-zero: entry is a cosTemplate and not a cos definition.
+ *             0       : anything else (including NULL).
+ */
+static int
+cos_cache_entry_is_cos_template(Slapi_Entry *e)
+{
+    int is_template = 0;
+    int is_definition = 0;
+    Slapi_Attr *pObjclasses = NULL;
+    Slapi_Value *val = NULL;
+    int index;
+
+    if (e == NULL || slapi_entry_attr_find(e, "objectclass", &pObjclasses)) {
+        return 0;
+    }
+
+    for (index = slapi_attr_first_value(pObjclasses, &val);
+         index != -1 && val;
+         index = slapi_attr_next_value(pObjclasses, index, &val)) {
+        const char *pObj = slapi_value_get_string(val);
+
+        if (!strcasecmp(pObj, "costemplate")) {
+            is_template = 1;
+        } else if (!strcasecmp(pObj, "cosdefinition") ||
+                   !strcasecmp(pObj, "cossuperdefinition")) {
+            is_definition = 1;
+        }
+    }
+
+    return (is_template && !is_definition);
+}
@@ -40,6 +40,11 @@
 
 #define MAX_NESTED_ROLES 30
 
+/* Upper bound of the nsRole membership index, it is reset when reached */
+#define ROLES_INDEX_MAX_ENTRIES 100000
+#define ROLES_INDEX_HASH_INIT 0xcbf29ce484222325ULL
+#define ROLES_INDEX_HASH_PRIME 0x100000001b3ULL
+
 static char *allUserAttributes[] = {
     LDAP_ALL_USER_ATTRS,
     NULL};
@@ -89,6 +94,13 @@ typedef struct _roles_cache_def
      */
     Avlnode *avl_tree;
 
+    /* Attribute types the membership in these roles depends on, rebuilt
+       with the definitions (see roles_cache_index_types_build) */
+    char **index_types;       /* names and aliases */
+    uint32_t *index_typeids;  /* interned ids of index_types */
+    size_t index_ntypeids;
+    int index_all_types;      /* a role filter does not name its attribute */
+
     /* Next roles suffix definitions */
     struct _roles_cache_def *next;
 
@@ -105,6 +117,26 @@ static roles_cache_def *roles_list = NULL;
 
 static Slapi_RWLock *global_lock = NULL;
 
+/* nsRole membership of an entry, as recorded in the membership index */
+typedef struct _roles_cache_member
+{
+    char *ndn;           /* normalized dn of the entry (index key) */
+    uint64_t fingerprint; /* digest of the entry values the roles depend on */
+    int32_t watermark;   /* vattr cache watermark when the roles were evaluated */
+    char **role_ndns;    /* ndn of the roles the entry is member of, NULL if none */
+} roles_cache_member;
+
+/* Membership index: entry ndn -> roles_cache_member
+   Records are dropped when the entry is written, and the whole index is
+   flushed (and roles_index_generation bumped) when a role definition,
+   a view or a backend changes.
+   The fingerprint guards against entries evaluated from a copy that
+   does not match what was indexed (uncommitted or pending changes) */
+static PLHashTable *roles_index = NULL;
+static Slapi_RWLock *roles_index_lock = NULL;
+static uint64_t roles_index_generation = 0;
+static int32_t roles_index_count = 0;
+
 /* Structure holding the nsrole values */
 typedef struct _roles_cache_build_result
 {
@@ -112,6 +144,7 @@ typedef struct _roles_cache_build_result
     Slapi_Entry *requested_entry;   /* entry to get nsrole from */
     int has_value;                  /* flag to determine if a new value has been added to the result */
     int need_value;                 /* flag to determine if we need the result */
+    int cacheable;                  /* flag to determine if the result can be indexed */
     vattr_context *context;         /* vattr context */
 } roles_cache_build_result;
 
@@ -119,8 +152,9 @@ typedef struct _roles_cache_build_result
 typedef struct _roles_cache_search_in_nested
 {
     Slapi_Entry *is_entry_member_of;
-    int present; /* flag to know if the entry is part of a role */
-    int hint;    /* to check the depth of the nested */
+    int present;     /* flag to know if the entry is part of a role */
+    int hint;        /* to check the depth of the nested */
+    int uncacheable; /* the result depends on more than the entry itself */
 } roles_cache_search_in_nested;
 
 /* Structure used to handle roles searches */
@@ -152,7 +186,7 @@ static int roles_is_entry_member_of_object_ext(vattr_context *c, caddr_t data, c
 static int roles_check_managed(Slapi_Entry *entry_to_check, role_object *role, int *present);
 static int roles_check_filtered(vattr_context *c, Slapi_Entry *entry_to_check, role_object *role, int *present);
 static int roles_check_nested(caddr_t data, caddr_t arg);
-static int roles_is_inscope(Slapi_Entry *entry_to_check, role_object *this_role);
+static int roles_is_inscope(Slapi_Entry *entry_to_check, role_object *this_role, int *in_view);
 static void berval_set_string(struct berval *bv, const char *string);
 static void roles_cache_role_def_delete(roles_cache_def *role_def);
 static void roles_cache_role_def_free(roles_cache_def *role_def);
@@ -162,6 +196,20 @@ static int roles_cache_dump(caddr_t data, caddr_t arg);
 static int roles_cache_add_entry_cb(Slapi_Entry *e, void *callback_data);
 static void roles_cache_result_cb(int rc, void *callback_data);
 static Slapi_DN *roles_cache_get_top_suffix(Slapi_DN *suffix);
+static int roles_cache_candidate_filter_ext(Slapi_DN *role_dn, int hint, Slapi_Filter **filter);
+static int roles_cache_candidate_filter_nested(caddr_t data, caddr_t arg);
+static int roles_cache_index_init(void);
+static void roles_cache_index_add_type(roles_cache_def *suffix_def, const char *type);
+static void roles_cache_index_types_build(roles_cache_def *suffix_def);
+static void roles_cache_index_types_free(roles_cache_def *suffix_def);
+static uint64_t roles_cache_index_hash(uint64_t hash, const void *data, size_t len);
+static uint64_t roles_cache_index_fingerprint(roles_cache_def *suffix_def, Slapi_Entry *entry);
+static int roles_cache_index_lookup(roles_cache_def *suffix_def, Slapi_Entry *entry, uint64_t *fingerprint, char ***role_ndns);
+static void roles_cache_index_store(Slapi_Entry *entry, uint64_t generation, int32_t watermark, uint64_t fingerprint, char **role_ndns);
+static void roles_cache_index_invalidate(const char *ndn);
+static void roles_cache_index_flush(void);
+static void roles_cache_index_clear(void);
+static PRIntn roles_cache_index_free_member(PLHashEntry *he, PRIntn i, void *arg);
 
 /*     ============== FUNCTIONS ================ */
 
@@ -189,6 +237,12 @@ roles_cache_init()
         global_lock = slapi_new_rwlock();
     }
 
+    if (roles_cache_index_init() != 0) {
+        slapi_log_err(SLAPI_LOG_ERR, ROLES_PLUGIN_SUBSYSTEM,
+                      "roles_cache_init - Failed to create the membership index\n");
+        return (-1);
+    }
+
     /* grab the views interface */
     if (slapi_apib_get_interface(Views_v1_0_GUID, &views_api)) {
         /* lets be tolerant if views is disabled */
@@ -244,6 +298,9 @@ roles_cache_init()
         return (-1);
     }
 
+    /* Let the backends find the candidates of nsRole equality filters */
+    slapi_vattrspi_register_candidates(vattr_handle, roles_sp_candidates);
+
     slapi_log_err(SLAPI_LOG_PLUGIN, ROLES_PLUGIN_SUBSYSTEM, "<-- roles_cache_init\n");
     return rc;
 }
@@ -453,6 +510,7 @@ roles_cache_trigger_update_suffix(void *handle __attribute__((unused)), char *be
             sdn = slapi_get_next_suffix(&node, 0);
         }
         slapi_rwlock_unlock(global_lock);
+        roles_cache_index_flush();
         return;
     }
 
@@ -484,6 +542,7 @@ roles_cache_trigger_update_suffix(void *handle __attribute__((unused)), char *be
     }
 
     slapi_rwlock_unlock(global_lock);
+    roles_cache_index_flush();
 }
 
 /* roles_cache_trigger_update_role
@@ -594,6 +653,10 @@ roles_cache_update(roles_cache_def *suffix_to_update)
         }
         suffix_to_update->notified_entry = NULL;
     }
+
+    /* memberships computed with the previous definitions are stale */
+    roles_cache_index_types_build(suffix_to_update);
+    roles_cache_index_flush();
 done:
     slapi_rwlock_unlock(suffix_to_update->cache_lock);
     if (dn != NULL) {
@@ -634,6 +697,8 @@ roles_cache_stop()
     slapi_rwlock_unlock(global_lock);
     roles_list = NULL;
 
+    roles_cache_index_flush();
+
     slapi_log_err(SLAPI_LOG_PLUGIN, ROLES_PLUGIN_SUBSYSTEM, "<-- roles_cache_stop\n");
 }
 
@@ -800,6 +865,15 @@ roles_cache_change_notify(Slapi_PBlock *pb)
         return;
     }
 
+    /* The indexed membership of the written entry is no longer valid.
+       A modrdn moves the entry (and possibly a subtree) in or out of
+       role scopes, so drop the whole index in that case */
+    if (operation_get_type(pb_operation) == SLAPI_OPERATION_MODRDN) {
+        roles_cache_index_flush();
+    } else {
+        roles_cache_index_invalidate(slapi_sdn_get_ndn(sdn));
+    }
+
     if (operation != SLAPI_OPERATION_MODIFY) {
         if (roles_cache_is_role_entry(e) != 1) {
             slapi_log_err(SLAPI_LOG_PLUGIN, ROLES_PLUGIN_SUBSYSTEM, "<-- roles_cache_change_notify - Not a role entry\n");
@@ -942,6 +1016,10 @@ roles_cache_add_roles_from_suffix(Slapi_DN *suffix_dn, roles_cache_def *suffix_d
     slapi_pblock_destroy(int_search_pb);
     int_search_pb = NULL;
 
+    slapi_rwlock_wrlock(suffix_def->cache_lock);
+    roles_cache_index_types_build(suffix_def);
+    slapi_rwlock_unlock(suffix_def->cache_lock);
+
     if (info.rc == LDAP_SUCCESS) {
         rc = 0;
     }
@@ -1475,6 +1553,12 @@ roles_cache_listroles_ext(vattr_context *c, Slapi_Entry *entry, int return_value
     int rc = 0;
     roles_cache_build_result arg;
     Slapi_Backend *be = NULL;
+    Slapi_ValueSet *nsrole_values = NULL;
+    char **role_ndns = NULL;
+    uint64_t fingerprint = 0;
+    uint64_t generation = 0;
+    int32_t watermark = 0;
+    int has_value = 0;
 
     slapi_log_err(SLAPI_LOG_PLUGIN,
                   ROLES_PLUGIN_SUBSYSTEM, "--> roles_cache_listroles\n");
@@ -1486,8 +1570,7 @@ roles_cache_listroles_ext(vattr_context *c, Slapi_Entry *entry, int return_value
     }
 
     if (return_values) {
-        *valueset_out = (Slapi_ValueSet *)slapi_ch_calloc(1, sizeof(Slapi_ValueSet));
-        slapi_valueset_init(*valueset_out);
+        *valueset_out = NULL;
     }
 
     /* First get a list of all the in-scope roles */
@@ -1501,32 +1584,61 @@ roles_cache_listroles_ext(vattr_context *c, Slapi_Entry *entry, int return_value
     /* Traverse the tree checking if the entry has any of the roles */
     if (roles_cache != NULL) {
         if (roles_cache->avl_tree) {
-            arg.nsrole_values = valueset_out;
-            arg.need_value = return_values;
-            arg.requested_entry = entry;
-            arg.has_value = 0;
-            arg.context = c;
-
-            /* XXX really need a mutex for this read operation ? */
-            slapi_rwlock_rdlock(roles_cache->cache_lock);
-
-            avl_apply(roles_cache->avl_tree, (IFP)roles_cache_build_nsrole, &arg, -1, AVL_INORDER);
-
-            slapi_rwlock_unlock(roles_cache->cache_lock);
-
-            if (!arg.has_value) {
-                if (return_values) {
-                    slapi_valueset_free(*valueset_out);
-                    *valueset_out = NULL;
+            if (roles_cache_index_lookup(roles_cache, entry, &fingerprint, &role_ndns) == 0) {
+                /* The membership is already known */
+                has_value = (role_ndns != NULL);
+                if (has_value && return_values) {
+                    *valueset_out = slapi_valueset_new();
+                    for (size_t i = 0; role_ndns[i]; i++) {
+                        slapi_valueset_add_value_ext(*valueset_out,
+                                                     slapi_value_new_string(role_ndns[i]),
+                                                     SLAPI_VALUE_FLAG_PASSIN);
+                    }
                 }
+                slapi_ch_array_free(role_ndns);
+            } else {
+                /* Evaluate all the roles, even if the caller only needs to
+                   know there is one, so that the membership can be indexed */
+                generation = slapi_atomic_load_64(&roles_index_generation, __ATOMIC_ACQUIRE);
+                watermark = slapi_entrycache_vattrcache_watermark_get();
+
+                nsrole_values = slapi_valueset_new();
+                arg.nsrole_values = &nsrole_values;
+                arg.need_value = 1;
+                arg.requested_entry = entry;
+                arg.has_value = 0;
+                arg.cacheable = 1;
+                arg.context = c;
+
+                /* XXX really need a mutex for this read operation ? */
+                slapi_rwlock_rdlock(roles_cache->cache_lock);
+
+                avl_apply(roles_cache->avl_tree, (IFP)roles_cache_build_nsrole, &arg, -1, AVL_INORDER);
+
+                slapi_rwlock_unlock(roles_cache->cache_lock);
+
+                has_value = arg.has_value;
+                if (arg.cacheable) {
+                    Slapi_Value *value = NULL;
+                    int i;
+
+                    for (i = slapi_valueset_first_value(nsrole_values, &value);
+                         value != NULL;
+                         i = slapi_valueset_next_value(nsrole_values, i, &value)) {
+                        slapi_ch_array_add(&role_ndns, slapi_ch_strdup(slapi_value_get_string(value)));
+                    }
+                    roles_cache_index_store(entry, generation, watermark, fingerprint, role_ndns);
+                }
+                if (has_value && return_values) {
+                    *valueset_out = nsrole_values;
+                } else {
+                    slapi_valueset_free(nsrole_values);
+                }
+            }
+            if (!has_value) {
                 rc = -1;
             }
-            /* Free the list (we already did that) */
         } else {
-            if (return_values) {
-                slapi_valueset_free(*valueset_out);
-                *valueset_out = NULL;
-            }
             rc = -1;
         }
     } else {
@@ -1566,11 +1678,16 @@ roles_cache_build_nsrole(caddr_t data, caddr_t arg)
     get_nsrole.is_entry_member_of = result->requested_entry;
     get_nsrole.present = 0;
     get_nsrole.hint = 0;
+    get_nsrole.uncacheable = 0;
 
     tmprc = roles_is_entry_member_of_object_ext(result->context, (caddr_t)this_role, (caddr_t)&get_nsrole);
     if (SLAPI_VIRTUALATTRS_LOOP_DETECTED == tmprc) {
         /* all we want to detect and return is loop/stack overflow */
         rc = tmprc;
+        result->cacheable = 0;
+    }
+    if (get_nsrole.uncacheable) {
+        result->cacheable = 0;
     }
 
     /* If so, add its DN to the attribute */
@@ -1610,6 +1727,8 @@ roles_check(Slapi_Entry *entry_to_check, Slapi_DN *role_dn, int *present)
     roles_cache_def *roles_cache = NULL;
     role_object *this_role = NULL;
     roles_cache_search_in_nested get_nsrole;
+    char **role_ndns = NULL;
+    uint64_t fingerprint = 0;
 
     int rc = 0;
 
@@ -1640,19 +1759,132 @@ roles_check(Slapi_Entry *entry_to_check, Slapi_DN *role_dn, int *present)
     }
     /* End patch */
 
-    get_nsrole.is_entry_member_of = entry_to_check;
-    get_nsrole.present = 0;
-    get_nsrole.hint = 0;
-
-    roles_is_entry_member_of_object((caddr_t)this_role, (caddr_t)&get_nsrole);
-    *present = get_nsrole.present;
+    /* Answer from the membership index, building it if needed */
+    if (roles_cache_index_lookup(roles_cache, entry_to_check, &fingerprint, &role_ndns) != 0) {
+        roles_cache_listroles(entry_to_check, 0, NULL);
+        if (roles_cache_index_lookup(roles_cache, entry_to_check, &fingerprint, &role_ndns) != 0) {
+            /* Not indexable, evaluate that role only */
+            get_nsrole.is_entry_member_of = entry_to_check;
+            get_nsrole.present = 0;
+            get_nsrole.hint = 0;
+            get_nsrole.uncacheable = 0;
+
+            roles_is_entry_member_of_object((caddr_t)this_role, (caddr_t)&get_nsrole);
+            *present = get_nsrole.present;
+            goto done;
+        }
+    }
+    *present = charray_inlist(role_ndns, (char *)slapi_sdn_get_ndn(this_role->dn));
+    slapi_ch_array_free(role_ndns);
 
+done:
     slapi_log_err(SLAPI_LOG_PLUGIN,
                   ROLES_PLUGIN_SUBSYSTEM, "<-- roles_check\n");
 
     return rc;
 }
 
+/* Argument of roles_cache_candidate_filter_nested */
+typedef struct _roles_cache_candidate_arg
+{
+    int hint;             /* nesting level */
+    Slapi_Filter *filter; /* OR of the filters of the nested roles */
+} roles_cache_candidate_arg;
+
+/* roles_cache_candidate_filter
+   ----------------------------
+   Build a filter on stored attributes selecting (at least) the members of
+   a role, so that the backend can find the candidates of (nsRole=<role>)
+   in its indexes:
+     managed role  -> (nsRoleDN=<role>)
+     filtered role -> the role filter
+     nested role   -> OR of the filters of the nested roles
+   The scope of the roles is not taken into account, the candidates are
+   still tested against the search filter.
+    return 0: ok, *filter must be freed by the caller
+    return -1: fail
+ */
+int
+roles_cache_candidate_filter(Slapi_DN *role_dn, Slapi_Filter **filter)
+{
+    int rc;
+
+    *filter = NULL;
+
+    slapi_rwlock_rdlock(global_lock);
+    rc = roles_cache_candidate_filter_ext(role_dn, 0, filter);
+    slapi_rwlock_unlock(global_lock);
+
+    if (rc != 0) {
+        slapi_filter_free(*filter, 1);
+        *filter = NULL;
+    }
+    return rc;
+}
+
+static int
+roles_cache_candidate_filter_ext(Slapi_DN *role_dn, int hint, Slapi_Filter **filter)
+{
+    roles_cache_def *roles_cache = NULL;
+    role_object *this_role = NULL;
+    roles_cache_candidate_arg arg;
+    char *filter_str = NULL;
+
+    /* do not allow circular dependencies */
+    if (hint > MAX_NESTED_ROLES) {
+        return -1;
+    }
+
+    if (roles_cache_find_roles_in_suffix(role_dn, &roles_cache) == 0) {
+        this_role = (role_object *)avl_find(roles_cache->avl_tree, role_dn, (IFP)roles_cache_find_node);
+    }
+
+    if (this_role && (this_role->type == ROLE_TYPE_FILTERED)) {
+        if (this_role->filter == NULL) {
+            return -1;
+        }
+        *filter = slapi_filter_dup(this_role->filter);
+        return 0;
+    }
+
+    if (this_role && (this_role->type == ROLE_TYPE_NESTED)) {
+        arg.hint = hint + 1;
+        arg.filter = NULL;
+        if (avl_apply(this_role->avl_tree, (IFP)roles_cache_candidate_filter_nested, &arg, -1, AVL_INORDER) == -1) {
+            slapi_filter_free(arg.filter, 1);
+            return -1;
+        }
+        if (arg.filter) {
+            *filter = arg.filter;
+            return 0;
+        }
+        /* no nested role, fall back on the managed attribute */
+    }
+
+    /* Managed role, or a role that does not exist (no member at all) */
+    filter_str = slapi_filter_escape_filter_value(ROLE_MANAGED_ATTR_NAME,
+                                                  (char *)slapi_sdn_get_ndn(role_dn));
+    *filter = filter_str ? slapi_str2filter(filter_str) : NULL;
+    slapi_ch_free_string(&filter_str);
+
+    return (*filter ? 0 : -1);
+}
+
+static int
+roles_cache_candidate_filter_nested(caddr_t data, caddr_t arg)
+{
+    role_object_nested *current_nested_role = (role_object_nested *)data;
+    roles_cache_candidate_arg *candidate_arg = (roles_cache_candidate_arg *)arg;
+    Slapi_Filter *nested_filter = NULL;
+
+    if (roles_cache_candidate_filter_ext(current_nested_role->dn, candidate_arg->hint, &nested_filter) != 0) {
+        /* Stop traversal value */
+        return -1;
+    }
+    candidate_arg->filter = slapi_filter_join_ex(LDAP_FILTER_OR, candidate_arg->filter, nested_filter, 0);
+    return 0;
+}
+
 /* roles_cache_find_node:
    ---------------------
    Comparison function to add a new node in the avl tree
@@ -1747,7 +1979,7 @@ roles_is_entry_member_of_object_ext(vattr_context *c, caddr_t data, caddr_t argu
         goto done;
     }
 
-    if (!roles_is_inscope(entry_to_check, this_role)) {
+    if (!roles_is_inscope(entry_to_check, this_role, &get_nsrole->uncacheable)) {
         slapi_log_err(SLAPI_LOG_PLUGIN,
                       ROLES_PLUGIN_SUBSYSTEM, "roles_is_entry_member_of_object - Entry not in scope of role\n");
         return rc;
@@ -1917,7 +2149,7 @@ roles_check_nested(caddr_t data, caddr_t arg)
             return rc;
         }
         /* get the role_object data associated to that dn */
-        if (roles_is_inscope(get_nsrole->is_entry_member_of, this_role)) {
+        if (roles_is_inscope(get_nsrole->is_entry_member_of, this_role, &get_nsrole->uncacheable)) {
             /* The list of nested roles is contained in the role definition */
             roles_is_entry_member_of_object((caddr_t)this_role, (caddr_t)get_nsrole);
             if (get_nsrole->present == 1) {
@@ -1933,9 +2165,11 @@ roles_check_nested(caddr_t data, caddr_t arg)
 /* roles_is_inscope
    ----------------------
    Tells us if a presented role is in scope with respect to the presented entry
+   in_view is set if the entry is only in scope through a view, in that case
+   the result depends on the view definition and must not be indexed
  */
 static int
-roles_is_inscope(Slapi_Entry *entry_to_check, role_object *this_role)
+roles_is_inscope(Slapi_Entry *entry_to_check, role_object *this_role, int *in_view)
 {
     int rc;
 
@@ -1959,6 +2193,9 @@ roles_is_inscope(Slapi_Entry *entry_to_check, role_object *this_role)
     /* we need to check whether the entry would be returned by a view in scope */
     if (!rc && views_api) {
         rc = views_entry_exists(views_api, (char *)slapi_sdn_get_ndn(&role_parent), entry_to_check);
+        if (rc) {
+            *in_view = 1;
+        }
     }
 
     slapi_sdn_done(&role_parent);
@@ -2027,6 +2264,7 @@ roles_cache_role_def_free(roles_cache_def *role_def)
     slapi_lock_mutex(role_def->stop_lock);
 
     avl_free(role_def->avl_tree, (IFP)roles_cache_role_object_free);
+    roles_cache_index_types_free(role_def);
     slapi_sdn_free(&(role_def->suffix_dn));
     slapi_destroy_rwlock(role_def->cache_lock);
     role_def->cache_lock = NULL;
@@ -2131,3 +2369,360 @@ roles_cache_dump(caddr_t data, caddr_t arg __attribute__((unused)))
 
     return 0;
 }
+
+/* roles_cache_views_change_notify
+   -------------------------------
+   Called by the statechange plugin when a view definition changes:
+   entries may have moved in or out of the roles scopes
+ */
+void
+roles_cache_views_change_notify(Slapi_Entry *e __attribute__((unused)),
+                                char *dn __attribute__((unused)),
+                                int modtype __attribute__((unused)),
+                                Slapi_PBlock *pb __attribute__((unused)),
+                                void *caller_data __attribute__((unused)))
+{
+    roles_cache_index_flush();
+}
+
+/* roles_cache_index_init
+   ----------------------
+   Create the nsRole membership index
+    return 0: OK
+    return -1: fail
+ */
+static int
+roles_cache_index_init(void)
+{
+    if (roles_index_lock == NULL) {
+        roles_index_lock = slapi_new_rwlock();
+        if (roles_index_lock == NULL) {
+            return (-1);
+        }
+    }
+    if (roles_index == NULL) {
+        roles_index = PL_NewHashTable(0, PL_HashString, PL_CompareStrings,
+                                      PL_CompareValues, NULL, NULL);
+        if (roles_index == NULL) {
+            return (-1);
+        }
+    }
+    return (0);
+}
+
+/* roles_cache_index_add_type
+   --------------------------
+   Register a type, with its aliases, as a type the roles membership of the
+   entries of a suffix depends on
+ */
+static void
+roles_cache_index_add_type(roles_cache_def *suffix_def, const char *type)
+{
+    char buf[SLAPD_TYPICAL_ATTRIBUTE_NAME_MAX_LENGTH];
+    char *basetype = NULL;
+    struct asyntaxinfo *asi = NULL;
+    char **names = NULL;
+
+    basetype = slapi_attr_basetype(type, buf, sizeof(buf));
+    if (basetype == NULL) {
+        basetype = buf;
+    }
+    slapi_ch_array_add(&names, slapi_ch_strdup(basetype));
+    asi = attr_syntax_get_by_name(basetype, 0);
+    if (asi) {
+        slapi_ch_array_add(&names, slapi_ch_strdup(asi->asi_name));
+        for (size_t i = 0; asi->asi_aliases && asi->asi_aliases[i]; i++) {
+            slapi_ch_array_add(&names, slapi_ch_strdup(asi->asi_aliases[i]));
+        }
+        attr_syntax_return(asi);
+    }
+    if (basetype != buf) {
+        slapi_ch_free_string(&basetype);
+    }
+
+    for (size_t i = 0; names[i]; i++) {
+        uint32_t typeid;
+
+        if (charray_inlist(suffix_def->index_types, names[i])) {
+            continue;
+        }
+        slapi_ch_array_add(&suffix_def->index_types, slapi_ch_strdup(names[i]));
+        if ((typeid = attr_typeid_get(names[i])) != 0) {
+            suffix_def->index_typeids = (uint32_t *)slapi_ch_realloc((char *)suffix_def->index_typeids,
+                                                                     (suffix_def->index_ntypeids + 1) * sizeof(uint32_t));
+            suffix_def->index_typeids[suffix_def->index_ntypeids++] = typeid;
+        }
+    }
+    slapi_ch_array_free(names);
+}
+
+/* roles_cache_index_add_filter_type
+   ---------------------------------
+   slapi_filter_apply callback: register the type of a filter component
+ */
+static int
+roles_cache_index_add_filter_type(Slapi_Filter *f, void *arg)
+{
+    roles_cache_def *suffix_def = (roles_cache_def *)arg;
+    char *type = NULL;
+
+    if ((slapi_filter_get_attribute_type(f, &type) != 0) || (type == NULL)) {
+        /* e.g. an extensible filter matching any attribute */
+        suffix_def->index_all_types = 1;
+        return SLAPI_FILTER_SCAN_CONTINUE;
+    }
+    roles_cache_index_add_type(suffix_def, type);
+    return SLAPI_FILTER_SCAN_CONTINUE;
+}
+
+/* roles_cache_index_add_role_types
+   --------------------------------
+   avl_apply callback: register the types of the filter of a role
+ */
+static int
+roles_cache_index_add_role_types(caddr_t data, caddr_t arg)
+{
+    role_object *this_role = (role_object *)data;
+    int error_code = 0;
+
+    if ((this_role->type == ROLE_TYPE_FILTERED) && this_role->filter) {
+        slapi_filter_apply(this_role->filter, roles_cache_index_add_filter_type, arg, &error_code);
+    }
+    return 0;
+}
+
+/* roles_cache_index_types_build
+   -----------------------------
+   Compute the types the roles of a suffix depend on, once per update of
+   the definitions instead of at each fingerprint
+   Called with the cache_lock of the suffix held in write
+ */
+static void
+roles_cache_index_types_build(roles_cache_def *suffix_def)
+{
+    roles_cache_index_types_free(suffix_def);
+    /* managed and nested roles only depend on nsRoleDN */
+    roles_cache_index_add_type(suffix_def, ROLE_MANAGED_ATTR_NAME);
+    avl_apply(suffix_def->avl_tree, (IFP)roles_cache_index_add_role_types, (caddr_t)suffix_def, -1, AVL_INORDER);
+}
+
+static void
+roles_cache_index_types_free(roles_cache_def *suffix_def)
+{
+    slapi_ch_array_free(suffix_def->index_types);
+    suffix_def->index_types = NULL;
+    slapi_ch_free((void **)&suffix_def->index_typeids);
+    suffix_def->index_ntypeids = 0;
+    suffix_def->index_all_types = 0;
+}
+
+/* roles_cache_index_type_matters
+   ------------------------------
+   Whether the roles of the suffix depend on the values of an attribute
+ */
+static int
+roles_cache_index_type_matters(roles_cache_def *suffix_def, Slapi_Attr *attr)
+{
+    char buf[SLAPD_TYPICAL_ATTRIBUTE_NAME_MAX_LENGTH];
+    char *basetype = NULL;
+    int rc;
+
+    if (suffix_def->index_all_types) {
+        return 1;
+    }
+    if (attr->a_typeid != 0) {
+        /* the attribute has no option, its id is enough */
+        for (size_t i = 0; i < suffix_def->index_ntypeids; i++) {
+            if (suffix_def->index_typeids[i] == attr->a_typeid) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+    basetype = slapi_attr_basetype(attr->a_type, buf, sizeof(buf));
+    rc = charray_inlist(suffix_def->index_types, basetype ? basetype : buf);
+    slapi_ch_free_string(&basetype);
+    return rc;
+}
+
+static uint64_t
+roles_cache_index_hash(uint64_t hash, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= ROLES_INDEX_HASH_PRIME;
+    }
+    return hash;
+}
+
+/* roles_cache_index_fingerprint
+   -----------------------------
+   Digest of the values of the entry that the roles evaluation depends on
+   Called with the cache_lock of the suffix held
+ */
+static uint64_t
+roles_cache_index_fingerprint(roles_cache_def *suffix_def, Slapi_Entry *entry)
+{
+    uint64_t hash = ROLES_INDEX_HASH_INIT;
+    Slapi_Attr *attr = NULL;
+    Slapi_Value *value = NULL;
+    char *type = NULL;
+    int rc;
+    int i;
+
+    for (rc = slapi_entry_first_attr(entry, &attr);
+         (rc == 0) && attr;
+         rc = slapi_entry_next_attr(entry, attr, &attr)) {
+        if (!roles_cache_index_type_matters(suffix_def, attr)) {
+            continue;
+        }
+        slapi_attr_get_type(attr, &type);
+        hash = roles_cache_index_hash(hash, type, strlen(type) + 1);
+        for (i = slapi_attr_first_value(attr, &value);
+             i != -1;
+             i = slapi_attr_next_value(attr, i, &value)) {
+            const struct berval *bv = slapi_value_get_berval(value);
+
+            hash = roles_cache_index_hash(hash, &bv->bv_len, sizeof(bv->bv_len));
+            hash = roles_cache_index_hash(hash, bv->bv_val, bv->bv_len);
+        }
+    }
+    return hash;
+}
+
+/* roles_cache_index_lookup
+   ------------------------
+   Get the indexed roles of an entry. fingerprint is set in any case, to be
+   given back to roles_cache_index_store if the lookup fails
+    return 0: found, role_ndns is a copy of the roles ndn (NULL if none)
+    return -1: not indexed, or the record is stale
+ */
+static int
+roles_cache_index_lookup(roles_cache_def *suffix_def, Slapi_Entry *entry, uint64_t *fingerprint, char ***role_ndns)
+{
+    roles_cache_member *member = NULL;
+    int rc = -1;
+
+    *role_ndns = NULL;
+
+    slapi_rwlock_rdlock(suffix_def->cache_lock);
+    *fingerprint = roles_cache_index_fingerprint(suffix_def, entry);
+    slapi_rwlock_unlock(suffix_def->cache_lock);
+
+    slapi_rwlock_rdlock(roles_index_lock);
+    member = (roles_cache_member *)PL_HashTableLookupConst(roles_index,
+                                                           slapi_sdn_get_ndn(slapi_entry_get_sdn_const(entry)));
+    if (member &&
+        (member->fingerprint == *fingerprint) &&
+        (member->watermark == slapi_entrycache_vattrcache_watermark_get())) {
+        *role_ndns = slapi_ch_array_dup(member->role_ndns);
+        rc = 0;
+    }
+    slapi_rwlock_unlock(roles_index_lock);
+
+    return rc;
+}
+
+/* roles_cache_index_store
+   -----------------------
+   Record the roles of an entry, role_ndns is consumed
+   The result is dropped if the roles definitions changed since generation
+   was read, as it may have been computed with the previous definitions
+ */
+static void
+roles_cache_index_store(Slapi_Entry *entry, uint64_t generation, int32_t watermark, uint64_t fingerprint, char **role_ndns)
+{
+    const char *ndn = slapi_sdn_get_ndn(slapi_entry_get_sdn_const(entry));
+    roles_cache_member *member = NULL;
+
+    slapi_rwlock_wrlock(roles_index_lock);
+    if (generation != slapi_atomic_load_64(&roles_index_generation, __ATOMIC_ACQUIRE)) {
+        slapi_rwlock_unlock(roles_index_lock);
+        slapi_ch_array_free(role_ndns);
+        return;
+    }
+
+    member = (roles_cache_member *)PL_HashTableLookup(roles_index, ndn);
+    if (member == NULL) {
+        if (roles_index_count >= ROLES_INDEX_MAX_ENTRIES) {
+            roles_cache_index_clear();
+        }
+        member = (roles_cache_member *)slapi_ch_calloc(1, sizeof(roles_cache_member));
+        member->ndn = slapi_ch_strdup(ndn);
+        PL_HashTableAdd(roles_index, member->ndn, member);
+        roles_index_count++;
+    } else {
+        slapi_ch_array_free(member->role_ndns);
+    }
+    member->fingerprint = fingerprint;
+    member->watermark = watermark;
+    member->role_ndns = role_ndns;
+    slapi_rwlock_unlock(roles_index_lock);
+}
+
+/* roles_cache_index_invalidate
+   ----------------------------
+   Drop the record of an entry that has been written
+ */
+static void
+roles_cache_index_invalidate(const char *ndn)
+{
+    roles_cache_member *member = NULL;
+
+    if ((ndn == NULL) || (roles_index_lock == NULL)) {
+        return;
+    }
+
+    slapi_rwlock_wrlock(roles_index_lock);
+    member = (roles_cache_member *)PL_HashTableLookup(roles_index, ndn);
+    if (member) {
+        PL_HashTableRemove(roles_index, ndn);
+        roles_index_count--;
+        slapi_ch_array_free(member->role_ndns);
+        slapi_ch_free_string(&member->ndn);
+        slapi_ch_free((void **)&member);
+    }
+    slapi_rwlock_unlock(roles_index_lock);
+}
+
+/* roles_cache_index_flush
+   -----------------------
+   Drop every record and prevent the ones being computed from being stored
+ */
+static void
+roles_cache_index_flush(void)
+{
+    if (roles_index_lock == NULL) {
+        return;
+    }
+
+    slapi_rwlock_wrlock(roles_index_lock);
+    roles_cache_index_clear();
+    slapi_atomic_incr_64(&roles_index_generation, __ATOMIC_RELEASE);
+    slapi_rwlock_unlock(roles_index_lock);
+}
+
+/* roles_cache_index_clear
+   -----------------------
+   Called with roles_index_lock held in write
+ */
+static void
+roles_cache_index_clear(void)
+{
+    PL_HashTableEnumerateEntries(roles_index, roles_cache_index_free_member, NULL);
+    roles_index_count = 0;
+}
+
+static PRIntn
+roles_cache_index_free_member(PLHashEntry *he, PRIntn i __attribute__((unused)), void *arg __attribute__((unused)))
+{
+    roles_cache_member *member = (roles_cache_member *)he->value;
+
+    slapi_ch_array_free(member->role_ndns);
+    slapi_ch_free_string(&member->ndn);
+    slapi_ch_free((void **)&member);
+
+    return HT_ENUMERATE_NEXT | HT_ENUMERATE_REMOVE;
+}
@@ -49,6 +49,8 @@ int roles_cache_listroles(Slapi_Entry *entry, int return_value, Slapi_ValueSet *
 int roles_cache_listroles_ext(vattr_context *c, Slapi_Entry *entry, int return_value, Slapi_ValueSet **valueset_out);
 
 int roles_check(Slapi_Entry *entry_to_check, Slapi_DN *role_dn, int *present);
+int roles_cache_candidate_filter(Slapi_DN *role_dn, Slapi_Filter **filter);
+void roles_cache_views_change_notify(Slapi_Entry *e, char *dn, int modtype, Slapi_PBlock *pb, void *caller_data);
 
 /* From roles_plugin.c */
 int roles_init(Slapi_PBlock *pb);
@@ -58,6 +60,8 @@ int roles_sp_compare_value(vattr_sp_handle *handle, vattr_context *c, Slapi_Entr
 
 int roles_sp_list_types(vattr_sp_handle *handle, Slapi_Entry *e, vattr_type_list_context *type_context, int flags);
 
+int roles_sp_candidates(vattr_sp_handle *handle, Slapi_PBlock *pb, Slapi_Filter *f, Slapi_Filter **candidate_filter, void *hint);
+
 void *roles_get_plugin_identity(void);
 
 #endif /* _ROLES_CACHE_H */
@@ -27,6 +27,7 @@
 #define STATECHANGE_ROLES_ID "Roles"
 #define STATECHANGE_ROLES_CONFG_FILTER "objectclass=nsRoleDefinition"
 #define STATECHANGE_ROLES_ENTRY_FILTER "objectclass=*"
+#define STATECHANGE_ROLES_VIEWS_FILTER "objectclass=nsView"
 
 #define ROLES_PLUGIN_SUBSYSTEM "roles-plugin" /* for logging */
 static void *roles_plugin_identity = NULL;
@@ -188,6 +189,14 @@ roles_start(Slapi_PBlock *pb __attribute__((unused)))
                              STATECHANGE_ROLES_CONFG_FILTER,
                              &vattr_global_invalidate,
                              (notify_callback)statechange_vattr_cache_invalidator_callback(statechange_api));
+
+        /* views change the roles scopes, the membership index must follow */
+        statechange_register(statechange_api,
+                             STATECHANGE_ROLES_ID,
+                             NULL,
+                             STATECHANGE_ROLES_VIEWS_FILTER,
+                             NULL,
+                             roles_cache_views_change_notify);
     }
 
     slapi_log_err(SLAPI_LOG_PLUGIN, ROLES_PLUGIN_SUBSYSTEM,
@@ -215,6 +224,10 @@ roles_close(Slapi_PBlock *pb __attribute__((unused)))
                                NULL,
                                STATECHANGE_ROLES_CONFG_FILTER,
                                (notify_callback)statechange_vattr_cache_invalidator_callback(statechange_api));
+        statechange_unregister(statechange_api,
+                               NULL,
+                               STATECHANGE_ROLES_VIEWS_FILTER,
+                               roles_cache_views_change_notify);
     }
 
     slapi_log_err(SLAPI_LOG_PLUGIN, ROLES_PLUGIN_SUBSYSTEM,
@@ -320,6 +333,46 @@ roles_sp_list_types(vattr_sp_handle *handle __attribute__((unused)),
     return 0;
 }
 
+/*    roles_sp_candidates
+    -------------------
+    Give the backend a filter on stored attributes selecting the
+    candidates of (nsRole=<role dn>), see roles_cache_candidate_filter().
+    Presence filters can not be answered that way.
+ */
+
+int
+roles_sp_candidates(vattr_sp_handle *handle __attribute__((unused)),
+                    Slapi_PBlock *pb __attribute__((unused)),
+                    Slapi_Filter *f,
+                    Slapi_Filter **candidate_filter,
+                    void *hint __attribute__((unused)))
+{
+    char *type = NULL;
+    struct berval *bval = NULL;
+    char *role_dn_str = NULL;
+    Slapi_DN the_dn;
+    int rv;
+
+    if ((slapi_filter_get_choice(f) != LDAP_FILTER_EQUALITY) ||
+        (slapi_filter_get_ava(f, &type, &bval) != 0) ||
+        (bval == NULL) || (bval->bv_val == NULL)) {
+        return -1;
+    }
+
+    /* the assertion value is not guaranteed to be null terminated */
+    role_dn_str = slapi_ch_malloc(bval->bv_len + 1);
+    memcpy(role_dn_str, bval->bv_val, bval->bv_len);
+    role_dn_str[bval->bv_len] = '\0';
+    slapi_sdn_init_dn_byref(&the_dn, role_dn_str);
+
+    rv = roles_cache_candidate_filter(&the_dn, candidate_filter);
+
+    slapi_sdn_done(&the_dn);
+    slapi_ch_free_string(&role_dn_str);
+
+    return rv;
+}
+
 /* What do we do on shutdown ? */
 int
 roles_sp_cleanup(void)
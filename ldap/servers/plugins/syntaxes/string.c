@@ -28,6 +28,43 @@ static int string_filter_approx(struct berval *bvfilter,
                                 Slapi_Value **retVal);
 static void substring_comp_keys(Slapi_Value ***ivals, int *nsubs, char *str, int lenstring, int prepost, int syntax, char *comp_buf, int *substrlens);
 
+/*
+ * Return the normalized form of a value (leading blanks trimmed).
+ * It is computed once and kept with the value (only a marker if it is the
+ * value itself), so the values of the cached entries are not normalized
+ * again at each filter test (see value_set_norm).
+ * If it cannot be kept, it is returned in tmp, to be freed by the caller.
+ */
+static const struct berval *
+string_value_normalized(Slapi_Value *v, int syntax, struct berval *tmp)
+{
+    const struct berval *bvp = value_get_norm(v, syntax);
+    const struct berval *raw = slapi_value_get_berval(v);
+    char *alt = NULL;
+    char *c = NULL;
+
+    if (bvp) {
+        return bvp;
+    }
+    c = slapi_ch_malloc(raw->bv_len + 1);
+    memcpy(c, raw->bv_val, raw->bv_len);
+    c[raw->bv_len] = '\0';
+    /* 3rd arg: 1 - trim leading blanks */
+    value_normalize_ext(c, syntax, 1, &alt);
+    if (alt) {
+        slapi_ch_free_string(&c);
+        c = alt;
+    }
+    bvp = value_set_norm(v, syntax, c, strlen(c));
+    if (bvp) {
+        slapi_ch_free_string(&c);
+        return bvp;
+    }
+    tmp->bv_val = c;
+    tmp->bv_len = strlen(c);
+    return tmp;
+}
+
 int
 string_filter_ava(struct berval *bvfilter, Slapi_Value **bvals, int syntax, int ftype, Slapi_Value **retVal)
 {
@@ -62,15 +99,18 @@ string_filter_ava(struct berval *bvfilter, Slapi_Value **bvals, int syntax, int
     }
 
     for (i = 0; (bvals != NULL) && (bvals[i] != NULL); i++) {
-        int norm_val = 1; /* normalize the first value only */
+        struct berval tmp = {0, NULL};
+        const struct berval *bvp = slapi_value_get_berval(bvals[i]);
+
         /* if the NORMALIZED flag is set, skip normalizing */
-        if (slapi_value_get_flags(bvals[i]) & SLAPI_ATTR_FLAG_NORMALIZED) {
-            norm_val = 0;
+        if (!(slapi_value_get_flags(bvals[i]) & SLAPI_ATTR_FLAG_NORMALIZED)) {
+            bvp = string_value_normalized(bvals[i], syntax, &tmp);
         }
         /* note - do not return the normalized value in retVal - the
            caller will usually want the "raw" value, and can normalize it later
         */
-        rc = value_cmp((struct berval *)slapi_value_get_berval(bvals[i]), pbvfilter_norm, syntax, norm_val);
+        rc = value_cmp((struct berval *)bvp, pbvfilter_norm, syntax, 0);
+        slapi_ch_free_string(&tmp.bv_val);
         switch (ftype) {
         case LDAP_FILTER_GE:
             if (rc >= 0) {
@@ -189,18 +229,16 @@ string_filter_approx(struct berval *bvfilter, Slapi_Value **bvals, Slapi_Value *
 int
 string_filter_sub(Slapi_PBlock *pb, char *initial, char **any, char * final, Slapi_Value **bvals, int syntax)
 {
-    int i, j, rc, size = 0;
-    char *p, *end, *realval, *tmpbuf = NULL, *bigpat = NULL;
+    int i, j, rc;
+    char *realval, *tmpbuf = NULL;
     size_t tmpbufsize;
-    char pat[BUFSIZ];
     char buf[BUFSIZ];
     struct timespec expire_time = {0};
     Operation *op = NULL;
-    Slapi_Regex *re = NULL;
-    const char *re_result = NULL;
+    Slapi_Substring *ss = NULL;
     char *alt = NULL;
     int filter_normalized = 0;
-    int free_re = 1;
+    int free_ss = 1;
     struct subfilt *sf = NULL;
 
     slapi_log_err(SLAPI_LOG_TRACE, SYNTAX_PLUGIN_SUBSYSTEM, "=> string_filter_sub\n");
@@ -217,109 +255,49 @@ string_filter_sub(Slapi_PBlock *pb, char *initial, char **any, char * final, Sla
         slapi_pblock_get(pb, SLAPI_PLUGIN_SYNTAX_FILTER_DATA, &sf);
     }
     if (sf) {
-        re = (Slapi_Regex *)sf->sf_private;
-        if (re) {
-            free_re = 0;
+        /* compiled once per search by the backend */
+        ss = (Slapi_Substring *)sf->sf_private;
+        if (ss) {
+            free_ss = 0;
         }
     }
 
-    if (!re) {
+    if (!ss) {
         /*
-         * construct a regular expression corresponding to the
-         * filter and let regex do the work for each value
-         * XXX should do this once and save it somewhere XXX
+         * compile the substring assertion from the normalized components
          */
-        pat[0] = '\0';
-        p = pat;
-        end = pat + sizeof(pat) - 2; /* leave room for null */
-
-        if (initial != NULL) {
-            size = strlen(initial) + 1; /* add 1 for "^" */
-        }
-
-        if (any != NULL) {
-            i = 0;
-            while (any[i]) {
-                size += strlen(any[i++]) + 2; /* add 2 for ".*" */
-            }
-        }
-
-        if (final != NULL) {
-            size += strlen(final) + 3; /* add 3 for ".*" and "$" */
-        }
-
-        size *= 2; /* doubled in case all filter chars need escaping */
-        size++;    /* add 1 for null */
-
-        if (p + size > end) {
-            bigpat = slapi_ch_malloc(size);
-            p = bigpat;
-        }
+        char *ninitial = NULL;
+        char **nany = NULL;
+        char *nfinal = NULL;
 
         if (initial != NULL) {
             /* 3rd arg: 1 - trim leading blanks */
             if (!filter_normalized) {
                 value_normalize_ext(initial, syntax, 1, &alt);
             }
-            *p++ = '^';
-            if (alt) {
-                filter_strcpy_special_ext(p, alt, FILTER_STRCPY_ESCAPE_RECHARS);
-                slapi_ch_free_string(&alt);
-            } else {
-                filter_strcpy_special_ext(p, initial, FILTER_STRCPY_ESCAPE_RECHARS);
-            }
-            p = strchr(p, '\0');
+            ninitial = alt ? alt : slapi_ch_strdup(initial);
+            alt = NULL;
         }
-        if (any != NULL) {
-            for (i = 0; any[i] != NULL; i++) {
-                /* 3rd arg: 0 - DO NOT trim leading blanks */
-                if (!filter_normalized) {
-                    value_normalize_ext(any[i], syntax, 0, &alt);
-                }
-                /* ".*" + value */
-                *p++ = '.';
-                *p++ = '*';
-                if (alt) {
-                    filter_strcpy_special_ext(p, alt, FILTER_STRCPY_ESCAPE_RECHARS);
-                    slapi_ch_free_string(&alt);
-                } else {
-                    filter_strcpy_special_ext(p, any[i], FILTER_STRCPY_ESCAPE_RECHARS);
-                }
-                p = strchr(p, '\0');
+        for (i = 0; any != NULL && any[i] != NULL; i++) {
+            /* 3rd arg: 0 - DO NOT trim leading blanks */
+            if (!filter_normalized) {
+                value_normalize_ext(any[i], syntax, 0, &alt);
             }
+            charray_add(&nany, alt ? alt : slapi_ch_strdup(any[i]));
+            alt = NULL;
         }
         if (final != NULL) {
             /* 3rd arg: 0 - DO NOT trim leading blanks */
             if (!filter_normalized) {
                 value_normalize_ext(final, syntax, 0, &alt);
             }
-            /* ".*" + value */
-            *p++ = '.';
-            *p++ = '*';
-            if (alt) {
-                filter_strcpy_special_ext(p, alt, FILTER_STRCPY_ESCAPE_RECHARS);
-                slapi_ch_free_string(&alt);
-            } else {
-                filter_strcpy_special_ext(p, final, FILTER_STRCPY_ESCAPE_RECHARS);
-            }
-            strcat(p, "$");
-        }
-
-        /* compile the regex */
-        p = (bigpat) ? bigpat : pat;
-        tmpbuf = NULL;
-        re = slapi_re_comp(p, &re_result);
-        if (NULL == re) {
-            slapi_log_err(SLAPI_LOG_ERR, SYNTAX_PLUGIN_SUBSYSTEM,
-                          "string_filter_sub - re_comp (%s) failed (%s): %s\n",
-                          pat, p, re_result ? re_result : "unknown");
-            rc = LDAP_OPERATIONS_ERROR;
-            goto bailout;
-        } else if (slapi_is_loglevel_set(SLAPI_LOG_TRACE)) {
-            char ebuf[BUFSIZ];
-            slapi_log_err(SLAPI_LOG_TRACE, SYNTAX_PLUGIN_SUBSYSTEM,
-                          "string_filter_sub - re_comp (%s)\n", escape_string(p, ebuf));
+            nfinal = alt ? alt : slapi_ch_strdup(final);
+            alt = NULL;
         }
+        ss = slapi_substring_comp(ninitial, nany, nfinal);
+        slapi_ch_free_string(&ninitial);
+        charray_free(nany);
+        slapi_ch_free_string(&nfinal);
     }
 
     if (slapi_timespec_expire_check(&expire_time) == TIMER_EXPIRED) {
@@ -329,7 +307,7 @@ string_filter_sub(Slapi_PBlock *pb, char *initial, char **any, char * final, Sla
     }
 
     /*
-     * test the regex against each value
+     * test the assertion against each value
      */
     rc = -1;
     tmpbuf = NULL;
@@ -338,62 +316,68 @@ string_filter_sub(Slapi_PBlock *pb, char *initial, char **any, char * final, Sla
         int tmprc;
         size_t len;
         const struct berval *bvp = slapi_value_get_berval(bvals[j]);
+        const struct berval *normbv = NULL;
 
-        len = bvp->bv_len;
-        if (len < sizeof(buf)) {
-            realval = buf;
-            strcpy(realval, bvp->bv_val);
-        } else if (len < tmpbufsize) {
-            realval = tmpbuf;
-            strncpy(realval, bvp->bv_val, tmpbufsize);
-        } else {
-            tmpbufsize = len + 1;
-            realval = tmpbuf = (char *)slapi_ch_realloc(tmpbuf, tmpbufsize);
-            strncpy(realval, bvp->bv_val, tmpbufsize);
-        }
-        /* 3rd arg: 1 - trim leading blanks */
-        if (!(slapi_value_get_flags(bvals[j]) & SLAPI_ATTR_FLAG_NORMALIZED)) {
-            value_normalize_ext(realval, syntax, 1, &alt);
-        } else if (syntax & SYNTAX_DN) {
-            slapi_dn_ignore_case(realval);
+        if (slapi_timespec_expire_check(&expire_time) == TIMER_EXPIRED) {
+            slapi_log_err(SLAPI_LOG_TRACE, SYNTAX_PLUGIN_SUBSYSTEM, "LDAP_TIMELIMIT_EXCEEDED\n");
+            rc = LDAP_TIMELIMIT_EXCEEDED;
+            goto bailout;
         }
-        if (alt) {
-            if (slapi_timespec_expire_check(&expire_time) == TIMER_EXPIRED) {
-                slapi_log_err(SLAPI_LOG_TRACE, SYNTAX_PLUGIN_SUBSYSTEM, "LDAP_TIMELIMIT_EXCEEDED\n");
-                rc = LDAP_TIMELIMIT_EXCEEDED;
-                goto bailout;
-            }
-            tmprc = slapi_re_exec_nt(re, alt);
-            slapi_ch_free_string(&alt);
+        if ((slapi_value_get_flags(bvals[j]) & SLAPI_ATTR_FLAG_NORMALIZED) && !(syntax & SYNTAX_DN)) {
+            /* nothing to normalize, match the value in place */
+            realval = bvp->bv_val;
+            len = bvp->bv_len;
+        } else if (!(slapi_value_get_flags(bvals[j]) & SLAPI_ATTR_FLAG_NORMALIZED) &&
+                   (normbv = value_get_norm(bvals[j], syntax))) {
+            /* normalized by a previous filter test */
+            realval = normbv->bv_val;
+            len = normbv->bv_len;
         } else {
-            if (slapi_timespec_expire_check(&expire_time) == TIMER_EXPIRED) {
-                slapi_log_err(SLAPI_LOG_TRACE, SYNTAX_PLUGIN_SUBSYSTEM, "LDAP_TIMELIMIT_EXCEEDED\n");
-                rc = LDAP_TIMELIMIT_EXCEEDED;
-                goto bailout;
+            len = bvp->bv_len;
+            if (len < sizeof(buf)) {
+                realval = buf;
+                strcpy(realval, bvp->bv_val);
+            } else if (len < tmpbufsize) {
+                realval = tmpbuf;
+                strncpy(realval, bvp->bv_val, tmpbufsize);
+            } else {
+                tmpbufsize = len + 1;
+                realval = tmpbuf = (char *)slapi_ch_realloc(tmpbuf, tmpbufsize);
+                strncpy(realval, bvp->bv_val, tmpbufsize);
+            }
+            /* 3rd arg: 1 - trim leading blanks */
+            if (!(slapi_value_get_flags(bvals[j]) & SLAPI_ATTR_FLAG_NORMALIZED)) {
+                value_normalize_ext(realval, syntax, 1, &alt);
+                if (alt) {
+                    realval = alt;
+                }
+                len = strlen(realval);
+                /* keep it for the next filter tests */
+                value_set_norm(bvals[j], syntax, realval, len);
+            } else {
+                slapi_dn_ignore_case(realval);
+                len = strlen(realval);
             }
-            tmprc = slapi_re_exec_nt(re, realval);
         }
+        tmprc = slapi_substring_exec(ss, realval, len);
 
         if (slapi_is_loglevel_set(SLAPI_LOG_TRACE)) {
             char ebuf[BUFSIZ];
-            slapi_log_err(SLAPI_LOG_TRACE, SYNTAX_PLUGIN_SUBSYSTEM, "re_exec (%s) %i\n",
+            slapi_log_err(SLAPI_LOG_TRACE, SYNTAX_PLUGIN_SUBSYSTEM, "substring_exec (%s) %i\n",
                           escape_string(realval, ebuf), tmprc);
         }
+        slapi_ch_free_string(&alt);
         if (tmprc == 1) {
             rc = 0;
             break;
-        } else if (tmprc != 0) {
-            rc = tmprc;
-            break;
         }
     }
 bailout:
-    if (free_re) {
-        slapi_re_free(re);
+    if (free_ss) {
+        slapi_substring_free(&ss);
     }
     slapi_ch_free_string(&alt);
     slapi_ch_free((void **)&tmpbuf); /* NULL is fine */
-    slapi_ch_free((void **)&bigpat); /* NULL is fine */
 
     slapi_log_err(SLAPI_LOG_TRACE, SYNTAX_PLUGIN_SUBSYSTEM, "<= string_filter_sub %d\n", rc);
     return (rc);
@@ -406,7 +390,6 @@ string_values2keys(Slapi_PBlock *pb, Slapi_Value **bvals, Slapi_Value ***ivals,
     Slapi_Value **nbvals, **nbvlp;
     Slapi_Value **bvlp;
     char *w, *c, *p;
-    char *alt = NULL;
 
     if (NULL == ivals) {
         return 1;
@@ -426,28 +409,31 @@ string_values2keys(Slapi_PBlock *pb, Slapi_Value **bvals, Slapi_Value ***ivals,
 
         for (bvlp = bvals, nbvlp = nbvals; bvlp && *bvlp; bvlp++, nbvlp++) {
             unsigned long value_flags = slapi_value_get_flags(*bvlp);
-            c = slapi_ch_strdup(slapi_value_get_string(*bvlp));
             /* if the NORMALIZED flag is set, skip normalizing */
             if (!(value_flags & SLAPI_ATTR_FLAG_NORMALIZED)) {
-                /* 3rd arg: 1 - trim leading blanks */
-                value_normalize_ext(c, syntax, 1, &alt);
+                struct berval tmp = {0, NULL};
+                const struct berval *bvp = string_value_normalized(*bvlp, syntax, &tmp);
+                if (tmp.bv_val) {
+                    c = tmp.bv_val;
+                } else {
+                    c = slapi_ch_malloc(bvp->bv_len + 1);
+                    memcpy(c, bvp->bv_val, bvp->bv_len);
+                    c[bvp->bv_len] = '\0';
+                }
                 value_flags |= SLAPI_ATTR_FLAG_NORMALIZED;
             } else if ((syntax & SYNTAX_DN) &&
                        (value_flags & SLAPI_ATTR_FLAG_NORMALIZED_CES)) {
+                c = slapi_ch_strdup(slapi_value_get_string(*bvlp));
                 /* This dn value is normalized, but not case-normalized. */
                 slapi_dn_ignore_case(c);
                 /* This dn value is case-normalized */
                 value_flags &= ~SLAPI_ATTR_FLAG_NORMALIZED_CES;
                 value_flags |= SLAPI_ATTR_FLAG_NORMALIZED_CIS;
-            }
-            if (alt) {
-                slapi_ch_free_string(&c);
-                *nbvlp = slapi_value_new_string_passin(alt);
-                alt = NULL;
             } else {
-                *nbvlp = slapi_value_new_string_passin(c);
-                c = NULL;
+                c = slapi_ch_strdup(slapi_value_get_string(*bvlp));
             }
+            *nbvlp = slapi_value_new_string_passin(c);
+            c = NULL;
             /* new value is normalized */
             slapi_value_set_flags(*nbvlp, value_flags);
         }
@@ -488,7 +474,7 @@ string_values2keys(Slapi_PBlock *pb, Slapi_Value **bvals, Slapi_Value ***ivals,
         char *buf;
         int i;
         int *substrlens = NULL;
-        int localsublens[3] = {SUBBEGIN, SUBMIDDLE, SUBEND}; /* default values */
+        int localsublens[INDEX_SUBSTRLEN] = {SUBBEGIN, SUBMIDDLE, SUBEND, 0}; /* default values */
         int maxsublen;
         /*
           * Substring key has 3 types:
@@ -505,9 +491,13 @@ string_values2keys(Slapi_PBlock *pb, Slapi_Value **bvals, Slapi_Value ***ivals,
           * nsSubStrBegin: 2
           * nsSubStrMiddle: 3
           * nsSubStrEnd: 2
+          * nsSubStrPrefix: 1
           * [...]
           *
           * By default, begin == 3, middle == 3, end == 3 (defined in syntax.h)
+         * nsSubStrPrefix adds the shorter begin keys (e.g., *^a for a
+         * prefix of 1 and a begin of 3) so that short initial substrings
+         * are indexed too. It is 0 (off) by default.
          */
 
         /* If nsSubStrLen is specified in each index entry,
@@ -550,6 +540,12 @@ string_values2keys(Slapi_PBlock *pb, Slapi_Value **bvals, Slapi_Value ***ivals,
             nsubs += slapi_value_get_length(*bvlp) - substrlens[INDEX_SUBSTRMIDDLE] + 3;
         }
         nsubs += substrlens[INDEX_SUBSTRMIDDLE] * 2 - substrlens[INDEX_SUBSTRBEGIN] - substrlens[INDEX_SUBSTREND];
+        if (substrlens[INDEX_SUBSTRPREFIX] > 0 &&
+            substrlens[INDEX_SUBSTRPREFIX] < substrlens[INDEX_SUBSTRBEGIN] - 1) {
+            for (bvlp = bvals; bvlp && *bvlp; bvlp++) {
+                nsubs += substrlens[INDEX_SUBSTRBEGIN] - 1 - substrlens[INDEX_SUBSTRPREFIX];
+            }
+        }
         *ivals = (Slapi_Value **)slapi_ch_calloc((nsubs + 1), sizeof(Slapi_Value *));
 
         n = 0;
@@ -557,19 +553,9 @@ string_values2keys(Slapi_PBlock *pb, Slapi_Value **bvals, Slapi_Value ***ivals,
         bvdup = slapi_value_new();
         for (bvlp = bvals; bvlp && *bvlp; bvlp++) {
             unsigned long value_flags = slapi_value_get_flags(*bvlp);
-            /* 3rd arg: 1 - trim leading blanks */
+            struct berval tmp = {0, NULL};
             if (!(value_flags & SLAPI_ATTR_FLAG_NORMALIZED)) {
-                c = slapi_ch_strdup(slapi_value_get_string(*bvlp));
-                value_normalize_ext(c, syntax, 1, &alt);
-                if (alt) {
-                    slapi_ch_free_string(&c);
-                    slapi_value_set_string_passin(bvdup, alt);
-                    alt = NULL;
-                } else {
-                    slapi_value_set_string_passin(bvdup, c);
-                    c = NULL;
-                }
-                bvp = slapi_value_get_berval(bvdup);
+                bvp = string_value_normalized(*bvlp, syntax, &tmp);
                 value_flags |= SLAPI_ATTR_FLAG_NORMALIZED;
             } else if ((syntax & SYNTAX_DN) &&
                        (value_flags & SLAPI_ATTR_FLAG_NORMALIZED_CES)) {
@@ -598,6 +584,21 @@ string_values2keys(Slapi_PBlock *pb, Slapi_Value **bvals, Slapi_Value ***ivals,
                 n++;
             }
 
+            /* short leading, shorter than the begin keys */
+            if (substrlens[INDEX_SUBSTRPREFIX] > 0) {
+                int prefixlen;
+                for (prefixlen = substrlens[INDEX_SUBSTRPREFIX];
+                     prefixlen < substrlens[INDEX_SUBSTRBEGIN] - 1 && prefixlen <= bvp->bv_len;
+                     prefixlen++) {
+                    buf[0] = '^';
+                    memcpy(buf + 1, bvp->bv_val, prefixlen);
+                    buf[prefixlen + 1] = '\0';
+                    (*ivals)[n] = slapi_value_new_string(buf);
+                    slapi_value_set_flags((*ivals)[n], value_flags);
+                    n++;
+                }
+            }
+
             /* any */
             for (p = bvp->bv_val;
                  p < (bvp->bv_val + bvp->bv_len - substrlens[INDEX_SUBSTRMIDDLE] + 1);
@@ -623,6 +624,7 @@ string_values2keys(Slapi_PBlock *pb, Slapi_Value **bvals, Slapi_Value ***ivals,
                 slapi_value_set_flags((*ivals)[n], value_flags);
                 n++;
             }
+            slapi_ch_free_string(&tmp.bv_val);
         }
         slapi_value_free(&bvdup);
         slapi_ch_free_string(&buf);
@@ -755,7 +757,7 @@ string_assertion2keys_sub(
     int nsubs, i, len;
     int initiallen = 0, finallen = 0;
     int *substrlens = NULL;
-    int localsublens[3] = {SUBBEGIN, SUBMIDDLE, SUBEND}; /* default values */
+    int localsublens[INDEX_SUBSTRLEN] = {SUBBEGIN, SUBMIDDLE, SUBEND, 0}; /* default values */
     int maxsublen;
     char *comp_buf = NULL;
     /* altinit|any|final: store alt string from value_normalize_ext if any,
@@ -805,7 +807,8 @@ string_assertion2keys_sub(
             altinit = initial;
         }
         initiallen = strlen(altinit);
-        if (initiallen > substrlens[INDEX_SUBSTRBEGIN] - 2) {
+        if (initiallen > substrlens[INDEX_SUBSTRBEGIN] - 2 ||
+            (substrlens[INDEX_SUBSTRPREFIX] > 0 && initiallen >= substrlens[INDEX_SUBSTRPREFIX])) {
             nsubs += 1; /* for the initial begin string key */
             /* the rest of the sub keys are "any" keys for this case */
             if (initiallen >= substrlens[INDEX_SUBSTRMIDDLE]) {
@@ -920,6 +923,10 @@ substring_comp_keys(
     /* prepend ^ for initial substring */
     if (prepost == '^') {
         substrlen = substrlens[INDEX_SUBSTRBEGIN];
+        if (lenstring < substrlen - 1) {
+            /* short initial substring, only indexed with nsSubStrPrefix */
+            substrlen = lenstring + 1;
+        }
         comp_buf[0] = '^';
         for (i = 0; i < substrlen - 1; i++) {
             comp_buf[i + 1] = str[i];
@@ -42,6 +42,52 @@ utf8isspace_fast(char *s)
     return 0;
 }
 
+/*
+ * Fast path of value_normalize_ext for the runs of ASCII characters that
+ * are not spaces, which are most of the values: copy them (lower-cased if
+ * lower is set) from s to d, 8 bytes at a time, and return the number of
+ * bytes done. It stops at the first space, control, non-ASCII or '-' (if
+ * dash is set) byte and at end, the rest is left to the UTF-8 path.
+ * d may overlap s, as long as d <= s.
+ */
+#define BYTES(c) (0x0101010101010101ULL * (c))
+#define HAS_LESS(w, c) (((w) - BYTES(c)) & ~(w) & BYTES(0x80))
+#define HAS_ZERO(w) HAS_LESS(w, 1)
+
+static size_t
+value_normalize_ascii(const char *s, const char *end, char *d, int lower, int dash)
+{
+    const char *p = s;
+    uint64_t w;
+
+    while (p + sizeof(w) <= end) {
+        memcpy(&w, p, sizeof(w));
+        if ((w & BYTES(0x80)) || HAS_LESS(w, 0x21) || (dash && HAS_ZERO(w ^ BYTES('-')))) {
+            break;
+        }
+        if (lower) {
+            /* the high bit of each byte is set for 'A' <= c <= 'Z' */
+            uint64_t upper = (w + BYTES(0x80 - 'A')) & ~(w + BYTES(0x7f - 'Z')) & BYTES(0x80);
+            w |= upper >> 2;
+        }
+        memcpy(d, &w, sizeof(w));
+        p += sizeof(w);
+        d += sizeof(w);
+    }
+    for (; p < end; p++, d++) {
+        unsigned char c = *(unsigned char *)p;
+        if (c <= 0x20 || c >= 0x80 || (dash && c == '-')) {
+            break;
+        }
+        *d = (lower && c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    }
+    return p - s;
+}
+
+#undef BYTES
+#undef HAS_LESS
+#undef HAS_ZERO
+
 /*
 ** This function is used to normalizes search filter components,
 ** and attribute values.
@@ -71,6 +117,7 @@ value_normalize_ext(
     char **alt)
 {
     char *head = s;
+    char *end;
     char *d;
     int prevspace, curspace;
 
@@ -143,8 +190,16 @@ value_normalize_ext(
         *d = '\0';
         return;
     }
+    end = s + strlen(s);
     prevspace = 0;
     while (*s) {
+        size_t ascii = value_normalize_ascii(s, end, d, syntax & SYNTAX_CIS, syntax & SYNTAX_TEL);
+        if (ascii) {
+            s += ascii;
+            d += ascii;
+            prevspace = 0;
+            continue;
+        }
         curspace = utf8isspace_fast(s);
 
         /* ignore spaces and '-' in telephone numbers */
@@ -104,6 +104,11 @@ slapi_attr_type_cmp(const char *a1, const char *a2, int opt)
 {
     int rc = 0;
 
+    if (a1 == a2) {
+        /* e.g. both are the canonical name of an interned type */
+        return 0;
+    }
+
     switch (opt) {
     case SLAPI_TYPE_CMP_EXACT: /* compare base name + options as given */
         rc = strcasecmp(a1, a2);
@@ -315,6 +320,7 @@ slapi_attr_init_locking_optional(Slapi_Attr *a, const char *type, PRBool use_loc
         }
         if (NULL == asi) {
             a->a_type = attr_syntax_normalize_no_lookup(type);
+            a->a_typeid = attr_typeid_get(a->a_type);
             /*
              * no syntax for this type... return Octet String
              * syntax.  we accomplish this by looking up a well known
@@ -331,6 +337,7 @@ slapi_attr_init_locking_optional(Slapi_Attr *a, const char *type, PRBool use_loc
 
             if (NULL == attroptions) {
                 a->a_type = slapi_ch_strdup(asi->asi_name);
+                a->a_typeid = asi->asi_typeid;
             } else {
                 /*
                  * If the original type includes any attribute options,
@@ -342,6 +349,7 @@ slapi_attr_init_locking_optional(Slapi_Attr *a, const char *type, PRBool use_loc
 
                 normalized_options = attr_syntax_normalize_no_lookup(attroptions);
                 a->a_type = slapi_ch_smprintf("%s%s", asi->asi_name, normalized_options);
+                a->a_typeid = 0; /* subtypes are not interned */
                 slapi_ch_free_string(&normalized_options);
             }
         }
@@ -379,6 +387,7 @@ slapi_attr_init_nosyntax(Slapi_Attr *a, const char *type)
 {
 
     a->a_type = slapi_ch_strdup(type);
+    a->a_typeid = attr_typeid_get(type);
     slapi_valueset_init(&a->a_present_values);
     slapi_valueset_init(&a->a_deleted_values);
     a->a_listtofree = NULL;
@@ -612,6 +621,7 @@ slapi_attr_value_cmp(const Slapi_Attr *a, const struct berval *v1, const struct
     }
     cvals[0] = &tmpcval;
     cvals[0]->v_csnset = NULL;
+    cvals[0]->v_norm = NULL;
     cvals[0]->bv = *v1;
     cvals[0]->v_flags = 0;
     cvals[1] = NULL;
@@ -795,6 +805,7 @@ slapi_attr_set_type(Slapi_Attr *a, const char *type)
     } else {
         slapi_ch_free_string(&a->a_type);
         a->a_type = slapi_ch_strdup(type);
+        a->a_typeid = attr_typeid_get(type);
     }
     return rc;
 }
@@ -24,6 +24,21 @@ attrlist_free(Slapi_Attr *alist)
     }
 }
 
+/*
+ * Compares the type of an attribute with a type whose interned id
+ * (attr_typeid_get) is typeid. When both types are interned the ids
+ * are compared, otherwise the names.
+ * Returns non-zero if they are the same type.
+ */
+static inline int
+attrlist_type_eq(const Slapi_Attr *a, const char *type, uint32_t typeid)
+{
+    if (typeid && a->a_typeid) {
+        return a->a_typeid == typeid;
+    }
+    return strcasecmp(a->a_type, type) == 0;
+}
+
 /*
  * Search for the attribute.
  * If not found then create it,
@@ -41,8 +56,9 @@ attrlist_find_or_create_locking_optional(Slapi_Attr **alist, const char *type, S
 {
     int rc = 0; /* found */
     if (*a == NULL) {
+        uint32_t typeid = attr_typeid_get(type);
         for (*a = alist; **a != NULL; *a = &(**a)->a_next) {
-            if (strcasecmp((**a)->a_type, type) == 0) {
+            if (attrlist_type_eq(**a, type, typeid)) {
                 break;
             }
         }
@@ -108,8 +124,10 @@ attrlist_merge_valuearray(Slapi_Attr **alist, const char *type, Slapi_Value **va
 Slapi_Attr *
 attrlist_find(Slapi_Attr *a, const char *type)
 {
+    uint32_t typeid = attr_typeid_get(type);
+
     for (; a != NULL; a = a->a_next) {
-        if (strcasecmp(a->a_type, type) == 0) {
+        if (attrlist_type_eq(a, type, typeid)) {
             return (a);
         }
     }
@@ -159,6 +177,7 @@ attrlist_find_ex(
     void **hint)
 {
     Slapi_Attr **attr_cursor = (Slapi_Attr **)hint;
+    uint32_t typeid = attr_typeid_get(type);
 
     if (type_name_disposition)
         *type_name_disposition = 0;
@@ -171,12 +190,15 @@ attrlist_find_ex(
         *attr_cursor = (*attr_cursor)->a_next;
 
     while (*attr_cursor != NULL) {
+        /* Neither type has options if both are interned: same id is an exact match */
+        int interned = typeid && (*attr_cursor)->a_typeid;
 
         /* Determine whether the two types are related:*/
-        if (slapi_attr_type_cmp(type, (*attr_cursor)->a_type, SLAPI_TYPE_CMP_SUBTYPE) == 0) {
+        if (interned ? (typeid == (*attr_cursor)->a_typeid)
+                     : (slapi_attr_type_cmp(type, (*attr_cursor)->a_type, SLAPI_TYPE_CMP_SUBTYPE) == 0)) {
             /* We got a match. Now figure out if we matched because it was a subtype */
             if (type_name_disposition) {
-                if (0 == slapi_attr_type_cmp(type, (*attr_cursor)->a_type, SLAPI_TYPE_CMP_EXACT)) {
+                if (interned || 0 == slapi_attr_type_cmp(type, (*attr_cursor)->a_type, SLAPI_TYPE_CMP_EXACT)) {
                     *type_name_disposition = SLAPI_VIRTUALATTRS_TYPE_NAME_MATCHED_EXACTLY_OR_ALIAS;
                 } else {
                     *type_name_disposition = SLAPI_VIRTUALATTRS_TYPE_NAME_MATCHED_SUBTYPE;
@@ -205,8 +227,10 @@ attrlist_remove(Slapi_Attr **attrs, const char *type)
 {
     Slapi_Attr **a;
     Slapi_Attr *save = NULL;
+    uint32_t typeid = attr_typeid_get(type);
+
     for (a = attrs; *a != NULL; a = &(*a)->a_next) {
-        if (strcasecmp((*a)->a_type, type) == 0) {
+        if (attrlist_type_eq(*a, type, typeid)) {
             break;
         }
     }
@@ -236,9 +260,10 @@ attrlist_delete(Slapi_Attr **attrs, const char *type)
 {
     Slapi_Attr **a;
     Slapi_Attr *save;
+    uint32_t typeid = attr_typeid_get(type);
 
     for (a = attrs; *a != NULL; a = &(*a)->a_next) {
-        if (strcasecmp((*a)->a_type, type) == 0) {
+        if (attrlist_type_eq(*a, type, typeid)) {
             break;
         }
     }
@@ -70,6 +70,38 @@ static int asi_locking = 1;
 
 static struct asyntaxinfo *default_asi = NULL;
 
+/*
+ * Bumped each time the attribute types of the live tables change, so
+ * the callers caching what they resolved from the schema (the filter
+ * plans of the backends...) know when to drop it.
+ */
+static uint64_t attr_syntax_gen = 0;
+
+/*
+ * Interned attribute type names.
+ * Every name and alias of the schema attribute types gets a stable id and
+ * a canonical copy when it is added. They are never removed, so the ids
+ * remain valid across schema reloads, and lookups do not need any lock:
+ * a slot is published by setting its id last, and is never reused.
+ * Names are case insensitive, types with options are not interned.
+ * Only the attribute type compares use the ids: the syntax and matching
+ * rule lookups still go by name or oid (or through the plugins cached on
+ * the Slapi_Attr).
+ */
+#define ATTR_TYPEID_SLOTS 16384                        /* power of two */
+#define ATTR_TYPEID_MAX ((ATTR_TYPEID_SLOTS / 4) * 3) /* keep probe chains short */
+
+typedef struct attr_typeid_slot
+{
+    const char *ats_name;
+    int32_t ats_id; /* 0 while the slot is free */
+} attr_typeid_slot;
+
+static attr_typeid_slot attr_typeid_table[ATTR_TYPEID_SLOTS];
+static const char *attr_typeid_names[ATTR_TYPEID_MAX + 1]; /* id -> canonical name */
+static int32_t attr_typeid_count = 0;
+static pthread_mutex_t attr_typeid_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static void *attr_syntax_get_plugin_by_name_with_default(const char *type);
 static void attr_syntax_delete_no_lock(struct asyntaxinfo *asip,
                                        PRBool remove_from_oid_table,
@@ -420,11 +452,13 @@ attr_syntax_add_by_name(struct asyntaxinfo *a, PRUint32 schema_flags, int lock)
         attr_syntax_insert_tmp(a);
 
         PL_HashTableAdd(name2asi_tmp, a->asi_name, a);
+        a->asi_typeid = attr_typeid_intern(a->asi_name);
         if (a->asi_aliases != NULL) {
             int i;
 
             for (i = 0; a->asi_aliases[i] != NULL; ++i) {
                 PL_HashTableAdd(name2asi_tmp, a->asi_aliases[i], a);
+                attr_typeid_intern(a->asi_aliases[i]);
             }
         }
     } else {
@@ -435,20 +469,136 @@ attr_syntax_add_by_name(struct asyntaxinfo *a, PRUint32 schema_flags, int lock)
         attr_syntax_insert(a);
 
         PL_HashTableAdd(name2asi, a->asi_name, a);
+        a->asi_typeid = attr_typeid_intern(a->asi_name);
         if (a->asi_aliases != NULL) {
             int i;
 
             for (i = 0; a->asi_aliases[i] != NULL; ++i) {
                 PL_HashTableAdd(name2asi, a->asi_aliases[i], a);
+                attr_typeid_intern(a->asi_aliases[i]);
             }
         }
 
+        slapi_atomic_incr_64(&attr_syntax_gen, __ATOMIC_RELEASE);
         if (lock) {
             AS_UNLOCK_WRITE(name2asi_lock);
         }
     }
 }
 
+/*
+ * Case insensitive (ASCII) hash of an attribute type.
+ * *has_options is set if the type has options.
+ */
+static uint32_t
+attr_typeid_hash(const char *type, int *has_options)
+{
+    uint32_t hash = 2166136261U; /* FNV-1a */
+
+    *has_options = 0;
+    for (; *type; type++) {
+        unsigned char c = (unsigned char)*type;
+        if (c == ';') {
+            *has_options = 1;
+            return 0;
+        }
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        hash ^= c;
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/*
+ * Returns the id of an interned attribute type, or 0 if the type is not
+ * interned (not in the schema, or with options). Does not lock.
+ */
+uint32_t
+attr_typeid_get(const char *type)
+{
+    int has_options;
+    uint32_t hash;
+    uint32_t i;
+
+    if (NULL == type) {
+        return 0;
+    }
+    hash = attr_typeid_hash(type, &has_options);
+    if (has_options) {
+        return 0;
+    }
+    /* The table is never full, so we always end on a free slot */
+    for (i = hash & (ATTR_TYPEID_SLOTS - 1);; i = (i + 1) & (ATTR_TYPEID_SLOTS - 1)) {
+        int32_t id = slapi_atomic_load_32(&(attr_typeid_table[i].ats_id), __ATOMIC_ACQUIRE);
+        if (id == 0) {
+            return 0;
+        }
+        if (strcasecmp(attr_typeid_table[i].ats_name, type) == 0) {
+            return (uint32_t)id;
+        }
+    }
+}
+
+/*
+ * Interns an attribute type name and returns its id, 0 if it can not be
+ * interned (options, or too many names).
+ */
+uint32_t
+attr_typeid_intern(const char *name)
+{
+    int has_options;
+    uint32_t hash;
+    uint32_t i;
+    int32_t id;
+
+    if (NULL == name) {
+        return 0;
+    }
+    hash = attr_typeid_hash(name, &has_options);
+    if (has_options) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&attr_typeid_lock);
+    for (i = hash & (ATTR_TYPEID_SLOTS - 1);; i = (i + 1) & (ATTR_TYPEID_SLOTS - 1)) {
+        id = attr_typeid_table[i].ats_id;
+        if (id == 0) {
+            break;
+        }
+        if (strcasecmp(attr_typeid_table[i].ats_name, name) == 0) {
+            pthread_mutex_unlock(&attr_typeid_lock);
+            return (uint32_t)id;
+        }
+    }
+    if (attr_typeid_count >= ATTR_TYPEID_MAX) {
+        pthread_mutex_unlock(&attr_typeid_lock);
+        slapi_log_err(SLAPI_LOG_WARNING, "attr_typeid_intern",
+                      "Too many attribute type names, %s is not interned\n", name);
+        return 0;
+    }
+    id = attr_typeid_count + 1;
+    attr_typeid_names[id] = slapi_ch_strdup(name);
+    attr_typeid_table[i].ats_name = attr_typeid_names[id];
+    /* publish the slot, then the name */
+    slapi_atomic_store_32(&(attr_typeid_table[i].ats_id), id, __ATOMIC_RELEASE);
+    slapi_atomic_store_32(&attr_typeid_count, id, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&attr_typeid_lock);
+
+    return (uint32_t)id;
+}
+
+/* Returns the canonical name of an interned attribute type */
+const char *
+attr_typeid_name(uint32_t typeid)
+{
+    if ((typeid == 0) || (typeid > (uint32_t)slapi_atomic_load_32(&attr_typeid_count, __ATOMIC_ACQUIRE))) {
+        return NULL;
+    }
+    return attr_typeid_names[typeid];
+}
+
 
 /*
  * Delete the attribute syntax and all entries corresponding to aliases
@@ -501,6 +651,7 @@ attr_syntax_delete_no_lock(struct asyntaxinfo *asi,
             ht = name2asi_tmp;
         } else {
             ht = name2asi;
+            slapi_atomic_incr_64(&attr_syntax_gen, __ATOMIC_RELEASE);
         }
         PL_HashTableRemove(ht, asi->asi_name);
         if (asi->asi_aliases != NULL) {
@@ -1661,4 +1812,14 @@ attr_syntax_swap_ht()
     oid2asi_tmp = NULL;
     global_at = global_at_tmp;
     global_at_tmp = NULL;
+    slapi_atomic_incr_64(&attr_syntax_gen, __ATOMIC_RELEASE);
+}
+
+/*
+ * Returns the generation of the attribute types, see attr_syntax_gen.
+ */
+uint64_t
+attr_syntax_generation(void)
+{
+    return slapi_atomic_load_64(&attr_syntax_gen, __ATOMIC_ACQUIRE);
 }
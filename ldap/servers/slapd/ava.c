@@ -35,6 +35,7 @@ get_ava(
     ava->ava_type = slapi_attr_syntax_normalize(type);
     slapi_ch_free_string(&type);
     ava->ava_private = NULL;
+    ava->ava_summary = 0;
 
     return (0);
 }
@@ -64,6 +65,7 @@ rdn2ava(
     ava->ava_value.bv_val = s;
     ava->ava_value.bv_len = strlen(s);
     ava->ava_private = NULL;
+    ava->ava_summary = 0;
 
     return (0);
 }
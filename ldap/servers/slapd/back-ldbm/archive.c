@@ -15,6 +15,56 @@
 
 #include "back-ldbm.h"
 #include "dblayer.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define ARCHIVE_NOT_A_STREAM -1
+#define ARCHIVE_STREAM_ERROR -2
+
+/*
+ * A backup is streamed instead of being stored in a directory when the
+ * archive is "-" (standard output or input, from the command line only),
+ * a named pipe, or a unix socket.
+ * Returns the file descriptor of the stream, ARCHIVE_NOT_A_STREAM or ARCHIVE_STREAM_ERROR
+ */
+static int
+ldbm_archive_open_stream(char *rawarchive, char *archive, int forwrite, int run_from_cmdline, Slapi_Task *task)
+{
+    struct sockaddr_un addr = {0};
+    struct stat sbuf;
+    int fd = -1;
+
+    if (run_from_cmdline && strcmp(rawarchive, "-") == 0) {
+        fd = dup(forwrite ? STDOUT_FILENO : STDIN_FILENO);
+    } else if (stat(archive, &sbuf) || !(S_ISFIFO(sbuf.st_mode) || S_ISSOCK(sbuf.st_mode))) {
+        return ARCHIVE_NOT_A_STREAM;
+    } else if (S_ISFIFO(sbuf.st_mode)) {
+        fd = open(archive, forwrite ? O_WRONLY : O_RDONLY);
+    } else if (strlen(archive) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+    } else {
+        addr.sun_family = AF_UNIX;
+        PL_strncpyz(addr.sun_path, archive, sizeof(addr.sun_path));
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+            int err = errno;
+            close(fd);
+            fd = -1;
+            errno = err;
+        }
+    }
+    if (fd < 0) {
+        int err = errno;
+        slapi_log_err(SLAPI_LOG_ERR, "ldbm_archive_open_stream", "Failed to open backup stream %s: %s (%d)\n",
+                      rawarchive, slapd_system_strerror(err), err);
+        if (task) {
+            slapi_task_log_notice(task, "Failed to open backup stream %s: %s (%d)",
+                                  rawarchive, slapd_system_strerror(err), err);
+        }
+        return ARCHIVE_STREAM_ERROR;
+    }
+    return fd;
+}
 
 int
 ldbm_temporary_close_all_instances(Slapi_PBlock *pb)
@@ -78,6 +128,7 @@ ldbm_temporary_close_all_instances(Slapi_PBlock *pb)
         if (entryrdn_get_switch()) {
             cache_clear(&inst->inst_dncache, CACHE_TYPE_DN);
         }
+        search_cache_flush(inst);
     }
     plugin_call_plugins(pb, SLAPI_PLUGIN_BE_PRE_CLOSE_FN);
     /* now we know nobody's using any of the backend instances, so we
@@ -155,6 +206,7 @@ ldbm_back_archive2ldbm(Slapi_PBlock *pb)
     int32_t task_flags = 0;
     int32_t run_from_cmdline = 0;
     int32_t is_old_to_new = 0;
+    int stream_fd = ARCHIVE_NOT_A_STREAM;
 
     slapi_pblock_get(pb, SLAPI_PLUGIN_PRIVATE, &li);
     slapi_pblock_get(pb, SLAPI_SEQ_VAL, &rawdirectory);
@@ -229,7 +281,14 @@ ldbm_back_archive2ldbm(Slapi_PBlock *pb)
     }
 
     /* tell the database to restore */
-    return_value = dblayer_restore(li, directory, task);
+    stream_fd = ldbm_archive_open_stream(rawdirectory, directory, 0, run_from_cmdline, task);
+    if (stream_fd == ARCHIVE_STREAM_ERROR) {
+        return_value = -1;
+    } else if (stream_fd != ARCHIVE_NOT_A_STREAM) {
+        return_value = dblayer_restore_stream(li, stream_fd, task);
+    } else {
+        return_value = dblayer_restore(li, directory, task);
+    }
     if (0 != return_value) {
         slapi_log_err(SLAPI_LOG_ERR,
                       "ldbm_back_archive2ldbm", "Failed to read backup file set. "
@@ -321,6 +380,9 @@ out:
     if (priv && run_from_cmdline && (0 == return_value)) {
         priv->dblayer_restore_file_update_fn(li, directory);
     }
+    if (stream_fd >= 0) {
+        close(stream_fd);
+    }
     slapi_ch_free_string(&directory);
     return return_value;
 }
@@ -332,6 +394,10 @@ ldbm_back_ldbm2archive(Slapi_PBlock *pb)
     char *rawdirectory = NULL; /* -a <directory> */
     char *directory = NULL;    /* normalized */
     char *dir_bak = NULL;
+    char *rawbase = NULL; /* previous backup of an incremental backup */
+    char *base = NULL;    /* normalized */
+    int stream_fd = ARCHIVE_NOT_A_STREAM;
+    int compact = 0;
     int return_value = -1;
     int task_flags = 0;
     int run_from_cmdline = 0;
@@ -340,6 +406,8 @@ ldbm_back_ldbm2archive(Slapi_PBlock *pb)
 
     slapi_pblock_get(pb, SLAPI_PLUGIN_PRIVATE, &li);
     slapi_pblock_get(pb, SLAPI_SEQ_VAL, &rawdirectory);
+    slapi_pblock_get(pb, SLAPI_DB2ARCHIVE_BASE, &rawbase);
+    slapi_pblock_get(pb, SLAPI_DB2ARCHIVE_COMPACT, &compact);
     slapi_pblock_get(pb, SLAPI_TASK_FLAGS, &task_flags);
     li->li_flags = run_from_cmdline = (task_flags & SLAPI_TASK_RUNNING_FROM_COMMANDLINE);
 
@@ -377,7 +445,35 @@ ldbm_back_ldbm2archive(Slapi_PBlock *pb)
     /* Initialize directory */
     directory = rel2abspath(rawdirectory);
 
-    if (stat(directory, &sbuf) == 0) {
+    if (rawbase && *rawbase) {
+        base = rel2abspath(rawbase);
+        /* the existing archive directory is moved away before the backup */
+        if (slapd_comp_path(base, directory) == 0) {
+            slapi_log_err(SLAPI_LOG_ERR, "ldbm_back_ldbm2archive",
+                          "An incremental backup cannot replace its base backup %s.\n", base);
+            if (task) {
+                slapi_task_log_notice(task,
+                                      "An incremental backup cannot replace its base backup %s.", base);
+            }
+            return_value = -1;
+            goto out;
+        }
+    }
+
+    /* A stream is directly written: there is no archive directory to prepare */
+    stream_fd = ldbm_archive_open_stream(rawdirectory, directory, 1, run_from_cmdline, task);
+    if (stream_fd == ARCHIVE_STREAM_ERROR || (stream_fd >= 0 && base)) {
+        if (stream_fd >= 0) {
+            slapi_log_err(SLAPI_LOG_ERR, "ldbm_back_ldbm2archive", "An incremental backup cannot be streamed.\n");
+            if (task) {
+                slapi_task_log_notice(task, "An incremental backup cannot be streamed.");
+            }
+        }
+        return_value = -1;
+        goto out;
+    }
+
+    if (stream_fd < 0 && stat(directory, &sbuf) == 0) {
         if (slapd_comp_path(directory, li->li_directory) == 0) {
             slapi_log_err(SLAPI_LOG_ERR,
                           "ldbm_back_ldbm2archive", "Cannot archive to the db directory.\n");
@@ -431,7 +527,7 @@ ldbm_back_ldbm2archive(Slapi_PBlock *pb)
             goto out;
         }
     }
-    if (0 != MKDIR(directory, SLAPD_DEFAULT_DIR_MODE) && EEXIST != errno) {
+    if (stream_fd < 0 && 0 != MKDIR(directory, SLAPD_DEFAULT_DIR_MODE) && EEXIST != errno) {
         const char *msg = dblayer_strerror(errno);
 
         slapi_log_err(SLAPI_LOG_ERR,
@@ -487,7 +583,13 @@ ldbm_back_ldbm2archive(Slapi_PBlock *pb)
     }
 
     /* tell it to archive */
-    return_value = dblayer_backup(li, directory, task);
+    if (stream_fd >= 0) {
+        return_value = dblayer_backup_stream(li, stream_fd, compact ? DBLAYER_BACKUP_COMPACT : 0, task);
+    } else if (base) {
+        return_value = dblayer_backup_incremental(li, directory, base, task);
+    } else {
+        return_value = dblayer_backup(li, directory, task);
+    }
     if (return_value) {
         slapi_log_err(SLAPI_LOG_BACKLDBM,
                       "ldbm_back_ldbm2archive", "dblayer_backup failed (%d).\n", return_value);
@@ -506,7 +608,7 @@ ldbm_back_ldbm2archive(Slapi_PBlock *pb)
         }
     }
 err:
-    if (return_value) {
+    if (return_value && stream_fd < 0) {
         if (dir_bak) {
             slapi_log_err(SLAPI_LOG_ERR,
                           "ldbm_back_ldbm2archive", "Failed renaming %s back to %s\n",
@@ -553,7 +655,11 @@ out:
         }
     }
 
+    if (stream_fd >= 0) {
+        close(stream_fd);
+    }
     slapi_ch_free_string(&dir_bak);
     slapi_ch_free_string(&directory);
+    slapi_ch_free_string(&base);
     return return_value;
 }
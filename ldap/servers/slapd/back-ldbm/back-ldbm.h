@@ -417,14 +417,23 @@ typedef struct attrcrypt_private   attrcrypt_private;
  * 1) stop the server,
  * 2) run db2index -t <attr>,
  * 3) start the server.
+ *
+ * Initial substrings shorter than the begin key, like (cn=a*) with the
+ * default length 3, are not indexed. nsSubStrPrefix sets the length of the
+ * shortest initial substring to index: with nsSubStrPrefix: 1, the values
+ * also get the shorter begin keys "^a" and "^ab". This is off (0) by default
+ * since these keys match a lot of entries. The index must be regenerated
+ * too (db2index or an index task) when it is changed.
  */
 #define INDEX_ATTR_SUBSTRBEGIN  "nsSubStrBegin"
 #define INDEX_ATTR_SUBSTRMIDDLE "nsSubStrMiddle"
 #define INDEX_ATTR_SUBSTREND    "nsSubStrEnd"
+#define INDEX_ATTR_SUBSTRPREFIX "nsSubStrPrefix"
 
 #define INDEX_SUBSTRBEGIN  0
 #define INDEX_SUBSTRMIDDLE 1
 #define INDEX_SUBSTREND    2
+#define INDEX_SUBSTRPREFIX 3
 
 struct index_idlistsizeinfo
 {
@@ -589,6 +598,11 @@ struct ldbminfo
     int li_filter_bypass;       /* bypass filter testing, when possible */
     int li_filter_bypass_check; /* check that filter bypass is doing the right thing */
     int li_use_vlv;             /* use vlv indexes to short-circuit matches when possible */
+    int li_vlv_auto_threshold;      /* sorted searches seen before a vlv index is created for them, 0 disables it */
+    int li_vlv_auto_min_candidates; /* smallest candidate list worth an automatic vlv index */
+    int li_vlv_auto_max_indexes;    /* maximum number of automatic vlv indexes per instance */
+    int li_entry_summary;           /* attach equality summaries to the cached entries (see entrysummary.c) */
+    int li_filter_plans;            /* maximum number of filter plans per instance, 0 disables them */
     void *li_identity;          /* The ldbm plugin needs to keep track of its identity so it can
                                  * perform internal ops.  Its identity is given to it when
                                  * its init function is called. */
@@ -783,6 +797,9 @@ typedef struct ldbm_instance
     int require_index;               /* set to 1 to require an index be used in search */
     int require_internalop_index;    /* set to 1 to require an index be used in an internal search */
     struct cache inst_dncache;       /* The dn cache for this instance. */
+    struct vlv_auto *inst_vlv_auto;  /* Sorted searches seen, for the automatic vlv indexes */
+    struct filter_plan_cache *inst_filter_plans; /* Plans of the search filters (see filterplan.c) */
+    struct search_cache *inst_search_cache;      /* Candidates of the repeated searches (see searchcache.c) */
 } ldbm_instance;
 
 /*
@@ -802,6 +819,7 @@ typedef struct _back_search_result_set
     int sr_flags;                 /* Magic flags, defined below */
     int sr_current_sizelimit;     /* Current sizelimit */
     Slapi_Filter *sr_norm_filter; /* search filter pre-normalized */
+    struct sort_keyset *sr_sort_keys; /* sort keys when only the first candidates are sorted */
 } back_search_result_set;
 #define SR_FLAG_CAN_SKIP_FILTER_TEST 1 /* If set in sr_flags, means that we can safely skip the filter test */
 
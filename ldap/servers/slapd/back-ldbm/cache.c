@@ -2194,6 +2194,23 @@ check_entry_cache(struct cache *cache, struct backentry *e)
 }
 #endif
 
+/*
+ * Charge the entry cache with memory that an entry took once in the cache
+ * (e.g. the normalized values kept by the filter tests, see value_set_norm,
+ * or the summary of an added entry).
+ * The cache is flushed when the entry is returned.
+ */
+void
+cache_adjust_size(struct cache *cache, struct backentry *e, size_t delta)
+{
+    cache_lock(cache);
+    if (!(e->ep_state & (ENTRY_STATE_DELETED | ENTRY_STATE_NOTINCACHE | ENTRY_STATE_INVALID))) {
+        e->ep_size += delta;
+        slapi_counter_add(cache->c_cursize, delta);
+    }
+    cache_unlock(cache);
+}
+
 int
 cache_has_otherref(struct cache *cache, void *ptr)
 {
@@ -187,6 +187,10 @@ bdb_monitor_instance_search(Slapi_PBlock *pb __attribute__((unused)),
     slapi_ch_free_string(&absolute_pathname);
     slapi_ch_free((void **)&mpfstat);
 
+    vlv_auto_monitor(inst, e);
+    filter_plan_monitor(inst, e);
+    search_cache_monitor(inst, e);
+
     *returncode = LDAP_SUCCESS;
     return SLAPI_DSE_CALLBACK_OK;
 }
@@ -112,6 +112,7 @@ int mdb_init(struct ldbminfo *li, config_info *config_array)
     pthread_mutex_init(&conf->dbis_lock, NULL);
     pthread_mutex_init(&conf->rcmutex, NULL);
     pthread_rwlock_init(&conf->dbmdb_env_lock, NULL);
+    dbmdb_txn_group_init(conf);
 
     dbmdb_ctx_t_setup_default(li);
     /* Do not compute limit if dse.ldif is not taken in account (i.e. dbscan) */
@@ -124,6 +125,8 @@ int mdb_init(struct ldbminfo *li, config_info *config_array)
     priv->dblayer_close_fn = &dbmdb_close;
     priv->dblayer_instance_start_fn = &dbmdb_instance_start;
     priv->dblayer_backup_fn = &dbmdb_backup;
+    priv->dblayer_backup_incremental_fn = &dbmdb_backup_incremental;
+    priv->dblayer_backup_stream_fn = &dbmdb_backup_stream;
     priv->dblayer_verify_fn = &dbmdb_verify;
     priv->dblayer_db_size_fn = &dbmdb_db_size;
     priv->dblayer_ldif2db_fn = &dbmdb_ldif2db;
@@ -133,8 +136,10 @@ int mdb_init(struct ldbminfo *li, config_info *config_array)
     priv->dblayer_upgradedn_fn = &dbmdb_upgradednformat;
     priv->dblayer_upgradedb_fn = &dbmdb_upgradedb;
     priv->dblayer_restore_fn = &dbmdb_restore;
+    priv->dblayer_restore_stream_fn = &dbmdb_restore_stream;
     priv->dblayer_txn_begin_fn = &dbmdb_txn_begin;
     priv->dblayer_txn_commit_fn = &dbmdb_txn_commit;
+    priv->dblayer_txn_wait_fn = &dbmdb_txn_wait;
     priv->dblayer_txn_abort_fn = &dbmdb_txn_abort;
     priv->dblayer_get_info_fn = &dbmdb_get_info;
     priv->dblayer_set_info_fn = &dbmdb_set_info;
@@ -433,6 +438,61 @@ dbmdb_ctx_t_db_durable_transactions_set(void *arg, void *value, char *errorbuf _
     return retval;
 }
 
+static void *
+dbmdb_ctx_t_get_batch_transactions(void *arg)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+
+    return (void *)((uintptr_t)(MDB_CONFIG(li)->group_commit.batch_val));
+}
+
+static int
+dbmdb_ctx_t_set_batch_transactions(void *arg, void *value, char *errorbuf __attribute__((unused)), int phase, int apply)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+    dbmdb_group_commit_t *gc = &MDB_CONFIG(li)->group_commit;
+    int val = (int)((uintptr_t)value);
+
+    if (val < 0) {
+        val = 0;
+    }
+    if (apply) {
+        /* The env must be reopened to enable or disable MDB_NOSYNC */
+        if (CONFIG_PHASE_RUNNING == phase && (val > 0) != (gc->batch_val > 0)) {
+            slapi_log_err(SLAPI_LOG_NOTICE, "dbmdb_ctx_t_set_batch_transactions",
+                          "Enabling or disabling %s will not take affect until the server is restarted\n",
+                          CONFIG_DB_TRANSACTION_BATCH);
+        }
+        gc->batch_val = val;
+    }
+
+    return LDAP_SUCCESS;
+}
+
+static void *
+dbmdb_ctx_t_get_batch_txn_max_sleep(void *arg)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+
+    return (void *)((uintptr_t)(MDB_CONFIG(li)->group_commit.max_wait));
+}
+
+static int
+dbmdb_ctx_t_set_batch_txn_max_sleep(void *arg, void *value, char *errorbuf __attribute__((unused)), int phase __attribute__((unused)), int apply)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+    int val = (int)((uintptr_t)value);
+
+    if (val < 0) {
+        val = 0;
+    }
+    if (apply) {
+        MDB_CONFIG(li)->group_commit.max_wait = val;
+    }
+
+    return LDAP_SUCCESS;
+}
+
 static int
 dbmdb_ctx_t_set_bypass_filter_test(void *arg,
                                    void *value,
@@ -514,6 +574,8 @@ static config_info dbmdb_ctx_t_param[] = {
     {CONFIG_MDB_MAX_DBS, CONFIG_TYPE_INT, "512", &dbmdb_ctx_t_db_max_dbs_get, &dbmdb_ctx_t_db_max_dbs_set, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
     {CONFIG_MAXPASSBEFOREMERGE, CONFIG_TYPE_INT, "100", &dbmdb_ctx_t_maxpassbeforemerge_get, &dbmdb_ctx_t_maxpassbeforemerge_set, 0},
     {CONFIG_DB_DURABLE_TRANSACTIONS, CONFIG_TYPE_ONOFF, "on", &dbmdb_ctx_t_db_durable_transactions_get, &dbmdb_ctx_t_db_durable_transactions_set, CONFIG_FLAG_ALWAYS_SHOW},
+    {CONFIG_DB_TRANSACTION_BATCH, CONFIG_TYPE_INT, "0", &dbmdb_ctx_t_get_batch_transactions, &dbmdb_ctx_t_set_batch_transactions, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
+    {CONFIG_DB_TRANSACTION_BATCH_MAX_SLEEP, CONFIG_TYPE_INT, "5", &dbmdb_ctx_t_get_batch_txn_max_sleep, &dbmdb_ctx_t_set_batch_txn_max_sleep, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
     {CONFIG_BYPASS_FILTER_TEST, CONFIG_TYPE_STRING, "on", &dbmdb_ctx_t_get_bypass_filter_test, &dbmdb_ctx_t_set_bypass_filter_test, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
     {CONFIG_SERIAL_LOCK, CONFIG_TYPE_ONOFF, "on", &dbmdb_ctx_t_serial_lock_get, &dbmdb_ctx_t_serial_lock_set, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
     {NULL, 0, NULL, NULL, NULL, 0}};
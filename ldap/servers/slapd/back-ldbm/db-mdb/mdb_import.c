@@ -615,6 +615,19 @@ dbmdb_import_monitor_threads(ImportJob *job, int *status)
                          job->average_progress_rate);
             p += sprintf(p, "recent rate %.1f/sec, ",
                          job->recent_progress_rate);
+            if (ctx->role == IM_INDEX && ctx->nbentries > 0 && entry_processed <= ctx->nbentries) {
+                /* Reindex knows how many entries remain: give an estimation */
+                size_t left = ctx->nbentries - entry_processed;
+                p += sprintf(p, "%d%% done, ", (int)(entry_processed * 100 / ctx->nbentries));
+                if (job->recent_progress_rate > 0) {
+                    p += sprintf(p, "about %d seconds left, ", (int)(left / job->recent_progress_rate));
+                }
+                if (job->task) {
+                    job->task->task_work = ctx->nbentries;
+                    job->task->task_progress = entry_processed;
+                    slapi_task_log_status(job->task, "%s", buffer);
+                }
+            }
             import_log_notice(job, SLAPI_LOG_INFO, "dbmdb_import_monitor_threads", "%s", buffer);
         }
 
@@ -671,7 +684,12 @@ dbmdb_import_all_done(ImportJob *job, int ret)
     ldbm_instance *inst = job->inst;
     int rc = 0;
 
-    if (job->flags & FLAG_ONLINE) {
+    if (job->flags & FLAG_SHADOW_INDEX) {
+        /* The backend was never brought down: just enable the indexes */
+        for (IndexInfo *index = job->index_list; index != NULL; index = index->next) {
+            index->ai->ai_indexmask &= ~INDEX_OFFLINE;
+        }
+    } else if (job->flags & FLAG_ONLINE) {
         /* make sure the indexes are online as well */
         /* richm 20070919 - if index entries are added online, they
            are created and marked as INDEX_OFFLINE, in anticipation
@@ -756,7 +774,21 @@ dbmdb_public_dbmdb_import_main(void *arg)
 
     /* insure all dbi get open */
     dbmdb_open_all_files(NULL, job->inst->inst_be);
-    dbmdb_build_import_index_list(ctx);
+    ret = dbmdb_build_import_index_list(ctx);
+    if (ret != 0) {
+        goto error;
+    }
+    if (ctx->role == IM_IMPORT || ctx->role == IM_INDEX) {
+        /* Build the attribute indexes by sort-merge */
+        dbmdb_import_runs_init(ctx);
+    }
+    if (job->flags & FLAG_SHADOW_INDEX) {
+        /* Log the index updates done while the indexes get rebuilt */
+        ret = dbmdb_import_shadow_start(ctx);
+        if (ret != 0) {
+            goto error;
+        }
+    }
 
     switch (ctx->role) {
         case IM_IMPORT:
@@ -819,6 +851,20 @@ dbmdb_public_dbmdb_import_main(void *arg)
     }
 
 
+    /* Write the indexes built by sort-merge (before numsubordinates that needs parentid) */
+    ret = dbmdb_import_runs_merge(ctx);
+    if (ret != 0) {
+        goto error;
+    }
+
+    if (job->flags & FLAG_SHADOW_INDEX) {
+        /* Replace the live indexes by the rebuilt ones */
+        ret = dbmdb_import_shadow_switch(ctx);
+        if (ret != 0) {
+            goto error;
+        }
+    }
+
     import_log_notice(job, SLAPI_LOG_INFO, "dbmdb_public_dbmdb_import_main", "Indexing complete.  Post-processing...");
 
     if (ctx->numsubordinates) {
@@ -837,6 +883,9 @@ dbmdb_public_dbmdb_import_main(void *arg)
     }
 
     import_log_notice(job, SLAPI_LOG_INFO, "dbmdb_public_dbmdb_import_main", "Flushing caches...");
+    /* The import txns are not synced by the group commit (i.e. the
+     * automatic vlv indexes are built by a reindex while the server runs) */
+    ret = dbmdb_txn_group_sync_env(ctx->ctx);
 
 /* New way to exit the routine: check the return code.
      * If it's non-zero, delete the database files.
@@ -845,6 +894,12 @@ dbmdb_public_dbmdb_import_main(void *arg)
      * Database. */
 
 error:
+    if (job->flags & FLAG_SHADOW_INDEX) {
+        /* The backend stayed online and only the shadow dbis must go away
+         * (on failure, the live indexes are left unchanged) */
+        dbmdb_import_shadow_cleanup(ctx);
+        goto closed;
+    }
     /* If we fail, the database is now in a mess, so we delete it
        except dry run mode */
     import_log_notice(job, SLAPI_LOG_INFO, "dbmdb_public_dbmdb_import_main", "Closing files...");
@@ -884,6 +939,7 @@ error:
             import_log_notice(job, SLAPI_LOG_WARNING, "dbmdb_public_dbmdb_import_main", "Failed to close database");
         }
     }
+closed:
     end = slapi_current_rel_time_t();
     if (verbose && (0 == ret)) {
         int seconds_to_import = end - beginning;
@@ -1120,6 +1176,10 @@ dbmdb_run_ldif2db(Slapi_PBlock *pb)
             job->flags |= FLAG_REINDEXING; /* call dbmdb_index_producer */
             dbmdb_import_init_writer(job, IM_INDEX);
             process_db2index_attrs(pb, job->writer_ctx);
+            if (dbmdb_shadow_reindex_possible(pb)) {
+                /* The backend keeps serving updates during the reindex */
+                job->flags |= FLAG_SHADOW_INDEX;
+            }
         }
     } else {
         dbmdb_import_init_writer(job, IM_IMPORT);
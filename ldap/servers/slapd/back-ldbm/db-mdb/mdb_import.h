@@ -28,6 +28,8 @@
 typedef enum { IM_UNKNOWN, IM_IMPORT, IM_INDEX, IM_UPGRADE, IM_BULKIMPORT } ImportRole_t;
 
 typedef struct importctx ImportCtx_t;
+typedef struct importruns ImportRuns_t;
+typedef struct importrunbuf ImportRunBuf_t;
 
 
 /******************** Queues ********************/
@@ -35,6 +37,7 @@ typedef struct importctx ImportCtx_t;
 typedef struct {
     ImportWorkerInfo winfo;
     volatile int count; /* Number of processed entries since thread is started */
+    ImportRunBuf_t *runbuf; /* Index keys not yet in a sorted run (see mdb_import_runs.c) */
     volatile int wait_id;
     int lineno;
     int nblines;
@@ -115,6 +118,8 @@ typedef struct _mdb_index_info {
     struct attrinfo *ai;
     int flags;
     dbmdb_dbi_t *dbi;
+    dbmdb_dbi_t *live;      /* FLAG_SHADOW_INDEX: the index in use (dbi is its shadow) */
+    dbmdb_dbi_t *shadowlog; /* FLAG_SHADOW_INDEX: updates of live during the rebuild */
     struct _mdb_index_info *next;
 } MdbIndexInfo_t;
 
@@ -136,6 +141,7 @@ struct importctx {
     ImportQueue_t workerq;
     WriterQueue_t writerq;;
     RDNcache_t *rdncache;
+    ImportRuns_t *runs; /* indexes built by sort-merge */
     Avlnode *indexes;  /* btree of MdbIndexInfo_t */
     ImportWorkerInfo producer;
     struct backentry *(*prepare_worker_entry_fn)(WorkerQueueData_t *wqelmnt);
@@ -146,6 +152,7 @@ struct importctx {
     ID idsuffix;
     ID idruv;
     int dupdn;
+    size_t nbentries;   /* reindex: number of entries to process */
 };
 
 /******************** Functions ********************/
@@ -162,6 +169,19 @@ void rdncache_free(RDNcache_t **cache);
 /* mdb_import.c */
 int dbmdb_run_ldif2db(Slapi_PBlock *pb);
 
+/* mdb_import_runs.c */
+void dbmdb_import_runs_init(ImportCtx_t *ctx);
+int dbmdb_import_runs_push(ImportCtx_t *ctx, WorkerQueueData_t *slot, WriterQueueData_t *wqd);
+int dbmdb_import_runs_merge(ImportCtx_t *ctx);
+void dbmdb_import_runs_free(ImportRuns_t **runs);
+void dbmdb_import_runbuf_free(ImportRunBuf_t **buf);
+
+/* mdb_shadow.c */
+int dbmdb_import_shadow_open(ImportCtx_t *ctx, MdbIndexInfo_t *mii);
+int dbmdb_import_shadow_start(ImportCtx_t *ctx);
+int dbmdb_import_shadow_switch(ImportCtx_t *ctx);
+void dbmdb_import_shadow_cleanup(ImportCtx_t *ctx);
+
 
 /* mdb_import_threads.c */
 void safe_cond_wait(pthread_cond_t *restrict cond, pthread_mutex_t *restrict mutex);
@@ -182,5 +202,5 @@ void dbmdb_free_worker_slot(struct importqueue *q, void *slot);
 
 int dbmdb_import_init_writer(ImportJob *job, ImportRole_t role);
 void dbmdb_free_import_ctx(ImportJob *job);
-void dbmdb_build_import_index_list(ImportCtx_t *ctx);
+int dbmdb_build_import_index_list(ImportCtx_t *ctx);
 
@@ -0,0 +1,1221 @@
+/** BEGIN COPYRIGHT BLOCK
+ * Copyright (C) 2026 Red Hat, Inc.
+ * All rights reserved.
+ *
+ * License: GPL (version 3 or any later version).
+ * See LICENSE for details.
+ * END COPYRIGHT BLOCK **/
+
+/*
+ * Sort-merge build of the attribute indexes during import and reindex.
+ *
+ * Instead of sending every index key/ID pair to the writer thread (which
+ * inserts them in random key order, splitting the btree pages again and
+ * again), the workers store them in a private buffer. When the buffer is
+ * full it gets sorted and written in a run file. Once all entries are
+ * processed, the runs (and the buffers that were not flushed) are merged
+ * and each index is written in key order with append mode cursor puts,
+ * which fills the pages sequentially.
+ *
+ * Only the dbis that are plain indexes (duplicate IDs, default key order)
+ * are built that way, the other ones still go through the writer queue.
+ *
+ * To bound the number of open files and the memory of the read buffers,
+ * the run files are merged by groups of RUN_MAX_FANIN into bigger runs:
+ * during the import as soon as a level has RUN_MAX_FANIN runs, and before
+ * the final merge if there are still more than RUN_MAX_FANIN of them.
+ *
+ * As LMDB only allows a single write txn per environment, the dbis are
+ * merged in parallel by several threads, each one writing in its own
+ * scratch environment. The scratch dbis are then copied in the main
+ * environment, a page of IDs at a time (MDB_MULTIPLE).
+ */
+
+#include "mdb_import.h"
+
+#define RUN_MEMORY          (256 * 1024 * 1024)  /* Memory shared by the worker buffers */
+#define RUN_MIN_BUFSIZE     (4 * 1024 * 1024)
+#define RUN_IOBUFSIZE       (1024 * 1024)
+#define RUN_MERGE_MEMORY    (64 * 1024 * 1024)   /* Memory shared by the read buffers of a merge */
+#define RUN_MIN_READSIZE    (64 * 1024)          /* Minimum read buffer of a run cursor */
+#define RUN_MAX_FANIN       64                   /* Max number of run files merged together */
+#define RUN_TXN_RECORDS     100000               /* Records written per txn while merging */
+
+/* An index record: the key is not NUL terminated and is followed by padding */
+typedef struct {
+    uint16_t dbidx; /* index in ImportRuns_t dbis */
+    uint16_t keylen;
+    ID id;
+    char key[];
+} ImportRunRec_t;
+
+#define RUNREC_SIZE(keylen) LONGALIGN(offsetof(ImportRunRec_t, key) + (keylen))
+
+/* Worker private buffer */
+struct importrunbuf {
+    char *mem;
+    size_t used;
+    size_t nbrecs;
+};
+
+/* A sorted run: either in a (unlinked) file, or in memory */
+typedef struct importrun {
+    struct importrun *next;
+    FILE *fd;
+    char *mem;
+    ImportRunRec_t **recs;
+    size_t nbrecs;
+    uint64_t size;
+    uint64_t *starts; /* Per dbi: file offset (or index in recs) of its first record */
+    int level;        /* 0 for a spilled buffer, n+1 if it merges level n runs */
+} ImportRun_t;
+
+/* Reads the records of a dbi in a run */
+typedef struct {
+    ImportRun_t *run;
+    uint64_t pos;
+    uint64_t end;
+    char *buf;
+    size_t bufsize;
+    size_t buflen;
+    size_t bufpos;
+    ImportRunRec_t *cur;
+} ImportRunCursor_t;
+
+/* Scratch environment of a merge thread */
+typedef struct {
+    ImportRuns_t *runs;
+    char *path;
+    MDB_env *env;
+    int rc;
+} ImportRunScratch_t;
+
+struct importruns {
+    ImportCtx_t *ctx;
+    pthread_mutex_t mutex; /* Protects runs list and counters */
+    int nbdbis;
+    dbmdb_dbi_t **dbis;
+    int *dbi2run;    /* mdb dbi handle -> index in dbis, or -1 */
+    MDB_dbi maxdbi;
+    size_t bufsize;  /* Size of a worker buffer */
+    size_t maxkeysize;
+    ImportRun_t *runs;
+    int nbruns;
+    int nbfileruns;
+    int compacting;  /* A thread is merging run files */
+    uint64_t nbrecs;
+    uint64_t size;
+    uint64_t spilled;
+    /* Merge phase */
+    ImportRun_t **runarray;
+    size_t readsize;        /* Read buffer of a run file cursor */
+    int nextdbidx;          /* Next dbi to merge */
+    int *scratchidx;        /* Per dbi: scratch env holding it */
+    MDB_dbi *scratchdbi;    /* Per dbi: dbi in that env */
+    ImportRunScratch_t *scratch; /* Scratch envs of the merge threads */
+    uint64_t merged;
+    uint64_t next_report;
+};
+
+
+static int
+cmp_runrec(const ImportRunRec_t *r1, const ImportRunRec_t *r2)
+{
+    int rc;
+
+    if (r1->dbidx != r2->dbidx) {
+        return r1->dbidx < r2->dbidx ? -1 : 1;
+    }
+    /* Same order than mdb default key compare function */
+    rc = memcmp(r1->key, r2->key, r1->keylen < r2->keylen ? r1->keylen : r2->keylen);
+    if (rc == 0 && r1->keylen != r2->keylen) {
+        rc = r1->keylen < r2->keylen ? -1 : 1;
+    }
+    if (rc == 0 && r1->id != r2->id) {
+        /* dbis are MDB_INTEGERDUP */
+        rc = r1->id < r2->id ? -1 : 1;
+    }
+    return rc;
+}
+
+static int
+cmp_runrec_pt(const void *p1, const void *p2)
+{
+    return cmp_runrec(*(const ImportRunRec_t **)p1, *(const ImportRunRec_t **)p2);
+}
+
+static int
+dbmdb_import_runs_add_dbi(caddr_t data, caddr_t arg)
+{
+    MdbIndexInfo_t *mii = (MdbIndexInfo_t *)data;
+    ImportRuns_t *runs = (ImportRuns_t *)arg;
+    ImportCtx_t *ctx = runs->ctx;
+    dbmdb_dbi_t *dbi = mii->dbi;
+
+    /* entryrdn has its own data format and is read back by the workers */
+    if (!dbi || mii == ctx->entryrdn || mii == ctx->numsubordinates) {
+        return 0;
+    }
+    if ((dbi->state.flags & MDB_INTEGERDUP) == 0 || dbi->cmp_fn) {
+        return 0;
+    }
+    runs->dbis = (dbmdb_dbi_t **)slapi_ch_realloc((char *)runs->dbis, (runs->nbdbis + 1) * sizeof(dbmdb_dbi_t *));
+    runs->dbis[runs->nbdbis++] = dbi;
+    if (dbi->dbi > runs->maxdbi) {
+        runs->maxdbi = dbi->dbi;
+    }
+    return 0;
+}
+
+/*
+ * Select the dbis that are built by sort-merge.
+ * Called once the import index list is built, before starting the threads.
+ */
+void
+dbmdb_import_runs_init(ImportCtx_t *ctx)
+{
+    ImportRuns_t *runs = CALLOC(ImportRuns_t);
+    int i;
+
+    runs->ctx = ctx;
+    pthread_mutex_init(&runs->mutex, NULL);
+    avl_apply(ctx->indexes, dbmdb_import_runs_add_dbi, (caddr_t)runs, -1, AVL_INORDER);
+    if (runs->nbdbis == 0 || runs->nbdbis > UINT16_MAX) {
+        dbmdb_import_runs_free(&runs);
+        return;
+    }
+    runs->dbi2run = (int *)slapi_ch_malloc((runs->maxdbi + 1) * sizeof(int));
+    for (MDB_dbi d = 0; d <= runs->maxdbi; d++) {
+        runs->dbi2run[d] = -1;
+    }
+    for (i = 0; i < runs->nbdbis; i++) {
+        runs->dbi2run[runs->dbis[i]->dbi] = i;
+    }
+    runs->maxkeysize = mdb_env_get_maxkeysize(ctx->ctx->env);
+    runs->bufsize = RUN_MEMORY / ctx->workerq.max_slots;
+    if (runs->bufsize < RUN_MIN_BUFSIZE) {
+        runs->bufsize = RUN_MIN_BUFSIZE;
+    }
+    ctx->runs = runs;
+}
+
+static void
+dbmdb_import_run_free(ImportRun_t **run)
+{
+    ImportRun_t *r = *run;
+
+    if (r) {
+        if (r->fd) {
+            fclose(r->fd);
+        }
+        slapi_ch_free_string(&r->mem);
+        slapi_ch_free((void **)&r->recs);
+        slapi_ch_free((void **)&r->starts);
+        slapi_ch_free((void **)run);
+    }
+}
+
+void
+dbmdb_import_runs_free(ImportRuns_t **runs)
+{
+    ImportRuns_t *r = *runs;
+    ImportRun_t *run = NULL;
+
+    if (r == NULL) {
+        return;
+    }
+    while ((run = r->runs)) {
+        r->runs = run->next;
+        dbmdb_import_run_free(&run);
+    }
+    pthread_mutex_destroy(&r->mutex);
+    slapi_ch_free((void **)&r->dbis);
+    slapi_ch_free((void **)&r->dbi2run);
+    slapi_ch_free((void **)&r->runarray);
+    slapi_ch_free((void **)&r->scratchidx);
+    slapi_ch_free((void **)&r->scratchdbi);
+    slapi_ch_free((void **)runs);
+}
+
+void
+dbmdb_import_runbuf_free(ImportRunBuf_t **buf)
+{
+    if (*buf) {
+        slapi_ch_free_string(&(*buf)->mem);
+        slapi_ch_free((void **)buf);
+    }
+}
+
+/* Returns the sorted records of a worker buffer */
+static ImportRunRec_t **
+dbmdb_import_runbuf_sort(ImportRunBuf_t *buf)
+{
+    ImportRunRec_t **recs = (ImportRunRec_t **)slapi_ch_malloc(buf->nbrecs * sizeof(ImportRunRec_t *));
+    size_t offset = 0;
+    size_t i;
+
+    for (i = 0; i < buf->nbrecs; i++) {
+        recs[i] = (ImportRunRec_t *)&buf->mem[offset];
+        offset += RUNREC_SIZE(recs[i]->keylen);
+    }
+    qsort(recs, buf->nbrecs, sizeof(ImportRunRec_t *), cmp_runrec_pt);
+    return recs;
+}
+
+static void
+dbmdb_import_runs_add(ImportRuns_t *runs, ImportRun_t *run, int spilled)
+{
+    pthread_mutex_lock(&runs->mutex);
+    run->next = runs->runs;
+    runs->runs = run;
+    runs->nbruns++;
+    if (run->fd) {
+        runs->nbfileruns++;
+    }
+    runs->nbrecs += run->nbrecs;
+    runs->size += run->size;
+    if (spilled) {
+        runs->spilled += run->size;
+    }
+    pthread_mutex_unlock(&runs->mutex);
+}
+
+static int dbmdb_import_runs_compact(ImportRuns_t *runs, int final);
+
+/* Create an empty run file */
+static ImportRun_t *
+dbmdb_import_run_create(ImportRuns_t *runs, int *rc)
+{
+    ImportJob *job = runs->ctx->job;
+    char *path = slapi_ch_smprintf("%s/import_run.XXXXXX", runs->ctx->ctx->home);
+    ImportRun_t *run = NULL;
+    FILE *fd = NULL;
+    int fno;
+
+    fno = mkstemp(path);
+    if (fno >= 0) {
+        /* The file only needs to live as long as the import */
+        unlink(path);
+        fd = fdopen(fno, "w+");
+        if (!fd) {
+            close(fno);
+        }
+    }
+    if (!fd) {
+        *rc = errno;
+        import_log_notice(job, SLAPI_LOG_ERR, "dbmdb_import_run_create",
+                          "Failed to create index run file %s. Error %d: %s",
+                          path, *rc, slapd_system_strerror(*rc));
+        slapi_ch_free_string(&path);
+        return NULL;
+    }
+    slapi_ch_free_string(&path);
+    setvbuf(fd, NULL, _IOFBF, RUN_IOBUFSIZE);
+
+    run = CALLOC(ImportRun_t);
+    run->fd = fd;
+    run->starts = (uint64_t *)slapi_ch_calloc(runs->nbdbis + 1, sizeof(uint64_t));
+    *rc = 0;
+    return run;
+}
+
+/* Sort a full worker buffer and write it in a run file */
+static int
+dbmdb_import_runbuf_spill(ImportRuns_t *runs, ImportRunBuf_t *buf)
+{
+    ImportJob *job = runs->ctx->job;
+    ImportRunRec_t **recs = NULL;
+    ImportRunRec_t *prev = NULL;
+    ImportRun_t *run = NULL;
+    FILE *fd = NULL;
+    int nextdbidx = 0;
+    int rc = 0;
+    size_t i;
+
+    run = dbmdb_import_run_create(runs, &rc);
+    if (!run) {
+        return rc;
+    }
+    fd = run->fd;
+    recs = dbmdb_import_runbuf_sort(buf);
+    for (i = 0; rc == 0 && i < buf->nbrecs; i++) {
+        size_t len = RUNREC_SIZE(recs[i]->keylen);
+        if (prev && cmp_runrec(prev, recs[i]) == 0) {
+            continue;
+        }
+        while (nextdbidx <= recs[i]->dbidx) {
+            run->starts[nextdbidx++] = run->size;
+        }
+        if (fwrite(recs[i], len, 1, fd) != 1) {
+            rc = errno;
+        }
+        run->size += len;
+        run->nbrecs++;
+        prev = recs[i];
+    }
+    while (nextdbidx <= runs->nbdbis) {
+        run->starts[nextdbidx++] = run->size;
+    }
+    if (rc == 0 && fflush(fd)) {
+        rc = errno;
+    }
+    slapi_ch_free((void **)&recs);
+    buf->used = 0;
+    buf->nbrecs = 0;
+    if (rc) {
+        import_log_notice(job, SLAPI_LOG_ERR, "dbmdb_import_runbuf_spill",
+                          "Failed to write index run file. Error %d: %s",
+                          rc, slapd_system_strerror(rc));
+        dbmdb_import_run_free(&run);
+        return rc;
+    }
+    dbmdb_import_runs_add(runs, run, 1);
+    return dbmdb_import_runs_compact(runs, 0);
+}
+
+/*
+ * Store an index update in the worker buffer if its dbi is built
+ * by sort-merge.
+ * Returns 1 if the update must go through the writer queue instead.
+ * (on error the import is aborted)
+ */
+int
+dbmdb_import_runs_push(ImportCtx_t *ctx, WorkerQueueData_t *slot, WriterQueueData_t *wqd)
+{
+    ImportRuns_t *runs = ctx->runs;
+    ImportRunBuf_t *buf = NULL;
+    ImportRunRec_t *rec = NULL;
+    size_t len;
+    int dbidx;
+
+    if (!runs || !slot || wqd->dbi->dbi > runs->maxdbi || wqd->data.mv_size != sizeof(ID) ||
+        wqd->key.mv_size > runs->maxkeysize) {
+        return 1;
+    }
+    dbidx = runs->dbi2run[wqd->dbi->dbi];
+    if (dbidx < 0) {
+        return 1;
+    }
+
+    len = RUNREC_SIZE(wqd->key.mv_size);
+    buf = slot->runbuf;
+    if (!buf) {
+        buf = slot->runbuf = CALLOC(ImportRunBuf_t);
+        buf->mem = slapi_ch_malloc(runs->bufsize);
+    }
+    if (buf->used + len > runs->bufsize) {
+        if (dbmdb_import_runbuf_spill(runs, buf)) {
+            ctx->job->flags |= FLAG_ABORT;
+            return 0;
+        }
+    }
+    rec = (ImportRunRec_t *)&buf->mem[buf->used];
+    rec->dbidx = dbidx;
+    rec->keylen = wqd->key.mv_size;
+    memcpy(&rec->id, wqd->data.mv_data, sizeof(ID));
+    memcpy(rec->key, wqd->key.mv_data, wqd->key.mv_size);
+    buf->used += len;
+    buf->nbrecs++;
+    return 0;
+}
+
+
+/*
+ * Position a cursor on the first record of dbi dbidx in a run
+ * (the read buffer of a previous position is reused)
+ */
+static void
+runcursor_init(ImportRunCursor_t *rc, ImportRun_t *run, int dbidx, size_t readsize)
+{
+    char *buf = rc->buf;
+
+    memset(rc, 0, sizeof(*rc));
+    rc->run = run;
+    rc->pos = run->starts[dbidx];
+    rc->end = run->starts[dbidx + 1];
+    if (run->fd) {
+        rc->buf = buf ? buf : slapi_ch_malloc(readsize);
+        rc->bufsize = readsize;
+    } else {
+        slapi_ch_free_string(&buf);
+    }
+}
+
+/*
+ * Move a cursor on its next record.
+ * Returns 1 if there is one, 0 at the end of the dbi records, -1 on error.
+ * (Several threads read the same run file so pread is used)
+ */
+static int
+runcursor_next(ImportRunCursor_t *rc, size_t maxrec)
+{
+    ImportRunRec_t *rec = NULL;
+
+    rc->cur = NULL;
+    if (!rc->run->fd) {
+        if (rc->pos >= rc->end) {
+            return 0;
+        }
+        rc->cur = rc->run->recs[rc->pos++];
+        return 1;
+    }
+    if (rc->buflen - rc->bufpos < maxrec && rc->pos < rc->end) {
+        size_t left = rc->buflen - rc->bufpos;
+        size_t want = rc->bufsize - left;
+        ssize_t nb;
+
+        memmove(rc->buf, rc->buf + rc->bufpos, left);
+        if (want > rc->end - rc->pos) {
+            want = rc->end - rc->pos;
+        }
+        nb = pread(fileno(rc->run->fd), rc->buf + left, want, rc->pos);
+        if (nb <= 0) {
+            return -1;
+        }
+        rc->pos += nb;
+        rc->buflen = left + nb;
+        rc->bufpos = 0;
+    }
+    if (rc->bufpos >= rc->buflen) {
+        return 0;
+    }
+    rec = (ImportRunRec_t *)&rc->buf[rc->bufpos];
+    rc->bufpos += RUNREC_SIZE(rec->keylen);
+    if (rc->bufpos > rc->buflen) {
+        /* Truncated run file */
+        return -1;
+    }
+    rc->cur = rec;
+    return 1;
+}
+
+static void
+runheap_down(ImportRunCursor_t **heap, int nb, int i)
+{
+    for (;;) {
+        int smallest = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        ImportRunCursor_t *tmp = NULL;
+
+        if (l < nb && cmp_runrec(heap[l]->cur, heap[smallest]->cur) < 0) {
+            smallest = l;
+        }
+        if (r < nb && cmp_runrec(heap[r]->cur, heap[smallest]->cur) < 0) {
+            smallest = r;
+        }
+        if (smallest == i) {
+            return;
+        }
+        tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+/*
+ * Position the cursors on the records of dbi dbidx in the runs and
+ * build a heap with the ones that have some.
+ * Returns the heap size, or -1 on error.
+ */
+static int
+runheap_init(ImportRunCursor_t *cursors, ImportRunCursor_t **heap, ImportRun_t **runarray, int nbruns,
+             int dbidx, size_t readsize, size_t maxrec)
+{
+    int nb = 0;
+    int rc = 0;
+    int i;
+
+    for (i = 0; i < nbruns; i++) {
+        runcursor_init(&cursors[i], runarray[i], dbidx, readsize);
+        rc = runcursor_next(&cursors[i], maxrec);
+        if (rc < 0) {
+            return -1;
+        }
+        if (rc > 0) {
+            heap[nb++] = &cursors[i];
+        }
+    }
+    for (i = nb / 2 - 1; i >= 0; i--) {
+        runheap_down(heap, nb, i);
+    }
+    return nb;
+}
+
+/* Move the cursor on top of the heap to its next record. Returns 0 or EIO */
+static int
+runheap_next(ImportRunCursor_t **heap, int *nb, size_t maxrec)
+{
+    int rc = runcursor_next(heap[0], maxrec);
+
+    if (rc == 0) {
+        heap[0] = heap[--(*nb)];
+    }
+    runheap_down(heap, *nb, 0);
+    return (rc < 0) ? EIO : 0;
+}
+
+/* Size of the read buffers when merging nbfiles run files (in each thread) */
+static size_t
+runs_readsize(ImportRuns_t *runs, int nbfiles)
+{
+    size_t minsize = 2 * RUNREC_SIZE(runs->maxkeysize);
+    size_t size = RUN_MERGE_MEMORY / (nbfiles > 0 ? nbfiles : 1);
+
+    if (size < RUN_MIN_READSIZE) {
+        size = RUN_MIN_READSIZE;
+    }
+    return size < minsize ? minsize : size;
+}
+
+static int
+cmp_run_size(const void *p1, const void *p2)
+{
+    const ImportRun_t *r1 = *(const ImportRun_t **)p1;
+    const ImportRun_t *r2 = *(const ImportRun_t **)p2;
+
+    if (r1->size != r2->size) {
+        return r1->size < r2->size ? -1 : 1;
+    }
+    return 0;
+}
+
+/* Merge run files in a new (bigger) run file */
+static int
+dbmdb_import_runs_merge_files(ImportRuns_t *runs, ImportRun_t **group, int nbruns, ImportRun_t **newrun)
+{
+    ImportJob *job = runs->ctx->job;
+    size_t maxrec = RUNREC_SIZE(runs->maxkeysize);
+    size_t readsize = runs_readsize(runs, nbruns);
+    ImportRunCursor_t *cursors = NULL;
+    ImportRunCursor_t **heap = NULL;
+    ImportRunRec_t *prev = NULL;
+    ImportRun_t *run = NULL;
+    int dbidx;
+    int rc = 0;
+    int i;
+
+    run = dbmdb_import_run_create(runs, &rc);
+    if (!run) {
+        return rc;
+    }
+    for (i = 0; i < nbruns; i++) {
+        if (group[i]->level >= run->level) {
+            run->level = group[i]->level + 1;
+        }
+    }
+    cursors = (ImportRunCursor_t *)slapi_ch_calloc(nbruns, sizeof(ImportRunCursor_t));
+    heap = (ImportRunCursor_t **)slapi_ch_calloc(nbruns, sizeof(ImportRunCursor_t *));
+    prev = (ImportRunRec_t *)slapi_ch_malloc(maxrec);
+    for (dbidx = 0; rc == 0 && dbidx < runs->nbdbis; dbidx++) {
+        int nb = runheap_init(cursors, heap, group, nbruns, dbidx, readsize, maxrec);
+        int first = 1;
+
+        run->starts[dbidx] = run->size;
+        if (nb < 0) {
+            rc = EIO;
+        }
+        while (rc == 0 && nb > 0) {
+            ImportRunRec_t *rec = heap[0]->cur;
+            size_t len = RUNREC_SIZE(rec->keylen);
+
+            if (first || cmp_runrec(prev, rec)) {
+                if (fwrite(rec, len, 1, run->fd) != 1) {
+                    rc = errno;
+                    break;
+                }
+                memcpy(prev, rec, len);
+                run->size += len;
+                run->nbrecs++;
+                first = 0;
+            }
+            rc = runheap_next(heap, &nb, maxrec);
+        }
+        if (job->flags & FLAG_ABORT) {
+            rc = -1;
+        }
+    }
+    run->starts[runs->nbdbis] = run->size;
+    if (rc == 0 && fflush(run->fd)) {
+        rc = errno;
+    }
+    for (i = 0; i < nbruns; i++) {
+        slapi_ch_free_string(&cursors[i].buf);
+    }
+    slapi_ch_free((void **)&cursors);
+    slapi_ch_free((void **)&heap);
+    slapi_ch_free((void **)&prev);
+    if (rc) {
+        if (rc > 0) {
+            import_log_notice(job, SLAPI_LOG_ERR, "dbmdb_import_runs_merge_files",
+                              "Failed to merge %d index run files. Error %d: %s",
+                              nbruns, rc, slapd_system_strerror(rc));
+        }
+        dbmdb_import_run_free(&run);
+        return rc;
+    }
+    *newrun = run;
+    return 0;
+}
+
+/*
+ * Select the run files to merge together. Returns their number.
+ * During the import: RUN_MAX_FANIN runs of the lowest level that has
+ * that many, so that each key is only rewritten a few times.
+ * Before the final merge: the smallest runs, just enough to have
+ * RUN_MAX_FANIN run files left.
+ */
+static int
+dbmdb_import_runs_pick(ImportRuns_t *runs, int final, ImportRun_t **group)
+{
+    ImportRun_t **files = NULL;
+    ImportRun_t **prun = NULL;
+    int counts[RUN_MAX_FANIN] = {0};
+    int level = -1;
+    int nb = 0;
+    int i;
+
+    if (runs->nbfileruns <= (final ? RUN_MAX_FANIN : RUN_MAX_FANIN - 1)) {
+        return 0;
+    }
+    if (!final) {
+        for (ImportRun_t *run = runs->runs; run; run = run->next) {
+            if (run->fd && run->level < RUN_MAX_FANIN) {
+                counts[run->level]++;
+            }
+        }
+        for (i = 0; level < 0 && i < RUN_MAX_FANIN; i++) {
+            if (counts[i] >= RUN_MAX_FANIN) {
+                level = i;
+            }
+        }
+        if (level < 0) {
+            return 0;
+        }
+    } else {
+        files = (ImportRun_t **)slapi_ch_malloc(runs->nbfileruns * sizeof(ImportRun_t *));
+        for (ImportRun_t *run = runs->runs; run; run = run->next) {
+            if (run->fd) {
+                files[nb++] = run;
+            }
+        }
+        qsort(files, nb, sizeof(ImportRun_t *), cmp_run_size);
+        nb = runs->nbfileruns - RUN_MAX_FANIN + 1;
+        if (nb > RUN_MAX_FANIN) {
+            nb = RUN_MAX_FANIN;
+        }
+    }
+
+    /* Remove the selected runs from the list */
+    for (i = 0, prun = &runs->runs; *prun && i < RUN_MAX_FANIN;) {
+        ImportRun_t *run = *prun;
+        int selected = 0;
+
+        if (final) {
+            for (int j = 0; j < nb && !selected; j++) {
+                selected = (files[j] == run);
+            }
+        } else {
+            selected = (run->fd && run->level == level);
+        }
+        if (selected) {
+            *prun = run->next;
+            run->next = NULL;
+            group[i++] = run;
+            runs->nbruns--;
+            runs->nbfileruns--;
+            runs->nbrecs -= run->nbrecs;
+            runs->size -= run->size;
+        } else {
+            prun = &run->next;
+        }
+    }
+    slapi_ch_free((void **)&files);
+    return i;
+}
+
+/*
+ * Merge run files together while there are too many of them.
+ * Only one thread does it at a time, the other ones keep going on.
+ */
+static int
+dbmdb_import_runs_compact(ImportRuns_t *runs, int final)
+{
+    ImportRun_t *group[RUN_MAX_FANIN];
+    ImportRun_t *run = NULL;
+    int rc = 0;
+    int nb;
+    int i;
+
+    pthread_mutex_lock(&runs->mutex);
+    if (runs->compacting) {
+        pthread_mutex_unlock(&runs->mutex);
+        return 0;
+    }
+    runs->compacting = 1;
+    while (rc == 0 && (nb = dbmdb_import_runs_pick(runs, final, group)) > 0) {
+        pthread_mutex_unlock(&runs->mutex);
+        rc = dbmdb_import_runs_merge_files(runs, group, nb, &run);
+        for (i = 0; i < nb; i++) {
+            dbmdb_import_run_free(&group[i]);
+        }
+        if (rc == 0) {
+            dbmdb_import_runs_add(runs, run, 1);
+        }
+        pthread_mutex_lock(&runs->mutex);
+    }
+    runs->compacting = 0;
+    pthread_mutex_unlock(&runs->mutex);
+    return rc;
+}
+
+/* Account merged keys and log the progress every 10% */
+static void
+dbmdb_import_runs_progress(ImportRuns_t *runs, uint64_t nb)
+{
+    pthread_mutex_lock(&runs->mutex);
+    runs->merged += nb;
+    if (runs->merged >= runs->next_report) {
+        import_log_notice(runs->ctx->job, SLAPI_LOG_INFO, "dbmdb_import_runs_merge",
+                          "Merging index keys: %d%% done (%" PRIu64 "/%" PRIu64 ").",
+                          (int)(runs->merged * 100 / runs->nbrecs), runs->merged, runs->nbrecs);
+        runs->next_report += runs->nbrecs / 10 + 1;
+    }
+    pthread_mutex_unlock(&runs->mutex);
+}
+
+static int
+dbmdb_import_runs_begin(MDB_env *env, MDB_dbi dbi, MDB_txn **txn, MDB_cursor **cursor)
+{
+    int rc = TXN_BEGIN(env, NULL, 0, txn);
+    if (rc == 0) {
+        rc = MDB_CURSOR_OPEN(*txn, dbi, cursor);
+        if (rc) {
+            TXN_ABORT(*txn);
+            *txn = NULL;
+        }
+    }
+    return rc;
+}
+
+static int
+dbmdb_import_runs_commit(MDB_txn **txn, MDB_cursor **cursor, int rc)
+{
+    if (*cursor) {
+        MDB_CURSOR_CLOSE(*cursor);
+        *cursor = NULL;
+    }
+    if (*txn) {
+        if (rc) {
+            TXN_ABORT(*txn);
+        } else {
+            rc = TXN_COMMIT(*txn);
+        }
+        *txn = NULL;
+    }
+    return rc;
+}
+
+/*
+ * Merge the records of a dbi from all the runs and write them in
+ * dbi of env, in key order.
+ */
+static int
+dbmdb_import_runs_merge_dbi(ImportRuns_t *runs, int dbidx, MDB_env *env, MDB_dbi dbi)
+{
+    ImportJob *job = runs->ctx->job;
+    size_t maxrec = RUNREC_SIZE(runs->maxkeysize);
+    ImportRunCursor_t *cursors = NULL;
+    ImportRunCursor_t **heap = NULL;
+    ImportRunRec_t *prev = NULL;
+    MDB_cursor *cursor = NULL;
+    MDB_txn *txn = NULL;
+    MDB_stat st = {0};
+    uint64_t done = 0;
+    int append = 0;
+    int nb = 0;
+    int rc = 0;
+    int i;
+
+    cursors = (ImportRunCursor_t *)slapi_ch_calloc(runs->nbruns, sizeof(ImportRunCursor_t));
+    heap = (ImportRunCursor_t **)slapi_ch_calloc(runs->nbruns, sizeof(ImportRunCursor_t *));
+    prev = (ImportRunRec_t *)slapi_ch_malloc(maxrec);
+    nb = runheap_init(cursors, heap, runs->runarray, runs->nbruns, dbidx, runs->readsize, maxrec);
+    if (nb < 0) {
+        rc = EIO;
+    }
+
+    if (rc == 0 && nb > 0) {
+        rc = dbmdb_import_runs_begin(env, dbi, &txn, &cursor);
+        if (rc == 0) {
+            /* Append mode is only possible if the dbi is empty */
+            append = (mdb_stat(txn, dbi, &st) == 0 && st.ms_entries == 0);
+        }
+    }
+    while (rc == 0 && nb > 0) {
+        ImportRunRec_t *rec = heap[0]->cur;
+        int samekey = (done > 0 && prev->keylen == rec->keylen &&
+                       memcmp(prev->key, rec->key, rec->keylen) == 0);
+
+        if (!samekey || prev->id != rec->id) {
+            MDB_val key = {rec->keylen, rec->key};
+            MDB_val data = {sizeof(ID), &rec->id};
+
+            rc = MDB_CURSOR_PUT(cursor, &key, &data, append ? (samekey ? MDB_APPENDDUP : MDB_APPEND) : 0);
+            if (rc == MDB_KEYEXIST && append) {
+                /* Should not happen: fall back on regular writes */
+                append = 0;
+                rc = MDB_CURSOR_PUT(cursor, &key, &data, 0);
+            }
+            memcpy(prev, rec, RUNREC_SIZE(rec->keylen));
+        }
+        done++;
+
+        if (rc == 0 && (done % RUN_TXN_RECORDS) == 0) {
+            /* Keep the txn reasonably small */
+            rc = dbmdb_import_runs_commit(&txn, &cursor, rc);
+            if (rc == 0) {
+                rc = dbmdb_import_runs_begin(env, dbi, &txn, &cursor);
+            }
+            if (job->flags & FLAG_ABORT) {
+                rc = -1;
+            }
+            dbmdb_import_runs_progress(runs, RUN_TXN_RECORDS);
+        }
+
+        if (rc == 0) {
+            rc = runheap_next(heap, &nb, maxrec);
+        }
+    }
+    rc = dbmdb_import_runs_commit(&txn, &cursor, rc);
+    dbmdb_import_runs_progress(runs, done % RUN_TXN_RECORDS);
+
+    for (i = 0; i < runs->nbruns; i++) {
+        slapi_ch_free_string(&cursors[i].buf);
+    }
+    slapi_ch_free((void **)&cursors);
+    slapi_ch_free((void **)&heap);
+    slapi_ch_free((void **)&prev);
+    return rc;
+}
+
+/* Merge thread: merges dbis in its scratch environment until there is no more */
+static void
+dbmdb_import_runs_merge_thread(void *arg)
+{
+    ImportRunScratch_t *scratch = (ImportRunScratch_t *)arg;
+    ImportRuns_t *runs = scratch->runs;
+    int myidx = scratch - runs->scratch;
+    int dbidx;
+
+    while (scratch->rc == 0) {
+        MDB_txn *txn = NULL;
+        MDB_dbi dbi = 0;
+        char name[16];
+
+        pthread_mutex_lock(&runs->mutex);
+        dbidx = runs->nextdbidx++;
+        pthread_mutex_unlock(&runs->mutex);
+        if (dbidx >= runs->nbdbis || (runs->ctx->job->flags & FLAG_ABORT)) {
+            break;
+        }
+        snprintf(name, sizeof(name), "%d", dbidx);
+        scratch->rc = TXN_BEGIN(scratch->env, NULL, 0, &txn);
+        if (scratch->rc == 0) {
+            scratch->rc = MDB_DBI_OPEN(txn, name, MDB_CREATE | MDB_DUPSORT | MDB_INTEGERDUP | MDB_DUPFIXED, &dbi);
+            if (scratch->rc) {
+                TXN_ABORT(txn);
+            } else {
+                scratch->rc = TXN_COMMIT(txn);
+            }
+        }
+        if (scratch->rc == 0) {
+            scratch->rc = dbmdb_import_runs_merge_dbi(runs, dbidx, scratch->env, dbi);
+        }
+        runs->scratchidx[dbidx] = myidx;
+        runs->scratchdbi[dbidx] = dbi;
+    }
+}
+
+/* Copy IDs of a key in the main environment, a page at a time */
+static int
+dbmdb_import_runs_copy_ids(MDB_cursor *cursor, MDB_val *key, ID *ids, size_t count, int first, int *append)
+{
+    MDB_val data[2] = {{sizeof(ID), ids}, {count, NULL}};
+    int flags = MDB_MULTIPLE;
+    int rc;
+
+    if (*append) {
+        flags |= first ? (MDB_APPEND | MDB_APPENDDUP) : MDB_APPENDDUP;
+    }
+    rc = MDB_CURSOR_PUT(cursor, key, data, flags);
+    if (rc == MDB_KEYEXIST && *append) {
+        /* Should not happen: fall back on regular writes (that ignores existing ids) */
+        *append = 0;
+        rc = 0;
+        for (size_t i = 0; rc == 0 && i < count; i++) {
+            MDB_val id = {sizeof(ID), &ids[i]};
+            rc = MDB_CURSOR_PUT(cursor, key, &id, 0);
+        }
+    }
+    return rc;
+}
+
+/* Copy a dbi from a scratch environment in the main environment */
+static int
+dbmdb_import_runs_copy_dbi(ImportRuns_t *runs, int dbidx, ImportRunScratch_t *scratch)
+{
+    MDB_env *env = runs->ctx->ctx->env;
+    MDB_dbi dbi = runs->dbis[dbidx]->dbi;
+    MDB_cursor *src = NULL;
+    MDB_cursor *dst = NULL;
+    MDB_txn *rtxn = NULL;
+    MDB_txn *txn = NULL;
+    MDB_stat st = {0};
+    MDB_val key = {0};
+    MDB_val data = {0};
+    uint64_t nbids = 0;
+    int append = 0;
+    int rc = 0;
+
+    rc = dbmdb_import_runs_begin(scratch->env, runs->scratchdbi[dbidx], &rtxn, &src);
+    if (rc == 0) {
+        rc = dbmdb_import_runs_begin(env, dbi, &txn, &dst);
+    }
+    if (rc == 0) {
+        append = (mdb_stat(txn, dbi, &st) == 0 && st.ms_entries == 0);
+        rc = MDB_CURSOR_GET(src, &key, &data, MDB_FIRST);
+    }
+    while (rc == 0) {
+        size_t count = 0;
+
+        rc = mdb_cursor_count(src, &count);
+        if (rc == 0 && count == 1) {
+            /* A single id is not stored in a sub database: no GET_MULTIPLE */
+            rc = dbmdb_import_runs_copy_ids(dst, &key, data.mv_data, 1, 1, &append);
+            nbids++;
+        } else if (rc == 0) {
+            int first = 1;
+            rc = MDB_CURSOR_GET(src, &key, &data, MDB_GET_MULTIPLE);
+            while (rc == 0) {
+                rc = dbmdb_import_runs_copy_ids(dst, &key, data.mv_data, data.mv_size / sizeof(ID), first, &append);
+                nbids += data.mv_size / sizeof(ID);
+                first = 0;
+                if (rc == 0) {
+                    rc = MDB_CURSOR_GET(src, &key, &data, MDB_NEXT_MULTIPLE);
+                }
+            }
+            if (rc == MDB_NOTFOUND) {
+                rc = 0;
+            }
+        }
+        if (rc == 0 && nbids >= RUN_TXN_RECORDS) {
+            nbids = 0;
+            rc = dbmdb_import_runs_commit(&txn, &dst, rc);
+            if (rc == 0) {
+                rc = dbmdb_import_runs_begin(env, dbi, &txn, &dst);
+            }
+        }
+        if (rc == 0) {
+            rc = MDB_CURSOR_GET(src, &key, &data, MDB_NEXT_NODUP);
+        }
+    }
+    if (rc == MDB_NOTFOUND) {
+        rc = 0;
+    }
+    rc = dbmdb_import_runs_commit(&txn, &dst, rc);
+    dbmdb_import_runs_commit(&rtxn, &src, 1); /* Read only txn: abort it */
+    return rc;
+}
+
+static int
+dbmdb_import_runs_open_scratch(ImportRuns_t *runs, ImportRunScratch_t *scratch)
+{
+    MDB_envinfo info = {0};
+    int rc = 0;
+
+    scratch->runs = runs;
+    scratch->path = slapi_ch_smprintf("%s/import_scratch.XXXXXX", runs->ctx->ctx->home);
+    if (!mkdtemp(scratch->path)) {
+        rc = errno;
+        slapi_ch_free_string(&scratch->path);
+        return rc;
+    }
+    mdb_env_info(runs->ctx->ctx->env, &info);
+    rc = mdb_env_create(&scratch->env);
+    if (rc == 0) {
+        rc = mdb_env_set_maxdbs(scratch->env, runs->nbdbis);
+    }
+    if (rc == 0) {
+        rc = mdb_env_set_mapsize(scratch->env, info.me_mapsize);
+    }
+    if (rc == 0) {
+        /* Only used by one thread at a time and thrown away at the end */
+        rc = mdb_env_open(scratch->env, scratch->path, MDB_NOSYNC | MDB_NOLOCK | MDB_NOTLS, 0600);
+    }
+    return rc;
+}
+
+static void
+dbmdb_import_runs_close_scratch(ImportRunScratch_t *scratch)
+{
+    char *file = NULL;
+
+    if (scratch->env) {
+        mdb_env_close(scratch->env);
+        scratch->env = NULL;
+    }
+    if (scratch->path) {
+        file = slapi_ch_smprintf("%s/data.mdb", scratch->path);
+        unlink(file);
+        slapi_ch_free_string(&file);
+        file = slapi_ch_smprintf("%s/lock.mdb", scratch->path);
+        unlink(file);
+        slapi_ch_free_string(&file);
+        rmdir(scratch->path);
+        slapi_ch_free_string(&scratch->path);
+    }
+}
+
+/* Merge the dbis in parallel in scratch environments, then copy them */
+static int
+dbmdb_import_runs_merge_parallel(ImportRuns_t *runs, int nbthreads)
+{
+    ImportJob *job = runs->ctx->job;
+    ImportRunScratch_t *scratch = NULL;
+    PRThread **threads = NULL;
+    int rc = 0;
+    int i;
+
+    scratch = (ImportRunScratch_t *)slapi_ch_calloc(nbthreads, sizeof(ImportRunScratch_t));
+    threads = (PRThread **)slapi_ch_calloc(nbthreads, sizeof(PRThread *));
+    runs->scratch = scratch;
+    runs->scratchidx = (int *)slapi_ch_calloc(runs->nbdbis, sizeof(int));
+    runs->scratchdbi = (MDB_dbi *)slapi_ch_calloc(runs->nbdbis, sizeof(MDB_dbi));
+
+    for (i = 0; rc == 0 && i < nbthreads; i++) {
+        rc = dbmdb_import_runs_open_scratch(runs, &scratch[i]);
+        if (rc) {
+            import_log_notice(job, SLAPI_LOG_ERR, "dbmdb_import_runs_merge",
+                              "Failed to create a scratch database in %s. Error %d: %s",
+                              runs->ctx->ctx->home, rc, mdb_strerror(rc));
+        }
+    }
+    for (i = 0; rc == 0 && i < nbthreads; i++) {
+        threads[i] = PR_CreateThread(PR_USER_THREAD, dbmdb_import_runs_merge_thread, &scratch[i],
+                                     PR_PRIORITY_NORMAL, PR_GLOBAL_BOUND_THREAD,
+                                     PR_JOINABLE_THREAD, SLAPD_DEFAULT_THREAD_STACKSIZE);
+        if (!threads[i]) {
+            rc = -1;
+            job->flags |= FLAG_ABORT; /* Stops the threads that are already running */
+        }
+    }
+    for (i = 0; i < nbthreads; i++) {
+        if (threads[i]) {
+            PR_JoinThread(threads[i]);
+        }
+        if (rc == 0) {
+            rc = scratch[i].rc;
+        }
+    }
+
+    if (rc == 0) {
+        import_log_notice(job, SLAPI_LOG_INFO, "dbmdb_import_runs_merge",
+                          "Copying %d indexes from the scratch databases.", runs->nbdbis);
+    }
+    for (i = 0; rc == 0 && i < runs->nbdbis; i++) {
+        rc = dbmdb_import_runs_copy_dbi(runs, i, &scratch[runs->scratchidx[i]]);
+        if (rc == 0 && (job->flags & FLAG_ABORT)) {
+            rc = -1;
+        }
+    }
+
+    for (i = 0; i < nbthreads; i++) {
+        dbmdb_import_runs_close_scratch(&scratch[i]);
+    }
+    runs->scratch = NULL;
+    slapi_ch_free((void **)&scratch);
+    slapi_ch_free((void **)&threads);
+    return rc;
+}
+
+/*
+ * Merge the sorted runs and write the indexes.
+ * Called once the worker and writer threads are finished.
+ */
+int
+dbmdb_import_runs_merge(ImportCtx_t *ctx)
+{
+    ImportRuns_t *runs = ctx->runs;
+    ImportJob *job = ctx->job;
+    WorkerQueueData_t *slots = ctx->workerq.slots;
+    ImportRun_t *run = NULL;
+    int nbthreads = 0;
+    int rc = 0;
+    int i;
+
+    if (!runs) {
+        return 0;
+    }
+    /* What is left in the worker buffers are in memory runs */
+    for (i = 0; i < ctx->workerq.max_slots; i++) {
+        ImportRunBuf_t *buf = slots[i].runbuf;
+        if (buf && buf->nbrecs) {
+            int nextdbidx = 0;
+            run = CALLOC(ImportRun_t);
+            run->recs = dbmdb_import_runbuf_sort(buf);
+            run->nbrecs = buf->nbrecs;
+            run->size = buf->used;
+            run->mem = buf->mem;
+            buf->mem = NULL;
+            run->starts = (uint64_t *)slapi_ch_calloc(runs->nbdbis + 1, sizeof(uint64_t));
+            for (size_t r = 0; r < run->nbrecs; r++) {
+                while (nextdbidx <= run->recs[r]->dbidx) {
+                    run->starts[nextdbidx++] = r;
+                }
+            }
+            while (nextdbidx <= runs->nbdbis) {
+                run->starts[nextdbidx++] = run->nbrecs;
+            }
+            dbmdb_import_runs_add(runs, run, 0);
+        }
+        dbmdb_import_runbuf_free(&slots[i].runbuf);
+    }
+    if (runs->nbruns == 0) {
+        return 0;
+    }
+    rc = dbmdb_import_runs_compact(runs, 1);
+    if (rc) {
+        return rc;
+    }
+    runs->runarray = (ImportRun_t **)slapi_ch_calloc(runs->nbruns, sizeof(ImportRun_t *));
+    for (i = 0, run = runs->runs; run; run = run->next) {
+        runs->runarray[i++] = run;
+    }
+    runs->next_report = runs->nbrecs / 10 + 1;
+
+    nbthreads = util_get_capped_hardware_threads(1, MAX_WORKER_SLOTS);
+    if (nbthreads > runs->nbdbis) {
+        nbthreads = runs->nbdbis;
+    }
+    /* Each thread reads all the run files */
+    runs->readsize = runs_readsize(runs, runs->nbfileruns * nbthreads);
+    import_log_notice(job, SLAPI_LOG_INFO, "dbmdb_import_runs_merge",
+                      "Merging %d sorted runs of index keys (%" PRIu64 " keys, %" PRIu64 " bytes written in run files) with %d threads.",
+                      runs->nbruns, runs->nbrecs, runs->spilled, nbthreads);
+
+    if (nbthreads > 1) {
+        rc = dbmdb_import_runs_merge_parallel(runs, nbthreads);
+    } else {
+        for (i = 0; rc == 0 && i < runs->nbdbis; i++) {
+            rc = dbmdb_import_runs_merge_dbi(runs, i, ctx->ctx->env, runs->dbis[i]->dbi);
+        }
+    }
+    if (rc) {
+        import_log_notice(job, SLAPI_LOG_ERR, "dbmdb_import_runs_merge",
+                          "Failed to write the index keys in the database. Error is 0x%x: %s.",
+                          rc, rc > 0 ? mdb_strerror(rc) : "import aborted");
+    }
+    return rc;
+}
@@ -21,6 +21,7 @@
  */
 
 #include <stddef.h>
+#include <sys/mman.h>
 #include "mdb_import.h"
 #include "../vlv_srch.h"
 
@@ -46,15 +47,17 @@
 typedef struct {
     back_txn txn;
     ImportCtx_t *ctx;
+    WorkerQueueData_t *slot; /* worker slot (for the sorted index runs) */
 } PseudoTxn_t;
 
 typedef enum { PEA_OK, PEA_ABORT, PEA_RENAME, PEA_DUPDN, PEA_SKIP, PEA_TOMBSTONE } ProcessEntryAction_t;
 
 typedef struct backentry backentry;
-static PseudoTxn_t init_pseudo_txn(ImportCtx_t *ctx);
+static PseudoTxn_t init_pseudo_txn(ImportCtx_t *ctx, WorkerQueueData_t *slot);
 static int cmp_mii(caddr_t data1, caddr_t data2);
 static int have_workers_finished(ImportJob *job);
 static void dbmdb_import_writeq_push(ImportCtx_t *ctx, WriterQueueData_t *wqd);
+static void dbmdb_import_index_push(ImportCtx_t *ctx, WorkerQueueData_t *slot, WriterQueueData_t *wqd);
 struct backentry *dbmdb_import_prepare_worker_entry(WorkerQueueData_t *wqelmnt);
 
 static inline void __attribute__((always_inline))
@@ -204,6 +207,9 @@ typedef struct
     char *b;       /* buffer */
     size_t size;   /* how full the buffer is */
     size_t offset; /* where the current entry starts */
+    char *map;     /* the whole file when it is mapped (then b is unused) */
+    size_t mapsize;
+    size_t mapoffset; /* where the next entry starts in map */
 } ldif_context;
 
 static void
@@ -211,6 +217,46 @@ dbmdb_import_init_ldif(ldif_context *c)
 {
     c->size = c->offset = 0;
     c->b = NULL;
+    c->map = NULL;
+    c->mapsize = c->mapoffset = 0;
+}
+
+/*
+ * Map a regular LDIF file in memory, so that the producer only has to
+ * look for the entries boundaries instead of copying the data
+ * through a small read buffer.
+ * Returns 0 if the file is mapped. Otherwise (pipe, stdin, empty file,
+ * address space exhausted) the entries are read from the fd.
+ */
+static int
+dbmdb_import_map_ldif(ldif_context *c, int fd)
+{
+    struct stat st = {0};
+    void *map = NULL;
+
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size == 0 ||
+        (uint64_t)st.st_size > (uint64_t)SIZE_MAX) {
+        return -1;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    (void)madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    c->map = map;
+    c->mapsize = (size_t)st.st_size;
+    c->mapoffset = 0;
+    return 0;
+}
+
+static void
+dbmdb_import_unmap_ldif(ldif_context *c)
+{
+    if (c->map) {
+        munmap(c->map, c->mapsize);
+        c->map = NULL;
+        c->mapsize = c->mapoffset = 0;
+    }
 }
 
 static void
@@ -218,9 +264,81 @@ dbmdb_import_free_ldif(ldif_context *c)
 {
     if (c->b)
         FREE(c->b);
+    dbmdb_import_unmap_ldif(c);
     dbmdb_import_init_ldif(c);
 }
 
+/*
+ * Get the next entry from a mapped LDIF file.
+ * An entry ends with an empty line ("\n\n" or "\n\r\n"), continuation
+ * lines start with a space so they never look like an entry boundary.
+ * *lineno is the number of lines before the entry on input and is
+ * updated to the number of lines up to the end of the entry.
+ * *nblines is set to the number of lines of the entry.
+ */
+static char *
+dbmdb_import_get_mapped_entry(ldif_context *c, int *lineno, int *nblines)
+{
+    const char *map = c->map;
+    const char *end = map + c->mapsize;
+    const char *pt = map + c->mapoffset;
+    const char *start = NULL;
+    char *estr = NULL;
+    int lines = 0;
+    size_t len;
+
+    /* skip blank lines at start of entry */
+    for (; pt < end; pt++) {
+        if (*pt == '\n') {
+            (*lineno)++;
+        } else if (!(*pt == '\r' || *pt == ' ' || *pt == '\t')) {
+            break;
+        }
+    }
+    if (pt >= end) {
+        c->mapoffset = c->mapsize;
+        *nblines = 0;
+        return NULL;
+    }
+
+    start = pt;
+    for (;;) {
+        pt = memchr(pt, '\n', end - pt);
+        if (pt == NULL) {
+            /* last entry without trailing empty line */
+            pt = end;
+            lines++;
+            break;
+        }
+        pt++;
+        lines++;
+        if (pt < end && *pt == '\n') {
+            pt++;
+            lines++;
+            break;
+        }
+        if (pt + 1 < end && pt[0] == '\r' && pt[1] == '\n') {
+            pt += 2;
+            lines++;
+            break;
+        }
+        if (pt >= end) {
+            break;
+        }
+    }
+
+    /* str2entry parses the entry in place: give it its own copy */
+    len = pt - start;
+    estr = slapi_ch_malloc(len + 1);
+    memcpy(estr, start, len);
+    estr[len] = 0;
+
+    c->mapoffset = pt - map;
+    *lineno += lines;
+    *nblines = lines;
+    return estr;
+}
+
 static char *
 dbmdb_import_get_entry(ldif_context *c, int fd, int *lineno)
 {
@@ -481,7 +599,7 @@ dbmdb_import_producer(void *param)
         /* move on to next file? */
         if (detected_eof) {
             /* check if the file can still be read, whine if so... */
-            if (read(fd, (void *)&idx, 1) > 0) {
+            if (!c.map && read(fd, (void *)&idx, 1) > 0) {
                 import_log_notice(job, SLAPI_LOG_WARNING, "dbmdb_import_producer", "Unexpected end of file found "
                                                                              "at line %d of file \"%s\"",
                                   curr_lineno,
@@ -497,6 +615,7 @@ dbmdb_import_producer(void *param)
                                                                           "entries)",
                                   curr_filename, (u_long)(id - id_filestart));
             }
+            dbmdb_import_unmap_ldif(&c);
             close(fd);
             fd = -1;
             detected_eof = 0;
@@ -537,6 +656,8 @@ dbmdb_import_producer(void *param)
             } else {
                 import_log_notice(job, SLAPI_LOG_INFO, "dbmdb_import_producer",
                                   "Processing file \"%s\"", curr_filename);
+                /* Read through the fd if the file cannot be mapped */
+                (void)dbmdb_import_map_ldif(&c, fd);
             }
         }
         while ((info->command == PAUSE) && !info_is_finished(info)) {
@@ -549,9 +670,14 @@ dbmdb_import_producer(void *param)
         }
 
         wqelmt.wait_id = id;
-        wqelmt.lineno = curr_lineno;
-        wqelmt.data = dbmdb_import_get_entry(&c, fd, &curr_lineno);
-        wqelmt.nblines = curr_lineno - wqelmt.lineno;
+        if (c.map) {
+            wqelmt.data = dbmdb_import_get_mapped_entry(&c, &curr_lineno, &wqelmt.nblines);
+            wqelmt.lineno = curr_lineno - wqelmt.nblines;
+        } else {
+            wqelmt.lineno = curr_lineno;
+            wqelmt.data = dbmdb_import_get_entry(&c, fd, &curr_lineno);
+            wqelmt.nblines = curr_lineno - wqelmt.lineno;
+        }
         wqelmt.datalen = 0;
         if (!wqelmt.data) {
             /* error reading entry, or end of file */
@@ -820,6 +946,7 @@ dbmdb_index_producer(void *param)
     MDB_cursor *dbc = NULL;
     MDB_val datacopy = {0};
     char *id2entry = NULL;
+    MDB_stat st = {0};
     MDB_txn *txn = NULL;
     MDB_val data = {0};
     MDB_val key = {0};
@@ -884,6 +1011,10 @@ dbmdb_index_producer(void *param)
                     errinfo = "open cursor";
                     continue;
                 }
+                if (mdb_stat(txn, db->dbi, &st) == 0) {
+                    /* Used to report the progress */
+                    ctx->nbentries = st.ms_entries;
+                }
                 rc = MDB_CURSOR_GET(dbc, &key, &data, MDB_FIRST);
                 break;
             case TXS_RESET:
@@ -1915,7 +2046,7 @@ process_foreman(backentry *ep, WorkerQueueData_t *wqelmnt)
     ldbm_instance *inst = job->inst;
     backend *be = inst->inst_be;
     /* Pseudo txn redirects database write towards import_txn_callback callback */
-    PseudoTxn_t txn = init_pseudo_txn(job->writer_ctx);
+    PseudoTxn_t txn = init_pseudo_txn(job->writer_ctx, NULL);
     int ret = 0;
 
 
@@ -2247,14 +2378,14 @@ slapi_log_error(SLAPI_LOG_ERR, "process_entryrdn_by_rdn", "rdn=%s nrdn=%s pid=%d
         /* Update parentid */
         wqd.dbi = ctx->parentid->dbi;
         prepare_ids(&wqd, pid, &ep->ep_id);
-        dbmdb_import_writeq_push(ctx, &wqd);
+        dbmdb_import_index_push(ctx, wqelmnt, &wqd);
         dbmdb_add_op_attrs(job, ep, pid);  /* Before loosing the pid */
 
         /* Update ancestorid */
         wqd.dbi = ctx->ancestorid->dbi;
         while (elem) {
             prepare_ids(&wqd, elem->eid, &ep->ep_id);
-            dbmdb_import_writeq_push(ctx, &wqd);
+            dbmdb_import_index_push(ctx, wqelmnt, &wqd);
             pid = elem->pid;
             rdncache_elem_release(&elem);
             elem = rdncache_id_lookup(ctx->rdncache, wqelmnt, pid);
@@ -2432,13 +2563,13 @@ process_entryrdn(backentry *ep, WorkerQueueData_t *wqelmnt)
         if (ancestors[0]) {
             wqd.dbi = ctx->parentid->dbi;
             prepare_ids(&wqd, pid, &ep->ep_id);
-            dbmdb_import_writeq_push(ctx, &wqd);
+            dbmdb_import_index_push(ctx, wqelmnt, &wqd);
         }
         /* And ancestorid index */
         while (ancestors[idx]) {
             wqd.dbi = ctx->ancestorid->dbi;
             prepare_ids(&wqd, ancestors[idx], &ep->ep_id);
-            dbmdb_import_writeq_push(ctx, &wqd);
+            dbmdb_import_index_push(ctx, wqelmnt, &wqd);
             idx++;
         }
     }
@@ -2475,7 +2606,8 @@ process_regular_index(backentry *ep, ImportWorkerInfo *info)
     MdbIndexInfo_t *mii = NULL;
     Slapi_Attr *attr = NULL;
     char *attrname = NULL;
-    PseudoTxn_t txn = init_pseudo_txn(ctx);
+    /* info is the winfo field of the worker slot */
+    PseudoTxn_t txn = init_pseudo_txn(ctx, (WorkerQueueData_t *)info);
 
     for (slapi_entry_first_attr(ep->ep_entry, &attr); attr; slapi_entry_next_attr(ep->ep_entry, attr, &attr)) {
         Slapi_Value val = {0};
@@ -2554,7 +2686,7 @@ process_vlv_index(backentry *ep, ImportWorkerInfo *info)
     ImportCtx_t *ctx = job->writer_ctx;
     ldbm_instance *inst = job->inst;
     backend *be = inst->inst_be;
-    PseudoTxn_t txn = init_pseudo_txn(ctx);
+    PseudoTxn_t txn = init_pseudo_txn(ctx, NULL);
     struct vlvSearch *ps;
     int ret = 0;
 
@@ -2593,17 +2725,22 @@ import_txn_callback(backend *be, back_txn_action flags, dbi_db_t *db, dbi_val_t
     if (wqd.data.mv_size == sizeof (index_update_t)) {
         wqd.data.mv_size = sizeof (ID);
     }
-    dbmdb_import_writeq_push(t->ctx, &wqd);
+    if (flags == BTXNACT_INDEX_ADD) {
+        dbmdb_import_index_push(t->ctx, t->slot, &wqd);
+    } else {
+        dbmdb_import_writeq_push(t->ctx, &wqd);
+    }
     return 0;
 }
 
 static PseudoTxn_t
-init_pseudo_txn(ImportCtx_t *ctx)
+init_pseudo_txn(ImportCtx_t *ctx, WorkerQueueData_t *slot)
 {
     PseudoTxn_t t;
     t.txn.back_txn_txn = (dbi_txn_t *) 0xBadCafef;   /* Make sure the txn is not used */
     t.txn.back_special_handling_fn = import_txn_callback;
     t.ctx = ctx;
+    t.slot = slot;
     return t;
 }
 
@@ -2746,12 +2883,13 @@ cmp_mii(caddr_t data1, caddr_t data2)
 }
 
 /* Create MdbIndexInfo_t for the naming attributes that are missing */
-void
+static int
 dbmdb_add_import_index(ImportCtx_t *ctx, const char *name, IndexInfo *ii)
 {
     int dbi_flags = MDB_CREATE|MDB_MARK_DIRTY_DBI|MDB_OPEN_DIRTY_DBI|MDB_TRUNCATE_DBI;
     ImportJob *job = ctx->job;
     MdbIndexInfo_t *mii;
+    int rc = 0;
     static const struct {
         char *name;
         int flags;
@@ -2795,18 +2933,27 @@ dbmdb_add_import_index(ImportCtx_t *ctx, const char *name, IndexInfo *ii)
         }
     }
 
-    dbmdb_open_dbi_from_filename(&mii->dbi, job->inst->inst_be, mii->name, NULL, dbi_flags);
+    if (job->flags & FLAG_SHADOW_INDEX) {
+        /* Keep the index online: rebuild it in a shadow dbi
+         * (inserted even on failure, so that the cleanup removes
+         *  the shadow dbis that got opened) */
+        rc = dbmdb_import_shadow_open(ctx, mii);
+    } else {
+        dbmdb_open_dbi_from_filename(&mii->dbi, job->inst->inst_be, mii->name, NULL, dbi_flags);
+    }
     avl_insert(&ctx->indexes, mii, cmp_mii, NULL);
+    return rc;
 }
 
-void
+int
 dbmdb_build_import_index_list(ImportCtx_t *ctx)
 {
     ImportJob *job = ctx->job;
     IndexInfo *ii;
+    int rc = 0;
 
     if (ctx->role != IM_UPGRADE) {
-            for (ii=job->index_list; ii; ii=ii->next) {
+            for (ii=job->index_list; ii && rc == 0; ii=ii->next) {
             if (ii->ai->ai_indexmask == INDEX_VLV) {
                 continue;
             }
@@ -2814,22 +2961,26 @@ dbmdb_build_import_index_list(ImportCtx_t *ctx)
             if (ctx->indexAttrs && !(attr_in_list(ii->ai->ai_type, ctx->indexAttrs))) {
                 continue;
             }
-            dbmdb_add_import_index(ctx, NULL, ii);
+            rc = dbmdb_add_import_index(ctx, NULL, ii);
         }
     }
+    if (rc) {
+        return rc;
+    }
 
     /* If a naming attribute is present, make sure that all of the are rebuilt */
     if (ctx->entryrdn || ctx->parentid || ctx->ancestorid || ctx->role != IM_INDEX) {
-        if (!ctx->entryrdn) {
-            dbmdb_add_import_index(ctx, LDBM_ENTRYRDN_STR, NULL);
+        if (!ctx->entryrdn && rc == 0) {
+            rc = dbmdb_add_import_index(ctx, LDBM_ENTRYRDN_STR, NULL);
         }
-        if (!ctx->parentid) {
-            dbmdb_add_import_index(ctx, LDBM_PARENTID_STR, NULL);
+        if (!ctx->parentid && rc == 0) {
+            rc = dbmdb_add_import_index(ctx, LDBM_PARENTID_STR, NULL);
         }
-        if (!ctx->ancestorid) {
-            dbmdb_add_import_index(ctx, LDBM_ANCESTORID_STR, NULL);
+        if (!ctx->ancestorid && rc == 0) {
+            rc = dbmdb_add_import_index(ctx, LDBM_ANCESTORID_STR, NULL);
         }
     }
+    return rc;
 }
 
 void
@@ -3380,6 +3531,17 @@ void dbmdb_import_writeq_push(ImportCtx_t *ctx, WriterQueueData_t *wqd)
     }
 }
 
+/* Queue an index key in the worker sorted run if its index is built by
+ * sort-merge, otherwise in the writer queue.
+ */
+static void
+dbmdb_import_index_push(ImportCtx_t *ctx, WorkerQueueData_t *slot, WriterQueueData_t *wqd)
+{
+    if (dbmdb_import_runs_push(ctx, slot, wqd)) {
+        dbmdb_import_writeq_push(ctx, wqd);
+    }
+}
+
 int
 dbmdb_import_init_writer(ImportJob *job, ImportRole_t role)
 {
@@ -3448,7 +3610,13 @@ void
 dbmdb_free_import_ctx(ImportJob *job)
 {
     ImportCtx_t *ctx = job->writer_ctx;
+    int i;
+
     job->writer_ctx = NULL;
+    for (i = 0; i < ctx->workerq.max_slots; i++) {
+        dbmdb_import_runbuf_free(&ctx->workerq.slots[i].runbuf);
+    }
+    dbmdb_import_runs_free(&ctx->runs);
     pthread_mutex_destroy(&ctx->workerq.mutex);
     pthread_cond_destroy(&ctx->workerq.cv);
     slapi_ch_free((void**)&ctx->workerq.slots);
@@ -623,6 +623,9 @@ int dbmdb_make_env(dbmdb_ctx_t *ctx, int readOnly, mdb_mode_t mode)
     if (rc ==0) {
         rc = mdb_env_info(env, &envinfo);
     }
+    if (rc ==0) {
+        dbmdb_txn_group_start(ctx, readOnly);
+    }
     if (rc ==0) { /* Update the INFO file with the real size provided by the db */
         dbmdb_cfg_t oldcfg = ctx->startcfg;
         ctx->startcfg.max_size = envinfo.me_mapsize;
@@ -668,6 +671,11 @@ void dbmdb_ctx_close(dbmdb_ctx_t *ctx)
          */
     }
     if (ctx->env) {
+        dbmdb_txn_pool_flush(ctx->env);
+        if (ctx->group_commit.active) {
+            /* Env is open with MDB_NOSYNC */
+            mdb_env_sync(ctx->env, 1);
+        }
         mdb_env_close(ctx->env);
         ctx->env = NULL;
     }
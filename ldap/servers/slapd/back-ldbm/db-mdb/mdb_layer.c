@@ -82,6 +82,8 @@ static int dbmdb_force_checkpoint(struct ldbminfo *li);
 #define FLUSH_REMOTEOFF 0
 
 static const char *backupfilelists[] = { INFOFILE, DBMAPFILE, DSE_INSTANCE, DSE_INDEX, NULL };
+static const char *backupoptfilelists[] = { PAGEMAPFILE, DELTAFILE, NULL }; /* Not in older backups */
+static const char *streamconffilelists[] = { DSE_INSTANCE, DSE_INDEX, INFOFILE, NULL }; /* Streamed before the db */
 
 /*
  * return nsslapd-db-home-directory (dbmdb_dbhome_directory), if exists.
@@ -234,6 +236,10 @@ dbmdb_instance_start(backend *be, int mode)
 
     /* Now attempt to open the instance files */
     return_value = dbmdb_open_all_files(ctx, be);
+    if (return_value == 0 && (mode & DBLAYER_NORMAL_MODE)) {
+        /* An online reindex may have been interrupted */
+        dbmdb_shadow_remove_stale(ctx, be);
+    }
     if (return_value == 0) {
         id2entry_dbi = (dbmdb_dbi_t*)(inst->inst_id2entry);
         if ((mode & DBLAYER_NORMAL_MODE) && id2entry_dbi->state.dataversion != DBMDB_CURRENT_DATAVERSION) {
@@ -578,6 +584,9 @@ dbmdb_txn_begin(struct ldbminfo *li, back_txnid parent_txn, back_txn *txn, PRBoo
                 slapi_rwlock_unlock(&conf->dbmdb_env_lock);
         } else {
             new_txn.back_txn_txn = new_txn_back_txn_txn;
+            if (use_lock && dbmdb_is_toplevel_txn(new_txn_back_txn_txn)) {
+                dbmdb_txn_group_enter(conf);
+            }
             /* this txn is now our current transaction for current operations
                and new parent for any nested transactions created */
             dblayer_push_pvt_txn(&new_txn);
@@ -604,6 +613,7 @@ dbmdb_txn_commit(struct ldbminfo *li, back_txn *txn, PRBool use_lock)
     dblayer_private *priv = NULL;
     dbi_txn_t *db_txn = NULL;
     back_txn *cur_txn = NULL;
+    int grouped = 0;
 
     PR_ASSERT(NULL != li);
 
@@ -630,7 +640,17 @@ dbmdb_txn_commit(struct ldbminfo *li, back_txn *txn, PRBool use_lock)
         if (!txn || (cur_txn && (cur_txn->back_txn_txn == db_txn))) {
             dblayer_pop_pvt_txn();
         }
+        grouped = use_lock && dbmdb_is_toplevel_txn(db_txn);
+        if (grouped) {
+            dbmdb_txn_group_join(db_txn);
+        }
         return_value = END_TXN(&db_txn, 0);
+        if (grouped && return_value == 0) {
+            /* dbmdb_txn_wait makes it durable, once the backend lock is released */
+            dbmdb_txn_group_committed(conf);
+        } else if (grouped) {
+            dbmdb_txn_group_leave(conf);
+        }
         return_value = dbmdb_map_error(__FUNCTION__, return_value);
         if (txn) {
             /* this handle is no longer value - set it to NULL */
@@ -653,6 +673,24 @@ dbmdb_txn_commit(struct ldbminfo *li, back_txn *txn, PRBool use_lock)
     return return_value;
 }
 
+/* Wait until the operation txn committed by the thread is durable (group commit) */
+int
+dbmdb_txn_wait(struct ldbminfo *li)
+{
+    int return_value = dbmdb_txn_group_wait(MDB_CONFIG(li));
+
+    return_value = dbmdb_map_error(__FUNCTION__, return_value);
+    if (0 != return_value) {
+        slapi_log_err(SLAPI_LOG_CRIT,
+                      "dbmdb_txn_wait", "Serious Error---Failed to sync the committed txn, err=%d (%s)\n",
+                      return_value, dblayer_strerror(return_value));
+        if (LDBM_OS_ERR_IS_DISKFULL(return_value)) {
+            operation_out_of_disk_space();
+        }
+    }
+    return return_value;
+}
+
 int
 dbmdb_txn_abort(struct ldbminfo *li, back_txn *txn, PRBool use_lock)
 {
@@ -687,6 +725,9 @@ dbmdb_txn_abort(struct ldbminfo *li, back_txn *txn, PRBool use_lock)
         if (!txn || (cur_txn && (cur_txn->back_txn_txn == db_txn))) {
             dblayer_pop_pvt_txn();
         }
+        if (use_lock && dbmdb_is_toplevel_txn(db_txn)) {
+            dbmdb_txn_group_leave(conf);
+        }
         END_TXN(&db_txn, 1);
         return_value = 0;
         if (txn) {
@@ -875,9 +916,12 @@ error:
     return return_value;
 }
 
-/* Destination Directory is an absolute pathname */
-int
-dbmdb_backup(struct ldbminfo *li, char *dest_dir, Slapi_Task *task)
+/*
+ * Destination Directory is an absolute pathname
+ * If base_dir is not NULL, only the pages changed since that backup are saved
+ */
+static int
+dbmdb_backup_ext(struct ldbminfo *li, char *dest_dir, char *base_dir, Slapi_Task *task)
 {
     int return_value = LDAP_UNWILLING_TO_PERFORM;
     dblayer_private *priv = NULL;
@@ -907,7 +951,7 @@ dbmdb_backup(struct ldbminfo *li, char *dest_dir, Slapi_Task *task)
      * What are we doing here ?
      * check that destinantion is OK
      * We want to copy into the backup directory:
-     * The mdb database
+     * The mdb database (or its changed pages) and its page map
      * The info file
      */
 
@@ -937,7 +981,7 @@ dbmdb_backup(struct ldbminfo *li, char *dest_dir, Slapi_Task *task)
         goto error_out;
     }
     /* Copy the mdb database */
-    return_value = mdb_env_copy(conf->env, dest_dir);
+    return_value = dbmdb_backup_pages(conf, dest_dir, base_dir, li->li_mode, task);
     if (return_value) {
         slapi_log_err(SLAPI_LOG_ERR, "dbmdb_backup", "Failed to backup mdb database to %s.\n", dest_dir);
         if (task) {
@@ -983,12 +1027,121 @@ error_out:
         unlink(pathname2);
         slapi_ch_free_string(&pathname2);
     }
+    for (pt=backupoptfilelists; *pt; pt++) {
+        pathname2 = slapi_ch_smprintf("%s/%s", dest_dir, *pt);
+        unlink(pathname2);
+        slapi_ch_free_string(&pathname2);
+    }
     rmdir(dest_dir);
     return_value = LDAP_UNWILLING_TO_PERFORM;
 bail:
     return return_value;
 }
 
+int
+dbmdb_backup(struct ldbminfo *li, char *dest_dir, Slapi_Task *task)
+{
+    return dbmdb_backup_ext(li, dest_dir, NULL, task);
+}
+
+int
+dbmdb_backup_incremental(struct ldbminfo *li, char *dest_dir, char *base_dir, Slapi_Task *task)
+{
+    return dbmdb_backup_ext(li, dest_dir, base_dir, task);
+}
+
+static void
+dbmdb_stream_remove_scratch(char **scratch)
+{
+    const char **pt;
+    char *pathname;
+
+    if (*scratch) {
+        for (pt = streamconffilelists; *pt; pt++) {
+            pathname = slapi_ch_smprintf("%s/%s", *scratch, *pt);
+            unlink(pathname);
+            slapi_ch_free_string(&pathname);
+        }
+        /* A restore that failed before the swap leaves its database copy */
+        pathname = slapi_ch_smprintf("%s/%s", *scratch, DBMAPFILE);
+        unlink(pathname);
+        slapi_ch_free_string(&pathname);
+        rmdir(*scratch);
+        slapi_ch_free_string(scratch);
+    }
+}
+
+/*
+ * Streamed backup: the files of a backup directory are written in fd
+ * (see mdb_stream.c) so that no disk space is needed for the copy.
+ * The database comes last: a restore checks the other files before
+ * replacing the current database.
+ */
+int
+dbmdb_backup_stream(struct ldbminfo *li, int fd, int flags, Slapi_Task *task)
+{
+    dbmdb_ctx_t *conf = MDB_CONFIG(li);
+    dbmdb_env_copy_t copy = {0};
+    char *scratch = NULL;
+    int copyfd = -1;
+    int rc = 0;
+
+    if (g_get_shutdown() || c_get_shutdown()) {
+        slapi_log_err(SLAPI_LOG_WARNING, "dbmdb_backup_stream", "Server shutting down, backup aborted\n");
+        return -1;
+    }
+
+    /* The index configuration is small: it is generated in a scratch directory */
+    scratch = slapi_ch_smprintf("%s/backup_stream.XXXXXX", conf->home);
+    if (!mkdtemp(scratch)) {
+        rc = errno;
+        slapi_ch_free_string(&scratch);
+    } else if (dbmdb_dse_conf_backup(li, scratch)) {
+        rc = EIO;
+    }
+    if (!rc) {
+        rc = dbmdb_stream_write_header(fd, flags);
+    }
+    if (!rc) {
+        rc = dbmdb_stream_write_file(fd, scratch, DSE_INSTANCE);
+    }
+    if (!rc) {
+        rc = dbmdb_stream_write_file(fd, scratch, DSE_INDEX);
+    }
+    if (!rc) {
+        rc = dbmdb_stream_write_file(fd, conf->home, INFOFILE);
+    }
+    if (!rc) {
+        copyfd = dbmdb_env_copy_begin(&copy, conf->env, (flags & DBLAYER_BACKUP_COMPACT) ? MDB_CP_COMPACT : 0);
+        if (copyfd < 0) {
+            rc = errno;
+        }
+    }
+    if (copyfd >= 0) {
+        rc = dbmdb_stream_write_fd(fd, DBMAPFILE, li->li_mode, copyfd);
+        if (dbmdb_env_copy_end(&copy, copyfd) && !rc) {
+            rc = EIO;
+        }
+    }
+    if (!rc) {
+        rc = dbmdb_stream_write_end(fd);
+    }
+    dbmdb_stream_remove_scratch(&scratch);
+
+    if (rc) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_backup_stream", "Failed to stream the backup: %s (%d)\n",
+                      slapi_system_strerror(rc), rc);
+        if (task) {
+            slapi_task_log_notice(task, "dbmdb_backup_stream - Failed to stream the backup: %s (%d)",
+                                  slapi_system_strerror(rc), rc);
+        }
+        return LDAP_UNWILLING_TO_PERFORM;
+    }
+    slapi_log_err(SLAPI_LOG_INFO, "dbmdb_backup_stream", "Backup streamed%s.\n",
+                  (flags & DBLAYER_BACKUP_COMPACT) ? " (compacted database)" : "");
+    return 0;
+}
+
 
 /*
  * Restore is pretty easy.
@@ -1020,13 +1173,43 @@ dbmdb_restore_file(struct ldbminfo *li, Slapi_Task *task, const char *src_dir, c
     return 0;
 }
 
+/* Start the restored database */
+static int
+dbmdb_restore_restart(struct ldbminfo *li, Slapi_Task *task)
+{
+    int dbmode = DBLAYER_RESTORE_NO_RECOVERY_MODE;
+    int tmp_rval;
+
+    slapi_ch_free(&li->li_dblayer_config);  /* mdb_init will recreate it */
+    mdb_init(li, NULL);
+    tmp_rval = dbmdb_start(li, dbmode);
+    if (0 != tmp_rval) {
+        slapi_log_err(SLAPI_LOG_ERR,
+                      "dbmdb_restore", "Failed to init database\n");
+        if (task) {
+            slapi_task_log_notice(task, "dbmdb_restore - Failed to init database");
+        }
+        return tmp_rval;
+    }
+
+    if (li->li_flags & SLAPI_TASK_RUNNING_FROM_COMMANDLINE) {
+        /* command line: close the database down again */
+        tmp_rval = dblayer_close(li, dbmode);
+        if (0 != tmp_rval) {
+            slapi_log_err(SLAPI_LOG_ERR, "dbmdb_restore", "Failed to close database\n");
+        }
+    } else {
+        allinstance_set_busy(li); /* on-line mode */
+    }
+    return tmp_rval;
+}
+
 int
 dbmdb_restore(struct ldbminfo *li, char *src_dir, Slapi_Task *task)
 {
     dblayer_private *priv = NULL;
     int return_value = 0;
     int tmp_rval;
-    int dbmode = DBLAYER_RESTORE_NO_RECOVERY_MODE;
     struct stat sbuf;
     const char **pt;
     char *pathname;
@@ -1061,7 +1244,9 @@ dbmdb_restore(struct ldbminfo *li, char *src_dir, Slapi_Task *task)
 
     /* Check that all files are present and not empty */
     for (pt=backupfilelists; *pt; pt++) {
-        pathname = slapi_ch_smprintf("%s/%s", src_dir, *pt);
+        /* An incremental backup has the changed pages instead of the database */
+        const char *filename = (strcmp(*pt, DBMAPFILE) || !dbmdb_backup_is_incremental(src_dir)) ? *pt : DELTAFILE;
+        pathname = slapi_ch_smprintf("%s/%s", src_dir, filename);
         if (stat(pathname, &sbuf) < 0 || sbuf.st_size == 0) {
             slapi_log_err(SLAPI_LOG_ERR, "dbmdb_restore",
                 "Backup directory %s does not contain a complete backup.\n", src_dir);
@@ -1092,44 +1277,184 @@ dbmdb_restore(struct ldbminfo *li, char *src_dir, Slapi_Task *task)
     dbmdb_ctx_close(li->li_dblayer_config);
     dbmdb_delete_db(li);
 
-    /* Copy db and info files */
-    if (dbmdb_restore_file(li, task, src_dir, DBMAPFILE) ||
-        dbmdb_restore_file(li, task, src_dir, INFOFILE)) {
-        return_value = -1;
-        goto error_out;
-    }
-
-    /* restart the db */
-    slapi_ch_free(&li->li_dblayer_config);  /* mdb_init will recreate it */
-    mdb_init(li, NULL);
-    tmp_rval = dbmdb_start(li, dbmode);
-    if (0 != tmp_rval) {
+    /* Copy db (applying the incremental backups) and info files */
+    pathname = slapi_ch_smprintf("%s/%s", MDB_CONFIG(li)->home, DBMAPFILE);
+    return_value = dbmdb_restore_pages(src_dir, pathname, li->li_mode, task);
+    if (return_value) {
         slapi_log_err(SLAPI_LOG_ERR,
-                      "dbmdb_restore", "Failed to init database\n");
+                      "dbmdb_restore", "Failed to copy database map file to %s.\n", pathname);
         if (task) {
-            slapi_task_log_notice(task, "dbmdb_restore - Failed to init database");
+            slapi_task_log_notice(task, "Restore: Failed to copy database map file to %s.\n", pathname);
         }
-        return_value = tmp_rval;
+    }
+    slapi_ch_free_string(&pathname);
+    if (return_value || dbmdb_restore_file(li, task, src_dir, INFOFILE)) {
+        return_value = -1;
         goto error_out;
     }
 
-    if (0 != tmp_rval)
-        slapi_log_err(SLAPI_LOG_WARNING, "dbmdb_restore", "Unable to verify the index configuration\n");
+    return_value = dbmdb_restore_restart(li, task);
 
-    if (li->li_flags & SLAPI_TASK_RUNNING_FROM_COMMANDLINE) {
-        /* command line: close the database down again */
-        tmp_rval = dblayer_close(li, dbmode);
-        if (0 != tmp_rval) {
-            slapi_log_err(SLAPI_LOG_ERR, "dbmdb_restore", "Failed to close database\n");
-        }
+error_out:
+    return return_value;
+}
+
+/* Check that a restored database file can be opened by lmdb */
+static int
+dbmdb_restore_check_db(const char *pathname)
+{
+    MDB_env *env = NULL;
+    MDB_txn *txn = NULL;
+    MDB_dbi dbi = 0;
+    int rc = mdb_env_create(&env);
+
+    if (!rc) {
+        rc = mdb_env_set_maxdbs(env, 1);
+    }
+    if (!rc) {
+        rc = mdb_env_open(env, pathname, MDB_NOSUBDIR | MDB_RDONLY | MDB_NOLOCK, 0600);
+    }
+    if (!rc) {
+        rc = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
+    }
+    if (!rc) {
+        /* Any server database has the list of its dbis */
+        rc = mdb_dbi_open(txn, DBNAMES, 0, &dbi);
+        mdb_txn_abort(txn);
+    }
+    if (env) {
+        mdb_env_close(env);
+    }
+    if (rc) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_restore_check_db",
+                      "The restored database is not valid: %s (%d)\n", mdb_strerror(rc), rc);
+    }
+    return rc;
+}
+
+/*
+ * Streamed restore: the whole stream, database included, is written in a
+ * scratch directory of the db home directory. Once the stream is read and
+ * checked, the current database is replaced by renaming the restored one,
+ * so a truncated or invalid stream leaves the current database unchanged.
+ */
+int
+dbmdb_restore_stream(struct ldbminfo *li, int fd, Slapi_Task *task)
+{
+    char *scratch = slapi_ch_smprintf("%s/restore_stream.XXXXXX", MDB_CONFIG(li)->home);
+    char *pathname = NULL;
+    char *dbpath = NULL;
+    char *name = NULL;
+    const char **pt;
+    struct stat sbuf;
+    uint32_t flags = 0;
+    uint32_t mode = 0;
+    uint64_t size = 0;
+    int received = 0;
+    int restored = 0;
+    int destfd = -1;
+    int rc = 0;
+
+    if (!mkdtemp(scratch)) {
+        rc = errno;
+        slapi_ch_free_string(&scratch);
     } else {
-        allinstance_set_busy(li); /* on-line mode */
+        rc = dbmdb_stream_read_header(fd, &flags);
+    }
+    while (!rc && !(rc = dbmdb_stream_next_file(fd, &name, &mode)) && name) {
+        if (received) {
+            /* The database must be the last file */
+            slapi_log_err(SLAPI_LOG_ERR, "dbmdb_restore_stream", "Unexpected %s after the database.\n", name);
+            rc = EINVAL;
+            break;
+        }
+        if (strcmp(name, DBMAPFILE) == 0) {
+            received = 1;
+            pathname = slapi_ch_smprintf("%s/%s", scratch, DBMAPFILE);
+            destfd = open(pathname, O_WRONLY | O_CREAT | O_TRUNC, li->li_mode);
+        } else if (charray_inlist((char **)streamconffilelists, name)) {
+            pathname = slapi_ch_smprintf("%s/%s", scratch, name);
+            destfd = open(pathname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        } else {
+            /* Not needed by this server version */
+            slapi_log_err(SLAPI_LOG_INFO, "dbmdb_restore_stream", "Skipping %s\n", name);
+        }
+        if (pathname && destfd < 0) {
+            rc = errno;
+        } else {
+            rc = dbmdb_stream_read_data(fd, destfd, &size);
+        }
+        if (!rc && destfd >= 0 && fsync(destfd)) {
+            rc = errno;
+        }
+        if (rc) {
+            slapi_log_err(SLAPI_LOG_ERR, "dbmdb_restore_stream", "Failed to restore %s: %s (%d)\n",
+                          name, slapi_system_strerror(rc), rc);
+        }
+        if (destfd >= 0) {
+            close(destfd);
+            destfd = -1;
+        }
+        slapi_ch_free_string(&pathname);
+        slapi_ch_free_string(&name);
     }
+    slapi_ch_free_string(&name);
 
-    return_value = tmp_rval ? tmp_rval : return_value;
+    /* The stream is fully read: check it before replacing the current database */
+    for (pt = streamconffilelists; *pt && !rc; pt++) {
+        pathname = slapi_ch_smprintf("%s/%s", scratch, *pt);
+        if (stat(pathname, &sbuf) < 0 || sbuf.st_size == 0) {
+            rc = EINVAL;
+        }
+        slapi_ch_free_string(&pathname);
+    }
+    if (!rc && !received) {
+        rc = EINVAL;
+    }
+    if (rc == EINVAL) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_restore_stream",
+                      "The backup stream does not contain a complete backup.\n");
+    }
+    if (!rc && dbmdb_dse_conf_verify(li, scratch)) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_restore_stream",
+                      "The backup stream is not compatible with current configuration.\n");
+        rc = EINVAL;
+    }
+    if (!rc) {
+        dbpath = slapi_ch_smprintf("%s/%s", scratch, DBMAPFILE);
+        if (dbmdb_restore_check_db(dbpath)) {
+            rc = EINVAL;
+        }
+    }
+    if (!rc) {
+        /* Swap the databases: the scratch directory is in the db home,
+         * so the rename cannot cross file systems */
+        dbmdb_ctx_close(li->li_dblayer_config);
+        dbmdb_delete_db(li);
+        restored = 1;
+        pathname = slapi_ch_smprintf("%s/%s", MDB_CONFIG(li)->home, DBMAPFILE);
+        if (rename(dbpath, pathname)) {
+            rc = errno;
+            slapi_log_err(SLAPI_LOG_ERR, "dbmdb_restore_stream", "Failed to rename %s to %s: %s (%d)\n",
+                          dbpath, pathname, slapi_system_strerror(rc), rc);
+        }
+        slapi_ch_free_string(&pathname);
+    }
+    slapi_ch_free_string(&dbpath);
+    if (!rc && dbmdb_restore_file(li, task, scratch, INFOFILE)) {
+        rc = EIO;
+    }
+    dbmdb_stream_remove_scratch(&scratch);
 
-error_out:
-    return return_value;
+    if (rc) {
+        if (task) {
+            slapi_task_log_notice(task, "dbmdb_restore_stream - Failed to restore the backup stream: %s (%d)",
+                                  slapi_system_strerror(rc), rc);
+        }
+        /* The current database is still there if the stream was rejected */
+        return restored ? -1 : LDAP_UNWILLING_TO_PERFORM;
+    }
+    return dbmdb_restore_restart(li, task);
 }
 
 static char *
@@ -1596,6 +1921,16 @@ int dbmdb_dbt2dbival(MDB_val *dbt, dbi_val_t *dbi, PRBool isresponse, int rc)
         dbi->size = dbt->mv_size;
         return rc;
     }
+    if (isresponse && (dbi->flags & DBI_VF_BORROWED)) {
+        /* Return the value in the memory map (valid until the txn ends) */
+        if (!(dbi->flags & DBI_VF_PROTECTED)) {
+            slapi_ch_free(&dbi->data);
+        }
+        dbi->flags |= DBI_VF_PROTECTED | DBI_VF_READONLY;
+        dbi->data = dbt->mv_data;
+        dbi->size = dbi->ulen = dbt->mv_size;
+        return rc;
+    }
 
     if (dbi->flags & DBI_VF_READONLY) {
         /* trying to modify read only data */
@@ -2387,13 +2722,19 @@ int dbmdb_public_cursor_op(dbi_cursor_t *cursor,  dbi_op_t op, dbi_val_t *key, d
             rc = MDB_CURSOR_PUT(dbmdb_cur, &dbmdb_key, &dbmdb_data, MDB_CURRENT);
             break;
         case DBI_OP_ADD:
-            rc = MDB_CURSOR_PUT(dbmdb_cur, &dbmdb_key, &dbmdb_data, 0);
+            rc = dbmdb_shadow_log_cursor(cursor, op, &dbmdb_key, &dbmdb_data);
+            if (rc == 0) {
+                rc = MDB_CURSOR_PUT(dbmdb_cur, &dbmdb_key, &dbmdb_data, 0);
+            }
             break;
         case DBI_OP_DEL:
-            rc = mdb_cursor_del(dbmdb_cur, 0);
+            rc = dbmdb_shadow_log_cursor(cursor, op, NULL, NULL);
+            if (rc == 0) {
+                rc = mdb_cursor_del(dbmdb_cur, 0);
+            }
             break;
         case DBI_OP_CLOSE:
-            MDB_CURSOR_CLOSE(dbmdb_cur);
+            dbmdb_txn_cursor_close(cursor->txn, dbmdb_cur);
             if (cursor->islocaltxn) {
                 /* local txn is read only and should be aborted when closing the cursor */
                 END_TXN(&cursor->txn, 1);
@@ -2433,13 +2774,18 @@ int dbmdb_public_db_op(dbi_db_t *db,  dbi_txn_t *txn, dbi_op_t op, dbi_val_t *ke
             rc = MDB_GET(mdb_txn, dbi, &dbmdb_key, &dbmdb_data);
             break;
         case DBI_OP_PUT:
-            rc = MDB_PUT(mdb_txn, dbi, &dbmdb_key, &dbmdb_data, 0);
-            break;
         case DBI_OP_ADD:
-            rc = MDB_PUT(mdb_txn, dbi, &dbmdb_key, &dbmdb_data, 0);
+            /* Keep track of the update if the index is being rebuilt */
+            rc = dbmdb_shadow_log(mdb_txn, dbmdb_db, op, &dbmdb_key, &dbmdb_data);
+            if (rc == 0) {
+                rc = MDB_PUT(mdb_txn, dbi, &dbmdb_key, &dbmdb_data, 0);
+            }
             break;
         case DBI_OP_DEL:
-            rc = MDB_DEL(mdb_txn, dbi, &dbmdb_key, dbmdb_data.mv_data ? &dbmdb_data : NULL);
+            rc = dbmdb_shadow_log(mdb_txn, dbmdb_db, op, &dbmdb_key, &dbmdb_data);
+            if (rc == 0) {
+                rc = MDB_DEL(mdb_txn, dbi, &dbmdb_key, dbmdb_data.mv_data ? &dbmdb_data : NULL);
+            }
             break;
         case DBI_OP_CLOSE:
             /* No need to close db instances with lmdb */
@@ -2452,6 +2798,14 @@ int dbmdb_public_db_op(dbi_db_t *db,  dbi_txn_t *txn, dbi_op_t op, dbi_val_t *ke
     }
     if (ltxn) {
         rc = END_TXN(&ltxn, rc);
+        if (data && (data->flags & DBI_VF_BORROWED)) {
+            /* The map pages may be reused once the local txn has ended: return a copy */
+            if (data->flags & DBI_VF_PROTECTED) {
+                data->data = NULL;
+                data->ulen = 0;
+            }
+            data->flags = DBI_VF_NONE;
+        }
     }
     rc = dbmdb_map_error(__FUNCTION__, rc);
     rc = dbmdb_dbt2dbival(&dbmdb_key, key, PR_TRUE, rc);
@@ -2480,7 +2834,7 @@ int dbmdb_public_new_cursor(dbi_db_t *db,  dbi_cursor_t *cursor)
         }
         cursor->islocaltxn = PR_TRUE;
     }
-    rc = MDB_CURSOR_OPEN(TXN(cursor->txn), dbi->dbi, (MDB_cursor**)&cursor->cur);
+    rc = dbmdb_txn_cursor_open(cursor->txn, dbi->dbi, (MDB_cursor**)&cursor->cur);
     if (rc==EINVAL) { /* DBG txn or dbi error */
         MDB_stat st2;
         rc = mdb_stat(TXN(cursor->txn), dbi->dbi, &st2);
@@ -63,6 +63,8 @@
 #define DSE_INDEX           "dse_index.ldif"        /* dse file in backup */
 #define DBMAPFILE           "data.mdb"
 #define INFOFILE            "INFO.mdb"
+#define PAGEMAPFILE         "data.mdb.pagemap"      /* page checksums in backup */
+#define DELTAFILE           "data.mdb.delta"        /* changed pages in incremental backup */
 #define DBNAMES             "__DBNAMES"
 #define CHANGELOG_PATTERN   "changelog"   /* pattern in changelog dbi name */
 #define RECNOCACHE_PREFIX   "~recno-cache/"
@@ -121,6 +123,7 @@ typedef struct
     dbistate_t state;             /* state (also stored in __DBNAMES database) */
     MDB_dbi dbi;                  /* The handle */
     value_compare_fn_type cmp_fn; /* Key compare function (from syntax plugins) */
+    MDB_dbi shadowlog;            /* Index rebuilt in a shadow dbi: dbi logging the updates (or 0) */
 } dbmdb_dbi_t;
 
 /* dbmdb_dbi_stat_t flags */
@@ -152,10 +155,29 @@ typedef struct {
     uint64_t nbactive;
     uint64_t nbabort;
     uint64_t nbcommit;
+    uint64_t nbrenew;   /* Read-only txns renewed from the pool */
     cumuled_time_t granttime;
     cumuled_time_t lifetime;
 } dbmdb_perfctrs_txn_t;
 
+/* Group commit of the write txns (see dbmdb_txn_group_wait) */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t batch_cv;       /* Wakes up the leader when a txn joins the batch */
+    pthread_cond_t done_cv;        /* Wakes up the txns when a batch is synced */
+    int batch_val;                 /* Max number of txns per sync (0 means no group commit) */
+    int max_wait;                  /* Max time (in ms) the leader waits for the batch */
+    int active;                    /* Env is open with MDB_NOSYNC */
+    int inprogress;                /* Running top level txns of the operations */
+    int syncing;                   /* A leader is gathering or syncing a batch */
+    uint64_t committed;            /* Sequence number of the last committed txn */
+    uint64_t synced;               /* Sequence number of the last synced txn */
+    uint64_t failed_from;          /* Txns of the last batch whose sync failed */
+    uint64_t failed_to;
+    int failed_rc;
+    uint64_t nbsync;
+} dbmdb_group_commit_t;
+
 /* structure which holds our stuff */
 typedef struct dbmdb_ctx_t
 {
@@ -177,6 +199,7 @@ typedef struct dbmdb_ctx_t
     perfctrs_private *perf_private;  /* Performance counter data (shared memory) */
     dbmdb_perfctrs_txn_t perf_rotxn; /* Read Only Txn Performance counter */
     dbmdb_perfctrs_txn_t perf_rwtxn; /* Read Write Txn Performance counter */
+    dbmdb_group_commit_t group_commit;
 } dbmdb_ctx_t;
 
 /*
@@ -262,6 +285,15 @@ typedef struct {
     int flags;
 } dbmdb_txn_ctx_t;
 
+/* Copy of the database in a pipe (see dbmdb_env_copy_begin) */
+typedef struct {
+    MDB_env *env;
+    unsigned int flags; /* mdb_env_copyfd2 flags */
+    int fd;             /* write end of the pipe, closed by the copy thread */
+    int rc;
+    PRThread *thread;
+} dbmdb_env_copy_t;
+
 #include "mdb_debug.h"
 
 extern Slapi_ComponentId *dbmdb_componentid;
@@ -272,6 +304,8 @@ int dbmdb_close(struct ldbminfo *li, int flags);
 int dbmdb_start(struct ldbminfo *li, int flags);
 int dbmdb_instance_start(backend *be, int flags);
 int dbmdb_backup(struct ldbminfo *li, char *dest_dir, Slapi_Task *task);
+int dbmdb_backup_incremental(struct ldbminfo *li, char *dest_dir, char *base_dir, Slapi_Task *task);
+int dbmdb_backup_stream(struct ldbminfo *li, int fd, int flags, Slapi_Task *task);
 int dbmdb_verify(Slapi_PBlock *pb);
 int dbmdb_db2ldif(Slapi_PBlock *pb);
 int dbmdb_db2index(Slapi_PBlock *pb);
@@ -281,10 +315,12 @@ int dbmdb_upgradedb(Slapi_PBlock *pb);
 int dbmdb_upgradednformat(Slapi_PBlock *pb);
 int dbmdb_upgradeddformat(Slapi_PBlock *pb);
 int dbmdb_restore(struct ldbminfo *li, char *src_dir, Slapi_Task *task);
+int dbmdb_restore_stream(struct ldbminfo *li, int fd, Slapi_Task *task);
 int dbmdb_cleanup(struct ldbminfo *li);
 int dbmdb_txn_begin(struct ldbminfo *li, back_txnid parent_txn, back_txn *txn, PRBool use_lock);
 int dbmdb_txn_commit(struct ldbminfo *li, back_txn *txn, PRBool use_lock);
 int dbmdb_txn_abort(struct ldbminfo *li, back_txn *txn, PRBool use_lock);
+int dbmdb_txn_wait(struct ldbminfo *li);
 int dbmdb_get_db(backend *be, char *indexname, int open_flag, struct attrinfo *ai, dbi_db_t **ppDB);
 int dbmdb_rm_db_file(backend *be, struct attrinfo *a, PRBool use_lock, int no_force_chkpt);
 int dbmdb_delete_db(struct ldbminfo *li);
@@ -479,6 +515,31 @@ dbmdb_stats_t *dbdmd_gather_stats(dbmdb_ctx_t *conf, backend *be);
 void dbmdb_free_stats(dbmdb_stats_t **stats);
 int dbmdb_reset_vlv_file(backend *be, const char *filename);
 
+/* mdb_shadow.c */
+int dbmdb_shadow_log(MDB_txn *txn, dbmdb_dbi_t *dbi, dbi_op_t op, MDB_val *key, MDB_val *data);
+int dbmdb_shadow_log_cursor(dbi_cursor_t *cursor, dbi_op_t op, MDB_val *key, MDB_val *data);
+int dbmdb_shadow_reindex_possible(Slapi_PBlock *pb);
+void dbmdb_shadow_remove_stale(dbmdb_ctx_t *ctx, backend *be);
+
+/* mdb_pagemap.c */
+int dbmdb_backup_pages(dbmdb_ctx_t *ctx, const char *dest_dir, const char *base_dir, int mode, Slapi_Task *task);
+int dbmdb_backup_is_incremental(const char *dir);
+int dbmdb_restore_pages(const char *src_dir, char *dest, int mode, Slapi_Task *task);
+int dbmdb_backup_verify(const char *dir);
+ssize_t dbmdb_read_full(int fd, void *buf, size_t len);
+int dbmdb_write_full(int fd, const void *buf, size_t len);
+int dbmdb_env_copy_begin(dbmdb_env_copy_t *copy, MDB_env *env, unsigned int flags);
+int dbmdb_env_copy_end(dbmdb_env_copy_t *copy, int fd);
+
+/* mdb_stream.c */
+int dbmdb_stream_write_header(int fd, uint32_t flags);
+int dbmdb_stream_write_fd(int fd, const char *name, uint32_t mode, int srcfd);
+int dbmdb_stream_write_file(int fd, const char *dir, const char *name);
+int dbmdb_stream_write_end(int fd);
+int dbmdb_stream_read_header(int fd, uint32_t *flags);
+int dbmdb_stream_next_file(int fd, char **name, uint32_t *mode);
+int dbmdb_stream_read_data(int fd, int destfd, uint64_t *size);
+
 /* mdb_txn.c */
 int dbmdb_start_txn(const char *funcname, dbi_txn_t *parent_txn, int flags, dbi_txn_t **txn);
 int dbmdb_end_txn(const char *funcname, int rc, dbi_txn_t **txn);
@@ -486,4 +547,16 @@ void init_mdbtxn(dbmdb_ctx_t *ctx);
 MDB_txn *dbmdb_txn(dbi_txn_t *txn);
 int dbmdb_is_read_only_txn_thread(void);
 int dbmdb_has_a_txn(void);
+void dbmdb_txn_pool_flush(MDB_env *env);
+int dbmdb_is_toplevel_txn(dbi_txn_t *txn);
+void dbmdb_txn_group_init(dbmdb_ctx_t *ctx);
+void dbmdb_txn_group_start(dbmdb_ctx_t *ctx, int readonly);
+void dbmdb_txn_group_enter(dbmdb_ctx_t *ctx);
+void dbmdb_txn_group_leave(dbmdb_ctx_t *ctx);
+void dbmdb_txn_group_join(dbi_txn_t *txn);
+int dbmdb_txn_group_sync_env(dbmdb_ctx_t *ctx);
+void dbmdb_txn_group_committed(dbmdb_ctx_t *ctx);
+int dbmdb_txn_group_wait(dbmdb_ctx_t *ctx);
+int dbmdb_txn_cursor_open(dbi_txn_t *txn, MDB_dbi dbi, MDB_cursor **cursor);
+void dbmdb_txn_cursor_close(dbi_txn_t *txn, MDB_cursor *cursor);
 
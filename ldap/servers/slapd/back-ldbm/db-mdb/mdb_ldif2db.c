@@ -28,6 +28,15 @@
 
 #define LDIF2LDBM_EXTBITS(x) ((x)&0xf)
 
+#define RUVRDN SLAPI_ATTR_UNIQUEID "=" RUV_STORAGE_ENTRY_UNIQUEID
+
+typedef struct _export_buf
+{
+    char *data;
+    size_t len;
+    size_t size;
+} export_buf;
+
 typedef struct _export_args
 {
     struct backentry *ep;
@@ -47,6 +56,8 @@ typedef struct _export_args
                                  its children's ID.  It happens when an entry
                                  is added and existing entries are moved under
                                  the newly added entry. */
+    export_buf *out;          /* parallel export: buffer of the chunk
+                                 (or NULL to write directly in fd) */
 } export_args;
 
 /* static functions */
@@ -427,6 +438,37 @@ dbmdb_fetch_subtrees(backend *be, char **include, int *err)
 }
 
 
+static void
+dbmdb_export_log_progress(ldbm_instance *inst, Slapi_Task *task, int cnt, int percent)
+{
+    if (task) {
+        slapi_task_log_status(task, "%s: Processed %d entries (%d%%).",
+                              inst->inst_name, cnt, percent);
+        slapi_task_log_notice(task, "%s: Processed %d entries (%d%%).",
+                              inst->inst_name, cnt, percent);
+    }
+    slapi_log_err(SLAPI_LOG_INFO, "dbmdb_export_one_entry", "export %s: Processed %d entries (%d%%).\n",
+                  inst->inst_name, cnt, percent);
+}
+
+/* Write in the ldif file, or in the chunk buffer when exporting in parallel */
+static int
+dbmdb_export_write(export_args *expargs, const char *str, size_t len)
+{
+    export_buf *out = expargs->out;
+
+    if (!out) {
+        return write(expargs->fd, str, len);
+    }
+    if (out->len + len > out->size) {
+        out->size = 2 * (out->len + len);
+        out->data = slapi_ch_realloc(out->data, out->size);
+    }
+    memcpy(out->data + out->len, str, len);
+    out->len += len;
+    return len;
+}
+
 static int
 dbmdb_export_one_entry(struct ldbminfo *li,
                  ldbm_instance *inst,
@@ -508,17 +550,17 @@ dbmdb_export_one_entry(struct ldbminfo *li,
         char idstr[32];
 
         sprintf(idstr, "# entry-id: %lu\n", (u_long)expargs->ep->ep_id);
-        rc = write(expargs->fd, idstr, strlen(idstr));
+        rc = dbmdb_export_write(expargs, idstr, strlen(idstr));
         PR_ASSERT(rc > 0);
     }
-    rc = write(expargs->fd, data.mv_data, len);
+    rc = dbmdb_export_write(expargs, data.mv_data, len);
     PR_ASSERT(rc > 0);
-    rc = write(expargs->fd, "\n", 1);
+    rc = dbmdb_export_write(expargs, "\n", 1);
     PR_ASSERT(rc > 0);
     slapi_ch_free(&data.mv_data);
     data.mv_size = 0;
     rc = 0;
-    if ((*expargs->cnt) % 1000 == 0) {
+    if (!expargs->out && (*expargs->cnt) % 1000 == 0) {
         int percent;
 
         if (expargs->idl) {
@@ -526,29 +568,451 @@ dbmdb_export_one_entry(struct ldbminfo *li,
         } else {
             percent = (expargs->ep->ep_id * 100 / expargs->lastid);
         }
-        if (expargs->task) {
-            slapi_task_log_status(expargs->task,
-                                  "%s: Processed %d entries (%d%%).",
-                                  inst->inst_name, *expargs->cnt, percent);
-            slapi_task_log_notice(expargs->task,
-                                  "%s: Processed %d entries (%d%%).",
-                                  inst->inst_name, *expargs->cnt, percent);
-        }
-        slapi_log_err(SLAPI_LOG_INFO, "dbmdb_export_one_entry", "export %s: Processed %d entries (%d%%).\n",
-                      inst->inst_name, *expargs->cnt, percent);
+        dbmdb_export_log_progress(inst, expargs->task, *expargs->cnt, percent);
         *expargs->lastcnt = *expargs->cnt;
     }
 bail:
     return rc;
 }
 
+/**********  parallel export  **********/
+
+/*
+ * A whole backend export is split in chunks of consecutive entries:
+ *  - the thread running db2ldif walks id2entry, fills the chunks with the
+ *    raw id2entry records (that stay valid as long as its read txn is open)
+ *    and writes the formatted chunks in the ldif file in id order.
+ *  - the worker threads decode and format the chunks.
+ * The dn of an entry is built from the dn of its parent, that is usually
+ * in the dn cache as the parents are exported first, instead of walking
+ * the entryrdn index for each entry.
+ */
+#define EXPORT_CHUNK_ENTRIES 256
+#define EXPORT_CHUNKS_PER_WORKER 4
+#define EXPORT_MAX_WORKERS 16
+
+typedef enum {
+    EXPORT_CHUNK_FREE,    /* being filled by the reader */
+    EXPORT_CHUNK_FILLED,  /* waiting for a worker */
+    EXPORT_CHUNK_RUNNING, /* being formatted by a worker */
+    EXPORT_CHUNK_DONE,    /* waiting to be written */
+} export_chunk_state;
+
+typedef struct _export_chunk
+{
+    export_chunk_state state;
+    int nbitems;
+    ID ids[EXPORT_CHUNK_ENTRIES];
+    char *data[EXPORT_CHUNK_ENTRIES]; /* raw id2entry records */
+    export_buf out;                   /* formatted entries */
+    int cnt;                          /* number of exported entries */
+} export_chunk;
+
+typedef struct _export_pool
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cv;    /* signaled when a chunk changes of state */
+    export_chunk *chunks; /* chunk n is chunks[n % nbchunks] */
+    int nbchunks;
+    uint64_t nbfilled;    /* chunks handed to the workers */
+    uint64_t nbtaken;     /* chunks taken by the workers */
+    uint64_t nbwritten;   /* chunks written in the ldif file */
+    int closing;
+    int nbworkers;
+    PRThread **workers;
+    struct ldbminfo *li;
+    ldbm_instance *inst;
+    dbmdb_dbi_t *id2entry;
+    export_args wargs;    /* export settings used by the workers */
+    int str2entry_options;
+    int run_from_cmdline;
+} export_pool;
+
+/* Get the dn of an entry (or NULL if it cannot be computed) */
+static char *
+dbmdb_export_get_dn(export_pool *pool, dbmdb_cursor_t *cur, ID id, const char *rdn, const char *data, int *cached)
+{
+    ldbm_instance *inst = pool->inst;
+    backend *be = inst->inst_be;
+    struct backdn *bdn = NULL;
+    char *pid_str = NULL;
+    Slapi_RDN psrdn = {0};
+    char *pdn = NULL;
+    char *dn = NULL;
+    ID pid = NOID;
+
+    bdn = dncache_find_id(&inst->inst_dncache, id);
+    if (bdn) {
+        dn = slapi_ch_strdup(slapi_sdn_get_dn(bdn->dn_sdn));
+        CACHE_RETURN(&inst->inst_dncache, &bdn);
+        *cached = 1;
+        return dn;
+    }
+    if (get_value_from_string(data, LDBM_PARENTID_STR, &pid_str) == 0) {
+        pid = (ID)strtol(pid_str, (char **)NULL, 10);
+        slapi_ch_free_string(&pid_str);
+        bdn = dncache_find_id(&inst->inst_dncache, pid);
+        if (bdn) {
+            dn = slapi_ch_smprintf("%s,%s", rdn, slapi_sdn_get_dn(bdn->dn_sdn));
+            CACHE_RETURN(&inst->inst_dncache, &bdn);
+            return dn;
+        }
+    }
+    if (entryrdn_lookup_dn(be, (char *)rdn, id, &dn, NULL, NULL) == 0) {
+        return dn;
+    }
+    /* We cannot use the entryrdn index; Compose dn from the entries in id2entry */
+    if (NOID == pid) {
+        return slapi_ch_strdup(rdn);
+    }
+    if (!cur->cur && dbmdb_open_cursor(cur, MDB_CONFIG(pool->li), pool->id2entry, MDB_RDONLY)) {
+        return NULL;
+    }
+    if (_get_and_add_parent_rdns(be, cur, pid, &psrdn, NULL, 0, pool->run_from_cmdline, NULL) == 0 &&
+        slapi_rdn_get_dn(&psrdn, &pdn) == 0) {
+        dn = slapi_ch_smprintf("%s,%s", rdn, pdn);
+    }
+    slapi_ch_free_string(&pdn);
+    slapi_rdn_done(&psrdn);
+    return dn;
+}
+
+static struct backentry *
+dbmdb_export_str2entry(export_pool *pool, dbmdb_cursor_t *cur, ID id, char *data)
+{
+    ldbm_instance *inst = pool->inst;
+    struct backentry *ep = backentry_alloc();
+    char *rdn = NULL;
+    char *dn = NULL;
+    int cached = 0;
+
+    if (get_value_from_string(data, "rdn", &rdn)) {
+        /* data may not include rdn: ..., try "dn: ..." */
+        ep->ep_entry = slapi_str2entry(data, pool->str2entry_options | SLAPI_STR2ENTRY_NO_ENTRYDN);
+    } else {
+        dn = dbmdb_export_get_dn(pool, cur, id, rdn, data, &cached);
+        if (dn) {
+            ep->ep_entry = slapi_str2entry_ext(dn, NULL, data,
+                                               pool->str2entry_options | SLAPI_STR2ENTRY_NO_ENTRYDN);
+        }
+        if (dn && !cached) {
+            /* so that the children find it; dn is freed with the dn cache entry */
+            struct backdn *bdn = backdn_init(slapi_sdn_new_dn_passin(dn), id, 0);
+            if (CACHE_ADD(&inst->inst_dncache, bdn, NULL)) {
+                backdn_free(&bdn);
+            } else {
+                CACHE_RETURN(&inst->inst_dncache, &bdn);
+            }
+        } else if (dn) {
+            slapi_ch_free_string(&dn);
+        } else {
+            slapi_log_err(SLAPI_LOG_WARNING, "dbmdb_export_str2entry",
+                          "Failed to compose dn for (rdn: %s, ID: %d)\n", rdn, id);
+        }
+        slapi_ch_free_string(&rdn);
+    }
+    if (ep->ep_entry) {
+        ep->ep_id = id;
+    } else {
+        slapi_log_err(SLAPI_LOG_WARNING, "dbmdb_export_str2entry",
+                      "Skipping badly formatted entry with id %lu\n", (u_long)id);
+        backentry_free(&ep);
+    }
+    return ep;
+}
+
+static void
+dbmdb_export_format_chunk(export_pool *pool, export_chunk *chunk, dbmdb_cursor_t *cur)
+{
+    export_args eargs = pool->wargs;
+    int lastcnt = 0;
+
+    eargs.cnt = &chunk->cnt;
+    eargs.lastcnt = &lastcnt;
+    eargs.out = &chunk->out;
+    for (int i = 0; i < chunk->nbitems; i++) {
+        eargs.ep = dbmdb_export_str2entry(pool, cur, chunk->ids[i], chunk->data[i]);
+        if (eargs.ep) {
+            dbmdb_export_one_entry(pool->li, pool->inst, &eargs);
+            backentry_free(&eargs.ep);
+        }
+    }
+}
+
+static void
+dbmdb_export_worker(void *arg)
+{
+    export_pool *pool = arg;
+    dbmdb_cursor_t cur = {0}; /* only used if entryrdn cannot give the dn */
+    export_chunk *chunk = NULL;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (pool->nbtaken == pool->nbfilled && !pool->closing) {
+            pthread_cond_wait(&pool->cv, &pool->mutex);
+        }
+        if (pool->nbtaken == pool->nbfilled) {
+            break;
+        }
+        chunk = &pool->chunks[pool->nbtaken++ % pool->nbchunks];
+        chunk->state = EXPORT_CHUNK_RUNNING;
+        pthread_mutex_unlock(&pool->mutex);
+
+        dbmdb_export_format_chunk(pool, chunk, &cur);
+
+        pthread_mutex_lock(&pool->mutex);
+        chunk->state = EXPORT_CHUNK_DONE;
+        pthread_cond_broadcast(&pool->cv);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    dbmdb_close_cursor(&cur, 1);
+}
+
+/* Write the formatted chunks in order until 'upto' chunks are written */
+static int
+dbmdb_export_write_chunks(export_pool *pool, uint64_t upto, int wait, int *cnt, int *lastcnt)
+{
+    export_args *wargs = &pool->wargs;
+    export_chunk *chunk = NULL;
+    ssize_t len = 0;
+    int done = 0;
+
+    while (pool->nbwritten < upto) {
+        chunk = &pool->chunks[pool->nbwritten % pool->nbchunks];
+        pthread_mutex_lock(&pool->mutex);
+        while (wait && chunk->state != EXPORT_CHUNK_DONE) {
+            pthread_cond_wait(&pool->cv, &pool->mutex);
+        }
+        done = (chunk->state == EXPORT_CHUNK_DONE);
+        pthread_mutex_unlock(&pool->mutex);
+        if (!done) {
+            break;
+        }
+        for (size_t pos = 0; pos < chunk->out.len; pos += len) {
+            len = write(wargs->fd, chunk->out.data + pos, chunk->out.len - pos);
+            if (len < 0 && errno == EINTR) {
+                len = 0;
+            } else if (len <= 0) {
+                slapi_log_err(SLAPI_LOG_ERR, "dbmdb_export_write_chunks",
+                              "export %s: failed to write the ldif file: %s (%d)\n",
+                              pool->inst->inst_name, slapi_system_strerror(errno), errno);
+                return -1;
+            }
+        }
+        if ((*cnt + chunk->cnt) / 1000 != *cnt / 1000) {
+            dbmdb_export_log_progress(pool->inst, wargs->task, *cnt + chunk->cnt,
+                                      chunk->ids[chunk->nbitems - 1] * 100 / wargs->lastid);
+            *lastcnt = *cnt + chunk->cnt;
+        }
+        *cnt += chunk->cnt;
+        chunk->cnt = 0;
+        chunk->nbitems = 0;
+        chunk->out.len = 0;
+        pthread_mutex_lock(&pool->mutex);
+        chunk->state = EXPORT_CHUNK_FREE;
+        pool->nbwritten++;
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return 0;
+}
+
+/* Hand the chunk being filled to the workers */
+static void
+dbmdb_export_dispatch(export_pool *pool)
+{
+    export_chunk *chunk = &pool->chunks[pool->nbfilled % pool->nbchunks];
+
+    if (chunk->nbitems > 0) {
+        pthread_mutex_lock(&pool->mutex);
+        chunk->state = EXPORT_CHUNK_FILLED;
+        pool->nbfilled++;
+        pthread_cond_broadcast(&pool->cv);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+static int
+dbmdb_export_add(export_pool *pool, ID id, char *data, int *cnt, int *lastcnt)
+{
+    export_chunk *chunk = &pool->chunks[pool->nbfilled % pool->nbchunks];
+    int rc = 0;
+
+    if (chunk->nbitems == 0 && pool->nbfilled >= pool->nbchunks) {
+        /* Wait until the previous use of the chunk is written */
+        rc = dbmdb_export_write_chunks(pool, pool->nbfilled - pool->nbchunks + 1, 1, cnt, lastcnt);
+    }
+    chunk->ids[chunk->nbitems] = id;
+    chunk->data[chunk->nbitems] = data;
+    if (++chunk->nbitems == EXPORT_CHUNK_ENTRIES) {
+        dbmdb_export_dispatch(pool);
+        if (rc == 0) {
+            rc = dbmdb_export_write_chunks(pool, pool->nbfilled, 0, cnt, lastcnt);
+        }
+    }
+    return rc;
+}
+
+/* Write everything that has been read so far */
+static int
+dbmdb_export_drain(export_pool *pool, int *cnt, int *lastcnt)
+{
+    dbmdb_export_dispatch(pool);
+    return dbmdb_export_write_chunks(pool, pool->nbfilled, 1, cnt, lastcnt);
+}
+
+static int
+dbmdb_export_pool_start(export_pool *pool, int nbworkers)
+{
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cv, NULL);
+    pool->nbchunks = nbworkers * EXPORT_CHUNKS_PER_WORKER;
+    pool->chunks = (export_chunk *)slapi_ch_calloc(pool->nbchunks, sizeof(export_chunk));
+    pool->workers = (PRThread **)slapi_ch_calloc(nbworkers, sizeof(PRThread *));
+    for (pool->nbworkers = 0; pool->nbworkers < nbworkers; pool->nbworkers++) {
+        pool->workers[pool->nbworkers] = PR_CreateThread(PR_USER_THREAD, dbmdb_export_worker, pool,
+                                                         PR_PRIORITY_NORMAL, PR_GLOBAL_BOUND_THREAD,
+                                                         PR_JOINABLE_THREAD, SLAPD_DEFAULT_THREAD_STACKSIZE);
+        if (!pool->workers[pool->nbworkers]) {
+            PRErrorCode prerr = PR_GetError();
+            slapi_log_err(SLAPI_LOG_WARNING, "dbmdb_export_pool_start",
+                          "Unable to create export worker thread, " SLAPI_COMPONENT_NAME_NSPR " error %d (%s)\n",
+                          prerr, slapd_pr_strerror(prerr));
+            break;
+        }
+    }
+    return pool->nbworkers > 0 ? 0 : -1;
+}
+
+static void
+dbmdb_export_pool_stop(export_pool *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->closing = 1;
+    pthread_cond_broadcast(&pool->cv);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->nbworkers; i++) {
+        PR_JoinThread(pool->workers[i]);
+    }
+    for (int i = 0; i < pool->nbchunks; i++) {
+        slapi_ch_free_string(&pool->chunks[i].out.data);
+    }
+    slapi_ch_free((void **)&pool->chunks);
+    slapi_ch_free((void **)&pool->workers);
+    pthread_cond_destroy(&pool->cv);
+    pthread_mutex_destroy(&pool->mutex);
+}
+
+/*
+ * Export the whole id2entry with a pool of worker threads.
+ * Returns 1 if the pool cannot be started (the caller then does a
+ * sequential export), 0 on success, and -1 on error.
+ */
+static int
+dbmdb_export_parallel(struct ldbminfo *li, ldbm_instance *inst, dbmdb_cursor_t *cur,
+                      export_args *eargs, int str2entry_options, int run_from_cmdline,
+                      int *cnt, int *lastcnt)
+{
+    int nbworkers = util_get_capped_hardware_threads(1, EXPORT_MAX_WORKERS);
+    export_pool pool = {0};
+    MDB_val key = {0};
+    MDB_val data = {0};
+    ID ruvid = NOID;
+    char *ruv = NULL;
+    int suffix_written = 0;
+    int op = MDB_FIRST;
+    int rc = 0;
+
+    if (nbworkers < 2 || plugin_has_entryfetch_plugins()) {
+        /* The workers format the entries straight from the map pages:
+         * the entry fetch plugins (that may modify or replace the
+         * string) are left to the sequential export. */
+        return 1;
+    }
+    pool.li = li;
+    pool.inst = inst;
+    pool.id2entry = cur->dbi;
+    pool.wargs = *eargs;
+    pool.str2entry_options = str2entry_options;
+    pool.run_from_cmdline = run_from_cmdline;
+    if (dbmdb_export_pool_start(&pool, nbworkers)) {
+        dbmdb_export_pool_stop(&pool);
+        return 1;
+    }
+    slapi_log_err(SLAPI_LOG_INFO, "dbmdb_export_parallel", "export %s: Exporting with %d threads.\n",
+                  inst->inst_name, pool.nbworkers);
+
+    while (rc == 0 && (rc = MDB_CURSOR_GET(cur->cur, &key, &data, op)) == 0) {
+        ID id = id_stored_to_internal((char *)key.mv_data);
+        char *entrystr = data.mv_data;
+        char *pid_str = NULL;
+        char *rdn = NULL;
+
+        op = MDB_NEXT;
+        if (idl_id_is_in_idlist(eargs->pre_exported_idl, id)) {
+            /* it's already exported */
+            continue;
+        }
+        if (get_value_from_string(entrystr, LDBM_PARENTID_STR, &pid_str) == 0) {
+            ID pid = (ID)strtol(pid_str, (char **)NULL, 10);
+            slapi_ch_free_string(&pid_str);
+            if (id < pid && !idl_id_is_in_idlist(eargs->pre_exported_idl, pid) &&
+                get_value_from_string(entrystr, "rdn", &rdn) == 0) {
+                /* The parent has to be exported first: do it once the
+                 * previous entries are written */
+                Slapi_RDN psrdn = {0};
+                rc = dbmdb_export_drain(&pool, cnt, lastcnt);
+                if (rc == 0) {
+                    eargs->cnt = cnt;
+                    eargs->lastcnt = lastcnt;
+                    if (_export_or_index_parents(inst, cur, id, rdn, id, pid, run_from_cmdline,
+                                                 eargs, DB2LDIF_ENTRYRDN, &psrdn)) {
+                        /* Skip the entry as the sequential export does */
+                        id = NOID;
+                    }
+                }
+                slapi_rdn_done(&psrdn);
+                slapi_ch_free_string(&rdn);
+            }
+        } else if (!suffix_written && get_value_from_string(entrystr, "rdn", &rdn) == 0) {
+            /* The suffix or the RUV: the RUV is exported last if it is
+             * before the suffix (see dbmdb_db2ldif) */
+            if (0 == strcasecmp(rdn, RUVRDN)) {
+                ruvid = id;
+                ruv = entrystr;
+                id = NOID;
+            } else {
+                suffix_written = 1;
+            }
+            slapi_ch_free_string(&rdn);
+        }
+        if (rc == 0 && id != NOID) {
+            rc = dbmdb_export_add(&pool, id, entrystr, cnt, lastcnt);
+        }
+    }
+    if (rc == MDB_NOTFOUND) {
+        /* reached the end of the database */
+        rc = 0;
+        if (ruv) {
+            rc = dbmdb_export_add(&pool, ruvid, ruv, cnt, lastcnt);
+        }
+        if (rc == 0) {
+            rc = dbmdb_export_drain(&pool, cnt, lastcnt);
+        }
+    } else if (rc != -1) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_export_parallel", "export %s: Failed to read id2entry: %s (%d)\n",
+                      inst->inst_name, dblayer_strerror(rc), rc);
+        rc = -1;
+    }
+    dbmdb_export_pool_stop(&pool);
+    return rc;
+}
+
 /*
  * dbmdb_db2ldif - backend routine to convert database to an
  * ldif file.
  * (reunified at last)
  */
 #define LDBM2LDIF_BUSY (-2)
-#define RUVRDN SLAPI_ATTR_UNIQUEID "=" RUV_STORAGE_ENTRY_UNIQUEID
 int
 dbmdb_db2ldif(Slapi_PBlock *pb)
 {
@@ -868,6 +1332,18 @@ dbmdb_db2ldif(Slapi_PBlock *pb)
     eargs.include_suffix = include_suffix;
     eargs.exclude_suffix = exclude_suffix;
 
+    if (keepgoing && !idl && entryrdn_get_switch()) {
+        /* Whole backend export: format the entries in parallel
+         * (the dns are built from the parent dns and the rdn stored in
+         *  id2entry, that only exists with entryrdn) */
+        rc = dbmdb_export_parallel(li, inst, &cur, &eargs, str2entry_options,
+                                   run_from_cmdline, &cnt, &lastcnt);
+        if (rc <= 0) {
+            return_value = rc;
+            keepgoing = 0;
+        }
+    }
+
     while (keepgoing) {
         /*
          * All database operations in a transactional environment,
@@ -1229,8 +1705,10 @@ dbmdb_db2index(Slapi_PBlock *pb)
         }
     }
 
-    /* make sure no other tasks are going, and set the backend readonly */
-    if (instance_set_busy_and_readonly(inst) != 0) {
+    /* make sure no other tasks are going, and set the backend readonly
+     * (unless the indexes are rebuilt in shadow dbis)
+     */
+    if ((dbmdb_shadow_reindex_possible(pb) ? instance_set_busy(inst) : instance_set_busy_and_readonly(inst)) != 0) {
         slapi_task_log_notice(task,
                 "%s: is already in the middle of another task and cannot be disturbed.",
                 inst->inst_name);
@@ -177,6 +177,10 @@ dbmdb_monitor_instance_search(Slapi_PBlock *pb __attribute__((unused)),
     }
     dbmdb_free_stats(&stats);
 
+    vlv_auto_monitor(inst, e);
+    filter_plan_monitor(inst, e);
+    search_cache_monitor(inst, e);
+
     *returncode = LDAP_SUCCESS;
     return SLAPI_DSE_CALLBACK_OK;
 }
@@ -305,6 +309,8 @@ dbmdb_dbmonitor_search(Slapi_PBlock *pb __attribute__((unused)),
     MSET("abortRWtxn");
     PR_snprintf(buf, sizeof(buf), "%lu", ctx->perf_rwtxn.nbcommit);
     MSET("commitRWtxn");
+    PR_snprintf(buf, sizeof(buf), "%lu", ctx->group_commit.nbsync);
+    MSET("groupSyncRWtxn");
     PR_snprintf(buf, sizeof(buf), "%lu", ctx->perf_rwtxn.granttime.ns/ctx->perf_rwtxn.granttime.nbsamples);
     MSET("grantTimeRWtxn");
     PR_snprintf(buf, sizeof(buf), "%lu", ctx->perf_rwtxn.lifetime.ns/ctx->perf_rwtxn.lifetime.nbsamples);
@@ -318,6 +324,8 @@ dbmdb_dbmonitor_search(Slapi_PBlock *pb __attribute__((unused)),
     MSET("abortROtxn");
     PR_snprintf(buf, sizeof(buf), "%lu", ctx->perf_rotxn.nbcommit);
     MSET("commitROtxn");
+    PR_snprintf(buf, sizeof(buf), "%lu", ctx->perf_rotxn.nbrenew);
+    MSET("renewROtxn");
     PR_snprintf(buf, sizeof(buf), "%lu", ctx->perf_rotxn.granttime.ns/ctx->perf_rotxn.granttime.nbsamples);
     MSET("grantTimeROtxn");
     PR_snprintf(buf, sizeof(buf), "%lu", ctx->perf_rotxn.lifetime.ns/ctx->perf_rotxn.lifetime.nbsamples);
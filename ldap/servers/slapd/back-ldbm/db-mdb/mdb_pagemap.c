@@ -0,0 +1,643 @@
+/** BEGIN COPYRIGHT BLOCK
+ * Copyright (C) 2026 Red Hat, Inc.
+ * All rights reserved.
+ *
+ * License: GPL (version 3 or any later version).
+ * See LICENSE for details.
+ * END COPYRIGHT BLOCK **/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/*
+ * Page maps of the backups and incremental backups.
+ *
+ * A backup is a copy of the database file done by mdb_env_copyfd, which
+ * writes the pages of a read txn snapshot in page number order. The copy
+ * goes through a pipe so that a checksum of each page is computed on the fly
+ * and stored in the page map file of the backup.
+ *
+ * The pages do not hold the id of the txn that last wrote them (LMDB 0.9),
+ * so the pages that changed since a base backup are found by comparing their
+ * checksums with the page map of the base backup. An incremental backup only
+ * stores these pages (in the delta file) and the page map of the whole
+ * database, so it can be the base of the next incremental backup.
+ *
+ * A restore copies the database file of the full backup, then applies the
+ * deltas of the chain of incremental backups, oldest first.
+ */
+
+#include "mdb_layer.h"
+
+#define PAGEMAP_MAGIC "MDBPGMAP"
+#define DELTA_MAGIC "MDBDELTA"
+#define BACKUP_FORMAT_VERSION 1
+#define BACKUP_IOPAGES 64      /* Pages read at once */
+#define BACKUP_MAPBUFSIZE 4096 /* Page checksums read or written at once */
+#define BACKUP_MAX_CHAIN 1000  /* Maximum number of incremental backups in a chain */
+
+uint64_t sds_siphash13(const void *src, size_t src_sz, const char key[16]);
+
+static const char pagemap_hash_key[16] = "389ds-pagemap-v1";
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t psize;
+    uint64_t npages;
+    uint64_t digest; /* digest of the page checksums */
+} dbmdb_pagemap_hdr_t;
+
+/* Followed by the path of the base backup, then by the (pgno, page) records */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t psize;
+    uint64_t npages;     /* database pages once the delta is applied */
+    uint64_t nchanged;   /* number of pages in the delta */
+    uint64_t basedigest; /* digest of the page map of the base backup */
+    uint32_t baselen;
+    uint32_t pad;
+} dbmdb_delta_hdr_t;
+
+typedef struct {
+    int fd;
+    size_t nb;  /* checksums in buf */
+    size_t pos; /* next checksum to read in buf */
+    uint64_t buf[BACKUP_MAPBUFSIZE];
+} dbmdb_pagemap_t;
+
+
+static uint64_t
+dbmdb_page_checksum(const void *page, uint32_t psize)
+{
+    return sds_siphash13(page, psize, pagemap_hash_key);
+}
+
+static uint64_t
+dbmdb_pagemap_digest(uint64_t digest, uint64_t pgno, uint64_t checksum)
+{
+    return digest + checksum * (2 * pgno + 1);
+}
+
+/* Read len bytes (or less at end of file). Returns the number of bytes read or -1 */
+ssize_t
+dbmdb_read_full(int fd, void *buf, size_t len)
+{
+    size_t pos = 0;
+    ssize_t rc;
+
+    while (pos < len) {
+        rc = read(fd, (char *)buf + pos, len - pos);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc < 0) {
+            return -1;
+        }
+        if (rc == 0) {
+            break;
+        }
+        pos += rc;
+    }
+    return pos;
+}
+
+/* Returns 0 or an errno */
+int
+dbmdb_write_full(int fd, const void *buf, size_t len)
+{
+    size_t pos = 0;
+    ssize_t rc;
+
+    while (pos < len) {
+        rc = write(fd, (const char *)buf + pos, len - pos);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            return rc < 0 ? errno : EIO;
+        }
+        pos += rc;
+    }
+    return 0;
+}
+
+static void
+dbmdb_pagemap_close(dbmdb_pagemap_t **map)
+{
+    if (*map) {
+        if ((*map)->fd >= 0) {
+            close((*map)->fd);
+        }
+        slapi_ch_free((void **)map);
+    }
+}
+
+/* Open the page map of a backup and read its header */
+static dbmdb_pagemap_t *
+dbmdb_pagemap_open(const char *dir, dbmdb_pagemap_hdr_t *hdr)
+{
+    char *path = slapi_ch_smprintf("%s/%s", dir, PAGEMAPFILE);
+    dbmdb_pagemap_t *map = (dbmdb_pagemap_t *)slapi_ch_calloc(1, sizeof(dbmdb_pagemap_t));
+
+    map->fd = open(path, O_RDONLY);
+    if (map->fd < 0 || dbmdb_read_full(map->fd, hdr, sizeof(*hdr)) != sizeof(*hdr) ||
+        memcmp(hdr->magic, PAGEMAP_MAGIC, sizeof(hdr->magic)) || hdr->version != BACKUP_FORMAT_VERSION) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_pagemap_open", "%s is missing or is not a valid page map.\n", path);
+        dbmdb_pagemap_close(&map);
+    }
+    slapi_ch_free_string(&path);
+    return map;
+}
+
+/* Get the next checksum. Returns 0, or -1 at end of the map */
+static int
+dbmdb_pagemap_next(dbmdb_pagemap_t *map, uint64_t *checksum)
+{
+    if (map->pos == map->nb) {
+        ssize_t len = dbmdb_read_full(map->fd, map->buf, sizeof(map->buf));
+        map->nb = len > 0 ? len / sizeof(uint64_t) : 0;
+        map->pos = 0;
+        if (map->nb == 0) {
+            return -1;
+        }
+    }
+    *checksum = map->buf[map->pos++];
+    return 0;
+}
+
+static int
+dbmdb_pagemap_flush(dbmdb_pagemap_t *map)
+{
+    int rc = dbmdb_write_full(map->fd, map->buf, map->nb * sizeof(uint64_t));
+    map->nb = 0;
+    return rc;
+}
+
+static int
+dbmdb_pagemap_put(dbmdb_pagemap_t *map, uint64_t checksum)
+{
+    map->buf[map->nb++] = checksum;
+    return (map->nb == BACKUP_MAPBUFSIZE) ? dbmdb_pagemap_flush(map) : 0;
+}
+
+static void
+dbmdb_env_copy_thread(void *arg)
+{
+    dbmdb_env_copy_t *copy = arg;
+
+    copy->rc = mdb_env_copyfd2(copy->env, copy->fd, copy->flags);
+    close(copy->fd);
+}
+
+/*
+ * Start copying a snapshot of the database in a pipe (flags are the
+ * mdb_env_copyfd2 ones). Returns the read end of the pipe or -1.
+ * The pipe must be read until its end (even if the data is not used)
+ * then dbmdb_env_copy_end must be called.
+ */
+int
+dbmdb_env_copy_begin(dbmdb_env_copy_t *copy, MDB_env *env, unsigned int flags)
+{
+    int pipefd[2] = {-1, -1};
+
+    memset(copy, 0, sizeof(*copy));
+    if (pipe(pipefd)) {
+        return -1;
+    }
+    copy->env = env;
+    copy->flags = flags;
+    copy->fd = pipefd[1];
+    copy->thread = PR_CreateThread(PR_USER_THREAD, dbmdb_env_copy_thread, copy,
+                                   PR_PRIORITY_NORMAL, PR_GLOBAL_BOUND_THREAD,
+                                   PR_JOINABLE_THREAD, SLAPD_DEFAULT_THREAD_STACKSIZE);
+    if (!copy->thread) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+        errno = ENOMEM;
+        return -1;
+    }
+    return pipefd[0];
+}
+
+/* Wait for the end of the copy and close the pipe. Returns the mdb_env_copyfd2 error code */
+int
+dbmdb_env_copy_end(dbmdb_env_copy_t *copy, int fd)
+{
+    PR_JoinThread(copy->thread);
+    copy->thread = NULL;
+    close(fd);
+    if (copy->rc) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_env_copy_end", "Failed to copy the database: %s (%d)\n",
+                      mdb_strerror(copy->rc), copy->rc);
+    }
+    return copy->rc;
+}
+
+static int
+dbmdb_backup_open(const char *dir, const char *filename, int mode)
+{
+    char *path = slapi_ch_smprintf("%s/%s", dir, filename);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+
+    if (fd < 0) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_backup_pages", "Failed to create %s: %s (%d)\n",
+                      path, slapi_system_strerror(errno), errno);
+    }
+    slapi_ch_free_string(&path);
+    return fd;
+}
+
+/*
+ * Copy the database in dest_dir with its page map.
+ * If base_dir is not NULL, only the pages that changed since the base backup
+ * are stored (in the delta file instead of the database file).
+ */
+int
+dbmdb_backup_pages(dbmdb_ctx_t *ctx, const char *dest_dir, const char *base_dir, int mode, Slapi_Task *task)
+{
+    dbmdb_env_copy_t copy = {0};
+    dbmdb_pagemap_hdr_t basehdr = {0};
+    dbmdb_pagemap_hdr_t maphdr = {0};
+    dbmdb_delta_hdr_t deltahdr = {0};
+    dbmdb_pagemap_t *basemap = NULL;
+    dbmdb_pagemap_t *map = NULL;
+    char *pages = NULL;
+    int copyfd = -1;
+    int datafd = -1;
+    uint64_t checksum = 0;
+    uint64_t basechecksum = 0;
+    uint64_t pgno = 0;
+    MDB_stat st = {0};
+    ssize_t len = 0;
+    int rc = 0;
+
+    mdb_env_stat(ctx->env, &st);
+    if (base_dir) {
+        basemap = dbmdb_pagemap_open(base_dir, &basehdr);
+        if (!basemap || basehdr.psize != st.ms_psize) {
+            slapi_log_err(SLAPI_LOG_ERR, "dbmdb_backup_pages",
+                          "%s cannot be the base of an incremental backup (it must be a backup done by this server version).\n",
+                          base_dir);
+            if (task) {
+                slapi_task_log_notice(task, "%s cannot be the base of an incremental backup.", base_dir);
+            }
+            rc = -1;
+            goto done;
+        }
+    }
+
+    map = (dbmdb_pagemap_t *)slapi_ch_calloc(1, sizeof(dbmdb_pagemap_t));
+    map->fd = dbmdb_backup_open(dest_dir, PAGEMAPFILE, mode);
+    datafd = dbmdb_backup_open(dest_dir, base_dir ? DELTAFILE : DBMAPFILE, mode);
+    if (map->fd < 0 || datafd < 0) {
+        rc = -1;
+        goto done;
+    }
+    /* Headers are rewritten once the copy is done */
+    rc = dbmdb_write_full(map->fd, &maphdr, sizeof(maphdr));
+    if (!rc && base_dir) {
+        rc = dbmdb_write_full(datafd, &deltahdr, sizeof(deltahdr));
+        if (!rc) {
+            rc = dbmdb_write_full(datafd, base_dir, strlen(base_dir));
+        }
+    }
+    if (rc) {
+        goto done;
+    }
+
+    /* Not compacted: the page numbers must be the ones of the database */
+    copyfd = dbmdb_env_copy_begin(&copy, ctx->env, 0);
+    if (copyfd < 0) {
+        rc = errno;
+        goto done;
+    }
+
+    pages = slapi_ch_malloc(BACKUP_IOPAGES * st.ms_psize);
+    while ((len = dbmdb_read_full(copyfd, pages, BACKUP_IOPAGES * st.ms_psize)) > 0) {
+        if (rc) {
+            /* Let the copy thread finish */
+            continue;
+        }
+        if (len % st.ms_psize) {
+            rc = EINVAL;
+            continue;
+        }
+        for (char *page = pages; page < pages + len && !rc; page += st.ms_psize, pgno++) {
+            checksum = dbmdb_page_checksum(page, st.ms_psize);
+            maphdr.digest = dbmdb_pagemap_digest(maphdr.digest, pgno, checksum);
+            rc = dbmdb_pagemap_put(map, checksum);
+            if (rc) {
+                break;
+            }
+            if (!base_dir) {
+                rc = dbmdb_write_full(datafd, page, st.ms_psize);
+            } else if (dbmdb_pagemap_next(basemap, &basechecksum) || basechecksum != checksum) {
+                rc = dbmdb_write_full(datafd, &pgno, sizeof(pgno));
+                if (!rc) {
+                    rc = dbmdb_write_full(datafd, page, st.ms_psize);
+                }
+                deltahdr.nchanged++;
+            }
+        }
+    }
+    if (len < 0 && !rc) {
+        rc = errno;
+    }
+    if (dbmdb_env_copy_end(&copy, copyfd) && !rc) {
+        rc = copy.rc;
+    }
+    if (!rc) {
+        rc = dbmdb_pagemap_flush(map);
+    }
+    if (!rc) {
+        memcpy(maphdr.magic, PAGEMAP_MAGIC, sizeof(maphdr.magic));
+        maphdr.version = BACKUP_FORMAT_VERSION;
+        maphdr.psize = st.ms_psize;
+        maphdr.npages = pgno;
+        if (pwrite(map->fd, &maphdr, sizeof(maphdr), 0) != sizeof(maphdr) || fsync(map->fd)) {
+            rc = errno;
+        }
+    }
+    if (!rc && base_dir) {
+        memcpy(deltahdr.magic, DELTA_MAGIC, sizeof(deltahdr.magic));
+        deltahdr.version = BACKUP_FORMAT_VERSION;
+        deltahdr.psize = st.ms_psize;
+        deltahdr.npages = pgno;
+        deltahdr.basedigest = basehdr.digest;
+        deltahdr.baselen = strlen(base_dir);
+        if (pwrite(datafd, &deltahdr, sizeof(deltahdr), 0) != sizeof(deltahdr)) {
+            rc = errno;
+        }
+    }
+    if (!rc && fsync(datafd)) {
+        rc = errno;
+    }
+    if (!rc) {
+        if (base_dir) {
+            slapi_log_err(SLAPI_LOG_INFO, "dbmdb_backup_pages",
+                          "Incremental backup: %lu of %lu pages changed since %s.\n",
+                          (u_long)deltahdr.nchanged, (u_long)pgno, base_dir);
+            if (task) {
+                slapi_task_log_notice(task, "Incremental backup: %lu of %lu pages changed since %s.",
+                                      (u_long)deltahdr.nchanged, (u_long)pgno, base_dir);
+            }
+        }
+    } else if (rc > 0) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_backup_pages", "Failed to backup the database in %s: %s (%d)\n",
+                      dest_dir, slapi_system_strerror(rc), rc);
+    }
+
+done:
+    if (datafd >= 0) {
+        close(datafd);
+    }
+    dbmdb_pagemap_close(&map);
+    dbmdb_pagemap_close(&basemap);
+    slapi_ch_free_string(&pages);
+    return rc ? -1 : 0;
+}
+
+/* Read the header of a delta file and the path of its base. Returns the open file or -1 */
+static int
+dbmdb_delta_open(const char *dir, dbmdb_delta_hdr_t *hdr, char **base_dir)
+{
+    char *path = slapi_ch_smprintf("%s/%s", dir, DELTAFILE);
+    int fd = open(path, O_RDONLY);
+
+    *base_dir = NULL;
+    if (fd < 0) {
+        slapi_ch_free_string(&path);
+        return -1;
+    }
+    if (dbmdb_read_full(fd, hdr, sizeof(*hdr)) != sizeof(*hdr) ||
+        memcmp(hdr->magic, DELTA_MAGIC, sizeof(hdr->magic)) || hdr->version != BACKUP_FORMAT_VERSION ||
+        hdr->baselen == 0 || hdr->baselen >= MAXPATHLEN) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_delta_open", "%s is not a valid incremental backup file.\n", path);
+        close(fd);
+        fd = -1;
+    } else {
+        *base_dir = slapi_ch_calloc(1, hdr->baselen + 1);
+        if (dbmdb_read_full(fd, *base_dir, hdr->baselen) != hdr->baselen) {
+            slapi_log_err(SLAPI_LOG_ERR, "dbmdb_delta_open", "%s is truncated.\n", path);
+            slapi_ch_free_string(base_dir);
+            close(fd);
+            fd = -1;
+        }
+    }
+    slapi_ch_free_string(&path);
+    return fd;
+}
+
+/* Check that the base of an incremental backup is the one it was made from */
+static int
+dbmdb_delta_check_base(const char *dir, const dbmdb_delta_hdr_t *hdr, const char *base_dir)
+{
+    dbmdb_pagemap_hdr_t basehdr = {0};
+    dbmdb_pagemap_t *basemap = dbmdb_pagemap_open(base_dir, &basehdr);
+    int rc = 0;
+
+    if (!basemap || basehdr.digest != hdr->basedigest || basehdr.psize != hdr->psize) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_delta_check_base",
+                      "%s is not the backup that incremental backup %s is based on.\n", base_dir, dir);
+        rc = -1;
+    }
+    dbmdb_pagemap_close(&basemap);
+    return rc;
+}
+
+int
+dbmdb_backup_is_incremental(const char *dir)
+{
+    char *path = slapi_ch_smprintf("%s/%s", dir, DELTAFILE);
+    int rc = (access(path, F_OK) == 0);
+
+    slapi_ch_free_string(&path);
+    return rc;
+}
+
+static int
+dbmdb_restore_pages_chain(const char *src_dir, char *dest, int mode, Slapi_Task *task, int depth)
+{
+    dbmdb_delta_hdr_t hdr = {0};
+    char *base_dir = NULL;
+    char *page = NULL;
+    uint64_t pgno = 0;
+    int destfd = -1;
+    int fd = -1;
+    int rc = 0;
+
+    if (!dbmdb_backup_is_incremental(src_dir)) {
+        char *path = slapi_ch_smprintf("%s/%s", src_dir, DBMAPFILE);
+        rc = dbmdb_copyfile(path, dest, PR_TRUE, mode);
+        slapi_ch_free_string(&path);
+        return rc;
+    }
+    if (depth >= BACKUP_MAX_CHAIN) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_restore_pages", "Too many incremental backups before %s.\n", src_dir);
+        return -1;
+    }
+    fd = dbmdb_delta_open(src_dir, &hdr, &base_dir);
+    if (fd < 0 || dbmdb_delta_check_base(src_dir, &hdr, base_dir) ||
+        dbmdb_restore_pages_chain(base_dir, dest, mode, task, depth + 1)) {
+        rc = -1;
+        goto done;
+    }
+
+    destfd = open(dest, O_WRONLY);
+    if (destfd < 0) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_restore_pages", "Failed to open %s: %s (%d)\n",
+                      dest, slapi_system_strerror(errno), errno);
+        rc = -1;
+        goto done;
+    }
+    page = slapi_ch_malloc(hdr.psize);
+    errno = 0;
+    for (uint64_t i = 0; i < hdr.nchanged && !rc; i++) {
+        if (dbmdb_read_full(fd, &pgno, sizeof(pgno)) != sizeof(pgno) ||
+            dbmdb_read_full(fd, page, hdr.psize) != hdr.psize || pgno >= hdr.npages) {
+            slapi_log_err(SLAPI_LOG_ERR, "dbmdb_restore_pages", "%s/%s is truncated or corrupted.\n",
+                          src_dir, DELTAFILE);
+            rc = -1;
+        } else if (pwrite(destfd, page, hdr.psize, pgno * hdr.psize) != hdr.psize) {
+            rc = -1;
+        }
+    }
+    if (!rc && (ftruncate(destfd, hdr.npages * hdr.psize) || fsync(destfd))) {
+        rc = -1;
+    }
+    if (rc && errno) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_restore_pages", "Failed to write %s: %s (%d)\n",
+                      dest, slapi_system_strerror(errno), errno);
+    }
+    if (!rc) {
+        slapi_log_err(SLAPI_LOG_INFO, "dbmdb_restore_pages", "Applied the %lu pages of incremental backup %s.\n",
+                      (u_long)hdr.nchanged, src_dir);
+        if (task) {
+            slapi_task_log_notice(task, "Applied the %lu pages of incremental backup %s.",
+                                  (u_long)hdr.nchanged, src_dir);
+        }
+    }
+
+done:
+    if (destfd >= 0) {
+        close(destfd);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    slapi_ch_free_string(&page);
+    slapi_ch_free_string(&base_dir);
+    return rc;
+}
+
+/* Rebuild the database file 'dest' from a full or incremental backup */
+int
+dbmdb_restore_pages(const char *src_dir, char *dest, int mode, Slapi_Task *task)
+{
+    return dbmdb_restore_pages_chain(src_dir, dest, mode, task, 0);
+}
+
+/* Check the page map of a backup against its content, then check its base */
+static int
+dbmdb_backup_verify_chain(const char *dir, int depth)
+{
+    dbmdb_pagemap_hdr_t maphdr = {0};
+    dbmdb_delta_hdr_t hdr = {0};
+    dbmdb_pagemap_t *map = dbmdb_pagemap_open(dir, &maphdr);
+    char *base_dir = NULL;
+    char *pages = NULL;
+    char *path = NULL;
+    uint64_t digest = 0;
+    uint64_t checksum = 0;
+    uint64_t pgno = 0;
+    off_t mapoffset = 0;
+    ssize_t len = 0;
+    int fd = -1;
+    int rc = -1;
+
+    if (!map) {
+        goto done;
+    }
+    /* The page map itself */
+    while (dbmdb_pagemap_next(map, &checksum) == 0) {
+        digest = dbmdb_pagemap_digest(digest, pgno++, checksum);
+    }
+    if (pgno != maphdr.npages || digest != maphdr.digest) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_backup_verify", "%s/%s is corrupted.\n", dir, PAGEMAPFILE);
+        goto done;
+    }
+
+    pages = slapi_ch_malloc(BACKUP_IOPAGES * maphdr.psize);
+    if (!dbmdb_backup_is_incremental(dir)) {
+        /* A full backup: the database pages must match the map */
+        path = slapi_ch_smprintf("%s/%s", dir, DBMAPFILE);
+        fd = open(path, O_RDONLY);
+        lseek(map->fd, sizeof(maphdr), SEEK_SET);
+        map->nb = map->pos = 0;
+        for (pgno = 0; fd >= 0 && (len = dbmdb_read_full(fd, pages, BACKUP_IOPAGES * maphdr.psize)) > 0;) {
+            for (char *page = pages; page < pages + len; page += maphdr.psize, pgno++) {
+                if ((page + maphdr.psize > pages + len) || dbmdb_pagemap_next(map, &checksum) ||
+                    checksum != dbmdb_page_checksum(page, maphdr.psize)) {
+                    slapi_log_err(SLAPI_LOG_ERR, "dbmdb_backup_verify", "%s: page %lu is corrupted.\n",
+                                  path, (u_long)pgno);
+                    goto done;
+                }
+            }
+        }
+        if (fd < 0 || len < 0 || pgno != maphdr.npages) {
+            slapi_log_err(SLAPI_LOG_ERR, "dbmdb_backup_verify", "%s is missing or truncated.\n", path);
+            goto done;
+        }
+        rc = 0;
+        goto done;
+    }
+
+    /* An incremental backup: the delta pages must match the map, then check the base */
+    fd = dbmdb_delta_open(dir, &hdr, &base_dir);
+    if (fd < 0 || hdr.psize != maphdr.psize || hdr.npages != maphdr.npages) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_backup_verify", "%s/%s does not match the page map.\n", dir, DELTAFILE);
+        goto done;
+    }
+    for (uint64_t i = 0; i < hdr.nchanged; i++) {
+        if (dbmdb_read_full(fd, &pgno, sizeof(pgno)) != sizeof(pgno) ||
+            dbmdb_read_full(fd, pages, hdr.psize) != hdr.psize || pgno >= hdr.npages) {
+            slapi_log_err(SLAPI_LOG_ERR, "dbmdb_backup_verify", "%s/%s is truncated.\n", dir, DELTAFILE);
+            goto done;
+        }
+        mapoffset = sizeof(maphdr) + pgno * sizeof(uint64_t);
+        if (pread(map->fd, &checksum, sizeof(checksum), mapoffset) != sizeof(checksum) ||
+            checksum != dbmdb_page_checksum(pages, hdr.psize)) {
+            slapi_log_err(SLAPI_LOG_ERR, "dbmdb_backup_verify", "%s/%s: page %lu is corrupted.\n",
+                          dir, DELTAFILE, (u_long)pgno);
+            goto done;
+        }
+    }
+    if (depth >= BACKUP_MAX_CHAIN || dbmdb_delta_check_base(dir, &hdr, base_dir)) {
+        goto done;
+    }
+    rc = dbmdb_backup_verify_chain(base_dir, depth + 1);
+
+done:
+    if (fd >= 0) {
+        close(fd);
+    }
+    dbmdb_pagemap_close(&map);
+    slapi_ch_free_string(&base_dir);
+    slapi_ch_free_string(&pages);
+    slapi_ch_free_string(&path);
+    return rc;
+}
+
+/* Returns 0 if the backup in 'dir' (and the backups it is based on) is consistent */
+int
+dbmdb_backup_verify(const char *dir)
+{
+    int rc = dbmdb_backup_verify_chain(dir, 0);
+
+    slapi_log_err(rc ? SLAPI_LOG_ERR : SLAPI_LOG_INFO, "dbmdb_backup_verify",
+                  "Backup %s is %s.\n", dir, rc ? "corrupted or incomplete" : "valid");
+    return rc;
+}
@@ -0,0 +1,436 @@
+/** BEGIN COPYRIGHT BLOCK
+ * Copyright (C) 2026 Red Hat, Inc.
+ * All rights reserved.
+ *
+ * License: GPL (version 3 or any later version).
+ * See LICENSE for details.
+ * END COPYRIGHT BLOCK **/
+
+/*
+ * Online reindex in shadow dbis.
+ *
+ * When a reindex task only rebuilds attribute indexes, the indexes are not
+ * cleared: they are rebuilt in a "<attr>.shadow" dbi while the live index
+ * keeps serving the searches and the backend keeps accepting updates.
+ *
+ * The updates of a live index made during the rebuild are logged (in the
+ * same txn) in a "<attr>.shadowlog" dbi, keyed by the index key prefixed by
+ * '+' (key/id added) or '-' (key/id removed). As a later update of the same
+ * key/id replaces the former one, the log holds the last update of each
+ * key/id pair. Whatever version of an entry the rebuild has seen, replaying
+ * the log on the shadow dbi gives the current index content.
+ *
+ * Once the rebuild is finished, a single write txn replays the log, copies
+ * the shadow dbi in the live one and stops the logging, so the readers see
+ * either the old index or the new one.
+ */
+
+#include "mdb_import.h"
+
+#define SHADOW_SUFFIX ".shadow"
+#define SHADOWLOG_SUFFIX ".shadowlog"
+#define SHADOWLOG_ADD '+'
+#define SHADOWLOG_DEL '-'
+
+/* The indexes that are not plain attribute indexes cannot be shadowed */
+static const char *shadow_excluded_indexes[] = {
+    LDBM_ENTRYRDN_STR,
+    LDBM_PARENTID_STR,
+    LDBM_ANCESTORID_STR,
+    LDBM_ENTRYDN_STR,
+    LDBM_NUMSUBORDINATES_STR,
+    NULL
+};
+
+typedef struct {
+    ImportCtx_t *ctx;
+    MDB_txn *txn;
+    int rc;
+} ShadowApplyCtx_t;
+
+static MDB_dbi
+dbmdb_shadow_logdbi(dbmdb_dbi_t *dbi)
+{
+    return (MDB_dbi)slapi_atomic_load_32((int32_t *)&dbi->shadowlog, __ATOMIC_ACQUIRE);
+}
+
+/* Log a single key/id update, replacing the previous update of the pair */
+static int
+dbmdb_shadow_log1(MDB_txn *txn, MDB_dbi logdbi, int isadd, MDB_val *key, MDB_val *data)
+{
+    char buf[512];
+    MDB_val lkey = {0};
+    int rc = 0;
+
+    lkey.mv_size = key->mv_size + 1;
+    lkey.mv_data = (lkey.mv_size <= sizeof buf) ? buf : slapi_ch_malloc(lkey.mv_size);
+    memcpy((char *)lkey.mv_data + 1, key->mv_data, key->mv_size);
+
+    *(char *)lkey.mv_data = isadd ? SHADOWLOG_DEL : SHADOWLOG_ADD;
+    rc = MDB_DEL(txn, logdbi, &lkey, data);
+    if (rc == MDB_NOTFOUND) {
+        rc = 0;
+    }
+    if (rc == 0) {
+        *(char *)lkey.mv_data = isadd ? SHADOWLOG_ADD : SHADOWLOG_DEL;
+        rc = MDB_PUT(txn, logdbi, &lkey, data, MDB_NODUPDATA);
+        if (rc == MDB_KEYEXIST) {
+            rc = 0;
+        }
+    }
+    if (lkey.mv_data != buf) {
+        slapi_ch_free(&lkey.mv_data);
+    }
+    return rc;
+}
+
+/*
+ * Log an update of an index that is rebuilt in a shadow dbi.
+ * Called in the txn of the update, before doing it.
+ * (no-op if the index is not being rebuilt)
+ */
+int
+dbmdb_shadow_log(MDB_txn *txn, dbmdb_dbi_t *dbi, dbi_op_t op, MDB_val *key, MDB_val *data)
+{
+    MDB_dbi logdbi = dbmdb_shadow_logdbi(dbi);
+    MDB_cursor *cur = NULL;
+    MDB_val ikey = {0};
+    MDB_val id = {0};
+    int rc = 0;
+
+    if (logdbi == 0 || (op != DBI_OP_ADD && op != DBI_OP_PUT && op != DBI_OP_DEL)) {
+        return 0;
+    }
+    if (data && data->mv_data) {
+        return dbmdb_shadow_log1(txn, logdbi, op != DBI_OP_DEL, key, data);
+    }
+    /* The whole key is removed: log all its ids */
+    ikey = *key;
+    rc = MDB_CURSOR_OPEN(txn, dbi->dbi, &cur);
+    if (rc == 0) {
+        rc = MDB_CURSOR_GET(cur, &ikey, &id, MDB_SET);
+        while (rc == 0) {
+            rc = dbmdb_shadow_log1(txn, logdbi, 0, key, &id);
+            if (rc == 0) {
+                rc = MDB_CURSOR_GET(cur, &ikey, &id, MDB_NEXT_DUP);
+            }
+        }
+        MDB_CURSOR_CLOSE(cur);
+    }
+    return (rc == MDB_NOTFOUND) ? 0 : rc;
+}
+
+/* Same as dbmdb_shadow_log for a cursor update (or deletion of the current record) */
+int
+dbmdb_shadow_log_cursor(dbi_cursor_t *cursor, dbi_op_t op, MDB_val *key, MDB_val *data)
+{
+    MDB_cursor *cur = (MDB_cursor *)cursor->cur;
+    MDB_val curkey = {0};
+    MDB_val curdata = {0};
+    dbmdb_ctx_t *ctx = NULL;
+    int rc = 0;
+
+    if (!cursor->be) {
+        return 0;
+    }
+    ctx = MDB_CONFIG((struct ldbminfo *)cursor->be->be_database->plg_private);
+    if (dbmdb_shadow_logdbi(&ctx->dbi_slots[mdb_cursor_dbi(cur)]) == 0) {
+        return 0;
+    }
+    if (op == DBI_OP_DEL) {
+        rc = MDB_CURSOR_GET(cur, &curkey, &curdata, MDB_GET_CURRENT);
+        key = &curkey;
+        data = &curdata;
+    }
+    if (rc == 0) {
+        rc = dbmdb_shadow_log(mdb_cursor_txn(cur), &ctx->dbi_slots[mdb_cursor_dbi(cur)], op, key, data);
+    }
+    return rc;
+}
+
+/*
+ * Tell whether a reindex task may rebuild its indexes in shadow dbis:
+ * it must be an online task that only rebuilds attribute indexes.
+ */
+int
+dbmdb_shadow_reindex_possible(Slapi_PBlock *pb)
+{
+    char **attrs = NULL;
+    int task_flags = 0;
+
+    slapi_pblock_get(pb, SLAPI_TASK_FLAGS, &task_flags);
+    slapi_pblock_get(pb, SLAPI_DB2INDEX_ATTRS, &attrs);
+    if ((task_flags & SLAPI_TASK_RUNNING_FROM_COMMANDLINE) || !attrs || !attrs[0]) {
+        return 0;
+    }
+    for (size_t i = 0; attrs[i]; i++) {
+        if (attrs[i][0] != 't') {
+            /* VLV index */
+            return 0;
+        }
+        if (charray_inlist((char **)shadow_excluded_indexes, attrs[i] + 1)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Open the live index, its shadow dbi (that the import fills) and its update log */
+int
+dbmdb_import_shadow_open(ImportCtx_t *ctx, MdbIndexInfo_t *mii)
+{
+    const int shadow_flags = MDB_CREATE | MDB_MARK_DIRTY_DBI | MDB_OPEN_DIRTY_DBI | MDB_TRUNCATE_DBI;
+    backend *be = ctx->job->inst->inst_be;
+    char *name = NULL;
+    int rc = 0;
+
+    rc = dbmdb_open_dbi_from_filename(&mii->live, be, mii->name, mii->ai, MDB_CREATE);
+    if (rc == 0) {
+        name = slapi_ch_smprintf("%s%s", mii->name, SHADOW_SUFFIX);
+        rc = dbmdb_open_dbi_from_filename(&mii->dbi, be, name, mii->ai, shadow_flags);
+        slapi_ch_free_string(&name);
+    }
+    if (rc == 0) {
+        /* Default key order: the key is prefixed by the update type */
+        name = slapi_ch_smprintf("%s%s", mii->name, SHADOWLOG_SUFFIX);
+        rc = dbmdb_open_dbi_from_filename(&mii->shadowlog, be, name, NULL, MDB_CREATE | MDB_TRUNCATE_DBI);
+        slapi_ch_free_string(&name);
+    }
+    if (rc) {
+        import_log_notice(ctx->job, SLAPI_LOG_ERR, "dbmdb_import_shadow_open",
+                          "Failed to open the shadow databases of index %s. Error %d: %s",
+                          mii->name, rc, mdb_strerror(rc));
+    }
+    return rc;
+}
+
+static int
+dbmdb_import_shadow_start_index(caddr_t data, caddr_t arg)
+{
+    MdbIndexInfo_t *mii = (MdbIndexInfo_t *)data;
+    ShadowApplyCtx_t *sctx = (ShadowApplyCtx_t *)arg;
+
+    if (!mii->live || !mii->dbi || !mii->shadowlog) {
+        sctx->rc = MDB_NOTFOUND;
+        return -1;
+    }
+    slapi_atomic_store_32((int32_t *)&mii->live->shadowlog, mii->shadowlog->dbi, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* Start logging the updates of the live indexes (before reading any entry) */
+int
+dbmdb_import_shadow_start(ImportCtx_t *ctx)
+{
+    ShadowApplyCtx_t sctx = {ctx, NULL, 0};
+    MDB_txn *txn = NULL;
+
+    avl_apply(ctx->indexes, dbmdb_import_shadow_start_index, (caddr_t)&sctx, -1, AVL_INORDER);
+    if (sctx.rc == 0) {
+        /*
+         * Wait until the write txn that may have updated an index without
+         * logging it is over (LMDB serializes the write txns)
+         */
+        sctx.rc = TXN_BEGIN(ctx->ctx->env, NULL, 0, &txn);
+        if (sctx.rc == 0) {
+            TXN_ABORT(txn);
+        }
+    }
+    if (sctx.rc) {
+        import_log_notice(ctx->job, SLAPI_LOG_ERR, "dbmdb_import_shadow_start",
+                          "Failed to start logging the index updates. Error %d: %s",
+                          sctx.rc, mdb_strerror(sctx.rc));
+    }
+    return sctx.rc;
+}
+
+/* Apply the logged updates on the shadow dbi */
+static int
+dbmdb_import_shadow_replay(MDB_txn *txn, MdbIndexInfo_t *mii, size_t *nbupdates)
+{
+    MDB_cursor *cur = NULL;
+    MDB_val key = {0};
+    MDB_val data = {0};
+    int rc = 0;
+
+    rc = MDB_CURSOR_OPEN(txn, mii->shadowlog->dbi, &cur);
+    if (rc) {
+        return rc;
+    }
+    rc = MDB_CURSOR_GET(cur, &key, &data, MDB_FIRST);
+    while (rc == 0) {
+        MDB_val ikey = {key.mv_size - 1, (char *)key.mv_data + 1};
+        if (*(char *)key.mv_data == SHADOWLOG_ADD) {
+            rc = MDB_PUT(txn, mii->dbi->dbi, &ikey, &data, MDB_NODUPDATA);
+            rc = (rc == MDB_KEYEXIST) ? 0 : rc;
+        } else {
+            rc = MDB_DEL(txn, mii->dbi->dbi, &ikey, &data);
+            rc = (rc == MDB_NOTFOUND) ? 0 : rc;
+        }
+        (*nbupdates)++;
+        if (rc == 0) {
+            rc = MDB_CURSOR_GET(cur, &key, &data, MDB_NEXT);
+        }
+    }
+    MDB_CURSOR_CLOSE(cur);
+    return (rc == MDB_NOTFOUND) ? 0 : rc;
+}
+
+/* Replace the content of the live index by the content of the shadow dbi */
+static int
+dbmdb_import_shadow_copy(MDB_txn *txn, MdbIndexInfo_t *mii)
+{
+    MDB_cursor *src = NULL;
+    MDB_cursor *dst = NULL;
+    MDB_val key = {0};
+    MDB_val data = {0};
+    int rc = 0;
+
+    rc = MDB_DROP(txn, mii->live->dbi, 0);
+    if (rc == 0) {
+        rc = MDB_CURSOR_OPEN(txn, mii->dbi->dbi, &src);
+    }
+    if (rc == 0) {
+        rc = MDB_CURSOR_OPEN(txn, mii->live->dbi, &dst);
+    }
+    if (rc == 0) {
+        rc = MDB_CURSOR_GET(src, &key, &data, MDB_FIRST);
+    }
+    while (rc == 0) {
+        /* Keys and ids come in order: the pages are filled sequentially */
+        rc = MDB_CURSOR_PUT(dst, &key, &data, MDB_APPEND);
+        while (rc == 0 && (rc = MDB_CURSOR_GET(src, &key, &data, MDB_NEXT_DUP)) == 0) {
+            rc = MDB_CURSOR_PUT(dst, &key, &data, MDB_APPENDDUP);
+        }
+        if (rc == MDB_NOTFOUND) {
+            rc = MDB_CURSOR_GET(src, &key, &data, MDB_NEXT_NODUP);
+        }
+    }
+    if (dst) {
+        MDB_CURSOR_CLOSE(dst);
+    }
+    if (src) {
+        MDB_CURSOR_CLOSE(src);
+    }
+    return (rc == MDB_NOTFOUND) ? 0 : rc;
+}
+
+static int
+dbmdb_import_shadow_switch_index(caddr_t data, caddr_t arg)
+{
+    MdbIndexInfo_t *mii = (MdbIndexInfo_t *)data;
+    ShadowApplyCtx_t *sctx = (ShadowApplyCtx_t *)arg;
+    size_t nbupdates = 0;
+
+    sctx->rc = dbmdb_import_shadow_replay(sctx->txn, mii, &nbupdates);
+    if (sctx->rc == 0) {
+        sctx->rc = dbmdb_import_shadow_copy(sctx->txn, mii);
+    }
+    if (sctx->rc) {
+        import_log_notice(sctx->ctx->job, SLAPI_LOG_ERR, "dbmdb_import_shadow_switch",
+                          "Failed to switch index %s to its rebuilt version. Error %d: %s",
+                          mii->name, sctx->rc, mdb_strerror(sctx->rc));
+        return -1;
+    }
+    /* The txn holds the write lock: no update can be missed */
+    slapi_atomic_store_32((int32_t *)&mii->live->shadowlog, 0, __ATOMIC_RELEASE);
+    import_log_notice(sctx->ctx->job, SLAPI_LOG_INFO, "dbmdb_import_shadow_switch",
+                      "Index %s rebuilt (%lu updates done during the rebuild).",
+                      mii->name, (u_long)nbupdates);
+    return 0;
+}
+
+/* Atomically replace the live indexes by the rebuilt ones */
+int
+dbmdb_import_shadow_switch(ImportCtx_t *ctx)
+{
+    ShadowApplyCtx_t sctx = {ctx, NULL, 0};
+
+    sctx.rc = TXN_BEGIN(ctx->ctx->env, NULL, 0, &sctx.txn);
+    if (sctx.rc == 0) {
+        avl_apply(ctx->indexes, dbmdb_import_shadow_switch_index, (caddr_t)&sctx, -1, AVL_INORDER);
+        if (sctx.rc) {
+            TXN_ABORT(sctx.txn);
+        } else {
+            sctx.rc = TXN_COMMIT(sctx.txn);
+        }
+        if (sctx.rc == 0) {
+            /* Not an operation txn: the group commit does not sync it */
+            sctx.rc = dbmdb_txn_group_sync_env(ctx->ctx);
+        }
+    }
+    if (sctx.rc) {
+        import_log_notice(ctx->job, SLAPI_LOG_ERR, "dbmdb_import_shadow_switch",
+                          "Failed to switch the rebuilt indexes. Error %d: %s",
+                          sctx.rc, mdb_strerror(sctx.rc));
+    }
+    return sctx.rc;
+}
+
+static int
+dbmdb_import_shadow_cleanup_index(caddr_t data, caddr_t arg)
+{
+    MdbIndexInfo_t *mii = (MdbIndexInfo_t *)data;
+    ImportCtx_t *ctx = (ImportCtx_t *)arg;
+
+    if (mii->live) {
+        slapi_atomic_store_32((int32_t *)&mii->live->shadowlog, 0, __ATOMIC_RELEASE);
+    }
+    if (mii->shadowlog) {
+        dbmdb_dbi_remove(ctx->ctx, (dbi_db_t **)&mii->shadowlog);
+    }
+    if (mii->dbi) {
+        dbmdb_dbi_remove(ctx->ctx, (dbi_db_t **)&mii->dbi);
+    }
+    return 0;
+}
+
+/* Stop logging the updates and remove the shadow dbis */
+void
+dbmdb_import_shadow_cleanup(ImportCtx_t *ctx)
+{
+    avl_apply(ctx->indexes, dbmdb_import_shadow_cleanup_index, (caddr_t)ctx, -1, AVL_INORDER);
+}
+
+/* Tell whether a dbi name ends with a shadow suffix */
+static int
+dbmdb_shadow_is_shadow_name(const char *dbname)
+{
+    static const char *suffixes[] = { SHADOW_SUFFIX LDBM_FILENAME_SUFFIX, SHADOWLOG_SUFFIX LDBM_FILENAME_SUFFIX, NULL };
+    size_t len = strlen(dbname);
+
+    for (size_t i = 0; suffixes[i]; i++) {
+        size_t slen = strlen(suffixes[i]);
+        if (len > slen && strcasecmp(dbname + len - slen, suffixes[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Remove the shadow dbis left by an online reindex that did not complete
+ * (i.e. the server stopped during the rebuild). Called when the instance
+ * starts, so no reindex task can use them.
+ */
+void
+dbmdb_shadow_remove_stale(dbmdb_ctx_t *ctx, backend *be)
+{
+    dbmdb_dbi_t **dbilist = NULL;
+    int size = 0;
+
+    if (ctx->readonly) {
+        return;
+    }
+    dbilist = dbmdb_list_dbis(ctx, be, NULL, PR_FALSE, &size);
+    for (int i = 0; i < size; i++) {
+        dbmdb_dbi_t *dbi = dbilist[i];
+        if (dbmdb_shadow_is_shadow_name(dbi->dbname)) {
+            slapi_log_err(SLAPI_LOG_INFO, "dbmdb_shadow_remove_stale",
+                          "Removing %s left by an interrupted reindex.\n", dbi->dbname);
+            dbi->shadowlog = 0;
+            dbmdb_dbi_remove(ctx, (dbi_db_t **)&dbi);
+        }
+    }
+    slapi_ch_free((void **)&dbilist);
+}
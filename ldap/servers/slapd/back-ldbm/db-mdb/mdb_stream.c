@@ -0,0 +1,276 @@
+/** BEGIN COPYRIGHT BLOCK
+ * Copyright (C) 2026 Red Hat, Inc.
+ * All rights reserved.
+ *
+ * License: GPL (version 3 or any later version).
+ * See LICENSE for details.
+ * END COPYRIGHT BLOCK **/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/*
+ * Format of the streamed backups.
+ *
+ * A streamed backup holds the same files as a backup directory but is
+ * written in a single file descriptor (a pipe to a compressor, a socket
+ * to a backup server, ...) so it does not need any disk space on the server.
+ * The size of the database copy is not known when it starts, so each file
+ * is split in chunks:
+ *
+ *     header: STREAM_MAGIC, version, flags
+ *     file:   name length, name, mode,
+ *             chunks (length, data) ended by an empty chunk,
+ *             file size
+ *     ...
+ *     end:    empty name
+ *
+ * All the integers are in network byte order.
+ */
+
+#include "mdb_layer.h"
+
+#define STREAM_MAGIC "DSBKSTRM"
+#define STREAM_FORMAT_VERSION 1
+#define STREAM_CHUNK_SIZE (1024 * 1024)
+#define STREAM_MAX_NAME 255
+
+static void
+dbmdb_stream_enc32(unsigned char *buf, uint32_t val)
+{
+    buf[0] = val >> 24;
+    buf[1] = val >> 16;
+    buf[2] = val >> 8;
+    buf[3] = val;
+}
+
+static uint32_t
+dbmdb_stream_dec32(const unsigned char *buf)
+{
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+static int
+dbmdb_stream_put32(int fd, uint32_t val)
+{
+    unsigned char buf[4];
+
+    dbmdb_stream_enc32(buf, val);
+    return dbmdb_write_full(fd, buf, sizeof(buf));
+}
+
+static int
+dbmdb_stream_put64(int fd, uint64_t val)
+{
+    unsigned char buf[8];
+
+    dbmdb_stream_enc32(buf, val >> 32);
+    dbmdb_stream_enc32(buf + 4, val);
+    return dbmdb_write_full(fd, buf, sizeof(buf));
+}
+
+/* Read exactly len bytes. Returns 0 or an errno (EIO if the stream is truncated) */
+static int
+dbmdb_stream_get(int fd, void *buf, size_t len)
+{
+    ssize_t rc = dbmdb_read_full(fd, buf, len);
+
+    if (rc < 0) {
+        return errno;
+    }
+    return ((size_t)rc == len) ? 0 : EIO;
+}
+
+static int
+dbmdb_stream_get32(int fd, uint32_t *val)
+{
+    unsigned char buf[4];
+    int rc = dbmdb_stream_get(fd, buf, sizeof(buf));
+
+    *val = dbmdb_stream_dec32(buf);
+    return rc;
+}
+
+static int
+dbmdb_stream_get64(int fd, uint64_t *val)
+{
+    unsigned char buf[8];
+    int rc = dbmdb_stream_get(fd, buf, sizeof(buf));
+
+    *val = ((uint64_t)dbmdb_stream_dec32(buf) << 32) | dbmdb_stream_dec32(buf + 4);
+    return rc;
+}
+
+/* All the functions return 0 or an errno */
+int
+dbmdb_stream_write_header(int fd, uint32_t flags)
+{
+    int rc = dbmdb_write_full(fd, STREAM_MAGIC, strlen(STREAM_MAGIC));
+
+    if (!rc) {
+        rc = dbmdb_stream_put32(fd, STREAM_FORMAT_VERSION);
+    }
+    if (!rc) {
+        rc = dbmdb_stream_put32(fd, flags);
+    }
+    return rc;
+}
+
+/*
+ * Write a file whose data is read from srcfd until its end.
+ * srcfd is always read until its end, even if the stream cannot be written,
+ * so that a writer on the other side of a pipe is never blocked.
+ */
+int
+dbmdb_stream_write_fd(int fd, const char *name, uint32_t mode, int srcfd)
+{
+    uint32_t namelen = strlen(name);
+    unsigned char *buf = NULL;
+    uint64_t size = 0;
+    ssize_t len = 0;
+    int rc = 0;
+
+    rc = dbmdb_stream_put32(fd, namelen);
+    if (!rc) {
+        rc = dbmdb_write_full(fd, name, namelen);
+    }
+    if (!rc) {
+        rc = dbmdb_stream_put32(fd, mode);
+    }
+    /* The length of the chunk is written with its data */
+    buf = (unsigned char *)slapi_ch_malloc(4 + STREAM_CHUNK_SIZE);
+    while ((len = dbmdb_read_full(srcfd, buf + 4, STREAM_CHUNK_SIZE)) > 0) {
+        if (!rc) {
+            dbmdb_stream_enc32(buf, len);
+            rc = dbmdb_write_full(fd, buf, 4 + len);
+            size += len;
+        }
+    }
+    if (len < 0 && !rc) {
+        rc = errno;
+    }
+    slapi_ch_free((void **)&buf);
+    if (!rc) {
+        rc = dbmdb_stream_put32(fd, 0);
+    }
+    if (!rc) {
+        rc = dbmdb_stream_put64(fd, size);
+    }
+    return rc;
+}
+
+int
+dbmdb_stream_write_file(int fd, const char *dir, const char *name)
+{
+    char *path = slapi_ch_smprintf("%s/%s", dir, name);
+    int srcfd = open(path, O_RDONLY);
+    struct stat sbuf = {0};
+    int rc = 0;
+
+    if (srcfd < 0 || fstat(srcfd, &sbuf)) {
+        rc = errno;
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_stream_write_file", "Failed to read %s: %s (%d)\n",
+                      path, slapi_system_strerror(rc), rc);
+    } else {
+        rc = dbmdb_stream_write_fd(fd, name, sbuf.st_mode & 0777, srcfd);
+    }
+    if (srcfd >= 0) {
+        close(srcfd);
+    }
+    slapi_ch_free_string(&path);
+    return rc;
+}
+
+int
+dbmdb_stream_write_end(int fd)
+{
+    return dbmdb_stream_put32(fd, 0);
+}
+
+int
+dbmdb_stream_read_header(int fd, uint32_t *flags)
+{
+    char magic[sizeof(STREAM_MAGIC) - 1];
+    uint32_t version = 0;
+    int rc = dbmdb_stream_get(fd, magic, sizeof(magic));
+
+    if (!rc) {
+        rc = dbmdb_stream_get32(fd, &version);
+    }
+    if (!rc) {
+        rc = dbmdb_stream_get32(fd, flags);
+    }
+    if (!rc && (memcmp(magic, STREAM_MAGIC, sizeof(magic)) || version != STREAM_FORMAT_VERSION)) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_stream_read_header", "The stream is not a backup of this server version.\n");
+        rc = EINVAL;
+    }
+    return rc;
+}
+
+/*
+ * Read the header of the next file. *name is NULL at the end of the stream.
+ * The names are plain file names: the stream cannot write outside of
+ * the directory where it is restored.
+ */
+int
+dbmdb_stream_next_file(int fd, char **name, uint32_t *mode)
+{
+    uint32_t namelen = 0;
+    int rc = dbmdb_stream_get32(fd, &namelen);
+
+    *name = NULL;
+    if (rc || namelen == 0) {
+        return rc;
+    }
+    if (namelen > STREAM_MAX_NAME) {
+        return EINVAL;
+    }
+    *name = slapi_ch_calloc(1, namelen + 1);
+    rc = dbmdb_stream_get(fd, *name, namelen);
+    if (!rc) {
+        rc = dbmdb_stream_get32(fd, mode);
+    }
+    if (!rc && (strlen(*name) != namelen || strchr(*name, '/') || **name == '.')) {
+        slapi_log_err(SLAPI_LOG_ERR, "dbmdb_stream_next_file", "Invalid file name in the backup stream.\n");
+        rc = EINVAL;
+    }
+    if (rc) {
+        slapi_ch_free_string(name);
+    }
+    return rc;
+}
+
+/* Read the data of the current file and write it in destfd (or skip it if destfd is -1) */
+int
+dbmdb_stream_read_data(int fd, int destfd, uint64_t *size)
+{
+    char *buf = slapi_ch_malloc(STREAM_CHUNK_SIZE);
+    uint64_t expected = 0;
+    uint32_t len = 0;
+    int rc = 0;
+
+    *size = 0;
+    while (!(rc = dbmdb_stream_get32(fd, &len)) && len > 0) {
+        if (len > STREAM_CHUNK_SIZE) {
+            rc = EINVAL;
+            break;
+        }
+        rc = dbmdb_stream_get(fd, buf, len);
+        if (!rc && destfd >= 0) {
+            rc = dbmdb_write_full(destfd, buf, len);
+        }
+        if (rc) {
+            break;
+        }
+        *size += len;
+    }
+    if (!rc) {
+        rc = dbmdb_stream_get64(fd, &expected);
+    }
+    if (!rc && expected != *size) {
+        rc = EINVAL;
+    }
+    slapi_ch_free_string(&buf);
+    return rc;
+}
@@ -19,6 +19,10 @@
 #define PERF_LOCK()      pthread_mutex_lock(&g_ctx->perf_lock);
 #define PERF_UNLOCK()    pthread_mutex_unlock(&g_ctx->perf_lock);
 
+#define TXNFL_POOLED                            0x100  /* The read-only txn of the thread pool */
+#define TXNFL_GROUPED                           0x200  /* Made durable by the group commit */
+#define ROTXN_MAX_AGE                           60     /* Seconds during which a pooled txn handle is renewed */
+
 /* transaction context (on which dbi_txn_t is mapped) */
 typedef struct dbmdb_txn_t {
     long magic[2];
@@ -29,43 +33,239 @@ typedef struct dbmdb_txn_t {
     struct timespec hr_time_start;
 } dbmdb_txn_t;
 
+/*
+ * Read-only txn pool:
+ * Searches begin and end a read-only txn for almost every lookup, so each
+ * thread keeps its last top level read-only txn and renews it for the next
+ * one instead of allocating a new one. The cursors closed in that txn are
+ * kept too (one per dbi) and renewed in the next txns.
+ * Between two txns the handle is reset, so it does not pin any page. The
+ * handles are recycled after ROTXN_MAX_AGE seconds, and dropped before the
+ * env is closed (see dbmdb_txn_pool_flush).
+ */
+typedef struct dbmdb_rotxn_pool_t {
+    pthread_mutex_t lock;       /* Against dbmdb_txn_pool_flush (from other threads) */
+    MDB_env *env;
+    MDB_txn *txn;               /* Pooled txn (NULL if none) */
+    time_t birth;               /* Creation time of txn */
+    int active;                 /* txn is used by the thread (otherwise it is reset) */
+    MDB_cursor **cursors;       /* Cursors closed in txn, indexed by dbi */
+    int nbcursors;
+    struct dbmdb_rotxn_pool_t *prev;
+    struct dbmdb_rotxn_pool_t *next;
+} dbmdb_rotxn_pool_t;
+
+/* Thread private data */
+typedef struct {
+    dbmdb_txn_t *stack;         /* Txns of the thread (last one first) */
+    dbmdb_rotxn_pool_t pool;
+    uint64_t group_seq;         /* Group commit: committed txn to wait for (0 if none) */
+} dbmdb_txn_tls_t;
+
 
 static PRUintn thread_private_mdb_txn_stack;
 static dbmdb_ctx_t *g_ctx;  /* Global dbmdb context */
+static pthread_mutex_t pools_lock = PTHREAD_MUTEX_INITIALIZER;
+static dbmdb_rotxn_pool_t *pools;  /* Pools of all threads */
+
+/* Drop the pooled txn and cursors. Pool lock must be held */
+static void
+dbmdb_rotxn_pool_release(dbmdb_rotxn_pool_t *pool)
+{
+    for (int i = 0; i < pool->nbcursors; i++) {
+        if (pool->cursors[i]) {
+            MDB_CURSOR_CLOSE(pool->cursors[i]);
+        }
+    }
+    slapi_ch_free((void**)&pool->cursors);
+    pool->nbcursors = 0;
+    if (pool->txn) {
+        TXN_ABORT(pool->txn);
+        pool->txn = NULL;
+    }
+    pool->env = NULL;
+}
 
 static void
 cleanup_mdbtxn_stack(void *arg)
 {
-    dbmdb_txn_t **anchor = (dbmdb_txn_t**)arg;
-    dbmdb_txn_t *txn = *anchor;
+    dbmdb_txn_tls_t *tls = (dbmdb_txn_tls_t*)arg;
+    dbmdb_rotxn_pool_t *pool = &tls->pool;
+    dbmdb_txn_t *txn = tls->stack;
     dbmdb_txn_t *txn2;
 
-    *anchor = NULL;
-    slapi_ch_free((void**)&anchor);
+    tls->stack = NULL;
     PR_SetThreadPrivate(thread_private_mdb_txn_stack, NULL);
     while (txn) {
         txn2 = txn->parent;
-        TXN_ABORT(TXN(txn));
+        if (!(txn->flags & TXNFL_POOLED)) {
+            TXN_ABORT(TXN(txn));
+        }
         slapi_ch_free((void**)&txn);
         txn = txn2;
     }
+
+    pthread_mutex_lock(&pools_lock);
+    if (pool->prev) {
+        pool->prev->next = pool->next;
+    } else {
+        pools = pool->next;
+    }
+    if (pool->next) {
+        pool->next->prev = pool->prev;
+    }
+    pthread_mutex_unlock(&pools_lock);
+    pthread_mutex_lock(&pool->lock);
+    dbmdb_rotxn_pool_release(pool);
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_destroy(&pool->lock);
+    slapi_ch_free((void**)&tls);
 }
 
 void
 init_mdbtxn(dbmdb_ctx_t *ctx)
 {
+    static int initialized;
+
     g_ctx = ctx;
-    PR_NewThreadPrivateIndex(&thread_private_mdb_txn_stack, cleanup_mdbtxn_stack);
+    /* The thread private data (and its pool) survive a restart of the env */
+    if (!initialized) {
+        PR_NewThreadPrivateIndex(&thread_private_mdb_txn_stack, cleanup_mdbtxn_stack);
+        initialized = 1;
+    }
+}
+
+static dbmdb_txn_tls_t *get_mdbtxn_tls(void)
+{
+    dbmdb_txn_tls_t *tls = (dbmdb_txn_tls_t *) PR_GetThreadPrivate(thread_private_mdb_txn_stack);
+    if (!tls) {
+        tls = (dbmdb_txn_tls_t *)slapi_ch_calloc(1, sizeof *tls);
+        pthread_mutex_init(&tls->pool.lock, NULL);
+        pthread_mutex_lock(&pools_lock);
+        tls->pool.next = pools;
+        if (pools) {
+            pools->prev = &tls->pool;
+        }
+        pools = &tls->pool;
+        pthread_mutex_unlock(&pools_lock);
+        PR_SetThreadPrivate(thread_private_mdb_txn_stack, tls);
+    }
+    return tls;
 }
 
 static dbmdb_txn_t **get_mdbtxnanchor(void)
 {
-    dbmdb_txn_t **anchor = (dbmdb_txn_t **) PR_GetThreadPrivate(thread_private_mdb_txn_stack);
-    if (!anchor) {
-        anchor = (dbmdb_txn_t **)slapi_ch_calloc(1, sizeof anchor);
-        PR_SetThreadPrivate(thread_private_mdb_txn_stack, anchor);
+    return &get_mdbtxn_tls()->stack;
+}
+
+/* Renew the pooled txn of the thread. Returns NULL if there is none */
+static MDB_txn *
+dbmdb_rotxn_pool_get(dbmdb_rotxn_pool_t *pool)
+{
+    MDB_txn *txn = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->txn && (pool->env != g_ctx->env || slapi_current_rel_time_t() - pool->birth > ROTXN_MAX_AGE)) {
+        dbmdb_rotxn_pool_release(pool);
     }
-    return anchor;
+    if (pool->txn) {
+        if (TXN_RENEW(pool->txn) == 0) {
+            txn = pool->txn;
+            pool->active = 1;
+        } else {
+            dbmdb_rotxn_pool_release(pool);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return txn;
+}
+
+/* Keep a new read-only txn in the pool (if it is empty) */
+static int
+dbmdb_rotxn_pool_adopt(dbmdb_rotxn_pool_t *pool, MDB_txn *txn)
+{
+    int adopted = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    if (!pool->txn) {
+        pool->txn = txn;
+        pool->env = g_ctx->env;
+        pool->birth = slapi_current_rel_time_t();
+        pool->active = 1;
+        adopted = 1;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return adopted;
+}
+
+static void
+dbmdb_rotxn_pool_put(dbmdb_rotxn_pool_t *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    TXN_RESET(pool->txn);
+    pool->active = 0;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* Drop the pooled txns before closing env (they cannot be used once it is closed) */
+void
+dbmdb_txn_pool_flush(MDB_env *env)
+{
+    dbmdb_rotxn_pool_t *pool;
+
+    pthread_mutex_lock(&pools_lock);
+    for (pool = pools; pool; pool = pool->next) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->env == env && !pool->active) {
+            dbmdb_rotxn_pool_release(pool);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pools_lock);
+}
+
+/* Open a cursor, renewing the one that was kept for the dbi in a read-only txn */
+int
+dbmdb_txn_cursor_open(dbi_txn_t *txn, MDB_dbi dbi, MDB_cursor **cursor)
+{
+    dbmdb_txn_t *ltxn = (dbmdb_txn_t*)txn;
+    dbmdb_rotxn_pool_t *pool;
+
+    if (ltxn && (ltxn->flags & TXNFL_POOLED)) {
+        pool = &get_mdbtxn_tls()->pool;
+        if (dbi < pool->nbcursors && pool->cursors[dbi]) {
+            *cursor = pool->cursors[dbi];
+            pool->cursors[dbi] = NULL;
+            if (mdb_cursor_renew(ltxn->txn, *cursor) == 0) {
+                return 0;
+            }
+            MDB_CURSOR_CLOSE(*cursor);
+        }
+    }
+    return MDB_CURSOR_OPEN(TXN(txn), dbi, cursor);
+}
+
+/* Close a cursor, or keep it for the next read-only txns */
+void
+dbmdb_txn_cursor_close(dbi_txn_t *txn, MDB_cursor *cursor)
+{
+    dbmdb_txn_t *ltxn = (dbmdb_txn_t*)txn;
+    dbmdb_rotxn_pool_t *pool;
+    MDB_dbi dbi;
+
+    if (ltxn && (ltxn->flags & TXNFL_POOLED) && mdb_cursor_txn(cursor) == ltxn->txn) {
+        pool = &get_mdbtxn_tls()->pool;
+        dbi = mdb_cursor_dbi(cursor);
+        if (!pool->cursors) {
+            pool->nbcursors = g_ctx->startcfg.max_dbs;
+            pool->cursors = (MDB_cursor **)slapi_ch_calloc(pool->nbcursors, sizeof (MDB_cursor *));
+        }
+        if (dbi < pool->nbcursors && !pool->cursors[dbi]) {
+            pool->cursors[dbi] = cursor;
+            return;
+        }
+    }
+    MDB_CURSOR_CLOSE(cursor);
 }
 
 static void push_mdbtxn(dbmdb_txn_t *txn)
@@ -111,8 +311,10 @@ int dbmdb_start_txn(const char *funcname, dbi_txn_t *parent_txn, int flags, dbi_
     struct timespec hr_time_now;
     struct timespec hr_elapsed;
     dbmdb_perfctrs_txn_t *perf;
+    dbmdb_rotxn_pool_t *pool = NULL;
     dbmdb_txn_t *ltxn = NULL;
     MDB_txn *mtxn = NULL;
+    int renewed = 0;
     int rc = 0;
 
     /* If parent is explicitly provided, we need to generate a sub txn */
@@ -166,12 +368,27 @@ int dbmdb_start_txn(const char *funcname, dbi_txn_t *parent_txn, int flags, dbi_
     PERF_UNLOCK();
 
     GET_HRTIME(&hr_time_start);
-    rc = TXN_BEGIN(g_ctx->env, TXN(parent_txn), ((flags & TXNFL_RDONLY)? MDB_RDONLY: 0), &mtxn);
+    if ((flags & (TXNFL_RDONLY|TXNFL_DBI)) == TXNFL_RDONLY && !parent_txn) {
+        /* Top level read-only txn: use the pool of the thread */
+        pool = &get_mdbtxn_tls()->pool;
+        mtxn = dbmdb_rotxn_pool_get(pool);
+        if (mtxn) {
+            renewed = 1;
+        } else {
+            rc = TXN_BEGIN(g_ctx->env, NULL, MDB_RDONLY, &mtxn);
+        }
+        if (rc == 0 && (renewed || dbmdb_rotxn_pool_adopt(pool, mtxn))) {
+            flags |= TXNFL_POOLED;
+        }
+    } else {
+        rc = TXN_BEGIN(g_ctx->env, TXN(parent_txn), ((flags & TXNFL_RDONLY)? MDB_RDONLY: 0), &mtxn);
+    }
     GET_HRTIME(&hr_time_now);
     slapi_timespec_diff(&hr_time_now, &hr_time_start, &hr_elapsed);
     PERF_LOCK();
     perf->nbwaiting--;
     perf->nbactive++;
+    perf->nbrenew += renewed;
     cumul_time(&hr_elapsed, &perf->granttime);
     PERF_UNLOCK();
 
@@ -208,10 +425,17 @@ int dbmdb_end_txn(const char *funcname, int rc, dbi_txn_t **txn)
     perf = (ltxn->flags & TXNFL_RDONLY) ? &g_ctx->perf_rotxn : &g_ctx->perf_rwtxn;
     TXN_LOG("release txn 0X%lx\n", ltxn->txn);
     if (ltxn->refcnt == 0) {
-        if (rc || (ltxn->flags & (TXNFL_DBI|TXNFL_RDONLY)) == TXNFL_RDONLY) {
+        if (ltxn->flags & TXNFL_POOLED) {
+            /* Kept (reset) for the next read-only txn of the thread */
+            dbmdb_rotxn_pool_put(&get_mdbtxn_tls()->pool);
+        } else if (rc || (ltxn->flags & (TXNFL_DBI|TXNFL_RDONLY)) == TXNFL_RDONLY) {
             TXN_ABORT(ltxn->txn);
         } else {
             rc = TXN_COMMIT(ltxn->txn);
+            if (rc == 0 && !ltxn->parent && !(ltxn->flags & (TXNFL_RDONLY | TXNFL_GROUPED))) {
+                /* Not an operation txn: it is not synced by the group commit */
+                rc = dbmdb_txn_group_sync_env(g_ctx);
+            }
         }
         GET_HRTIME(&hr_time_now);
         slapi_timespec_diff(&hr_time_now, &ltxn->hr_time_start, &hr_elapsed);
@@ -245,3 +469,184 @@ MDB_txn *dbmdb_txn(dbi_txn_t *txn)
 }
 
 
+
+int dbmdb_is_toplevel_txn(dbi_txn_t *txn)
+{
+    dbmdb_txn_t *dbtxn = (dbmdb_txn_t*) txn;
+    return (dbtxn && !dbtxn->parent);
+}
+
+/*
+ * Group commit:
+ * When nsslapd-db-transaction-batch-val is set, the env is open with MDB_NOSYNC
+ * and the top level write txns of the operations wait, once committed, until
+ * the env is synced. The wait is done by dblayer_txn_commit once the backend
+ * serial lock is released, so that the next operations of the backend can
+ * join the batch. The first waiting txn leads the batch: it waits (up to
+ * max_wait ms) for the other running txns, then a single sync makes the whole
+ * batch durable.
+ * LMDB serializes the writers so a sync also covers all the txns committed
+ * before: an operation result is never returned before the changes of the
+ * previous operations (changelog, RUV, ...) are on the disk.
+ * The other write txns (dbi creation and state, index switch, ...) are
+ * synced by themselves when they are committed (see dbmdb_end_txn).
+ */
+void
+dbmdb_txn_group_init(dbmdb_ctx_t *ctx)
+{
+    dbmdb_group_commit_t *gc = &ctx->group_commit;
+    pthread_condattr_t condAttr;
+
+    pthread_mutex_init(&gc->lock, NULL);
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&gc->batch_cv, &condAttr);
+    pthread_cond_init(&gc->done_cv, NULL);
+    pthread_condattr_destroy(&condAttr);
+}
+
+/* Called once the env is open */
+void
+dbmdb_txn_group_start(dbmdb_ctx_t *ctx, int readonly)
+{
+    dbmdb_group_commit_t *gc = &ctx->group_commit;
+
+    pthread_mutex_lock(&gc->lock);
+    gc->active = (gc->batch_val > 0 && !readonly);
+    gc->inprogress = 0;
+    gc->committed = gc->synced = 0;
+    gc->failed_from = gc->failed_to = 0;
+    mdb_env_set_flags(ctx->env, MDB_NOSYNC, gc->active);
+    pthread_mutex_unlock(&gc->lock);
+    if (gc->active) {
+        slapi_log_err(SLAPI_LOG_INFO, "dbmdb_txn_group_start",
+                      "Group commit is enabled (up to %d txns per sync, %d ms max wait).\n",
+                      gc->batch_val, gc->max_wait);
+    }
+}
+
+/* A top level write txn of an operation begins */
+void
+dbmdb_txn_group_enter(dbmdb_ctx_t *ctx)
+{
+    dbmdb_group_commit_t *gc = &ctx->group_commit;
+
+    if (gc->active) {
+        pthread_mutex_lock(&gc->lock);
+        gc->inprogress++;
+        pthread_mutex_unlock(&gc->lock);
+    }
+}
+
+/* A top level write txn of an operation is aborted */
+void
+dbmdb_txn_group_leave(dbmdb_ctx_t *ctx)
+{
+    dbmdb_group_commit_t *gc = &ctx->group_commit;
+
+    if (gc->active) {
+        pthread_mutex_lock(&gc->lock);
+        gc->inprogress--;
+        /* The leader may be waiting for this txn */
+        pthread_cond_signal(&gc->batch_cv);
+        pthread_mutex_unlock(&gc->lock);
+    }
+}
+
+/* The txn is made durable by the group commit instead of being synced when committed */
+void
+dbmdb_txn_group_join(dbi_txn_t *txn)
+{
+    ((dbmdb_txn_t *)txn)->flags |= TXNFL_GROUPED;
+}
+
+/* Sync a write txn that is not part of a batch */
+int
+dbmdb_txn_group_sync_env(dbmdb_ctx_t *ctx)
+{
+    int rc = 0;
+
+    if (ctx->group_commit.active) {
+        rc = mdb_env_sync(ctx->env, 1);
+        if (rc) {
+            slapi_log_err(SLAPI_LOG_CRIT, "dbmdb_txn_group_sync_env",
+                          "Failed to sync the database. err=%d %s\n", rc, mdb_strerror(rc));
+        }
+    }
+    return rc;
+}
+
+/* A top level write txn of an operation is committed: dbmdb_txn_group_wait must be called */
+void
+dbmdb_txn_group_committed(dbmdb_ctx_t *ctx)
+{
+    dbmdb_group_commit_t *gc = &ctx->group_commit;
+    uint64_t seq = 0;
+
+    if (!gc->active) {
+        return;
+    }
+    pthread_mutex_lock(&gc->lock);
+    gc->inprogress--;
+    seq = ++gc->committed;
+    pthread_cond_signal(&gc->batch_cv);
+    pthread_mutex_unlock(&gc->lock);
+    get_mdbtxn_tls()->group_seq = seq;
+}
+
+/* Wait until the last txn committed by the thread is durable */
+int
+dbmdb_txn_group_wait(dbmdb_ctx_t *ctx)
+{
+    dbmdb_group_commit_t *gc = &ctx->group_commit;
+    dbmdb_txn_tls_t *tls = get_mdbtxn_tls();
+    struct timespec deadline = {0};
+    uint64_t target = 0;
+    uint64_t seq = tls->group_seq;
+    int rc = 0;
+
+    tls->group_seq = 0;
+    if (!gc->active || seq == 0) {
+        return 0;
+    }
+    pthread_mutex_lock(&gc->lock);
+    /* (the env may have been reopened since the commit: it was synced when closed) */
+    while (gc->synced < seq && seq <= gc->committed) {
+        if (gc->syncing) {
+            pthread_cond_wait(&gc->done_cv, &gc->lock);
+            continue;
+        }
+        /* Lead the batch: sync once the batch is full, once no other txn is
+         * running, or after max_wait ms
+         */
+        gc->syncing = 1;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += gc->max_wait * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        while (gc->committed - gc->synced < (uint64_t)gc->batch_val && gc->inprogress > 0) {
+            if (pthread_cond_timedwait(&gc->batch_cv, &gc->lock, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        target = gc->committed;
+        pthread_mutex_unlock(&gc->lock);
+        rc = mdb_env_sync(ctx->env, 1);
+        pthread_mutex_lock(&gc->lock);
+        if (rc) {
+            slapi_log_err(SLAPI_LOG_CRIT, "dbmdb_txn_group_wait",
+                          "Failed to sync the database for %lu txns. err=%d %s\n",
+                          target - gc->synced, rc, mdb_strerror(rc));
+            gc->failed_from = gc->synced + 1;
+            gc->failed_to = target;
+            gc->failed_rc = rc;
+        }
+        gc->synced = target;
+        gc->syncing = 0;
+        gc->nbsync++;
+        pthread_cond_broadcast(&gc->done_cv);
+    }
+    rc = (seq >= gc->failed_from && seq <= gc->failed_to) ? gc->failed_rc : 0;
+    pthread_mutex_unlock(&gc->lock);
+    return rc;
+}
@@ -17,5 +17,21 @@
 int
 dbmdb_verify(Slapi_PBlock *pb)
 {
-    return 0;  /* Fonction useless with lmdb - as we can verify the db when doing a backup */
+    char *dbdir = NULL;
+    char *pagemap = NULL;
+    int rc = 0;
+
+    /*
+     * The live db does not need verification with lmdb (it is checked when doing a backup)
+     * but the backups do: check the page map and the data of the backup chain.
+     */
+    slapi_pblock_get(pb, SLAPI_DBVERIFY_DBDIR, &dbdir);
+    if (dbdir && *dbdir) {
+        pagemap = slapi_ch_smprintf("%s/%s", dbdir, PAGEMAPFILE);
+        if (PR_Access(pagemap, PR_ACCESS_EXISTS) == PR_SUCCESS) {
+            rc = dbmdb_backup_verify(dbdir) ? 1 : 0;
+        }
+        slapi_ch_free_string(&pagemap);
+    }
+    return rc;
 }
@@ -231,6 +231,27 @@ int dblayer_value_protect_data(Slapi_Backend *be __attribute__((unused)), dbi_va
 }
 
 
+/*
+ * Let the next read operations return the value without copying it when the
+ * db supports it (i.e lmdb): the value then points in the db memory map, is
+ * only valid until the txn used for the operation ends, and must neither be
+ * modified nor freed. Operations without txn (and other dbs) still return
+ * a copy (see dblayer_value_is_borrowed).
+ */
+int dblayer_value_borrow(Slapi_Backend *be, dbi_val_t *data)
+{
+    dblayer_value_free(be, data);
+    dblayer_value_init(be, data);
+    data->flags = DBI_VF_BORROWED;
+    return DBI_RC_SUCCESS;
+}
+
+/* Tells whether the value returned by the last operation points in the db */
+int dblayer_value_is_borrowed(dbi_val_t *data)
+{
+    return (data->flags & (DBI_VF_BORROWED|DBI_VF_PROTECTED)) == (DBI_VF_BORROWED|DBI_VF_PROTECTED);
+}
+
 /* Set value memory as a fixed size buffer */
 int dblayer_value_set_buffer(Slapi_Backend *be, dbi_val_t *data, void *buff, size_t len)
 {
@@ -42,6 +42,7 @@ typedef enum {
     DBI_VF_READONLY    = 0x04,  /* data should not be modified */
     DBI_VF_BULK_DATA   = 0x08,  /* Bulk operation on data only */
     DBI_VF_BULK_RECORD = 0x10,  /* Bulk operation on key+data */
+    DBI_VF_BORROWED    = 0x20,  /* data may point in the db itself (see dblayer_value_borrow) */
 } dbi_valflags_t;               /* Should not be used in backend except within dbimpl.c */
 
 /* Warning! any change in dbi_op_t should also be reported in dblayer_op2str() */
@@ -136,6 +137,8 @@ int dblayer_new_cursor(Slapi_Backend *be, dbi_db_t *db,  dbi_txn_t *txn, dbi_cur
 int dblayer_value_free(Slapi_Backend *be, dbi_val_t *data);
 int dblayer_value_init(Slapi_Backend *be, dbi_val_t *data);
 int dblayer_value_protect_data(Slapi_Backend *be, dbi_val_t *data);
+int dblayer_value_borrow(Slapi_Backend *be, dbi_val_t *data);
+int dblayer_value_is_borrowed(dbi_val_t *data);
 int dblayer_value_set_buffer(Slapi_Backend *be, dbi_val_t *data, void *buff, size_t len);
 int dblayer_value_set(Slapi_Backend *be, dbi_val_t *data, void *ptr, size_t size);
 int dblayer_value_strdup(Slapi_Backend *be, dbi_val_t *data, char *str);
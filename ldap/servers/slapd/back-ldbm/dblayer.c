@@ -415,6 +415,8 @@ dblayer_instance_close(backend *be)
                       inst->inst_name);
         cache_clear(&inst->inst_dncache, CACHE_TYPE_DN);
     }
+    /* The database may be replaced (import, reindex...) */
+    search_cache_flush(inst);
 
     if (attrcrypt_cleanup_private(inst)) {
         slapi_log_err(SLAPI_LOG_ERR,
@@ -707,6 +709,10 @@ dblayer_txn_begin(backend *be, back_txnid parent_txn, back_txn *txn)
             dblayer_unlock_backend(be);
         }
     }
+    if (!rc) {
+        /* The searches must not cache what this transaction writes until it ends */
+        search_cache_write_begin();
+    }
     return rc;
 }
 
@@ -723,6 +729,22 @@ dblayer_txn_commit_ext(struct ldbminfo *li, back_txn *txn, PRBool use_lock)
     return priv->dblayer_txn_commit_fn(li, txn, use_lock);
 }
 
+/*
+ * Wait until the txn committed by the thread is durable. With a group commit,
+ * the commit returns once the txn is visible, and the thread waits here,
+ * without holding the backend lock, so that other txns join the batch.
+ */
+static int
+dblayer_txn_wait(struct ldbminfo *li)
+{
+    dblayer_private *priv = (dblayer_private *)li->li_dblayer_private;
+
+    if (NULL == priv->dblayer_txn_wait_fn) {
+        return 0;
+    }
+    return priv->dblayer_txn_wait_fn(li);
+}
+
 int
 dblayer_read_txn_commit(backend *be, back_txn *txn)
 {
@@ -746,6 +768,10 @@ dblayer_txn_commit(backend *be, back_txn *txn)
             dblayer_unlock_backend(be);
         }
     }
+    search_cache_write_end();
+    if (0 == rc) {
+        rc = dblayer_txn_wait(li);
+    }
     return rc;
 }
 
@@ -785,6 +811,7 @@ dblayer_txn_abort(backend *be, back_txn *txn)
             dblayer_unlock_backend(be);
         }
     }
+    search_cache_write_end();
     return rc;
 }
 
@@ -797,7 +824,11 @@ dblayer_txn_begin_all(struct ldbminfo *li, back_txnid parent_txn, back_txn *txn)
 int
 dblayer_txn_commit_all(struct ldbminfo *li, back_txn *txn)
 {
-    return (dblayer_txn_commit_ext(li, txn, PR_TRUE));
+    int rc = dblayer_txn_commit_ext(li, txn, PR_TRUE);
+    if (0 == rc) {
+        rc = dblayer_txn_wait(li);
+    }
+    return rc;
 }
 
 int
@@ -1164,6 +1195,57 @@ dblayer_backup(struct ldbminfo *li, char *dest_dir, Slapi_Task *task)
     return priv->dblayer_backup_fn(li, dest_dir, task);
 }
 
+/* Only backup what changed since the backup in base_dir */
+int
+dblayer_backup_incremental(struct ldbminfo *li, char *dest_dir, char *base_dir, Slapi_Task *task)
+{
+    dblayer_private *priv = (dblayer_private *)li->li_dblayer_private;
+
+    if (NULL == priv->dblayer_backup_incremental_fn) {
+        slapi_log_err(SLAPI_LOG_ERR, "dblayer_backup_incremental",
+                      "Incremental backups are not supported by this database implementation.\n");
+        if (task) {
+            slapi_task_log_notice(task, "Incremental backups are not supported by this database implementation.");
+        }
+        return LDAP_UNWILLING_TO_PERFORM;
+    }
+    return priv->dblayer_backup_incremental_fn(li, dest_dir, base_dir, task);
+}
+
+static int
+dblayer_stream_unsupported(const char *funcname, Slapi_Task *task)
+{
+    slapi_log_err(SLAPI_LOG_ERR, funcname,
+                  "Streamed backups are not supported by this database implementation.\n");
+    if (task) {
+        slapi_task_log_notice(task, "Streamed backups are not supported by this database implementation.");
+    }
+    return LDAP_UNWILLING_TO_PERFORM;
+}
+
+/* Write the backup in a pipe or a socket instead of a directory */
+int
+dblayer_backup_stream(struct ldbminfo *li, int fd, int flags, Slapi_Task *task)
+{
+    dblayer_private *priv = (dblayer_private *)li->li_dblayer_private;
+
+    if (NULL == priv->dblayer_backup_stream_fn) {
+        return dblayer_stream_unsupported("dblayer_backup_stream", task);
+    }
+    return priv->dblayer_backup_stream_fn(li, fd, flags, task);
+}
+
+int
+dblayer_restore_stream(struct ldbminfo *li, int fd, Slapi_Task *task)
+{
+    dblayer_private *priv = (dblayer_private *)li->li_dblayer_private;
+
+    if (NULL == priv->dblayer_restore_stream_fn) {
+        return dblayer_stream_unsupported("dblayer_restore_stream", task);
+    }
+    return priv->dblayer_restore_stream_fn(li, fd, task);
+}
+
 
 /*
  * Restore is pretty easy.
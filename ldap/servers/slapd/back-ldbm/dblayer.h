@@ -57,10 +57,14 @@
 #define DBLAYER_LIB_VERSION_PRE_24 1
 #define DBLAYER_LIB_VERSION_POST_24 2
 
+#define DBLAYER_BACKUP_COMPACT 0x1 /* streamed backup: compact the database */
+
 typedef int dblayer_start_fn_t(struct ldbminfo *li, int flags);
 typedef int dblayer_close_fn_t(struct ldbminfo *li, int flags);
 typedef int dblayer_instance_start_fn_t(backend *be, int flags);
 typedef int dblayer_backup_fn_t(struct ldbminfo *li, char *dest_dir, Slapi_Task *task);
+typedef int dblayer_backup_incremental_fn_t(struct ldbminfo *li, char *dest_dir, char *base_dir, Slapi_Task *task);
+typedef int dblayer_backup_stream_fn_t(struct ldbminfo *li, int fd, int flags, Slapi_Task *task);
 typedef int dblayer_verify_fn_t(Slapi_PBlock *pb);
 typedef int dblayer_db_size_fn_t(Slapi_PBlock *pb);
 typedef int dblayer_ldif2db_fn_t(Slapi_PBlock *pb);
@@ -70,8 +74,10 @@ typedef int dblayer_cleanup_fn_t(struct ldbminfo *li);
 typedef int dblayer_upgradedn_fn_t(Slapi_PBlock *pb);
 typedef int dblayer_upgradedb_fn_t(Slapi_PBlock *pb);
 typedef int dblayer_restore_fn_t(struct ldbminfo *li, char *src_dir, Slapi_Task *task);
+typedef int dblayer_restore_stream_fn_t(struct ldbminfo *li, int fd, Slapi_Task *task);
 typedef int dblayer_txn_begin_fn_t(struct ldbminfo *li, back_txnid parent_txn, back_txn *txn, PRBool use_lock);
 typedef int dblayer_txn_commit_fn_t(struct ldbminfo *li, back_txn *txn, PRBool use_lock);
+typedef int dblayer_txn_wait_fn_t(struct ldbminfo *li);
 typedef int dblayer_txn_abort_fn_t(struct ldbminfo *li, back_txn *txn, PRBool use_lock);
 typedef int dblayer_get_info_fn_t(Slapi_Backend *be, int cmd, void **info);
 typedef int dblayer_set_info_fn_t(Slapi_Backend *be, int cmd, void **info);
@@ -142,6 +148,8 @@ struct dblayer_private
     dblayer_close_fn_t *dblayer_close_fn;
     dblayer_instance_start_fn_t *dblayer_instance_start_fn;
     dblayer_backup_fn_t *dblayer_backup_fn;
+    dblayer_backup_incremental_fn_t *dblayer_backup_incremental_fn; /* NULL if not supported */
+    dblayer_backup_stream_fn_t *dblayer_backup_stream_fn;           /* NULL if not supported */
     dblayer_verify_fn_t *dblayer_verify_fn;
     dblayer_db_size_fn_t *dblayer_db_size_fn;
     dblayer_ldif2db_fn_t *dblayer_ldif2db_fn;
@@ -151,8 +159,10 @@ struct dblayer_private
     dblayer_upgradedn_fn_t *dblayer_upgradedn_fn;
     dblayer_upgradedb_fn_t *dblayer_upgradedb_fn;
     dblayer_restore_fn_t *dblayer_restore_fn;
+    dblayer_restore_stream_fn_t *dblayer_restore_stream_fn; /* NULL if not supported */
     dblayer_txn_begin_fn_t *dblayer_txn_begin_fn;
     dblayer_txn_commit_fn_t *dblayer_txn_commit_fn;
+    dblayer_txn_wait_fn_t *dblayer_txn_wait_fn; /* NULL if commits are durable when they return */
     dblayer_txn_abort_fn_t *dblayer_txn_abort_fn;
     dblayer_get_info_fn_t *dblayer_get_info_fn;
     dblayer_set_info_fn_t *dblayer_set_info_fn;
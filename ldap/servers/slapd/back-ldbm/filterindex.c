@@ -44,7 +44,10 @@ keys2idl(
     int *err,
     int *unindexed,
     back_txn *txn,
-    int allidslimit);
+    int allidslimit,
+    NIDS enough);
+static void substring_order_keys(Slapi_Value **ivals);
+static void substring_sort_keys_by_count(backend *be, char *type, Slapi_Value **ivals, back_txn *txn);
 
 IDList *
 filter_candidates_ext(
@@ -82,8 +85,28 @@ filter_candidates_ext(
         }
     }
 
+    ftype = slapi_filter_get_choice(f);
+    if (((ftype == LDAP_FILTER_EQUALITY) || (ftype == LDAP_FILTER_PRESENT)) &&
+        !(f->f_flags & SLAPI_FILTER_REALATTRS_ONLY)) {
+        Slapi_Filter *vf = NULL;
+
+        /* a virtual attribute can not be indexed, but its providers may
+         * know which stored attributes select the entries they serve.
+         * The providers namespace is the suffix of this backend. */
+        if (slapi_vattr_filter_candidates(pb, slapi_be_getsuffix(be, 0), f, &vf) == 0) {
+            slapi_log_err(SLAPI_LOG_FILTER, "filter_candidates_ext", "\tVIRTUAL\n");
+            result = filter_candidates_ext(pb, be, base, vf, NULL, range, err, allidslimit);
+            slapi_filter_free(vf, 1);
+            /* the candidates are a superset, the filter test must be done */
+            f->f_flags |= SLAPI_FILTER_VIRTUAL_CANDIDATES;
+            slapi_log_err(SLAPI_LOG_TRACE, "filter_candidates_ext", "<= %lu (virtual)\n",
+                          (u_long)IDL_NIDS(result));
+            return result;
+        }
+    }
+
     result = NULL;
-    switch ((ftype = slapi_filter_get_choice(f))) {
+    switch (ftype) {
     case LDAP_FILTER_EQUALITY:
         slapi_log_err(SLAPI_LOG_FILTER, "filter_candidates_ext", "\tEQUALITY\n");
         result = ava_candidates(pb, be, f, LDAP_FILTER_EQUALITY, nextf, range, err, allidslimit);
@@ -290,9 +313,11 @@ ava_candidates(
 
         tmp.bv = *bval;
         tmp.v_csnset = NULL;
+        tmp.v_norm = NULL;
         tmp.v_flags = 0;
         fake.bv.bv_val = buf;
         fake.bv.bv_len = sizeof(buf);
+        fake.v_norm = NULL;
         ptr[0] = &fake;
         ptr[1] = NULL;
         ivals = ptr;
@@ -309,7 +334,7 @@ ava_candidates(
             idl = idl_alloc(0);
         } else {
             slapi_attr_assertion2keys_ava_sv(&sattr, &tmp, (Slapi_Value ***)&ivals, LDAP_FILTER_EQUALITY_FAST);
-            idl = keys2idl(pb, be, type, indextype, ivals, err, &unindexed, &txn, allidslimit);
+            idl = keys2idl(pb, be, type, indextype, ivals, err, &unindexed, &txn, allidslimit, 0);
         }
 
         if (unindexed) {
@@ -353,7 +378,7 @@ ava_candidates(
                 idl = idl_allids(be);
                 goto done;
             }
-            idl = keys2idl(pb, be, type, indextype, ivals, err, &unindexed, &txn, allidslimit);
+            idl = keys2idl(pb, be, type, indextype, ivals, err, &unindexed, &txn, allidslimit, 0);
         }
 
         if (unindexed) {
@@ -1009,8 +1034,15 @@ substring_candidates(
     if (f->f_flags & SLAPI_FILTER_INVALID_ATTR_UNDEFINE) {
         idl = idl_alloc(0);
     } else {
+        /*
+         * The candidates of a substring filter are always filter tested,
+         * so there is no need to read all the keys once the list is small.
+         */
         slapi_pblock_get(pb, SLAPI_TXN, &txn.back_txn_txn);
-        idl = keys2idl(pb, be, type, indextype_SUB, ivals, err, &unindexed, &txn, allidslimit);
+        substring_order_keys(ivals);
+        substring_sort_keys_by_count(be, type, ivals, &txn);
+        idl = keys2idl(pb, be, type, indextype_SUB, ivals, err, &unindexed, &txn, allidslimit,
+                       FILTER_TEST_THRESHOLD);
     }
     if (unindexed) {
         Operation *pb_op;
@@ -1027,6 +1059,115 @@ substring_candidates(
     return (idl);
 }
 
+/*
+ * Remove the duplicate keys of a substring assertion, and order them by
+ * their likely selectivity (substring_sort_keys_by_count then only moves
+ * the keys holding fewer ids first):
+ *   - the begin (^ab) and end (yz$) keys, which are anchored to a position
+ *     of the value,
+ *   - then the middle keys that do not overlap each other ("smi" and "ths"
+ *     for *smithson*),
+ *   - then the remaining overlapping middle keys ("mit", "ith", ...).
+ */
+static void
+substring_order_keys(Slapi_Value **ivals)
+{
+    Slapi_Value **sorted = NULL;
+    size_t count = 0;
+    size_t n = 0;
+    size_t middle = 0;
+    size_t keylen = 0;
+    int pass;
+
+    for (size_t i = 0; ivals[i] != NULL; i++) {
+        const struct berval *bv = slapi_value_get_berval(ivals[i]);
+        size_t j;
+        for (j = 0; j < count; j++) {
+            const struct berval *bv2 = slapi_value_get_berval(ivals[j]);
+            if (bv->bv_len == bv2->bv_len && memcmp(bv->bv_val, bv2->bv_val, bv->bv_len) == 0) {
+                break;
+            }
+        }
+        if (j < count) {
+            slapi_value_free(&ivals[i]);
+        } else {
+            ivals[count++] = ivals[i];
+        }
+    }
+    ivals[count] = NULL;
+    if (count < 3) {
+        return;
+    }
+
+    sorted = (Slapi_Value **)slapi_ch_calloc(count, sizeof(Slapi_Value *));
+    for (pass = 0; pass < 3; pass++) {
+        middle = 0;
+        for (size_t i = 0; i < count; i++) {
+            const struct berval *bv = slapi_value_get_berval(ivals[i]);
+            int anchored = bv->bv_len > 0 && (bv->bv_val[0] == '^' || bv->bv_val[bv->bv_len - 1] == '$');
+            int selected;
+
+            if (anchored) {
+                selected = (pass == 0);
+            } else {
+                /* All the middle keys have the same length */
+                if (keylen == 0) {
+                    keylen = bv->bv_len;
+                }
+                selected = (pass == 1) ? (middle % keylen == 0) : (pass == 2 && middle % keylen != 0);
+                middle++;
+            }
+            if (selected) {
+                sorted[n++] = ivals[i];
+            }
+        }
+    }
+    memcpy(ivals, sorted, count * sizeof(Slapi_Value *));
+    slapi_ch_free((void **)&sorted);
+}
+
+/*
+ * Order the substring keys by the number of ids they hold, the rarest first,
+ * so that the intersection gets small after reading the fewest ids.
+ * Counting a key only positions a cursor on it. The keys holding the same
+ * number of ids keep the order of substring_order_keys.
+ */
+static void
+substring_sort_keys_by_count(backend *be, char *type, Slapi_Value **ivals, back_txn *txn)
+{
+    uint64_t *counts = NULL;
+    size_t count = 0;
+
+    while (ivals[count] != NULL) {
+        count++;
+    }
+    if (count < 2) {
+        return;
+    }
+    counts = (uint64_t *)slapi_ch_malloc(count * sizeof(uint64_t));
+    if (index_count_keys(be, type, indextype_SUB, ivals, txn, counts) == 0) {
+        /* insertion sort: there are only a few keys and it is stable */
+        for (size_t i = 1; i < count; i++) {
+            Slapi_Value *v = ivals[i];
+            uint64_t c = counts[i];
+            size_t j = i;
+
+            for (; j > 0 && counts[j - 1] > c; j--) {
+                ivals[j] = ivals[j - 1];
+                counts[j] = counts[j - 1];
+            }
+            ivals[j] = v;
+            counts[j] = c;
+        }
+    }
+    slapi_ch_free((void **)&counts);
+}
+
+/*
+ * Read the keys and intersect their id lists.
+ * If enough is not 0, stop reading the keys once the intersection holds
+ * no more than enough ids: the caller filter tests the candidates.
+ */
 static IDList *
 keys2idl(
     Slapi_PBlock *pb,
@@ -1037,7 +1178,8 @@ keys2idl(
     int *err,
     int *unindexed,
     back_txn *txn,
-    int allidslimit)
+    int allidslimit,
+    NIDS enough)
 {
     IDList *idl = NULL;
 
@@ -1078,6 +1220,11 @@ keys2idl(
             idl_free(&idl2);
             idl_free(&tmp);
         }
+        if (enough && !ALLIDS(idl) && IDL_NIDS(idl) <= enough) {
+            slapi_log_err(SLAPI_LOG_TRACE, "keys2idl", "<= %" PRIu32 " IDs, skipping the remaining keys\n",
+                          (uint32_t)IDL_NIDS(idl));
+            break;
+        }
     }
 
     return (idl);
@@ -0,0 +1,517 @@
+/** BEGIN COPYRIGHT BLOCK
+ * Copyright (C) 2026 Red Hat, Inc.
+ * All rights reserved.
+ *
+ * License: GPL (version 3 or any later version).
+ * See LICENSE for details.
+ * END COPYRIGHT BLOCK **/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/*
+ * filterplan.c - plans of the search filters, reused by the searches
+ * with filters of the same shape.
+ *
+ * The applications send the same few filters again and again with other
+ * assertion values. The shape of a filter is its structure and its
+ * attribute types, without the values: "(&(uid=*)(objectclass=person))"
+ * and "(&(uid=bjensen)(objectclass=person))" do not have the same shape,
+ * "(uid=bjensen)" and "(uid=scarter)" do. The plan of a shape holds, for
+ * each leaf of the filter (in the slapi_filter_apply() order):
+ *   - the normalized attribute type,
+ *   - an attribute initialized with its syntax and matching rules, to
+ *     normalize the assertion values and generate their keys,
+ * and whether the filter test can be bypassed for the shape. The searches
+ * take the plan of their filter instead of looking up the schema for each
+ * attribute type of the filter.
+ *
+ * The plans are dropped when the schema changes (attr_syntax_generation).
+ * When the cache is full, the least recently used plan makes room for the
+ * new one.
+ * The virtual attributes and the index configuration are still checked
+ * by each search.
+ */
+
+#include "back-ldbm.h"
+
+#define FILTER_PLAN_BUCKETS 256
+/* The longer shapes are not worth a plan */
+#define FILTER_PLAN_MAX_SHAPE 1024
+
+struct filter_plan_comp
+{
+    char *type;     /* normalized type of the leaf */
+    Slapi_Attr attr; /* initialized with the type */
+};
+
+struct filter_plan
+{
+    struct filter_plan *next; /* in the bucket */
+    char *shape;
+    uint64_t hash;
+    uint64_t generation; /* of the schema */
+    uint64_t used;  /* cache clock of the last use, for the eviction */
+    int32_t refcnt;
+    int32_t bypass; /* can_skip_filter_test() of the shape, -1 until known */
+    int ncomps;
+    struct filter_plan_comp comps[];
+};
+
+struct filter_plan_cache
+{
+    Slapi_RWLock *lock;
+    uint64_t generation; /* of the schema, for all the plans of the cache */
+    int nplans;
+    uint64_t clock; /* incremented at each use of a plan */
+    uint64_t hits;
+    uint64_t misses;
+    struct filter_plan *buckets[FILTER_PLAN_BUCKETS];
+};
+
+struct filter_plan_shape
+{
+    char buf[FILTER_PLAN_MAX_SHAPE];
+    size_t len;
+    int nleaves;
+};
+
+static int
+filter_plan_shape_add(struct filter_plan_shape *s, const char *str, size_t len)
+{
+    if (s->len + len >= sizeof(s->buf)) {
+        return -1;
+    }
+    memcpy(s->buf + s->len, str, len);
+    s->len += len;
+    s->buf[s->len] = '\0';
+    return 0;
+}
+
+static int
+filter_plan_shape_leaf(struct filter_plan_shape *s, const Slapi_Filter *f, const char *type)
+{
+    char choice[8];
+
+    if (type == NULL) {
+        return -1;
+    }
+    s->nleaves++;
+    PR_snprintf(choice, sizeof(choice), "(%lx", f->f_choice);
+    if (filter_plan_shape_add(s, choice, strlen(choice)) ||
+        filter_plan_shape_add(s, type, strlen(type))) {
+        return -1;
+    }
+    return filter_plan_shape_add(s, ")", 1);
+}
+
+/* Builds the shape of the filter, returns -1 if it has none */
+static int
+filter_plan_shape_build(struct filter_plan_shape *s, const Slapi_Filter *f)
+{
+    char choice[8];
+
+    switch (f->f_choice) {
+    case LDAP_FILTER_GE:
+    case LDAP_FILTER_LE:
+    case LDAP_FILTER_APPROX:
+    case LDAP_FILTER_EQUALITY:
+        return filter_plan_shape_leaf(s, f, f->f_avtype);
+    case LDAP_FILTER_SUBSTRINGS:
+        return filter_plan_shape_leaf(s, f, f->f_sub_type);
+    case LDAP_FILTER_PRESENT:
+        return filter_plan_shape_leaf(s, f, f->f_type);
+    case LDAP_FILTER_EXTENDED:
+        return filter_plan_shape_leaf(s, f, f->f_mr_type);
+    case LDAP_FILTER_AND:
+    case LDAP_FILTER_OR:
+    case LDAP_FILTER_NOT:
+        PR_snprintf(choice, sizeof(choice), "(%lx", f->f_choice);
+        if (filter_plan_shape_add(s, choice, strlen(choice))) {
+            return -1;
+        }
+        for (const Slapi_Filter *c = f->f_list; c != NULL; c = c->f_next) {
+            if (filter_plan_shape_build(s, c)) {
+                return -1;
+            }
+        }
+        return filter_plan_shape_add(s, ")", 1);
+    default:
+        return -1;
+    }
+}
+
+/* FNV-1a */
+static uint64_t
+filter_plan_hash(const char *shape)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (; *shape; shape++) {
+        hash ^= (unsigned char)*shape;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void
+filter_plan_free(struct filter_plan *plan)
+{
+    for (int i = 0; i < plan->ncomps; i++) {
+        slapi_ch_free_string(&plan->comps[i].type);
+        attr_done(&plan->comps[i].attr);
+    }
+    slapi_ch_free_string(&plan->shape);
+    slapi_ch_free((void **)&plan);
+}
+
+struct filter_plan_build
+{
+    struct filter_plan *plan;
+    int failed;
+};
+
+static int
+filter_plan_build_comp(Slapi_Filter *f, void *arg)
+{
+    struct filter_plan_build *b = (struct filter_plan_build *)arg;
+    struct filter_plan_comp *comp = &b->plan->comps[b->plan->ncomps];
+    char *type = NULL;
+
+    slapi_filter_get_attribute_type(f, &type);
+    comp->type = slapi_attr_syntax_normalize(type);
+    slapi_attr_init(&comp->attr, comp->type);
+    b->plan->ncomps++;
+    /* The attribute is shared by the searches, it must not be initialized lazily */
+    if (comp->attr.a_plugin == NULL) {
+        slapi_attr_init_syntax(&comp->attr);
+    }
+    if (comp->attr.a_plugin == NULL) {
+        b->failed = 1;
+        return SLAPI_FILTER_SCAN_STOP;
+    }
+    return SLAPI_FILTER_SCAN_CONTINUE;
+}
+
+static struct filter_plan *
+filter_plan_new(Slapi_Filter *f, const struct filter_plan_shape *s, uint64_t hash, uint64_t generation)
+{
+    struct filter_plan_build b = {0};
+    int filt_errs = 0;
+
+    b.plan = (struct filter_plan *)slapi_ch_calloc(1, sizeof(struct filter_plan) +
+                                                          s->nleaves * sizeof(struct filter_plan_comp));
+    b.plan->shape = slapi_ch_strdup(s->buf);
+    b.plan->hash = hash;
+    b.plan->generation = generation;
+    b.plan->refcnt = 1;
+    b.plan->bypass = -1;
+    if (slapi_filter_apply(f, filter_plan_build_comp, &b, &filt_errs) != SLAPI_FILTER_SCAN_NOMORE ||
+        b.failed || b.plan->ncomps != s->nleaves) {
+        filter_plan_free(b.plan);
+        return NULL;
+    }
+    return b.plan;
+}
+
+static void
+filter_plan_flush(struct filter_plan_cache *cache)
+{
+    for (size_t i = 0; i < FILTER_PLAN_BUCKETS; i++) {
+        while (cache->buckets[i]) {
+            struct filter_plan *plan = cache->buckets[i];
+            cache->buckets[i] = plan->next;
+            plan->next = NULL;
+            filter_plan_release(&plan);
+        }
+    }
+    cache->nplans = 0;
+}
+
+/* Drop the least recently used plan, the cache must be write locked */
+static void
+filter_plan_evict(struct filter_plan_cache *cache)
+{
+    struct filter_plan **victim = NULL;
+
+    for (size_t i = 0; i < FILTER_PLAN_BUCKETS; i++) {
+        for (struct filter_plan **p = &cache->buckets[i]; *p != NULL; p = &(*p)->next) {
+            if (victim == NULL || (*p)->used < (*victim)->used) {
+                victim = p;
+            }
+        }
+    }
+    if (victim) {
+        struct filter_plan *plan = *victim;
+        *victim = plan->next;
+        plan->next = NULL;
+        filter_plan_release(&plan);
+        cache->nplans--;
+    }
+}
+
+static struct filter_plan *
+filter_plan_find(struct filter_plan_cache *cache, const char *shape, uint64_t hash)
+{
+    struct filter_plan *plan = cache->buckets[hash % FILTER_PLAN_BUCKETS];
+
+    for (; plan != NULL; plan = plan->next) {
+        if (plan->hash == hash && strcmp(plan->shape, shape) == 0) {
+            return plan;
+        }
+    }
+    return NULL;
+}
+
+void
+filter_plan_init(ldbm_instance *inst)
+{
+    if (inst->inst_filter_plans == NULL) {
+        inst->inst_filter_plans = (struct filter_plan_cache *)slapi_ch_calloc(1, sizeof(struct filter_plan_cache));
+        inst->inst_filter_plans->lock = slapi_new_rwlock();
+    }
+}
+
+void
+filter_plan_close(ldbm_instance *inst)
+{
+    struct filter_plan_cache *cache = inst->inst_filter_plans;
+
+    if (cache == NULL) {
+        return;
+    }
+    filter_plan_flush(cache);
+    slapi_destroy_rwlock(cache->lock);
+    slapi_ch_free((void **)&inst->inst_filter_plans);
+}
+
+/*
+ * Returns the plan of the shape of the filter, NULL if the filter has
+ * no plan. The plan must be released with filter_plan_release().
+ */
+struct filter_plan *
+filter_plan_get(ldbm_instance *inst, Slapi_Filter *f)
+{
+    struct filter_plan_cache *cache = inst->inst_filter_plans;
+    int max = inst->inst_li->li_filter_plans;
+    struct filter_plan_shape s;
+    struct filter_plan *plan = NULL;
+    struct filter_plan *found = NULL;
+    uint64_t generation;
+    uint64_t hash;
+
+    if (cache == NULL || max <= 0 || f == NULL) {
+        return NULL;
+    }
+    s.len = 0;
+    s.nleaves = 0;
+    s.buf[0] = '\0';
+    if (filter_plan_shape_build(&s, f) || s.nleaves == 0) {
+        return NULL;
+    }
+    hash = filter_plan_hash(s.buf);
+    generation = attr_syntax_generation();
+
+    slapi_rwlock_rdlock(cache->lock);
+    if (cache->generation == generation && (plan = filter_plan_find(cache, s.buf, hash))) {
+        slapi_atomic_incr_32(&plan->refcnt, __ATOMIC_RELAXED);
+        slapi_atomic_store_64(&plan->used, slapi_atomic_incr_64(&cache->clock, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    }
+    slapi_rwlock_unlock(cache->lock);
+    if (plan) {
+        slapi_atomic_incr_64(&cache->hits, __ATOMIC_RELAXED);
+        return plan;
+    }
+
+    slapi_atomic_incr_64(&cache->misses, __ATOMIC_RELAXED);
+    /* Look up the schema out of the lock */
+    if ((plan = filter_plan_new(f, &s, hash, generation)) == NULL) {
+        return NULL;
+    }
+    slapi_rwlock_wrlock(cache->lock);
+    if (cache->generation < generation) {
+        filter_plan_flush(cache);
+        cache->generation = generation;
+    }
+    if (cache->generation == generation) {
+        if ((found = filter_plan_find(cache, s.buf, hash))) {
+            /* Another search added it meanwhile */
+            slapi_atomic_incr_32(&found->refcnt, __ATOMIC_RELAXED);
+        } else {
+            while (cache->nplans >= max) {
+                filter_plan_evict(cache);
+            }
+            slapi_atomic_incr_32(&plan->refcnt, __ATOMIC_RELAXED);
+            plan->used = slapi_atomic_incr_64(&cache->clock, __ATOMIC_RELAXED);
+            plan->next = cache->buckets[hash % FILTER_PLAN_BUCKETS];
+            cache->buckets[hash % FILTER_PLAN_BUCKETS] = plan;
+            cache->nplans++;
+        }
+    }
+    /* else the schema changed again, the plan is only used by this search */
+    slapi_rwlock_unlock(cache->lock);
+    if (found) {
+        filter_plan_free(plan);
+        plan = found;
+    }
+    return plan;
+}
+
+void
+filter_plan_release(struct filter_plan **plan)
+{
+    if (plan == NULL || *plan == NULL) {
+        return;
+    }
+    if (slapi_atomic_decr_32(&(*plan)->refcnt, __ATOMIC_ACQ_REL) == 0) {
+        filter_plan_free(*plan);
+    }
+    *plan = NULL;
+}
+
+/*
+ * Returns whether the filter test can be bypassed for the shape of the
+ * filter, grok() tells it the first time.
+ */
+int
+filter_plan_bypass(struct filter_plan *plan, Slapi_Filter *f, int (*grok)(Slapi_Filter *f))
+{
+    int32_t bypass;
+
+    if (plan == NULL) {
+        return grok(f);
+    }
+    bypass = slapi_atomic_load_32(&plan->bypass, __ATOMIC_RELAXED);
+    if (bypass < 0) {
+        bypass = grok(f) ? 1 : 0;
+        slapi_atomic_store_32(&plan->bypass, bypass, __ATOMIC_RELAXED);
+    }
+    return bypass;
+}
+
+/*
+ * Returns the attribute of the leaf number n of the filter, NULL if
+ * there is no plan.
+ */
+const Slapi_Attr *
+filter_plan_attr(const struct filter_plan *plan, int n)
+{
+    if (plan == NULL || n < 0 || n >= plan->ncomps) {
+        return NULL;
+    }
+    return &plan->comps[n].attr;
+}
+
+struct filter_plan_normalize
+{
+    const struct filter_plan *plan;
+    int n;
+};
+
+/* Replaces the type of a leaf with the normalized one */
+static void
+filter_plan_normalize_type(char **type, const struct filter_plan_comp *comp)
+{
+    if (strcmp(*type, comp->type) != 0) {
+        slapi_ch_free_string(type);
+        *type = slapi_ch_strdup(comp->type);
+    }
+}
+
+/* Same as filter_normalize_ext() but with the types and the attributes of the plan */
+static int
+filter_plan_normalize_comp(Slapi_Filter *f, void *arg)
+{
+    struct filter_plan_normalize *n = (struct filter_plan_normalize *)arg;
+    const struct filter_plan_comp *comp = NULL;
+    char *newval = NULL;
+
+    if (n->n >= n->plan->ncomps) {
+        /* not the shape of the plan */
+        return SLAPI_FILTER_SCAN_STOP;
+    }
+    comp = &n->plan->comps[n->n++];
+
+    switch (f->f_choice) {
+    case LDAP_FILTER_GE:
+    case LDAP_FILTER_LE:
+    case LDAP_FILTER_APPROX:
+    case LDAP_FILTER_EQUALITY:
+        filter_plan_normalize_type(&f->f_avtype, comp);
+        slapi_attr_value_normalize_ext(NULL, &comp->attr, NULL, f->f_avvalue.bv_val, 1, &newval, f->f_choice);
+        if (newval && (newval != f->f_avvalue.bv_val)) {
+            slapi_ch_free_string(&f->f_avvalue.bv_val);
+            f->f_avvalue.bv_val = newval;
+            f->f_avvalue.bv_len = strlen(newval);
+        }
+        f->f_flags |= SLAPI_FILTER_NORMALIZED_TYPE | SLAPI_FILTER_NORMALIZED_VALUE;
+        break;
+    case LDAP_FILTER_SUBSTRINGS:
+        filter_plan_normalize_type(&f->f_sub_type, comp);
+        slapi_attr_value_normalize_ext(NULL, &comp->attr, NULL, f->f_sub_initial, 1, &newval, f->f_choice);
+        if (newval && (newval != f->f_sub_initial)) {
+            slapi_ch_free_string(&f->f_sub_initial);
+            f->f_sub_initial = newval;
+        }
+        for (size_t i = 0; f->f_sub_any && f->f_sub_any[i]; i++) {
+            newval = NULL;
+            /* do not trim spaces of sf_any values - see string_filter_sub() */
+            slapi_attr_value_normalize_ext(NULL, &comp->attr, NULL, f->f_sub_any[i], 0, &newval, f->f_choice);
+            if (newval && (newval != f->f_sub_any[i])) {
+                slapi_ch_free_string(&f->f_sub_any[i]);
+                f->f_sub_any[i] = newval;
+            }
+        }
+        newval = NULL;
+        slapi_attr_value_normalize_ext(NULL, &comp->attr, NULL, f->f_sub_final, 0, &newval, f->f_choice);
+        if (newval && (newval != f->f_sub_final)) {
+            slapi_ch_free_string(&f->f_sub_final);
+            f->f_sub_final = newval;
+        }
+        f->f_flags |= SLAPI_FILTER_NORMALIZED_TYPE | SLAPI_FILTER_NORMALIZED_VALUE;
+        break;
+    case LDAP_FILTER_PRESENT:
+        filter_plan_normalize_type(&f->f_type, comp);
+        f->f_flags |= SLAPI_FILTER_NORMALIZED_TYPE;
+        break;
+    case LDAP_FILTER_EXTENDED:
+        filter_plan_normalize_type(&f->f_mr_type, comp);
+        f->f_flags |= SLAPI_FILTER_NORMALIZED_TYPE;
+        break;
+    default:
+        break;
+    }
+    return SLAPI_FILTER_SCAN_CONTINUE;
+}
+
+/*
+ * Normalizes the types and the values of a filter of the shape of the
+ * plan, as slapi_filter_normalize(f, PR_TRUE) does.
+ */
+void
+filter_plan_normalize(const struct filter_plan *plan, Slapi_Filter *f)
+{
+    struct filter_plan_normalize n = {plan, 0};
+    int filt_errs = 0;
+
+    slapi_filter_apply(f, filter_plan_normalize_comp, &n, &filt_errs);
+}
+
+/* Add the number of plans and their uses to the monitor entry of the instance */
+void
+filter_plan_monitor(ldbm_instance *inst, Slapi_Entry *e)
+{
+    struct filter_plan_cache *cache = inst->inst_filter_plans;
+    int nplans;
+
+    if (cache == NULL) {
+        return;
+    }
+    slapi_rwlock_rdlock(cache->lock);
+    nplans = cache->nplans;
+    slapi_rwlock_unlock(cache->lock);
+    slapi_entry_attr_set_int(e, "filterPlans", nplans);
+    slapi_entry_attr_set_ulong(e, "filterPlanHits", slapi_atomic_load_64(&cache->hits, __ATOMIC_RELAXED));
+    slapi_entry_attr_set_ulong(e, "filterPlanMisses", slapi_atomic_load_64(&cache->misses, __ATOMIC_RELAXED));
+}
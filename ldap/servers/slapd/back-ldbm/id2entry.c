@@ -258,13 +258,17 @@ struct backentry *
 id2entry(backend *be, ID id, back_txn *txn, int *err)
 {
     ldbm_instance *inst = (ldbm_instance *)be->be_instance_info;
+    struct ldbminfo *li = (struct ldbminfo *)be->be_database->plg_private;
     dbi_db_t *db = NULL;
     dbi_txn_t *db_txn = NULL;
+    dbi_txn_t *read_txn = NULL;
     dbi_val_t key = {0};
     dbi_val_t data = {0};
     struct backentry *e = NULL;
     Slapi_Entry *ee;
     char temp_id[sizeof(ID)];
+    char *estr = NULL;  /* The entry string that is decoded */
+    char *ebuf = NULL;  /* estr when it is allocated for this entry */
     uint32_t esize;
 
     slapi_log_err(SLAPI_LOG_TRACE, ID2ENTRY,
@@ -293,6 +297,15 @@ id2entry(backend *be, ID id, back_txn *txn, int *err)
     if (NULL != txn) {
         db_txn = txn->back_txn_txn;
     }
+    if (li->li_flags & LI_LMDB_IMPL) {
+        /* Read the record in place in the memory map (that needs a txn) */
+        if (!db_txn && dblayer_dbi_txn_begin(be, NULL, PR_TRUE, NULL, &read_txn) == 0) {
+            db_txn = read_txn;
+        }
+        if (db_txn) {
+            dblayer_value_borrow(be, &data);
+        }
+    }
     do {
         *err = dblayer_db_op(be, db, db_txn, DBI_OP_GET, &key, &data);
         if ((0 != *err) &&
@@ -315,6 +328,9 @@ id2entry(backend *be, ID id, back_txn *txn, int *err)
                           *err, slapd_system_strerror(*err));
             exit(1);
         }
+        if (read_txn) {
+            dblayer_dbi_txn_abort(be, read_txn);
+        }
         dblayer_release_id2entry(be, db);
         return (NULL);
     }
@@ -325,20 +341,43 @@ id2entry(backend *be, ID id, back_txn *txn, int *err)
         goto bail;
     }
 
-    /* call post-entry plugin */
+    /*
+     * A borrowed record is decoded in place: slapi_str2entry does not
+     * modify the string, and the read txn is only ended at the bail.
+     */
     esize = (uint32_t)data.dsize;
-    plugin_call_entryfetch_plugins((char **)&data.dptr, &esize);
-    data.dsize = esize;
+    estr = data.dptr;
+    if (plugin_has_entryfetch_plugins()) {
+        if (dblayer_value_is_borrowed(&data)) {
+            /* The plugins may replace the string: give them a heap copy
+             * rather than the record in the (read only) map.
+             */
+            estr = ebuf = slapi_ch_malloc(esize);
+            memcpy(estr, data.dptr, esize);
+        }
+        if (read_txn) {
+            dblayer_dbi_txn_abort(be, read_txn);
+            read_txn = NULL;
+        }
+        /* call post-entry plugin */
+        plugin_call_entryfetch_plugins(&estr, &esize);
+        /* and free the string it returns */
+        if (ebuf) {
+            ebuf = estr;
+        } else {
+            data.dptr = estr;
+        }
+    }
 
     if (entryrdn_get_switch()) {
         char *rdn = NULL;
         int rc = 0;
 
         /* rdn is allocated in get_value_from_string */
-        rc = get_value_from_string((const char *)data.dptr, "rdn", &rdn);
+        rc = get_value_from_string((const char *)estr, "rdn", &rdn);
         if (rc) {
-            /* data.dptr may not include rdn: ..., try "dn: ..." */
-            ee = slapi_str2entry(data.dptr, SLAPI_STR2ENTRY_NO_ENTRYDN);
+            /* estr may not include rdn: ..., try "dn: ..." */
+            ee = slapi_str2entry(estr, SLAPI_STR2ENTRY_NO_ENTRYDN);
         } else {
             char *normdn = NULL;
             Slapi_RDN *srdn = NULL;
@@ -379,14 +418,14 @@ id2entry(backend *be, ID id, back_txn *txn, int *err)
                                   normdn, id);
                 }
             }
-            ee = slapi_str2entry_ext((const char *)normdn, (const Slapi_RDN *)srdn, data.dptr,
+            ee = slapi_str2entry_ext((const char *)normdn, (const Slapi_RDN *)srdn, estr,
                                      SLAPI_STR2ENTRY_NO_ENTRYDN);
             slapi_ch_free_string(&rdn);
             slapi_ch_free_string(&normdn);
             slapi_rdn_free(&srdn);
         }
     } else {
-        ee = slapi_str2entry(data.dptr, 0);
+        ee = slapi_str2entry(estr, 0);
     }
 
     if (ee != NULL) {
@@ -434,6 +473,9 @@ id2entry(backend *be, ID id, back_txn *txn, int *err)
                 slapi_ch_free_string(&entrydn);
             }
         }
+        if (inst->inst_li->li_entry_summary) {
+            entry_summary_build(e->ep_entry);
+        }
         retval = CACHE_ADD(&inst->inst_cache, e, &imposter);
         if (1 == retval) {
             /* This means that someone else put the entry in the cache
@@ -455,11 +497,15 @@ id2entry(backend *be, ID id, back_txn *txn, int *err)
     } else {
         slapi_log_err(SLAPI_LOG_ERR, ID2ENTRY,
                       "str2entry returned NULL for id %lu, string=\"%s\"\n",
-                      (u_long)id, (char *)data.data);
+                      (u_long)id, estr);
         e = NULL;
     }
 
 bail:
+    if (read_txn) {
+        dblayer_dbi_txn_abort(be, read_txn);
+    }
+    slapi_ch_free_string(&ebuf);
     dblayer_value_free(be, &data);
     dblayer_release_id2entry(be, db);
 
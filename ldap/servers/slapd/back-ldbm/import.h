@@ -153,6 +153,7 @@ typedef struct _ImportJob
 #define FLAG_UPGRADEDNFORMAT 0x80     /* read from id2entry and do upgrade dn */
 #define FLAG_DRYRUN 0x100             /* dryrun for upgrade dn */
 #define FLAG_UPGRADEDNFORMAT_V1 0x200 /* taking care multiple spaces in dn */
+#define FLAG_SHADOW_INDEX 0x400       /* reindex in shadow dbis while the backend is updated */
 
 
 /* Structure holding stuff about a worker thread and what it's up to */
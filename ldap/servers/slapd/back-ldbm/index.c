@@ -364,6 +364,9 @@ index_addordel_entry(
                   (flags & BE_INDEX_ADD) ? "add" : "del",
                   backentry_get_ndn(e), (u_long)e->ep_id);
 
+    /* for the cached candidates of the filters with a NOT */
+    search_cache_touch_entries();
+
     /* if we are adding a tombstone entry (see ldbm_add.c) */
     if ((flags & BE_INDEX_TOMBSTONE) && (flags & BE_INDEX_ADD)) {
         const CSN *tombstone_csn = NULL;
@@ -531,6 +534,7 @@ index_add_mods(
                                                * should be deleted.
                                                */
 
+    search_cache_touch_mods(mods);
     for (i = 0; mods && mods[i] != NULL; i++) {
         /* Get base attribute type */
         basetype = buf;
@@ -1111,6 +1115,87 @@ index_read_ext_allids(
     return (idl);
 }
 
+/*
+ * Count the ids stored under each key of a type and index type, without
+ * reading them: one cursor positioning per key. A key holding ALLIDS, or
+ * too long to be stored as is, gets UINT64_MAX.
+ * Returns 0, or -1 if the keys can not be counted (not indexed, old idl
+ * format, db error).
+ */
+int
+index_count_keys(backend *be, char *type, const char *indextype, Slapi_Value **ivals, back_txn *txn, uint64_t *counts)
+{
+    struct ldbminfo *li = (struct ldbminfo *)be->be_database->plg_private;
+    char typebuf[SLAPD_TYPICAL_ATTRIBUTE_NAME_MAX_LENGTH];
+    char *basetmp, *basetype;
+    struct attrinfo *ai = NULL;
+    dbi_cursor_t cursor = {0};
+    dbi_db_t *db = NULL;
+    char *prefix = NULL;
+    int rc = 0;
+
+    if (!idl_get_idl_new() || (prefix = index_index2prefix(indextype)) == NULL) {
+        return -1;
+    }
+    basetype = typebuf;
+    if ((basetmp = slapi_attr_basetype(type, typebuf, sizeof(typebuf))) != NULL) {
+        basetype = basetmp;
+    }
+    ainfo_get(be, basetype, &ai);
+    if (ai == NULL || !is_indexed(indextype, ai->ai_indexmask, ai->ai_index_rules) ||
+        dblayer_get_index_file(be, ai, &db, DBOPEN_CREATE) != 0) {
+        index_free_prefix(prefix);
+        slapi_ch_free_string(&basetmp);
+        return -1;
+    }
+
+    if (dblayer_new_cursor(be, db, txn ? txn->back_txn_txn : NULL, &cursor) != 0) {
+        dblayer_release_index_file(be, ai, db);
+        index_free_prefix(prefix);
+        slapi_ch_free_string(&basetmp);
+        return -1;
+    }
+    for (size_t i = 0; rc == 0 && ivals[i] != NULL; i++) {
+        const struct berval *val = slapi_value_get_berval(ivals[i]);
+        struct berval *encrypted_val = NULL;
+        dbi_val_t key = {0};
+        dbi_val_t data = {0};
+        dbi_recno_t count = 0;
+        char buf[BUFSIZ];
+        ID id = NOID;
+
+        counts[i] = UINT64_MAX;
+        if (val->bv_len >= li->li_max_key_len) {
+            /* the key is hashed: let it be read */
+            continue;
+        }
+        attrcrypt_encrypt_index_key(be, ai, val, &encrypted_val);
+        if (encrypted_val) {
+            val = encrypted_val;
+        }
+        dblayer_value_concat(be, &key, buf, sizeof(buf),
+            prefix, strlen(prefix), val->bv_val, val->bv_len, "", 1);
+        dblayer_value_set_buffer(be, &data, &id, sizeof(id));
+        rc = dblayer_cursor_op(&cursor, DBI_OP_MOVE_TO_KEY, &key, &data);
+        if (rc == DBI_RC_NOTFOUND) {
+            counts[i] = 0;
+            rc = 0;
+        } else if (rc == 0 && id != ALLID) {
+            rc = dblayer_cursor_get_count(&cursor, &count);
+            counts[i] = count;
+        }
+        dblayer_value_free(be, &key);
+        if (encrypted_val) {
+            ber_bvfree(encrypted_val);
+        }
+    }
+    dblayer_cursor_op(&cursor, DBI_OP_CLOSE, NULL, NULL);
+    dblayer_release_index_file(be, ai, db);
+    index_free_prefix(prefix);
+    slapi_ch_free_string(&basetmp);
+    return rc ? -1 : 0;
+}
+
 IDList *
 index_read_ext(
     backend *be,
@@ -2036,6 +2121,11 @@ index_addordel_values_ext_sv(
     slapi_log_err(SLAPI_LOG_TRACE,
                   "index_addordel_values_ext_sv", "( \"%s\", %lu )\n", type, (u_long)id);
 
+    /* The imports (no transaction) flush the cached candidates when they close the instance */
+    if (txn != NULL && buffer_handle == NULL) {
+        search_cache_touch_values(type, vals);
+    }
+
     basetype = buf;
     if ((basetmp = slapi_attr_basetype(type, buf, sizeof(buf))) != NULL) {
         basetype = basetmp;
@@ -2433,6 +2523,7 @@ index_get_allids(int *allids, const char *indextype, struct attrinfo *ai, const
         sval.bv.bv_val = val->bv_val;
         sval.bv.bv_len = val->bv_len;
         sval.v_csnset = NULL;
+        sval.v_norm = NULL;
         sval.v_flags = SLAPI_ATTR_FLAG_NORMALIZED; /* the value must be a normalized key */
     }
 
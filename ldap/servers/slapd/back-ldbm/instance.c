@@ -99,6 +99,9 @@ ldbm_instance_create(backend *be, char *name)
     inst->inst_li = li;
     be->be_instance_info = inst;
 
+    filter_plan_init(inst);
+    search_cache_init(inst);
+
     /* Initialize the fields with some default values. */
     ldbm_instance_config_setup_default(inst);
 
@@ -395,6 +398,8 @@ ldbm_instance_destructor(void **arg)
     PR_DestroyLock(inst->inst_nextid_mutex);
     PR_DestroyCondVar(inst->inst_indexer_cv);
     attrinfo_deletetree(inst);
+    filter_plan_close(inst);
+    search_cache_close(inst);
     slapi_ch_free((void **)&inst->inst_dataversion);
     /* cache has already been destroyed */
 
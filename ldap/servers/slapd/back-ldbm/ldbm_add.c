@@ -1161,10 +1161,19 @@ ldbm_back_add(Slapi_PBlock *pb)
     slapi_pblock_set(pb, SLAPI_ENTRY_PRE_OP, NULL);
     slapi_pblock_set(pb, SLAPI_ENTRY_POST_OP, slapi_entry_dup(addingentry->ep_entry));
 
+    if (li->li_entry_summary && !is_resurect_operation) {
+        /* The entry is complete: summarize it before it can be found in the cache */
+        entry_summary_build(addingentry->ep_entry);
+        cache_adjust_size(&inst->inst_cache, addingentry, entry_summary_size(addingentry->ep_entry));
+    }
+
     if (is_resurect_operation) {
         /*
          * We can now switch the tombstone entry with the real entry.
          */
+        if (li->li_entry_summary) {
+            entry_summary_build(addingentry->ep_entry);
+        }
         retval = cache_replace(&inst->inst_cache, tombstoneentry, addingentry);
         if (retval) {
             /* This happens if the dn of addingentry already exists */
@@ -313,6 +313,7 @@ attr_index_parse_idlistsize_values(Slapi_Attr *attr, struct index_idlistsizeinfo
             sval.bv.bv_len = filt->f_avvalue.bv_len;
             sval.v_flags = 0;
             sval.v_csnset = NULL;
+            sval.v_norm = NULL;
             (void)slapi_attr_assertion2keys_ava_sv(attr, &sval, (Slapi_Value ***)&ivals, LDAP_FILTER_EQUALITY);
         }
         /* don't need filter any more */
@@ -771,6 +772,7 @@ attr_index_config(
      * nsSubStrBegin: 2
      * nsSubStrMiddle: 2
      * nsSubStrEnd: 2
+     * nsSubStrPrefix: 1
      */
     substrval = slapi_entry_attr_get_int(e, INDEX_ATTR_SUBSTRBEGIN);
     if (substrval) {
@@ -791,6 +793,13 @@ attr_index_config(
         }
         substrlens[INDEX_SUBSTREND] = substrval;
     }
+    substrval = slapi_entry_attr_get_int(e, INDEX_ATTR_SUBSTRPREFIX);
+    if (substrval > 0) {
+        if (!substrlens) {
+            substrlens = (int *)slapi_ch_calloc(1, sizeof(int) * INDEX_SUBSTRLEN);
+        }
+        substrlens[INDEX_SUBSTRPREFIX] = substrval;
+    }
     a->ai_substr_lens = substrlens;
 
     if (0 == slapi_entry_attr_find(e, "nsMatchingRule", &attr)) {
@@ -832,6 +841,12 @@ attr_index_config(
                 }
                 do_continue = 1; /* done with j - next j */
             }
+            if (PL_strcasestr(attrValue->bv_val, INDEX_ATTR_SUBSTRPREFIX)) {
+                if (!a->ai_substr_lens || !a->ai_substr_lens[INDEX_SUBSTRPREFIX]) {
+                    _set_attr_substrlen(INDEX_SUBSTRPREFIX, attrValue->bv_val, &substrlens);
+                }
+                do_continue = 1; /* done with j - next j */
+            }
             /* check if this is a simple ordering specification
                for an attribute that has no ordering matching rule */
             if (slapi_matchingrule_is_ordering(attrValue->bv_val, attrsyntax_oid) &&
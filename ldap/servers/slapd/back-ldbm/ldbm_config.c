@@ -901,6 +901,134 @@ ldbm_config_get_use_vlv_index(void *arg)
     return (void *)((uintptr_t)li->li_use_vlv);
 }
 
+static int
+ldbm_config_set_entry_summary(void *arg,
+                              void *value,
+                              char *errorbuf __attribute__((unused)),
+                              int phase __attribute__((unused)),
+                              int apply)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+    int val = (int)((uintptr_t)value);
+
+    if (apply) {
+        li->li_entry_summary = val ? 1 : 0;
+    }
+    return LDAP_SUCCESS;
+}
+
+static void *
+ldbm_config_get_entry_summary(void *arg)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+
+    return (void *)((uintptr_t)li->li_entry_summary);
+}
+
+static void *
+ldbm_config_filter_plans_get(void *arg)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+
+    return (void *)((uintptr_t)(li->li_filter_plans));
+}
+
+static int
+ldbm_config_filter_plans_set(void *arg, void *value, char *errorbuf, int phase __attribute__((unused)), int apply)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+    int val = (int)((uintptr_t)value);
+
+    if (val < 0) {
+        slapi_create_errormsg(errorbuf, SLAPI_DSE_RETURNTEXT_SIZE,
+                              "Invalid value for %s (%d). Must be 0 (disabled) or greater.",
+                              CONFIG_SEARCH_FILTER_PLANS, val);
+        return LDAP_UNWILLING_TO_PERFORM;
+    }
+    if (apply) {
+        li->li_filter_plans = val;
+    }
+    return LDAP_SUCCESS;
+}
+
+static void *
+ldbm_config_vlv_auto_threshold_get(void *arg)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+
+    return (void *)((uintptr_t)(li->li_vlv_auto_threshold));
+}
+
+static int
+ldbm_config_vlv_auto_threshold_set(void *arg, void *value, char *errorbuf, int phase __attribute__((unused)), int apply)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+    int val = (int)((uintptr_t)value);
+
+    if (val < 0) {
+        slapi_create_errormsg(errorbuf, SLAPI_DSE_RETURNTEXT_SIZE,
+                              "Invalid value for %s (%d). Must be 0 (disabled) or greater.",
+                              CONFIG_VLV_AUTO_THRESHOLD, val);
+        return LDAP_UNWILLING_TO_PERFORM;
+    }
+    if (apply) {
+        li->li_vlv_auto_threshold = val;
+    }
+    return LDAP_SUCCESS;
+}
+
+static void *
+ldbm_config_vlv_auto_min_candidates_get(void *arg)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+
+    return (void *)((uintptr_t)(li->li_vlv_auto_min_candidates));
+}
+
+static int
+ldbm_config_vlv_auto_min_candidates_set(void *arg, void *value, char *errorbuf, int phase __attribute__((unused)), int apply)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+    int val = (int)((uintptr_t)value);
+
+    if (val < 0) {
+        slapi_create_errormsg(errorbuf, SLAPI_DSE_RETURNTEXT_SIZE,
+                              "Invalid value for %s (%d). Must be 0 or greater.",
+                              CONFIG_VLV_AUTO_MIN_CANDIDATES, val);
+        return LDAP_UNWILLING_TO_PERFORM;
+    }
+    if (apply) {
+        li->li_vlv_auto_min_candidates = val;
+    }
+    return LDAP_SUCCESS;
+}
+
+static void *
+ldbm_config_vlv_auto_max_indexes_get(void *arg)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+
+    return (void *)((uintptr_t)(li->li_vlv_auto_max_indexes));
+}
+
+static int
+ldbm_config_vlv_auto_max_indexes_set(void *arg, void *value, char *errorbuf, int phase __attribute__((unused)), int apply)
+{
+    struct ldbminfo *li = (struct ldbminfo *)arg;
+    int val = (int)((uintptr_t)value);
+
+    if (val < 0) {
+        slapi_create_errormsg(errorbuf, SLAPI_DSE_RETURNTEXT_SIZE,
+                              "Invalid value for %s (%d). Must be 0 or greater.",
+                              CONFIG_VLV_AUTO_MAX_INDEXES, val);
+        return LDAP_UNWILLING_TO_PERFORM;
+    }
+    if (apply) {
+        li->li_vlv_auto_max_indexes = val;
+    }
+    return LDAP_SUCCESS;
+}
+
 static int
 ldbm_config_exclude_from_export_set(void *arg,
                                     void *value,
@@ -976,6 +1104,11 @@ static config_info ldbm_config[] = {
     {CONFIG_IDL_UPDATE, CONFIG_TYPE_ONOFF, "on", &ldbm_config_idl_get_update, &ldbm_config_idl_set_update, 0},
     {CONFIG_BYPASS_FILTER_TEST, CONFIG_TYPE_STRING, "on", &ldbm_config_get_bypass_filter_test, &ldbm_config_set_bypass_filter_test, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
     {CONFIG_USE_VLV_INDEX, CONFIG_TYPE_ONOFF, "on", &ldbm_config_get_use_vlv_index, &ldbm_config_set_use_vlv_index, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
+    {CONFIG_VLV_AUTO_THRESHOLD, CONFIG_TYPE_INT, "0", &ldbm_config_vlv_auto_threshold_get, &ldbm_config_vlv_auto_threshold_set, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
+    {CONFIG_VLV_AUTO_MIN_CANDIDATES, CONFIG_TYPE_INT, "1000", &ldbm_config_vlv_auto_min_candidates_get, &ldbm_config_vlv_auto_min_candidates_set, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
+    {CONFIG_VLV_AUTO_MAX_INDEXES, CONFIG_TYPE_INT, "10", &ldbm_config_vlv_auto_max_indexes_get, &ldbm_config_vlv_auto_max_indexes_set, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
+    {CONFIG_SEARCH_ENTRY_SUMMARY, CONFIG_TYPE_ONOFF, "off", &ldbm_config_get_entry_summary, &ldbm_config_set_entry_summary, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
+    {CONFIG_SEARCH_FILTER_PLANS, CONFIG_TYPE_INT, "1024", &ldbm_config_filter_plans_get, &ldbm_config_filter_plans_set, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
     {CONFIG_EXCLUDE_FROM_EXPORT, CONFIG_TYPE_STRING, CONFIG_EXCLUDE_FROM_EXPORT_DEFAULT_VALUE, &ldbm_config_exclude_from_export_get, &ldbm_config_exclude_from_export_set, CONFIG_FLAG_ALWAYS_SHOW},
     {CONFIG_SERIAL_LOCK, CONFIG_TYPE_ONOFF, "on", &ldbm_config_serial_lock_get, &ldbm_config_serial_lock_set, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
     {CONFIG_USE_LEGACY_ERRORCODE, CONFIG_TYPE_ONOFF, "off", &ldbm_config_legacy_errcode_get, &ldbm_config_legacy_errcode_set, 0},
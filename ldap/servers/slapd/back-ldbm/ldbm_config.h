@@ -123,6 +123,11 @@ struct config_info
 #define CONFIG_IDL_UPDATE "nsslapd-idl-update"
 #define CONFIG_BYPASS_FILTER_TEST "nsslapd-search-bypass-filter-test"
 #define CONFIG_USE_VLV_INDEX "nsslapd-search-use-vlv-index"
+#define CONFIG_VLV_AUTO_THRESHOLD "nsslapd-vlv-auto-threshold"
+#define CONFIG_VLV_AUTO_MIN_CANDIDATES "nsslapd-vlv-auto-min-candidates"
+#define CONFIG_VLV_AUTO_MAX_INDEXES "nsslapd-vlv-auto-max-indexes"
+#define CONFIG_SEARCH_ENTRY_SUMMARY "nsslapd-search-entry-summary"
+#define CONFIG_SEARCH_FILTER_PLANS "nsslapd-search-filter-plans"
 #define CONFIG_SERIAL_LOCK "nsslapd-serial-lock"
 #define CONFIG_BACKEND_OPT_LEVEL "nsslapd-backend-opt-level"
 
@@ -140,6 +145,8 @@ struct config_info
 
 #define CONFIG_INSTANCE_REQUIRE_INDEX "nsslapd-require-index"
 #define CONFIG_INSTANCE_REQUIRE_INTERNALOP_INDEX "nsslapd-require-internalop-index"
+#define CONFIG_INSTANCE_SEARCH_RESULT_CACHE_SIZE "nsslapd-search-result-cache-size"
+#define CONFIG_INSTANCE_SEARCH_RESULT_CACHE_TTL "nsslapd-search-result-cache-ttl"
 
 #define CONFIG_USE_LEGACY_ERRORCODE "nsslapd-do-not-use-vlv-error"
 
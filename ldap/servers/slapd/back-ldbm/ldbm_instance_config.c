@@ -325,6 +325,66 @@ ldbm_instance_config_require_internalop_index_set(void *arg,
     return LDAP_SUCCESS;
 }
 
+static void *
+ldbm_instance_config_search_result_cache_size_get(void *arg)
+{
+    ldbm_instance *inst = (ldbm_instance *)arg;
+
+    return (void *)((uintptr_t)search_cache_get_max_size(inst));
+}
+
+static int
+ldbm_instance_config_search_result_cache_size_set(void *arg,
+                                                  void *value,
+                                                  char *errorbuf __attribute__((unused)),
+                                                  int phase __attribute__((unused)),
+                                                  int apply)
+{
+    ldbm_instance *inst = (ldbm_instance *)arg;
+
+    if (!apply) {
+        return LDAP_SUCCESS;
+    }
+
+    /* 0 disables the cache and drops its results */
+    search_cache_set_max_size(inst, (uint64_t)((uintptr_t)value));
+
+    return LDAP_SUCCESS;
+}
+
+static void *
+ldbm_instance_config_search_result_cache_ttl_get(void *arg)
+{
+    ldbm_instance *inst = (ldbm_instance *)arg;
+
+    return (void *)((uintptr_t)search_cache_get_ttl(inst));
+}
+
+static int
+ldbm_instance_config_search_result_cache_ttl_set(void *arg,
+                                                 void *value,
+                                                 char *errorbuf,
+                                                 int phase __attribute__((unused)),
+                                                 int apply)
+{
+    ldbm_instance *inst = (ldbm_instance *)arg;
+    int val = (int)((uintptr_t)value);
+
+    if (val < 0) {
+        slapi_create_errormsg(errorbuf, SLAPI_DSE_RETURNTEXT_SIZE,
+                              "Error: %s must not be negative (0 to never expire the results)",
+                              CONFIG_INSTANCE_SEARCH_RESULT_CACHE_TTL);
+        return LDAP_UNWILLING_TO_PERFORM;
+    }
+    if (!apply) {
+        return LDAP_SUCCESS;
+    }
+
+    search_cache_set_ttl(inst, val);
+
+    return LDAP_SUCCESS;
+}
+
 /*------------------------------------------------------------------------
  * ldbm instance configuration array
  *----------------------------------------------------------------------*/
@@ -335,6 +395,8 @@ static config_info ldbm_instance_config[] = {
     {CONFIG_INSTANCE_REQUIRE_INDEX, CONFIG_TYPE_ONOFF, "off", &ldbm_instance_config_require_index_get, &ldbm_instance_config_require_index_set, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
     {CONFIG_INSTANCE_REQUIRE_INTERNALOP_INDEX, CONFIG_TYPE_ONOFF, "off", &ldbm_instance_config_require_internalop_index_get, &ldbm_instance_config_require_internalop_index_set, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
     {CONFIG_INSTANCE_DNCACHEMEMSIZE, CONFIG_TYPE_UINT64, DEFAULT_DNCACHE_SIZE_STR, &ldbm_instance_config_dncachememsize_get, &ldbm_instance_config_dncachememsize_set, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
+    {CONFIG_INSTANCE_SEARCH_RESULT_CACHE_SIZE, CONFIG_TYPE_UINT64, "0", &ldbm_instance_config_search_result_cache_size_get, &ldbm_instance_config_search_result_cache_size_set, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
+    {CONFIG_INSTANCE_SEARCH_RESULT_CACHE_TTL, CONFIG_TYPE_INT, "60", &ldbm_instance_config_search_result_cache_ttl_get, &ldbm_instance_config_search_result_cache_ttl_set, CONFIG_FLAG_ALWAYS_SHOW | CONFIG_FLAG_ALLOW_RUNNING_CHANGE},
     {NULL, 0, NULL, NULL, NULL, 0}};
 
 void
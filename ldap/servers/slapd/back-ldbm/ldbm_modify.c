@@ -91,6 +91,9 @@ modify_switch_entries(modify_context *mc, backend *be)
     ldbm_instance *inst = (ldbm_instance *)be->be_instance_info;
     int ret = 0;
     if (mc->old_entry && mc->new_entry) {
+        if (inst->inst_li->li_entry_summary) {
+            entry_summary_build(mc->new_entry->ep_entry);
+        }
         ret = cache_replace(&(inst->inst_cache), mc->old_entry, mc->new_entry);
         if (ret) {
             slapi_log_err(SLAPI_LOG_CACHE, "modify_switch_entries", "Replacing %s with %s failed (%d)\n",
@@ -970,6 +973,9 @@ ldbm_back_modify(Slapi_PBlock *pb)
         }
     }
 
+    if (li->li_entry_summary) {
+        entry_summary_build(ec->ep_entry);
+    }
     if (cache_replace(&inst->inst_cache, e, ec) != 0) {
         MOD_SET_ERROR(ldap_result_code, LDAP_OPERATIONS_ERROR, retry_count);
         goto error_return;
@@ -34,7 +34,7 @@ static IDList *base_candidates(Slapi_PBlock *pb, struct backentry *e);
 static IDList *onelevel_candidates(Slapi_PBlock *pb, backend *be, const char *base, struct backentry *e, Slapi_Filter *filter, int managedsait, int *lookup_returned_allidsp, int *err);
 static back_search_result_set *new_search_result_set(IDList *idl, int vlv, int lookthroughlimit);
 static void delete_search_result_set(Slapi_PBlock *pb, back_search_result_set **sr);
-static int can_skip_filter_test(Slapi_PBlock *pb, struct slapi_filter *f, int scope, IDList *idl);
+static int can_skip_filter_test(Slapi_PBlock *pb, struct slapi_filter *f, int scope, IDList *idl, struct filter_plan *plan);
 
 /* This is for performance testing, allows us to disable ACL checking altogether */
 #if defined(DISABLE_ACL_CHECK)
@@ -130,6 +130,33 @@ compute_allids_limit(Slapi_PBlock *pb, struct ldbminfo *li)
 }
 
 
+/*
+ * How many candidates the client reads first, when it is known: the size
+ * limit or the page size of a simple paged results search. Only these ones
+ * are sorted first, the other ones are sorted if the search reaches them.
+ * Returns 0 when the whole candidate list must be sorted.
+ */
+static NIDS
+sort_candidates_topk(Slapi_PBlock *pb, Slapi_Operation *op, int virtual_list_view)
+{
+    Slapi_Connection *conn = NULL;
+    int pr_idx = -1;
+    int limit = -1;
+
+    if (virtual_list_view || operation_is_flag_set(op, OP_FLAG_REVERSE_CANDIDATE_ORDER)) {
+        /* The VLV trims, and the reverse search reads, the whole sorted list */
+        return 0;
+    }
+    if (op_is_pagedresults(op)) {
+        slapi_pblock_get(pb, SLAPI_CONNECTION, &conn);
+        slapi_pblock_get(pb, SLAPI_PAGED_RESULTS_INDEX, &pr_idx);
+        limit = pagedresults_get_pagesize(conn, op, pr_idx);
+    } else {
+        slapi_pblock_get(pb, SLAPI_SEARCH_SIZELIMIT, &limit);
+    }
+    return (limit > 0) ? (NIDS)limit : 0;
+}
+
 /* don't free the berval, just clean it */
 static void
 berval_done(struct berval *val)
@@ -199,80 +226,37 @@ ldbm_back_search_cleanup(Slapi_PBlock *pb,
     return function_result;
 }
 
+struct ldbm_search_compile
+{
+    Slapi_Backend *be;
+    const struct filter_plan *plan; /* of the filter, or NULL */
+    int leaf;                       /* number of the current leaf of the filter */
+};
+
 static int
-ldbm_search_compile_filter(Slapi_Filter *f, void *arg __attribute__((unused)))
+ldbm_search_compile_filter(Slapi_Filter *f, void *arg)
 {
+    struct ldbm_search_compile *compile = (struct ldbm_search_compile *)arg;
+    Slapi_Backend *be = compile->be;
+    ldbm_instance *inst = (ldbm_instance *)be->be_instance_info;
     int rc = SLAPI_FILTER_SCAN_CONTINUE;
+    int leaf = compile->leaf++;
     if (f->f_choice == LDAP_FILTER_SUBSTRINGS) {
-        char pat[BUFSIZ];
-        char *p, *end, *bigpat = NULL;
-        size_t size = 0;
-        Slapi_Regex *re = NULL;
-        const char *re_result = NULL;
-        int i = 0;
-
         PR_ASSERT(NULL == f->f_un.f_un_sub.sf_private);
         /*
-         * construct a regular expression corresponding to the filter
+         * compile the substring assertion once for all the candidates,
+         * the filter values are already normalized
          */
-        pat[0] = '\0';
-        p = pat;
-        end = pat + sizeof(pat) - 2; /* leave room for null */
-
-        if (f->f_sub_initial != NULL) {
-            size = strlen(f->f_sub_initial) + 1; /* add 1 for "^" */
-        }
-
-        while (f->f_sub_any && f->f_sub_any[i]) {
-            size += strlen(f->f_sub_any[i++]) + 2; /* add 2 for ".*" */
-        }
-
-        if (f->f_sub_final != NULL) {
-            size += strlen(f->f_sub_final) + 3; /* add 3 for ".*" and "$" */
-        }
-
-        size *= 2; /* doubled in case all filter chars need escaping (regex special chars) */
-        size++;    /* add 1 for null */
-
-        if (p + size > end) {
-            bigpat = slapi_ch_malloc(size);
-            p = bigpat;
-        }
-        if (f->f_sub_initial != NULL) {
-            *p++ = '^';
-            p = filter_strcpy_special_ext(p, f->f_sub_initial, FILTER_STRCPY_ESCAPE_RECHARS);
-        }
-        for (i = 0; f->f_sub_any && f->f_sub_any[i]; i++) {
-            /* ".*" + value */
-            *p++ = '.';
-            *p++ = '*';
-            p = filter_strcpy_special_ext(p, f->f_sub_any[i], FILTER_STRCPY_ESCAPE_RECHARS);
-        }
-        if (f->f_sub_final != NULL) {
-            /* ".*" + value */
-            *p++ = '.';
-            *p++ = '*';
-            p = filter_strcpy_special_ext(p, f->f_sub_final, FILTER_STRCPY_ESCAPE_RECHARS);
-            strcat(p, "$");
-        }
-
-        /* compile the regex */
-        p = bigpat ? bigpat : pat;
-        re = slapi_re_comp(p, &re_result);
-        if (NULL == re) {
-            slapi_log_err(SLAPI_LOG_ERR, "ldbm_search_compile_filter", "re_comp (%s) failed (%s): %s\n",
-                          pat, p, re_result ? re_result : "unknown");
-            rc = SLAPI_FILTER_SCAN_ERROR;
-        } else {
-            char ebuf[BUFSIZ];
-            slapi_log_err(SLAPI_LOG_TRACE, "ldbm_search_compile_filter", "re_comp (%s)\n",
-                          escape_string(p, ebuf));
-            f->f_un.f_un_sub.sf_private = (void *)re;
-        }
+        f->f_un.f_un_sub.sf_private = (void *)slapi_substring_comp(f->f_sub_initial, f->f_sub_any, f->f_sub_final);
     } else if (f->f_choice == LDAP_FILTER_EQUALITY) {
         /* store the flags in the ava_private - should be ok - points
            to itself - no dangling references */
         f->f_un.f_un_ava.ava_private = &f->f_flags;
+        /* the summaries of the cached entries only hold their stored values */
+        if (inst->inst_li->li_entry_summary &&
+            !vattr_type_is_virtual(slapi_be_getsuffix(be, 0), f->f_avtype)) {
+            f->f_un.f_un_ava.ava_summary = entry_summary_ava_hash(&f->f_ava, filter_plan_attr(compile->plan, leaf));
+        }
     }
     return rc;
 }
@@ -283,11 +267,11 @@ ldbm_search_free_compiled_filter(Slapi_Filter *f, void *arg __attribute__((unuse
     int rc = SLAPI_FILTER_SCAN_CONTINUE;
     if ((f->f_choice == LDAP_FILTER_SUBSTRINGS) &&
         (f->f_un.f_un_sub.sf_private)) {
-        slapi_re_free((Slapi_Regex *)f->f_un.f_un_sub.sf_private);
-        f->f_un.f_un_sub.sf_private = NULL;
+        slapi_substring_free((Slapi_Substring **)&f->f_un.f_un_sub.sf_private);
     } else if (f->f_choice == LDAP_FILTER_EQUALITY) {
         /* clear the flags in the ava_private */
         f->f_un.f_un_ava.ava_private = NULL;
+        f->f_un.f_un_ava.ava_summary = 0;
     }
     return rc;
 }
@@ -342,6 +326,7 @@ ldbm_back_search(Slapi_PBlock *pb)
     int backend_count = 1;
     static int print_once = 1;
     back_txn txn = {NULL};
+    struct filter_plan *plan = NULL;
     int rc = 0;
 
     slapi_pblock_get(pb, SLAPI_BACKEND, &be);
@@ -626,10 +611,41 @@ ldbm_back_search(Slapi_PBlock *pb)
                                                     &vlv_request_control, e, candidates);
                 }
             }
+        } else if (sort && !vlv && li->li_use_vlv && li->li_vlv_auto_threshold > 0) {
+            int tlimit = 0;
+
+            slapi_pblock_get(pb, SLAPI_SEARCH_TIMELIMIT, &tlimit);
+            slapi_operation_time_expiry(operation, (time_t)tlimit, &expire_time);
+            lookthrough_limit = compute_lookthrough_limit(pb, li);
+            if (vlv_search_sorted_candidates(pb, basesdn, sort_control, lookthrough_limit,
+                                             &expire_time, &candidates) == LDAP_SUCCESS) {
+                /* An automatic vlv index matches this sorted search: the
+                 * candidates are already sorted, but the client expects a
+                 * Sort Response control */
+                if (!operation_is_flag_set(operation, OP_FLAG_INTERNAL)) {
+                    sort_log_access(pb, sort_control, NULL);
+                }
+                if (LDAP_SUCCESS != sort_make_sort_response_control(pb, 0, NULL)) {
+                    return ldbm_back_search_cleanup(pb, li, sort_control,
+                                                    LDAP_OPERATIONS_ERROR,
+                                                    "Sort Response Control",
+                                                    SLAPI_FAIL_GENERAL,
+                                                    &vlv_request_control, e, candidates);
+                }
+            }
         }
         if (candidates == NULL) {
-            int rc = build_candidate_list(pb, be, e, base, scope,
+            struct search_cache_key *cache_key = search_cache_key_new(pb, inst, basesdn, scope);
+            int rc = 0;
+
+            if (cache_key == NULL || !search_cache_get(inst, cache_key, &candidates)) {
+                rc = build_candidate_list(pb, be, e, base, scope,
                                           &lookup_returned_allids, &candidates);
+                if (rc == 0 && cache_key && !lookup_returned_allids) {
+                    search_cache_put(pb, inst, cache_key, candidates);
+                }
+            }
+            search_cache_key_free(&cache_key);
             if (rc) {
                 /* Error result sent by build_candidate_list */
                 return ldbm_back_search_cleanup(pb, li, sort_control,
@@ -721,9 +737,13 @@ ldbm_back_search(Slapi_PBlock *pb)
                      * input to ldapsearch> <#candidates> | <unsortable> */
                         sort_log_access(pb, sort_control, candidates);
                     }
+                    /* Count this search for the automatic vlv indexes */
+                    vlv_auto_record(pb, basesdn, sort_control, candidates);
                     sort_return_value = sort_candidates(be, lookthrough_limit,
                                                         &expire_time, pb, candidates,
                                                         sort_control,
+                                                        sort_candidates_topk(pb, operation, virtual_list_view),
+                                                        &sr->sr_sort_keys,
                                                         &sort_error_type);
                     /* Fix for bugid # 394184, SD, 20 Jul 00 */
                     /* replace the hard coded return value by the appropriate
@@ -922,7 +942,8 @@ ldbm_back_search(Slapi_PBlock *pb)
             tmp_desc = "Filter is not set";
             goto bail;
         }
-        if (can_skip_filter_test(pb, filter, scope, candidates)) {
+        plan = filter_plan_get(inst, filter);
+        if (can_skip_filter_test(pb, filter, scope, candidates, plan)) {
             sr->sr_flags |= SR_FLAG_CAN_SKIP_FILTER_TEST;
         }
     }
@@ -933,6 +954,7 @@ ldbm_back_search(Slapi_PBlock *pb)
         li->li_filter_bypass_check) {
         int rc = 0, filt_errs = 0;
         Slapi_Filter *filter = NULL;
+        struct ldbm_search_compile compile = {be, NULL, 0};
 
         slapi_pblock_get(pb, SLAPI_SEARCH_FILTER, &filter);
         if (NULL == filter) {
@@ -940,24 +962,33 @@ ldbm_back_search(Slapi_PBlock *pb)
             tmp_desc = "Filter is not set";
             goto bail;
         }
+        if (plan == NULL) {
+            plan = filter_plan_get(inst, filter);
+        }
         slapi_filter_free(sr->sr_norm_filter, 1);
         sr->sr_norm_filter = slapi_filter_dup(filter);
         /* step 1 - normalize all of the values used in the search filter */
-        slapi_filter_normalize(sr->sr_norm_filter, PR_TRUE /* normalize values too */);
-        /* step 2 - pre-compile the substr regex and the equality flags */
+        if (plan) {
+            filter_plan_normalize(plan, sr->sr_norm_filter);
+        } else {
+            slapi_filter_normalize(sr->sr_norm_filter, PR_TRUE /* normalize values too */);
+        }
+        /* step 2 - pre-compile the substring assertions and the equality flags */
+        compile.plan = plan;
         rc = slapi_filter_apply(sr->sr_norm_filter, ldbm_search_compile_filter,
-                                NULL, &filt_errs);
+                                &compile, &filt_errs);
         if (rc != SLAPI_FILTER_SCAN_NOMORE) {
             slapi_log_err(SLAPI_LOG_ERR,
                           "ldbm_back_search", "Could not pre-compile the search filter - error %d %d\n",
                           rc, filt_errs);
             if (rc == SLAPI_FILTER_SCAN_ERROR) {
                 tmp_err = LDAP_OPERATIONS_ERROR;
-                tmp_desc = "Could not compile regex for filter matching";
+                tmp_desc = "Could not compile the filter for matching";
             }
         }
     }
 bail:
+    filter_plan_release(&plan);
     /* Fix for bugid #394184, SD, 05 Jul 00 */
     /* tmp_err == LDBM_SRCH_DEFAULT_RESULT: no error */
     return ldbm_back_search_cleanup(pb, li, sort_control, tmp_err, tmp_desc,
@@ -1339,7 +1370,8 @@ can_skip_filter_test(
     Slapi_PBlock *pb __attribute__((unused)),
     struct slapi_filter *f,
     int scope,
-    IDList *idl)
+    IDList *idl,
+    struct filter_plan *plan)
 {
     int rc = 0;
 
@@ -1359,8 +1391,18 @@ can_skip_filter_test(
         return rc;
     }
 
-    /* Grok the filter and tell me if it has only equality components in it */
-    rc = grok_filter(f);
+    /* Grok the filter and tell me if it has only equality components in it,
+     * it only depends on the shape of the filter */
+    rc = filter_plan_bypass(plan, f, grok_filter);
+
+    /* The candidates of a virtual attribute come from the filter its
+     * providers gave, they are only a superset of the matching entries */
+    while (rc && f->f_choice == LDAP_FILTER_AND) {
+        f = f->f_and;
+    }
+    if (rc && (f->f_flags & SLAPI_FILTER_VIRTUAL_CANDIDATES)) {
+        rc = 0;
+    }
 
 
     return rc;
@@ -1583,6 +1625,11 @@ ldbm_back_next_search_entry(Slapi_PBlock *pb)
             }
         } else {
             /* Process the candidate list in the normal order. */
+            if (sr->sr_sort_keys &&
+                !sort_candidates_continue(sr->sr_sort_keys, sr->sr_candidates, sr->sr_current)) {
+                /* All the candidates are sorted now */
+                sort_keyset_free(&sr->sr_sort_keys);
+            }
             id = idl_iterator_dereference_increment(&(sr->sr_current), sr->sr_candidates);
         }
 
@@ -1712,6 +1759,10 @@ ldbm_back_next_search_entry(Slapi_PBlock *pb)
                     }
                 }
                 if (filter_test == 0) {
+                    size_t norm_size = 0;
+
+                    /* the normalized values kept by the filter test make the cached entry bigger */
+                    slapi_td_set_norm_size(&norm_size);
                     /* check if the entry matches the filter, and passes the ACL check */
                     filter_test = -1;
                     if (0 != (sr->sr_flags & SR_FLAG_CAN_SKIP_FILTER_TEST)) {
@@ -1740,6 +1791,10 @@ ldbm_back_next_search_entry(Slapi_PBlock *pb)
                         /* Old-style case---we need to do a filter test */
                         filter_test = slapi_vattr_filter_test(pb, e->ep_entry, filter, ACL_CHECK_FLAG);
                     }
+                    slapi_td_set_norm_size(NULL);
+                    if (norm_size) {
+                        cache_adjust_size(&inst->inst_cache, e, norm_size);
+                    }
                 }
             }
             if ((filter_test == 0) || (sr->sr_virtuallistview && (filter_test != -1)))
@@ -1893,6 +1948,7 @@ delete_search_result_set(Slapi_PBlock *pb, back_search_result_set **sr)
     if (NULL != (*sr)->sr_candidates) {
         idl_free(&((*sr)->sr_candidates));
     }
+    sort_keyset_free(&(*sr)->sr_sort_keys);
     rc = slapi_filter_apply((*sr)->sr_norm_filter, ldbm_search_free_compiled_filter,
                             NULL, &filt_errs);
     if (rc != SLAPI_FILTER_SCAN_NOMORE) {
@@ -58,6 +58,7 @@ int cache_add_tentative(struct cache *cache, struct backentry *e, struct backent
 int cache_lock_entry(struct cache *cache, struct backentry *e);
 void cache_unlock_entry(struct cache *cache, struct backentry *e);
 int cache_replace(struct cache *cache, void *oldptr, void *newptr);
+void cache_adjust_size(struct cache *cache, struct backentry *e, size_t delta);
 int cache_has_otherref(struct cache *cache, void *bep);
 int cache_is_in_cache(struct cache *cache, void *ptr);
 void revert_cache(ldbm_instance *inst, struct timespec *start_time);
@@ -106,7 +107,10 @@ int dblayer_plugin_begin(Slapi_PBlock *pb);
 int dblayer_plugin_commit(Slapi_PBlock *pb);
 int dblayer_plugin_abort(Slapi_PBlock *pb);
 int dblayer_backup(struct ldbminfo *li, char *destination_directory, Slapi_Task *task);
+int dblayer_backup_incremental(struct ldbminfo *li, char *destination_directory, char *base_directory, Slapi_Task *task);
 int dblayer_restore(struct ldbminfo *li, char *source_directory, Slapi_Task *task);
+int dblayer_backup_stream(struct ldbminfo *li, int fd, int flags, Slapi_Task *task);
+int dblayer_restore_stream(struct ldbminfo *li, int fd, Slapi_Task *task);
 int dblayer_delete_database(struct ldbminfo *li);
 int dblayer_close_indexes(backend *be);
 int dblayer_open_file(backend *be, char *indexname, int create, struct attrinfo *ai, dbi_db_t **ppDB);
@@ -259,6 +263,7 @@ int id_array_init(Id_Array *new_guy, int size);
 IDList *index_read(backend *be, const char *type, const char *indextype, const struct berval *val, back_txn *txn, int *err);
 IDList *index_read_ext(backend *be, char *type, const char *indextype, const struct berval *val, back_txn *txn, int *err, int *unindexed);
 IDList *index_read_ext_allids(Slapi_PBlock *pb, backend *be, char *type, const char *indextype, const struct berval *val, back_txn *txn, int *err, int *unindexed, int allidslimit);
+int index_count_keys(backend *be, char *type, const char *indextype, Slapi_Value **ivals, back_txn *txn, uint64_t *counts);
 IDList *index_range_read(Slapi_PBlock *pb, backend *be, char *type, const char *indextype, int ftype, struct berval *val, struct berval *nextval, int range, back_txn *txn, int *err);
 IDList *index_range_read_ext(Slapi_PBlock *pb, backend *be, char *type, const char *indextype, int ftype, struct berval *val, struct berval *nextval, int range, back_txn *txn, int *err, int allidslimit);
 const char *encode(const struct berval *data, char buf[BUFSIZ]);
@@ -407,9 +412,12 @@ struct sort_spec_thing
 };
 typedef struct sort_spec_thing sort_spec_thing;
 typedef struct sort_spec_thing sort_spec;
+typedef struct sort_keyset sort_keyset;
 
 void sort_spec_free(sort_spec *s);
-int sort_candidates(backend *be, int lookthrough_limit, struct timespec *expire_time, Slapi_PBlock *pb, IDList *candidates, sort_spec_thing *sort_spec, char **sort_error_type);
+int sort_candidates(backend *be, int lookthrough_limit, struct timespec *expire_time, Slapi_PBlock *pb, IDList *candidates, sort_spec_thing *sort_spec, NIDS topk, sort_keyset **remaining, char **sort_error_type);
+int sort_candidates_continue(sort_keyset *ks, IDList *candidates, NIDS position);
+void sort_keyset_free(sort_keyset **pks);
 int make_sort_response_control(Slapi_PBlock *pb, int code, char *error_type);
 int parse_sort_spec(struct berval *sort_spec_ber, sort_spec **ps);
 struct berval *attr_value_lowest(struct berval **values, value_compare_fn_type compare_fn);
@@ -499,6 +507,46 @@ int vlv_delete_search_entry(Slapi_PBlock *pb, Slapi_Entry *e, ldbm_instance *ins
 void vlv_acquire_lock(backend *be);
 void vlv_release_lock(backend *be);
 int vlv_isvlv(char *filename);
+void vlv_auto_record(Slapi_PBlock *pb, const Slapi_DN *base, const sort_spec *sort_control, const IDList *candidates);
+int vlv_search_sorted_candidates(Slapi_PBlock *pb, const Slapi_DN *base, const sort_spec *sort_control, int lookthrough_limit, struct timespec *expire_time, IDList **candidates);
+void vlv_auto_monitor(ldbm_instance *inst, Slapi_Entry *e);
+
+/*
+ * filterplan.c
+ */
+struct filter_plan;
+void filter_plan_init(ldbm_instance *inst);
+void filter_plan_close(ldbm_instance *inst);
+struct filter_plan *filter_plan_get(ldbm_instance *inst, Slapi_Filter *f);
+void filter_plan_release(struct filter_plan **plan);
+int filter_plan_bypass(struct filter_plan *plan, Slapi_Filter *f, int (*grok)(Slapi_Filter *f));
+const Slapi_Attr *filter_plan_attr(const struct filter_plan *plan, int n);
+void filter_plan_normalize(const struct filter_plan *plan, Slapi_Filter *f);
+void filter_plan_monitor(ldbm_instance *inst, Slapi_Entry *e);
+
+/*
+ * searchcache.c
+ */
+struct search_cache_key;
+void search_cache_init(ldbm_instance *inst);
+void search_cache_close(ldbm_instance *inst);
+void search_cache_clear(ldbm_instance *inst);
+void search_cache_flush(ldbm_instance *inst);
+uint64_t search_cache_get_max_size(ldbm_instance *inst);
+void search_cache_set_max_size(ldbm_instance *inst, uint64_t maxsize);
+int search_cache_get_ttl(ldbm_instance *inst);
+void search_cache_set_ttl(ldbm_instance *inst, int ttl);
+struct search_cache_key *search_cache_key_new(Slapi_PBlock *pb, ldbm_instance *inst, const Slapi_DN *base, int scope);
+void search_cache_key_free(struct search_cache_key **key);
+int search_cache_get(ldbm_instance *inst, const struct search_cache_key *key, IDList **candidates);
+void search_cache_put(Slapi_PBlock *pb, ldbm_instance *inst, const struct search_cache_key *key, IDList *candidates);
+void search_cache_touch_values(const char *type, Slapi_Value **vals);
+void search_cache_touch_mods(LDAPMod **mods);
+void search_cache_touch_entries(void);
+void search_cache_touch_all(void);
+void search_cache_write_begin(void);
+void search_cache_write_end(void);
+void search_cache_monitor(ldbm_instance *inst, Slapi_Entry *e);
 
 
 /*
@@ -0,0 +1,792 @@
+/** BEGIN COPYRIGHT BLOCK
+ * Copyright (C) 2026 Red Hat, Inc.
+ * All rights reserved.
+ *
+ * License: GPL (version 3 or any later version).
+ * See LICENSE for details.
+ * END COPYRIGHT BLOCK **/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/*
+ * searchcache.c - cache of the candidate lists of the searches
+ *
+ * The NSS/PAM clients send the same searches again and again. Each
+ * instance may keep the candidate list built by build_candidate_list()
+ * for a search, keyed by its base, scope, filter, bind DN and
+ * manageDSAit control, and give a copy of it to the next identical
+ * searches instead of reading the indexes again. The entries are still
+ * fetched, tested against the filter and checked by the access control.
+ *
+ * Invalidation: each attribute type hashes to a slot holding the last
+ * write sequence number of the types of the slot. The writes touch the
+ * slots of the types they modify or index (index_add_mods,
+ * index_addordel_values_ext_sv) and a result is valid while no slot of the types of its filter was
+ * touched after its candidates were read. A slot touched by a write
+ * transaction stays dirty until no write transaction is open (a
+ * transaction can be nested in the transaction of another backend) and
+ * is touched again then, once the new index keys are visible. The writer
+ * count is global, so the dirty slots are only cleared when no write is in
+ * progress at all: under a steady flow of overlapping writes, the results
+ * of the filters on the written types are not cached. Besides the types
+ * of the filters, the results depend on:
+ *   - SEARCH_CACHE_SLOT_ALL: touched by the renames (the scopes) and
+ *     the imports, restores...
+ *   - SEARCH_CACHE_SLOT_ENTRIES: touched by the added and deleted
+ *     entries, for the filters with a NOT that match them whatever their
+ *     types are.
+ *   - SEARCH_CACHE_SLOT_REFERRAL: touched by the referral entries, the
+ *     candidates include the referrals without the manageDSAit control.
+ * The sequence numbers are shared by the instances: a write may touch
+ * the slots of a type used by the results of another instance, they are
+ * rebuilt once.
+ *
+ * The results also expire after nsslapd-search-result-cache-ttl seconds
+ * and the least recently used ones are evicted when the cache holds more
+ * than nsslapd-search-result-cache-size bytes (0 disables the cache).
+ * The writes only touch the slots while the cache of an instance is
+ * enabled.
+ *
+ * The cached candidates are still tested against the filter, unless the
+ * search can skip the filter test (SR_FLAG_CAN_SKIP_FILTER_TEST): then a
+ * stale list could return an entry that no longer matches, hence the
+ * invalidation.
+ */
+
+#include "back-ldbm.h"
+
+#define SEARCH_CACHE_BUCKETS 1024
+#define SEARCH_CACHE_TYPE_SLOTS 512
+#define SEARCH_CACHE_SLOT_ALL SEARCH_CACHE_TYPE_SLOTS
+#define SEARCH_CACHE_SLOT_ENTRIES (SEARCH_CACHE_TYPE_SLOTS + 1)
+#define SEARCH_CACHE_SLOT_REFERRAL (SEARCH_CACHE_TYPE_SLOTS + 2)
+#define SEARCH_CACHE_SLOTS (SEARCH_CACHE_TYPE_SLOTS + 3)
+/* The larger filters are not worth a cached result */
+#define SEARCH_CACHE_MAX_LEAVES 32
+
+struct search_cache_result
+{
+    struct search_cache_result *next;     /* in the bucket */
+    struct search_cache_result *lru_prev; /* more recently used */
+    struct search_cache_result *lru_next; /* less recently used */
+    char *key;
+    size_t keylen;
+    uint64_t hash;
+    uint64_t seq;  /* write sequence number when the candidates were read */
+    time_t expire; /* 0 if it does not expire */
+    size_t size;
+    IDList *candidates; /* may be NULL */
+    int nslots;
+    uint16_t slots[];
+};
+
+struct search_cache
+{
+    PRLock *lock;
+    uint64_t maxsize;
+    int ttl;
+    uint64_t size;
+    uint64_t count;
+    uint64_t hits;
+    uint64_t tries;
+    uint64_t invalidations;
+    uint64_t evictions;
+    struct search_cache_result *lru_head;
+    struct search_cache_result *lru_tail;
+    struct search_cache_result *buckets[SEARCH_CACHE_BUCKETS];
+};
+
+struct search_cache_key
+{
+    char *key;
+    size_t keylen;
+    size_t keymax;
+    uint64_t hash;
+    uint64_t seq;
+    int nslots;
+    uint16_t slots[SEARCH_CACHE_MAX_LEAVES + 3];
+};
+
+/*
+ * The write sequence numbers, shared by the instances. The writers hold
+ * the lock, the searches only read them. The write transactions are
+ * counted without the lock.
+ */
+static pthread_mutex_t search_cache_seq_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t search_cache_seq = 0;
+static uint64_t search_cache_slot_seq[SEARCH_CACHE_SLOTS];
+static int32_t search_cache_slot_dirty[SEARCH_CACHE_SLOTS];
+static int32_t search_cache_ndirty = 0;
+static int32_t search_cache_writers = 0;
+/* Number of instances with an enabled cache */
+static int32_t search_cache_enabled = 0;
+
+static int
+search_cache_is_enabled(void)
+{
+    return slapi_atomic_load_32(&search_cache_enabled, __ATOMIC_ACQUIRE) > 0;
+}
+
+/* FNV-1a */
+static uint64_t
+search_cache_hash(const char *s, size_t len, int lower)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (lower && c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* The slot of the base type of an attribute type, aliases included */
+static uint16_t
+search_cache_type_slot(const char *type)
+{
+    char buf[SLAPD_TYPICAL_ATTRIBUTE_NAME_MAX_LENGTH];
+    char *basetype = NULL;
+    const char *name = NULL;
+    struct asyntaxinfo *asi = NULL;
+    uint16_t slot;
+
+    basetype = slapi_attr_basetype(type, buf, sizeof(buf));
+    name = basetype ? basetype : buf;
+    if ((asi = attr_syntax_get_by_name(name, 0)) != NULL) {
+        name = asi->asi_name;
+    }
+    slot = search_cache_hash(name, strlen(name), 1) % SEARCH_CACHE_TYPE_SLOTS;
+    attr_syntax_return(asi);
+    slapi_ch_free_string(&basetype);
+    return slot;
+}
+
+/* Caller holds search_cache_seq_lock */
+static void
+search_cache_touch_slot(uint16_t slot)
+{
+    slapi_atomic_store_64(&search_cache_slot_seq[slot], ++search_cache_seq, __ATOMIC_RELEASE);
+    if (slapi_atomic_load_32(&search_cache_writers, __ATOMIC_ACQUIRE) > 0 && !search_cache_slot_dirty[slot]) {
+        slapi_atomic_store_32(&search_cache_slot_dirty[slot], 1, __ATOMIC_RELEASE);
+        slapi_atomic_store_32(&search_cache_ndirty, search_cache_ndirty + 1, __ATOMIC_RELEASE);
+    }
+}
+
+static int
+search_cache_is_referral(const struct berval *bv)
+{
+    return bv->bv_len == sizeof("referral") - 1 && strncasecmp(bv->bv_val, "referral", bv->bv_len) == 0;
+}
+
+/*
+ * Called for the values added to or deleted from the indexes of a type,
+ * vals NULL if they are not known
+ */
+void
+search_cache_touch_values(const char *type, Slapi_Value **vals)
+{
+    uint16_t slot;
+    int referral = 0;
+
+    if (!search_cache_is_enabled()) {
+        return;
+    }
+    slot = search_cache_type_slot(type);
+    if (slapi_attr_type_cmp(type, SLAPI_ATTR_OBJECTCLASS, SLAPI_TYPE_CMP_BASE) == 0) {
+        referral = vals == NULL;
+        for (size_t i = 0; !referral && vals[i]; i++) {
+            referral = search_cache_is_referral(slapi_value_get_berval(vals[i]));
+        }
+    }
+    pthread_mutex_lock(&search_cache_seq_lock);
+    search_cache_touch_slot(slot);
+    if (referral) {
+        search_cache_touch_slot(SEARCH_CACHE_SLOT_REFERRAL);
+    }
+    pthread_mutex_unlock(&search_cache_seq_lock);
+}
+
+/*
+ * Called by index_add_mods() for the modified attributes, the attributes
+ * that are not indexed included: their index may have been removed. The
+ * values of objectclass, always indexed, are touched with the index.
+ */
+void
+search_cache_touch_mods(LDAPMod **mods)
+{
+    if (!search_cache_is_enabled()) {
+        return;
+    }
+    for (size_t i = 0; mods && mods[i]; i++) {
+        uint16_t slot = search_cache_type_slot(mods[i]->mod_type);
+
+        pthread_mutex_lock(&search_cache_seq_lock);
+        search_cache_touch_slot(slot);
+        pthread_mutex_unlock(&search_cache_seq_lock);
+    }
+}
+
+/*
+ * Called by index_addordel_entry() for the added and deleted entries,
+ * their values touch their types.
+ */
+void
+search_cache_touch_entries(void)
+{
+    if (!search_cache_is_enabled()) {
+        return;
+    }
+    pthread_mutex_lock(&search_cache_seq_lock);
+    search_cache_touch_slot(SEARCH_CACHE_SLOT_ENTRIES);
+    pthread_mutex_unlock(&search_cache_seq_lock);
+}
+
+/* Invalidates all the results, the renames move whole subtrees */
+void
+search_cache_touch_all(void)
+{
+    if (!search_cache_is_enabled()) {
+        return;
+    }
+    pthread_mutex_lock(&search_cache_seq_lock);
+    search_cache_touch_slot(SEARCH_CACHE_SLOT_ALL);
+    pthread_mutex_unlock(&search_cache_seq_lock);
+}
+
+/*
+ * Called when a write transaction of a backend begins. The transactions
+ * are counted even if no cache is enabled, a cache may be enabled while
+ * they are open.
+ */
+void
+search_cache_write_begin(void)
+{
+    slapi_atomic_incr_32(&search_cache_writers, __ATOMIC_ACQ_REL);
+}
+
+/* Called when a write transaction of a backend is committed or aborted */
+void
+search_cache_write_end(void)
+{
+    int32_t writers;
+
+    slapi_atomic_decr_32(&search_cache_writers, __ATOMIC_ACQ_REL);
+    /* Nothing to do without dirty slot: a slot touched meanwhile by a
+     * transaction still open is processed when that transaction ends */
+    if (slapi_atomic_load_32(&search_cache_ndirty, __ATOMIC_ACQUIRE) == 0) {
+        return;
+    }
+    pthread_mutex_lock(&search_cache_seq_lock);
+    if (search_cache_ndirty) {
+        writers = slapi_atomic_load_32(&search_cache_writers, __ATOMIC_ACQUIRE);
+        /* The index keys of the dirty slots may be visible now */
+        search_cache_seq++;
+        for (size_t i = 0; i < SEARCH_CACHE_SLOTS; i++) {
+            if (search_cache_slot_dirty[i]) {
+                slapi_atomic_store_64(&search_cache_slot_seq[i], search_cache_seq, __ATOMIC_RELEASE);
+                if (writers <= 0) {
+                    slapi_atomic_store_32(&search_cache_slot_dirty[i], 0, __ATOMIC_RELEASE);
+                }
+            }
+        }
+        if (writers <= 0) {
+            slapi_atomic_store_32(&search_cache_ndirty, 0, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&search_cache_seq_lock);
+}
+
+/* Returns 1 if no slot was touched since seq */
+static int
+search_cache_slots_valid(const uint16_t *slots, int nslots, uint64_t seq)
+{
+    for (int i = 0; i < nslots; i++) {
+        if (slapi_atomic_load_32(&search_cache_slot_dirty[slots[i]], __ATOMIC_ACQUIRE) ||
+            slapi_atomic_load_64(&search_cache_slot_seq[slots[i]], __ATOMIC_ACQUIRE) > seq) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void
+search_cache_key_add(struct search_cache_key *key, const void *data, size_t len)
+{
+    if (key->keylen + len > key->keymax) {
+        key->keymax = (key->keylen + len) * 2;
+        key->key = slapi_ch_realloc(key->key, key->keymax);
+    }
+    memcpy(key->key + key->keylen, data, len);
+    key->keylen += len;
+}
+
+/* Length prefixed, no value can be mistaken for a part of the filter */
+static void
+search_cache_key_add_value(struct search_cache_key *key, const char *val, size_t len)
+{
+    uint32_t len32 = (uint32_t)len;
+
+    search_cache_key_add(key, &len32, sizeof(len32));
+    search_cache_key_add(key, val, len);
+}
+
+static void
+search_cache_key_add_string(struct search_cache_key *key, const char *s)
+{
+    if (s == NULL) {
+        search_cache_key_add(key, "\xff\xff\xff\xff", 4);
+    } else {
+        search_cache_key_add_value(key, s, strlen(s));
+    }
+}
+
+static void
+search_cache_key_add_slot(struct search_cache_key *key, uint16_t slot)
+{
+    for (int i = 0; i < key->nslots; i++) {
+        if (key->slots[i] == slot) {
+            return;
+        }
+    }
+    key->slots[key->nslots++] = slot;
+}
+
+/* Adds the filter to the key, returns -1 if its result can not be cached */
+static int
+search_cache_key_add_filter(struct search_cache_key *key, const Slapi_DN *suffix, const Slapi_Filter *f)
+{
+    uint32_t choice = (uint32_t)f->f_choice;
+    const char *type = NULL;
+
+    search_cache_key_add(key, &choice, sizeof(choice));
+    switch (f->f_choice) {
+    case LDAP_FILTER_GE:
+    case LDAP_FILTER_LE:
+    case LDAP_FILTER_APPROX:
+    case LDAP_FILTER_EQUALITY:
+        type = f->f_avtype;
+        search_cache_key_add_string(key, type);
+        search_cache_key_add_value(key, f->f_avvalue.bv_val, f->f_avvalue.bv_len);
+        break;
+    case LDAP_FILTER_SUBSTRINGS:
+        type = f->f_sub_type;
+        search_cache_key_add_string(key, type);
+        search_cache_key_add_string(key, f->f_sub_initial);
+        for (size_t i = 0; f->f_sub_any && f->f_sub_any[i]; i++) {
+            search_cache_key_add_string(key, f->f_sub_any[i]);
+        }
+        search_cache_key_add(key, "", 1);
+        search_cache_key_add_string(key, f->f_sub_final);
+        break;
+    case LDAP_FILTER_PRESENT:
+        type = f->f_type;
+        search_cache_key_add_string(key, type);
+        break;
+    case LDAP_FILTER_EXTENDED:
+        type = f->f_mr_type;
+        search_cache_key_add_string(key, type);
+        search_cache_key_add_string(key, f->f_mr_oid);
+        search_cache_key_add_value(key, f->f_mr_value.bv_val, f->f_mr_value.bv_len);
+        search_cache_key_add(key, f->f_mr_dnAttrs ? "d" : "-", 1);
+        if (type == NULL) {
+            /* any attribute may match */
+            return -1;
+        }
+        break;
+    case LDAP_FILTER_NOT:
+        search_cache_key_add_slot(key, SEARCH_CACHE_SLOT_ENTRIES);
+        /* FALLTHRU */
+    case LDAP_FILTER_AND:
+    case LDAP_FILTER_OR:
+        for (const Slapi_Filter *c = f->f_list; c != NULL; c = c->f_next) {
+            if (search_cache_key_add_filter(key, suffix, c)) {
+                return -1;
+            }
+        }
+        search_cache_key_add(key, ")", 1);
+        return 0;
+    default:
+        return -1;
+    }
+
+    /* The candidates of the virtual attributes do not come from the indexes */
+    if (type == NULL || key->nslots >= SEARCH_CACHE_MAX_LEAVES || vattr_type_is_virtual(suffix, type)) {
+        return -1;
+    }
+    search_cache_key_add_slot(key, search_cache_type_slot(type));
+    return 0;
+}
+
+void
+search_cache_key_free(struct search_cache_key **key)
+{
+    if (key && *key) {
+        slapi_ch_free_string(&(*key)->key);
+        slapi_ch_free((void **)key);
+    }
+}
+
+/*
+ * Returns the key of the candidates of a search, NULL if they can not be
+ * cached.
+ */
+struct search_cache_key *
+search_cache_key_new(Slapi_PBlock *pb, ldbm_instance *inst, const Slapi_DN *base, int scope)
+{
+    struct search_cache *cache = inst->inst_search_cache;
+    struct search_cache_key *key = NULL;
+    Slapi_Filter *filter = NULL;
+    char *requestor = NULL;
+    void *txn = NULL;
+    int managedsait = 0;
+    uint32_t hdr[2];
+
+    /* The candidates of a base search are the base entry */
+    if (cache == NULL || slapi_atomic_load_64(&cache->maxsize, __ATOMIC_RELAXED) == 0 ||
+        scope == LDAP_SCOPE_BASE) {
+        return NULL;
+    }
+    /* A search inside a write transaction may read what it wrote */
+    slapi_pblock_get(pb, SLAPI_TXN, &txn);
+    slapi_pblock_get(pb, SLAPI_SEARCH_FILTER, &filter);
+    slapi_pblock_get(pb, SLAPI_MANAGEDSAIT, &managedsait);
+    /* The limits of the bind DN may turn the candidates into ALLIDS */
+    slapi_pblock_get(pb, SLAPI_REQUESTOR_NDN, &requestor);
+    if (txn != NULL || filter == NULL) {
+        return NULL;
+    }
+
+    key = (struct search_cache_key *)slapi_ch_calloc(1, sizeof(struct search_cache_key));
+    /* The sequence number before the indexes are read */
+    key->seq = slapi_atomic_load_64(&search_cache_seq, __ATOMIC_ACQUIRE);
+    hdr[0] = (uint32_t)scope;
+    hdr[1] = (uint32_t)managedsait;
+    search_cache_key_add(key, hdr, sizeof(hdr));
+    search_cache_key_add_string(key, slapi_sdn_get_ndn(base));
+    search_cache_key_add_string(key, requestor);
+    search_cache_key_add_slot(key, SEARCH_CACHE_SLOT_ALL);
+    if (!managedsait) {
+        search_cache_key_add_slot(key, SEARCH_CACHE_SLOT_REFERRAL);
+    }
+    if (search_cache_key_add_filter(key, slapi_be_getsuffix(inst->inst_be, 0), filter)) {
+        search_cache_key_free(&key);
+        return NULL;
+    }
+    key->hash = search_cache_hash(key->key, key->keylen, 0);
+    return key;
+}
+
+/* Caller holds the lock */
+static void
+search_cache_lru_remove(struct search_cache *cache, struct search_cache_result *r)
+{
+    if (r->lru_prev) {
+        r->lru_prev->lru_next = r->lru_next;
+    } else {
+        cache->lru_head = r->lru_next;
+    }
+    if (r->lru_next) {
+        r->lru_next->lru_prev = r->lru_prev;
+    } else {
+        cache->lru_tail = r->lru_prev;
+    }
+    r->lru_prev = r->lru_next = NULL;
+}
+
+/* Caller holds the lock */
+static void
+search_cache_lru_push(struct search_cache *cache, struct search_cache_result *r)
+{
+    r->lru_prev = NULL;
+    r->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = r;
+    } else {
+        cache->lru_tail = r;
+    }
+    cache->lru_head = r;
+}
+
+/* Caller holds the lock */
+static void
+search_cache_remove(struct search_cache *cache, struct search_cache_result *r)
+{
+    struct search_cache_result **prev = &cache->buckets[r->hash % SEARCH_CACHE_BUCKETS];
+
+    while (*prev != r) {
+        prev = &(*prev)->next;
+    }
+    *prev = r->next;
+    search_cache_lru_remove(cache, r);
+    cache->size -= r->size;
+    cache->count--;
+    idl_free(&r->candidates);
+    slapi_ch_free_string(&r->key);
+    slapi_ch_free((void **)&r);
+}
+
+/* Caller holds the lock */
+static struct search_cache_result *
+search_cache_find(struct search_cache *cache, const struct search_cache_key *key)
+{
+    struct search_cache_result *r = cache->buckets[key->hash % SEARCH_CACHE_BUCKETS];
+
+    for (; r != NULL; r = r->next) {
+        if (r->hash == key->hash && r->keylen == key->keylen &&
+            memcmp(r->key, key->key, key->keylen) == 0) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+static IDList *
+search_cache_idl_copy(const IDList *idl)
+{
+    IDList *copy = NULL;
+
+    if (idl) {
+        copy = idl_alloc(idl->b_nids);
+        copy->b_nids = idl->b_nids;
+        memcpy(copy->b_ids, idl->b_ids, idl->b_nids * sizeof(ID));
+    }
+    return copy;
+}
+
+/*
+ * Returns 1 and a copy of the cached candidates of the key, 0 if there
+ * is no valid cached result for the key.
+ */
+int
+search_cache_get(ldbm_instance *inst, const struct search_cache_key *key, IDList **candidates)
+{
+    struct search_cache *cache = inst->inst_search_cache;
+    struct search_cache_result *r = NULL;
+    int found = 0;
+
+    PR_Lock(cache->lock);
+    cache->tries++;
+    if ((r = search_cache_find(cache, key)) != NULL) {
+        if ((r->expire && r->expire <= slapi_current_rel_time_t()) ||
+            !search_cache_slots_valid(r->slots, r->nslots, r->seq)) {
+            cache->invalidations++;
+            search_cache_remove(cache, r);
+        } else {
+            cache->hits++;
+            search_cache_lru_remove(cache, r);
+            search_cache_lru_push(cache, r);
+            *candidates = search_cache_idl_copy(r->candidates);
+            found = 1;
+        }
+    }
+    PR_Unlock(cache->lock);
+    return found;
+}
+
+/* Returns 1 if a filter of the search got candidates from a virtual attribute */
+static int
+search_cache_filter_virtual(const Slapi_Filter *f)
+{
+    if (f->f_flags & SLAPI_FILTER_VIRTUAL_CANDIDATES) {
+        return 1;
+    }
+    switch (f->f_choice) {
+    case LDAP_FILTER_AND:
+    case LDAP_FILTER_OR:
+    case LDAP_FILTER_NOT:
+        for (const Slapi_Filter *c = f->f_list; c != NULL; c = c->f_next) {
+            if (search_cache_filter_virtual(c)) {
+                return 1;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+/* Keeps a copy of the candidates read for the key */
+void
+search_cache_put(Slapi_PBlock *pb, ldbm_instance *inst, const struct search_cache_key *key, IDList *candidates)
+{
+    struct search_cache *cache = inst->inst_search_cache;
+    struct search_cache_result *r = NULL;
+    Slapi_Filter *filter = NULL;
+    size_t size;
+
+    /* An ALLIDS list is not worth it, and the unindexed searches must still be noted */
+    if (ALLIDS(candidates) ||
+        (slapi_pblock_get_operation_notes(pb) & (SLAPI_OP_NOTE_UNINDEXED | SLAPI_OP_NOTE_FULL_UNINDEXED))) {
+        return;
+    }
+    slapi_pblock_get(pb, SLAPI_SEARCH_FILTER, &filter);
+    if (filter == NULL || search_cache_filter_virtual(filter) ||
+        !search_cache_slots_valid(key->slots, key->nslots, key->seq)) {
+        return;
+    }
+
+    size = sizeof(struct search_cache_result) + key->nslots * sizeof(uint16_t) + key->keylen +
+           (candidates ? sizeof(IDList) + candidates->b_nids * sizeof(ID) : 0);
+    r = (struct search_cache_result *)slapi_ch_calloc(1, sizeof(struct search_cache_result) +
+                                                             key->nslots * sizeof(uint16_t));
+    r->key = slapi_ch_malloc(key->keylen);
+    memcpy(r->key, key->key, key->keylen);
+    r->keylen = key->keylen;
+    r->hash = key->hash;
+    r->seq = key->seq;
+    r->size = size;
+    r->candidates = search_cache_idl_copy(candidates);
+    r->nslots = key->nslots;
+    memcpy(r->slots, key->slots, key->nslots * sizeof(uint16_t));
+
+    PR_Lock(cache->lock);
+    if (size > cache->maxsize) {
+        PR_Unlock(cache->lock);
+        idl_free(&r->candidates);
+        slapi_ch_free_string(&r->key);
+        slapi_ch_free((void **)&r);
+        return;
+    }
+    if (cache->ttl > 0) {
+        r->expire = slapi_current_rel_time_t() + cache->ttl;
+    }
+    {
+        struct search_cache_result *old = search_cache_find(cache, key);
+        if (old) {
+            search_cache_remove(cache, old);
+        }
+    }
+    while (cache->lru_tail && cache->size + size > cache->maxsize) {
+        cache->evictions++;
+        search_cache_remove(cache, cache->lru_tail);
+    }
+    r->next = cache->buckets[r->hash % SEARCH_CACHE_BUCKETS];
+    cache->buckets[r->hash % SEARCH_CACHE_BUCKETS] = r;
+    search_cache_lru_push(cache, r);
+    cache->size += size;
+    cache->count++;
+    PR_Unlock(cache->lock);
+}
+
+void
+search_cache_init(ldbm_instance *inst)
+{
+    if (inst->inst_search_cache == NULL) {
+        inst->inst_search_cache = (struct search_cache *)slapi_ch_calloc(1, sizeof(struct search_cache));
+        inst->inst_search_cache->lock = PR_NewLock();
+    }
+}
+
+/* Drops the results of the instance */
+void
+search_cache_clear(ldbm_instance *inst)
+{
+    struct search_cache *cache = inst->inst_search_cache;
+
+    if (cache == NULL) {
+        return;
+    }
+    PR_Lock(cache->lock);
+    while (cache->lru_head) {
+        search_cache_remove(cache, cache->lru_head);
+    }
+    PR_Unlock(cache->lock);
+}
+
+/*
+ * Drops the results of the instance when its database is replaced
+ * (import, restore...), and those being built.
+ */
+void
+search_cache_flush(ldbm_instance *inst)
+{
+    search_cache_touch_all();
+    search_cache_clear(inst);
+}
+
+void
+search_cache_close(ldbm_instance *inst)
+{
+    if (inst->inst_search_cache == NULL) {
+        return;
+    }
+    search_cache_set_max_size(inst, 0);
+    PR_DestroyLock(inst->inst_search_cache->lock);
+    slapi_ch_free((void **)&inst->inst_search_cache);
+}
+
+uint64_t
+search_cache_get_max_size(ldbm_instance *inst)
+{
+    return slapi_atomic_load_64(&inst->inst_search_cache->maxsize, __ATOMIC_RELAXED);
+}
+
+void
+search_cache_set_max_size(ldbm_instance *inst, uint64_t maxsize)
+{
+    struct search_cache *cache = inst->inst_search_cache;
+
+    PR_Lock(cache->lock);
+    if (cache->maxsize == 0 && maxsize > 0) {
+        /* The writes of the transactions already open were not noted:
+         * the results stay invalid until they end */
+        slapi_atomic_incr_32(&search_cache_enabled, __ATOMIC_ACQ_REL);
+        pthread_mutex_lock(&search_cache_seq_lock);
+        search_cache_touch_slot(SEARCH_CACHE_SLOT_ALL);
+        pthread_mutex_unlock(&search_cache_seq_lock);
+    } else if (cache->maxsize > 0 && maxsize == 0) {
+        slapi_atomic_decr_32(&search_cache_enabled, __ATOMIC_ACQ_REL);
+    }
+    slapi_atomic_store_64(&cache->maxsize, maxsize, __ATOMIC_RELAXED);
+    while (cache->lru_tail && cache->size > maxsize) {
+        cache->evictions++;
+        search_cache_remove(cache, cache->lru_tail);
+    }
+    PR_Unlock(cache->lock);
+}
+
+int
+search_cache_get_ttl(ldbm_instance *inst)
+{
+    return inst->inst_search_cache->ttl;
+}
+
+void
+search_cache_set_ttl(ldbm_instance *inst, int ttl)
+{
+    PR_Lock(inst->inst_search_cache->lock);
+    inst->inst_search_cache->ttl = ttl;
+    PR_Unlock(inst->inst_search_cache->lock);
+}
+
+/* Add the statistics of the cache to the monitor entry of the instance */
+void
+search_cache_monitor(ldbm_instance *inst, Slapi_Entry *e)
+{
+    struct search_cache *cache = inst->inst_search_cache;
+    uint64_t hits, tries;
+
+    if (cache == NULL) {
+        return;
+    }
+    PR_Lock(cache->lock);
+    hits = cache->hits;
+    tries = cache->tries;
+    slapi_entry_attr_set_ulong(e, "searchResultCacheHits", hits);
+    slapi_entry_attr_set_ulong(e, "searchResultCacheTries", tries);
+    slapi_entry_attr_set_ulong(e, "searchResultCacheHitRatio",
+                               (uint64_t)(100.0 * (double)hits / (double)(tries > 0 ? tries : 1)));
+    slapi_entry_attr_set_ulong(e, "searchResultCacheInvalidations", cache->invalidations);
+    slapi_entry_attr_set_ulong(e, "searchResultCacheEvictions", cache->evictions);
+    slapi_entry_attr_set_ulong(e, "currentSearchResultCacheSize", cache->size);
+    slapi_entry_attr_set_ulong(e, "maxSearchResultCacheSize", cache->maxsize);
+    slapi_entry_attr_set_ulong(e, "currentSearchResultCacheCount", cache->count);
+    PR_Unlock(cache->lock);
+}
@@ -28,7 +28,7 @@ struct baggage_carrier
 };
 typedef struct baggage_carrier baggage_carrier;
 
-static int slapd_qsort(baggage_carrier *bc, IDList *list, sort_spec *s);
+static int sort_keys_sort(baggage_carrier *bc, IDList *list, sort_spec *s, NIDS topk, sort_keyset **remaining);
 static int print_out_sort_spec(char *buffer, sort_spec *s, int *size);
 
 static void
@@ -134,6 +134,11 @@ sort_log_access(Slapi_PBlock *pb, sort_spec_thing *s, IDList *candidates)
  *            -5 -- admin limit exceeded       now is: LDAP_ADMINLIMIT_EXCEEDED
  *          -6 -- abandoned                  now is: LDAP_OTHER
  */
+/*
+ * When remaining is not NULL and only the first topk candidates are
+ * needed (size limit or page size), only them are sorted and *remaining
+ * is set to the keys of the candidates, for sort_candidates_continue.
+ */
 /*
  * So here's the plan:
  * Plan A:  We do a regular quicksort on the entries.
@@ -144,7 +149,7 @@ sort_log_access(Slapi_PBlock *pb, sort_spec_thing *s, IDList *candidates)
  *            far too hard for us to even try, so we refuse.
  */
 int
-sort_candidates(backend *be, int lookthrough_limit, struct timespec *expire_time, Slapi_PBlock *pb, IDList *candidates, sort_spec_thing *s, char **sort_error_type)
+sort_candidates(backend *be, int lookthrough_limit, struct timespec *expire_time, Slapi_PBlock *pb, IDList *candidates, sort_spec_thing *s, NIDS topk, sort_keyset **remaining, char **sort_error_type)
 {
     int return_value = LDAP_SUCCESS;
     baggage_carrier bc = {0};
@@ -194,7 +199,7 @@ sort_candidates(backend *be, int lookthrough_limit, struct timespec *expire_time
     bc.lookthrough_limit = lookthrough_limit;
     bc.check_counter = 1;
 
-    return_value = slapd_qsort(&bc, candidates, s);
+    return_value = sort_keys_sort(&bc, candidates, s, topk, remaining);
     slapi_log_err(SLAPI_LOG_TRACE, "Sorting done", "<=\n");
 
     return return_value;
@@ -439,6 +444,189 @@ sort_attr_compare(struct berval **value_a, struct berval **value_b, value_compar
     return compare_fn(compare_value_a, compare_value_b);
 }
 
+/*
+ * The sort keys of a candidate: the lowest value of each sort attribute
+ * (or its lowest ordering key on the matching rule path), extracted once
+ * so that the comparisons neither fetch the entries nor call the
+ * matching rule plugins.
+ */
+typedef struct sort_key
+{
+    ID id;
+    struct berval **values; /* One per sort spec, NULL when the attribute is missing */
+    uint64_t *prefixes;     /* First bytes of the values, for the memcmp ordered keys */
+} sort_key;
+
+/*
+ * The sort keys of a candidate list. It does not refer to the sort spec
+ * so that it can be kept in the search result set, when only the first
+ * candidates are sorted, and used to sort the next ones when the search
+ * reaches them.
+ */
+struct sort_keyset
+{
+    sort_key *keys;
+    NIDS nkeys;
+    NIDS nsorted; /* The keys [0, nsorted) are sorted and lower than the other ones */
+    NIDS chunk;   /* How many keys are sorted each time the search reaches nsorted */
+    int nspecs;
+    int *orders;
+    value_compare_fn_type *compare_fns;
+};
+
+/* The first 8 bytes of a value, big endian and zero padded, so that
+ * comparing two prefixes gives the same order as slapi_berval_cmp
+ * whenever they differ */
+static uint64_t
+sort_key_prefix(const struct berval *bv)
+{
+    uint64_t prefix = 0;
+    size_t i;
+
+    for (i = 0; i < sizeof(prefix); i++) {
+        prefix <<= 8;
+        if (i < bv->bv_len) {
+            prefix |= (unsigned char)bv->bv_val[i];
+        }
+    }
+    return prefix;
+}
+
+/* Get the key of one sort spec from an entry. Returns 0 or -1 if the
+ * matching rule plugin failed to generate the ordering keys */
+static int
+sort_key_value(Slapi_Entry *e, sort_spec_thing *this_one, struct berval **key)
+{
+    Slapi_Attr *attr = NULL;
+    struct berval **values = NULL;
+    struct berval **mr_keys = NULL;
+    int rc = 0;
+
+    *key = NULL;
+    slapi_entry_attr_find(e, this_one->type, &attr);
+    if (NULL == attr) {
+        return 0;
+    }
+    valuearray_get_bervalarray(valueset_get_valuearray(&attr->a_present_values), &values);
+    if (NULL == values) {
+        return 0;
+    }
+    if (NULL == this_one->matchrule) {
+        /* Per X.511, a multi-valued attribute is sorted on its lowest value */
+        *key = slapi_ch_bvdup(attr_value_lowest(values, this_one->compare_fn));
+    } else {
+        /* The keys belong to the indexer and are overwritten by its next call */
+        matchrule_values_to_keys(this_one->mr_pb, values, &mr_keys);
+        if (NULL == mr_keys) {
+            rc = -1;
+        } else if (mr_keys[0]) {
+            *key = slapi_ch_bvdup(attr_value_lowest(mr_keys, this_one->compare_fn));
+        }
+    }
+    ber_bvecfree(values);
+    return rc;
+}
+
+static sort_keyset *
+sort_keyset_new(sort_spec *s, NIDS num)
+{
+    sort_keyset *ks = (sort_keyset *)slapi_ch_calloc(1, sizeof(sort_keyset));
+    sort_spec_thing *this_one = NULL;
+    int j = 0;
+
+    for (this_one = (sort_spec_thing *)s; this_one; this_one = this_one->next) {
+        ks->nspecs++;
+    }
+    ks->orders = (int *)slapi_ch_calloc(ks->nspecs, sizeof(int));
+    ks->compare_fns = (value_compare_fn_type *)slapi_ch_calloc(ks->nspecs, sizeof(value_compare_fn_type));
+    for (this_one = (sort_spec_thing *)s; this_one; this_one = this_one->next, j++) {
+        ks->orders[j] = this_one->order;
+        ks->compare_fns[j] = this_one->compare_fn;
+    }
+    ks->keys = (sort_key *)slapi_ch_calloc(num, sizeof(sort_key));
+    return ks;
+}
+
+void
+sort_keyset_free(sort_keyset **pks)
+{
+    sort_keyset *ks = *pks;
+    NIDS i;
+    int j;
+
+    if (NULL == ks) {
+        return;
+    }
+    /* The keys that were not extracted have no values */
+    for (i = 0; i < ks->nkeys && ks->keys[i].values; i++) {
+        for (j = 0; j < ks->nspecs; j++) {
+            if (ks->keys[i].values[j]) {
+                ber_bvfree(ks->keys[i].values[j]);
+            }
+        }
+        slapi_ch_free((void **)&ks->keys[i].values);
+        slapi_ch_free((void **)&ks->keys[i].prefixes);
+    }
+    slapi_ch_free((void **)&ks->keys);
+    slapi_ch_free((void **)&ks->orders);
+    slapi_ch_free((void **)&ks->compare_fns);
+    slapi_ch_free((void **)pks);
+}
+
+static int sort_check(baggage_carrier *bc);
+
+/*
+ * Fetch each candidate entry once and extract its sort keys.
+ * Returns LDAP_SUCCESS or the error to send back to the client.
+ */
+static int
+sort_keys_extract(baggage_carrier *bc, IDList *list, sort_spec *s, sort_keyset *ks)
+{
+    ldbm_instance *inst = (ldbm_instance *)bc->be->be_instance_info;
+    back_txn txn = {NULL};
+    sort_spec_thing *this_one = NULL;
+    NIDS i;
+    int return_value = LDAP_SUCCESS;
+
+    slapi_pblock_get(bc->pb, SLAPI_TXN, &txn.back_txn_txn);
+    ks->nkeys = list->b_nids;
+    for (i = 0; i < ks->nkeys; i++) {
+        sort_key *key = &ks->keys[i];
+        struct backentry *e = NULL;
+        int err = 0;
+        int j = 0;
+
+        if (LDAP_SUCCESS != (return_value = sort_check(bc))) {
+            break;
+        }
+        key->id = list->b_ids[i];
+        key->values = (struct berval **)slapi_ch_calloc(ks->nspecs, sizeof(struct berval *));
+        key->prefixes = (uint64_t *)slapi_ch_calloc(ks->nspecs, sizeof(uint64_t));
+        e = id2entry(bc->be, list->b_ids[i], &txn, &err);
+        if (NULL == e) {
+            /* Deleted since the candidates were read: without values, it
+             * sorts last, and the search skips it */
+            slapi_log_err(SLAPI_LOG_TRACE, "sort_keys_extract", "Failed to get entry %u, db err %d\n",
+                          list->b_ids[i], err);
+            continue;
+        }
+        for (this_one = (sort_spec_thing *)s; this_one; this_one = this_one->next, j++) {
+            if (sort_key_value(e->ep_entry, this_one, &key->values[j])) {
+                return_value = LDAP_OPERATIONS_ERROR;
+                break;
+            }
+            if (key->values[j]) {
+                key->prefixes[j] = sort_key_prefix(key->values[j]);
+            }
+        }
+        CACHE_RETURN(&inst->inst_cache, &e);
+        if (LDAP_SUCCESS != return_value) {
+            break;
+        }
+    }
+    return return_value;
+}
+
 /* Comparison routine, called by qsort.
  * The job here is to return the correct value
  * for the operation a < b
@@ -448,135 +636,51 @@ sort_attr_compare(struct berval **value_a, struct berval **value_b, value_compar
  * >0 when a > b
  */
 static int
-compare_entries_sv(ID *id_a, ID *id_b, sort_spec *s, baggage_carrier *bc, int *error)
+compare_sort_keys(sort_key *a, sort_key *b, sort_keyset *ks)
 {
-    /* We get passed the IDs, but need to fetch the entries in order to
-     * perform the comparison .
-     */
-    struct backentry *a = NULL;
-    struct backentry *b = NULL;
     int result = 0;
-    sort_spec_thing *this_one = NULL;
-    backend *be = bc->be;
-    ldbm_instance *inst = (ldbm_instance *)be->be_instance_info;
-    int err;
-    back_txn txn = {NULL};
+    int j;
 
-    slapi_pblock_get(bc->pb, SLAPI_TXN, &txn.back_txn_txn);
-    *error = 1;
-    a = id2entry(be, *id_a, &txn, &err);
-    if (NULL == a) {
-        if (0 != err) {
-            slapi_log_err(SLAPI_LOG_TRACE, "compare_entries_sv", "db err %d\n", err);
-        }
-        /* Were up a creek without paddle here */
-        /* Best to log error and set some flag */
-        return 0;
-    }
-    b = id2entry(be, *id_b, &txn, &err);
-    if (NULL == b) {
-        if (0 != err) {
-            slapi_log_err(SLAPI_LOG_TRACE, "compare_entries_sv", "db err %d\n", err);
-        }
-        CACHE_RETURN(&inst->inst_cache, &a);
-        return 0;
-    }
-    /* OK, now we have the entries, so we work our way down the attribute list comparing as we go */
-    for (this_one = (sort_spec_thing *)s; this_one; this_one = this_one->next) {
+    /* We work our way down the attribute list comparing as we go */
+    for (j = 0; j < ks->nspecs; j++) {
+        struct berval *value_a = a->values[j];
+        struct berval *value_b = b->values[j];
+        uint64_t prefix_a = a->prefixes[j];
+        uint64_t prefix_b = b->prefixes[j];
 
-        char *type = this_one->type;
-        int order = this_one->order;
-        Slapi_Attr *attr_a = NULL;
-        Slapi_Attr *attr_b = NULL;
-        struct berval **value_a = NULL;
-        struct berval **value_b = NULL;
-
-        /* Get the two attribute values from the entries */
-        slapi_entry_attr_find(a->ep_entry, type, &attr_a);
-        slapi_entry_attr_find(b->ep_entry, type, &attr_b);
-        /* What do we do if one or more of the entries lacks this attribute ? */
         /* if one lacks the attribute */
-        if (NULL == attr_a) {
+        if (NULL == value_a) {
             /* then if the other does too, they're equal */
-            if (NULL == attr_b) {
-                result = 0;
+            if (NULL == value_b) {
                 continue;
-            } else {
-                /* If one has the attribute, and the other
-                 * doesn't, the missing attribute is the
-                 * LARGER one.  (bug #108154)  -robey
-                 */
-                result = 1;
-                break;
             }
+            /* If one has the attribute, and the other
+             * doesn't, the missing attribute is the
+             * LARGER one.  (bug #108154)  -robey
+             */
+            return 1;
         }
-        if (NULL == attr_b) {
-            result = -1;
-            break;
+        if (NULL == value_b) {
+            return -1;
         }
-        /* Somewhere in here, we need to go sideways for match rule case
-         * we need to call the match rule plugin to get the attribute values
-         * converted into ordering keys. Then we proceed as usual to use those,
-         * but ensuring that we don't leak memory anywhere. This works as follows:
-         * the code assumes that the attrs are references into the entry, so
-         * doesn't try to free them. We need to note at the right place that
-         * we're on the matchrule path, and accordingly free the keys---this turns out
-         * to be when we free the indexer */
-        if (NULL == this_one->matchrule) {
-            /* Non-match rule case */
-            valuearray_get_bervalarray(valueset_get_valuearray(&attr_a->a_present_values), &value_a);
-            valuearray_get_bervalarray(valueset_get_valuearray(&attr_b->a_present_values), &value_b);
-        } else {
-            /* Match rule case */
-            struct berval **actual_value_a = NULL;
-            struct berval **actual_value_b = NULL;
-            struct berval **temp_value = NULL;
-
-            valuearray_get_bervalarray(valueset_get_valuearray(&attr_a->a_present_values), &actual_value_a);
-            valuearray_get_bervalarray(valueset_get_valuearray(&attr_b->a_present_values), &actual_value_b);
-            matchrule_values_to_keys(this_one->mr_pb, actual_value_a, &temp_value);
-            /* Now copy it, so the second call doesn't crap on it */
-            value_a = slapi_ch_bvecdup(temp_value); /* Really, we'd prefer to not call the chXXX variant...*/
-            matchrule_values_to_keys(this_one->mr_pb, actual_value_b, &value_b);
-
-            if ((actual_value_a && !value_a) ||
-                (actual_value_b && !value_b)) {
-                ber_bvecfree(actual_value_a);
-                ber_bvecfree(actual_value_b);
-                CACHE_RETURN(&inst->inst_cache, &a);
-                CACHE_RETURN(&inst->inst_cache, &b);
-                *error = 1;
-                return 0;
-            }
-            if (actual_value_a)
-                ber_bvecfree(actual_value_a);
-            if (actual_value_b)
-                ber_bvecfree(actual_value_b);
-        }
-        /* Compare them */
-        if (!order) {
-            result = sort_attr_compare(value_a, value_b, this_one->compare_fn);
-        } else {
+        if (ks->orders[j]) {
             /* If reverse, invert the sense of the comparison */
-            result = sort_attr_compare(value_b, value_a, this_one->compare_fn);
+            value_a = b->values[j];
+            value_b = a->values[j];
+            prefix_a = b->prefixes[j];
+            prefix_b = a->prefixes[j];
         }
-        /* Time to free up the attributes allocated above */
-        if (NULL != this_one->matchrule) {
-            ber_bvecfree(value_a);
+        if (ks->compare_fns[j] == slapi_berval_cmp && prefix_a != prefix_b) {
+            /* The ordering keys are compared byte per byte, so most of
+             * them are ordered by their prefix alone */
+            result = (prefix_a < prefix_b) ? -1 : 1;
         } else {
-            ber_bvecfree(value_a);
-            ber_bvecfree(value_b);
+            result = ks->compare_fns[j](value_a, value_b);
         }
-        /* Are they equal ? */
         if (0 != result) {
-            /* If not, we're done */
             break;
         }
-        /* If so, proceed to the next attribute for comparison */
     }
-    CACHE_RETURN(&inst->inst_cache, &a);
-    CACHE_RETURN(&inst->inst_cache, &b);
-    *error = 0;
     return result;
 }
 
@@ -625,8 +729,8 @@ sort_check(baggage_carrier *bc)
 /* End fix for bug # 394184 */
 
 /* prototypes for local routines */
-static void shortsort(baggage_carrier *bc, ID *lo, ID *hi, sort_spec *s);
-static void swap(ID *a, ID *b);
+static void shortsort(sort_key *lo, sort_key *hi, sort_keyset *ks);
+static void swap(sort_key *a, sort_key *b);
 
 /* this parameter defines the cutoff between using quick sort and
    insertion sort for arrays; arrays with lengths shorter or equal to the
@@ -639,6 +743,8 @@ static void swap(ID *a, ID *b);
 /* replace the hard coded return value by the appropriate LDAP error code */
 /* Our qsort needs to police the client timeout and lookthrough limit ?
  * It knows how to compare entries, so we don't bother with all the void * stuff.
+ * The entries are fetched once, when their sort keys are extracted, and the
+ * sort then only works on the keys.
  */
 /*
  * Returns:
@@ -651,17 +757,15 @@ static void swap(ID *a, ID *b);
  * -6: Abandoned             now is: LDAP_OTHER
  */
 static int
-slapd_qsort(baggage_carrier *bc, IDList *list, sort_spec *s)
+slapd_qsort(baggage_carrier *bc, sort_key *keys, NIDS num, sort_keyset *ks)
 {
-    ID *lo, *hi;       /* ends of sub-array currently sorting */
-    ID *mid;           /* points to middle of subarray */
-    ID *loguy, *higuy; /* traveling pointers for partition step */
-    NIDS size;         /* size of the sub-array */
-    ID *lostk[30], *histk[30];
+    sort_key *lo, *hi;       /* ends of sub-array currently sorting */
+    sort_key *mid;           /* points to middle of subarray */
+    sort_key *loguy, *higuy; /* traveling pointers for partition step */
+    NIDS size;               /* size of the sub-array */
+    sort_key *lostk[30], *histk[30];
     int stkptr; /* stack for saving sub-array to be processed */
-    NIDS num = list->b_nids;
     int return_value = LDAP_SUCCESS;
-    int error = 0;
 
     /* Note: the number of stack entries required is no more than
        1 + log2(size), so 30 is sufficient for any array */
@@ -670,14 +774,8 @@ slapd_qsort(baggage_carrier *bc, IDList *list, sort_spec *s)
 
     stkptr = 0; /* initialize stack */
 
-    lo = &(list->b_ids[0]);
-    hi = &(list->b_ids[num - 1]); /* initialize limits */
-
-    /* Fix for bugid #394184, SD, 20 Jul 00 */
-    if (bc->lookthrough_limit != -1 && (bc->lookthrough_limit <= (int)list->b_nids)) {
-        return LDAP_ADMINLIMIT_EXCEEDED;
-    }
-/* end Fix for bugid #394184 */
+    lo = &keys[0];
+    hi = &keys[num - 1]; /* initialize limits */
 
 /* this entry point is for pseudo-recursion calling: setting
        lo and hi and jumping to here is like recursion, but stkptr is
@@ -688,7 +786,7 @@ recurse:
 
     /* below a certain size, it is faster to use a O(n^2) sorting method */
     if (size <= CUTOFF) {
-        shortsort(bc, lo, hi, s);
+        shortsort(lo, hi, ks);
     } else {
         /* First we pick a partititioning element.  The efficiency of the
            algorithm demands that we find one that is approximately the
@@ -719,19 +817,15 @@ recurse:
                A[i] >= A[lo] for higuy <= i <= hi */
 
             do {
-                if (error)
-                    return LDAP_OPERATIONS_ERROR;
                 loguy++;
-            } while (loguy <= hi && compare_entries_sv(loguy, lo, s, bc, &error) <= 0);
+            } while (loguy <= hi && compare_sort_keys(loguy, lo, ks) <= 0);
 
             /* lo < loguy <= hi+1, A[i] <= A[lo] for lo <= i < loguy,
                either loguy > hi or A[loguy] > A[lo] */
 
             do {
-                if (error)
-                    return LDAP_OPERATIONS_ERROR;
                 higuy--;
-            } while (higuy > lo && compare_entries_sv(higuy, lo, s, bc, &error) >= 0);
+            } while (higuy > lo && compare_sort_keys(higuy, lo, ks) >= 0);
 
             /* lo-1 <= higuy <= hi, A[i] >= A[lo] for higuy < i <= hi,
                either higuy <= lo or A[higuy] < A[lo] */
@@ -746,7 +840,7 @@ recurse:
             swap(loguy, higuy);
 
             /* Check admin and time limits here on the sort */
-            if (LDAP_SUCCESS != (return_value = sort_check(bc))) {
+            if (bc && LDAP_SUCCESS != (return_value = sort_check(bc))) {
                 return return_value;
             }
 
@@ -812,16 +906,73 @@ recurse:
 }
 /* End  fix for bug # 394184 */
 
+/* Move down the key at pos in the max-heap heap[0, size) */
+static void
+heap_sift_down(sort_key *heap, NIDS pos, NIDS size, sort_keyset *ks)
+{
+    NIDS child;
+
+    while ((child = 2 * pos + 1) < size) {
+        if (child + 1 < size && compare_sort_keys(&heap[child + 1], &heap[child], ks) > 0) {
+            child++;
+        }
+        if (compare_sort_keys(&heap[pos], &heap[child], ks) >= 0) {
+            break;
+        }
+        swap(&heap[pos], &heap[child]);
+        pos = child;
+    }
+}
+
+/*
+ * Partial sort: move the count lowest keys of [nsorted, nkeys) at its
+ * beginning, in order, without sorting the other ones.
+ * The lowest keys are selected with a max-heap of count keys, so it costs
+ * O(n log(count)) instead of O(n log(n)) for the sort of the whole set.
+ */
+static int
+sort_keys_select(baggage_carrier *bc, sort_keyset *ks, NIDS count)
+{
+    sort_key *heap = &ks->keys[ks->nsorted];
+    NIDS num = ks->nkeys - ks->nsorted;
+    NIDS i;
+    int return_value = LDAP_SUCCESS;
+
+    if (count >= num) {
+        count = num;
+        return_value = slapd_qsort(bc, heap, num, ks);
+    } else {
+        for (i = count / 2; i > 0; i--) {
+            heap_sift_down(heap, i - 1, count, ks);
+        }
+        for (i = count; i < num; i++) {
+            if (bc && LDAP_SUCCESS != (return_value = sort_check(bc))) {
+                return return_value;
+            }
+            if (compare_sort_keys(&heap[i], &heap[0], ks) < 0) {
+                swap(&heap[i], &heap[0]);
+                heap_sift_down(heap, 0, count, ks);
+            }
+        }
+        /* Sort the heap, from its highest key to the end */
+        for (i = count - 1; i > 0; i--) {
+            swap(&heap[0], &heap[i]);
+            heap_sift_down(heap, 0, i, ks);
+        }
+    }
+    if (LDAP_SUCCESS == return_value) {
+        ks->nsorted += count;
+    }
+    return return_value;
+}
 
 static void
 shortsort(
-    baggage_carrier *bc,
-    ID *lo,
-    ID *hi,
-    sort_spec *s)
+    sort_key *lo,
+    sort_key *hi,
+    sort_keyset *ks)
 {
-    ID *p, *max;
-    int error = 0;
+    sort_key *p, *max;
 
     /* Note: in assertions below, i and j are alway inside original bound of
        array to sort. */
@@ -831,7 +982,7 @@ shortsort(
         max = lo;
         for (p = lo + 1; p <= hi; p++) {
             /* A[i] <= A[max] for lo <= i < p */
-            if (compare_entries_sv(p, max, s, bc, &error) > 0) {
+            if (compare_sort_keys(p, max, ks) > 0) {
                 max = p;
             }
             /* A[i] <= A[max] for lo <= i <= p */
@@ -852,9 +1003,9 @@ shortsort(
 }
 
 static void
-swap(ID *a, ID *b)
+swap(sort_key *a, sort_key *b)
 {
-    ID tmp;
+    sort_key tmp;
 
     if (a != b) {
         tmp = *a;
@@ -862,3 +1013,75 @@ swap(ID *a, ID *b)
         *b = tmp;
     }
 }
+
+/*
+ * Extract the sort keys of the candidates and sort them, or only the
+ * topk first ones if it is worth it.
+ */
+static int
+sort_keys_sort(baggage_carrier *bc, IDList *list, sort_spec *s, NIDS topk, sort_keyset **remaining)
+{
+    sort_keyset *ks = NULL;
+    NIDS num = list->b_nids;
+    NIDS i;
+    int return_value = LDAP_SUCCESS;
+
+    if (num < 2)
+        return LDAP_SUCCESS; /* nothing to do */
+
+    /* Fix for bugid #394184, SD, 20 Jul 00 */
+    if (bc->lookthrough_limit != -1 && (bc->lookthrough_limit <= (int)list->b_nids)) {
+        return LDAP_ADMINLIMIT_EXCEEDED;
+    }
+    /* end Fix for bugid #394184 */
+
+    ks = sort_keyset_new(s, num);
+    return_value = sort_keys_extract(bc, list, s, ks);
+    if (LDAP_SUCCESS == return_value) {
+        if (remaining && topk > 0 && topk < num / 2) {
+            ks->chunk = topk;
+            return_value = sort_keys_select(bc, ks, topk);
+        } else {
+            return_value = slapd_qsort(bc, ks->keys, num, ks);
+            ks->nsorted = num;
+        }
+    }
+    if (LDAP_SUCCESS == return_value) {
+        for (i = 0; i < num; i++) {
+            list->b_ids[i] = ks->keys[i].id;
+        }
+        if (ks->nsorted < num) {
+            *remaining = ks;
+            ks = NULL;
+        }
+    }
+    sort_keyset_free(&ks);
+    return return_value;
+}
+
+/*
+ * Called by the search before it reads the candidate at position, when
+ * only the first candidates were sorted: if it is not sorted yet, the next
+ * chunk of candidates is sorted. The entries are not fetched again.
+ * Returns 1 while some candidates are not sorted, else 0 and ks can be freed.
+ */
+int
+sort_candidates_continue(sort_keyset *ks, IDList *candidates, NIDS position)
+{
+    NIDS first = ks->nsorted;
+    NIDS i;
+
+    if (candidates == NULL || candidates->b_nids != ks->nkeys) {
+        /* Not the list that was sorted */
+        return 0;
+    }
+    if (position < ks->nsorted) {
+        return 1;
+    }
+    /* Without baggage carrier there is no limit check, the search does them */
+    sort_keys_select(NULL, ks, (ks->chunk < (ks->nkeys - first) / 2) ? ks->chunk : ks->nkeys - first);
+    for (i = first; i < ks->nkeys; i++) {
+        candidates->b_ids[i] = ks->keys[i].id;
+    }
+    return ks->nsorted < ks->nkeys;
+}
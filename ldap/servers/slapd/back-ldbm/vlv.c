@@ -32,6 +32,9 @@
 static PRUint32 vlv_trim_candidates_byindex(PRUint32 length, const struct vlv_request *vlv_request_control);
 static PRUint32 vlv_trim_candidates_byvalue(backend *be, const IDList *candidates, const sort_spec *sort_control, const struct vlv_request *vlv_request_control, back_txn *txn);
 static int vlv_build_candidate_list(backend *be, struct vlvIndex *p, const struct vlv_request *vlv_request_control, IDList **candidates, struct vlv_response *vlv_response_control, int is_srchlist_locked, back_txn *txn);
+static void vlv_auto_init(ldbm_instance *inst);
+static void vlv_auto_close(ldbm_instance *inst);
+static int vlv_auto_isauto(const struct vlvIndex *pi);
 
 /* New mutex for vlv locking
 Slapi_RWLock * vlvSearchList_lock=NULL;
@@ -375,6 +378,7 @@ vlv_close(ldbm_instance *inst)
     if (be->vlvSearchList_lock) {
         slapi_destroy_rwlock(be->vlvSearchList_lock);
     }
+    vlv_auto_close(inst);
 }
 
 /*
@@ -408,6 +412,7 @@ vlv_init(ldbm_instance *inst)
         be->vlvSearchList_lock = slapi_new_rwlock();
         slapi_ch_free((void **)&rwlockname);
     }
+    vlv_auto_init(inst);
     if (NULL != (struct vlvSearch *)be->vlvSearchList) {
         struct vlvSearch *t = NULL;
         struct vlvSearch *nt = NULL;
@@ -1282,6 +1287,10 @@ vlv_build_candidate_list(backend *be, struct vlvIndex *p, const struct vlv_reque
         vlv_response_control->targetPosition = si + 1;
         vlv_response_control->contentCount = length;
         vlv_response_control->result = return_value;
+    } else if (length == 0) {
+        /* The whole index is asked, and it is empty */
+        do_trim = 0;
+        *candidates = idl_alloc(1);
     }
 
     if ((return_value == LDAP_SUCCESS) && do_trim) {
@@ -2098,3 +2107,599 @@ vlv_release_lock(backend *be)
     slapi_log_err(SLAPI_LOG_TRACE, "vlv_release_lock", "Trying to release the lock\n");
     slapi_rwlock_unlock(be->vlvSearchList_lock);
 }
+
+/*
+ * Automatic VLV indexes.
+ *
+ * When nsslapd-vlv-auto-threshold is set, the sorted searches sorting at
+ * least nsslapd-vlv-auto-min-candidates candidates are counted by shape:
+ * base, scope, filter and sort keys. Once a shape has been seen threshold
+ * times, a vlvSearch/vlvIndex pair is added for it, like an administrator
+ * would do, and an index task builds it. From then on the index is kept up
+ * to date by vlv_update_all_indexes and the sorted searches of this shape
+ * read their candidates from it instead of sorting them.
+ *
+ * The automatic indexes are named VLV_AUTO_PREFIX<hash of the shape>, so
+ * they are found again after a restart and can be removed like any other
+ * vlv index.
+ *
+ * Every VLV_AUTO_AGING_INTERVAL, the automatic indexes are aged by the
+ * number of searches they served (vlvUses in the monitor): the unused ones
+ * are removed, and so is the least used one if a more frequent shape is
+ * waiting for a free slot (see vlv_auto_age).
+ */
+#define VLV_AUTO_PREFIX "autoVlv"
+#define VLV_AUTO_MAX_SHAPES 128
+#define VLV_AUTO_AGING_INTERVAL 3600 /* seconds */
+
+struct vlv_auto_shape
+{
+    char *name; /* name of the vlv index built for this shape */
+    char *base;
+    int scope;
+    char *filter;
+    char *sort; /* sort keys, in the vlvSort syntax */
+    uint64_t count;
+    int scheduled;
+};
+
+struct vlv_auto
+{
+    PRLock *lock;
+    int nshapes;
+    int pending; /* indexes scheduled but not yet added */
+    time_t next_aging;
+    struct vlv_auto_shape shapes[VLV_AUTO_MAX_SHAPES];
+};
+
+struct vlv_auto_create
+{
+    struct ldbminfo *li;
+    char *inst_name;
+    char *name;
+    char *base;
+    int scope;
+    char *filter;
+    char *sort;
+};
+
+static void
+vlv_auto_init(ldbm_instance *inst)
+{
+    if (inst->inst_vlv_auto == NULL) {
+        inst->inst_vlv_auto = (struct vlv_auto *)slapi_ch_calloc(1, sizeof(struct vlv_auto));
+        inst->inst_vlv_auto->lock = PR_NewLock();
+    }
+}
+
+static void
+vlv_auto_shape_done(struct vlv_auto_shape *shape)
+{
+    slapi_ch_free_string(&shape->name);
+    slapi_ch_free_string(&shape->base);
+    slapi_ch_free_string(&shape->filter);
+    slapi_ch_free_string(&shape->sort);
+    memset(shape, 0, sizeof(*shape));
+}
+
+static void
+vlv_auto_close(ldbm_instance *inst)
+{
+    struct vlv_auto *va = inst->inst_vlv_auto;
+    int i;
+
+    if (va == NULL) {
+        return;
+    }
+    for (i = 0; i < va->nshapes; i++) {
+        vlv_auto_shape_done(&va->shapes[i]);
+    }
+    PR_DestroyLock(va->lock);
+    slapi_ch_free((void **)&inst->inst_vlv_auto);
+}
+
+static int
+vlv_auto_isauto(const struct vlvIndex *pi)
+{
+    return pi->vlv_name && strncasecmp(pi->vlv_name, VLV_AUTO_PREFIX, sizeof(VLV_AUTO_PREFIX) - 1) == 0;
+}
+
+/*
+ * Write the sort keys in the vlvSort syntax.
+ * Returns NULL for the reverse orders: the vlv index puts the entries
+ * without the sorted attribute first where the server side sorting puts
+ * them last, so the index would not give the same result.
+ */
+static char *
+vlv_auto_sort_string(const sort_spec *sort_control)
+{
+    const sort_spec *s;
+    char *str = NULL;
+
+    for (s = sort_control; s != NULL; s = s->next) {
+        char *prev = str;
+
+        if (s->order) {
+            slapi_ch_free_string(&str);
+            return NULL;
+        }
+        str = slapi_ch_smprintf("%s%s%s%s%s", prev ? prev : "", prev ? " " : "",
+                                s->type, s->matchrule ? ":" : "", s->matchrule ? s->matchrule : "");
+        slapi_ch_free_string(&prev);
+    }
+    return str;
+}
+
+static char *
+vlv_auto_name(const char *base, int scope, const char *filter, const char *sort)
+{
+    const char *parts[] = {base, filter, sort};
+    uint32_t hash = 2166136261U; /* FNV-1a */
+    size_t i;
+    const char *p;
+
+    for (i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+        for (p = parts[i]; *p; p++) {
+            hash = (hash ^ (unsigned char)TOLOWER(*p)) * 16777619U;
+        }
+        hash = (hash ^ (unsigned char)scope) * 16777619U;
+    }
+    return slapi_ch_smprintf("%s%08x", VLV_AUTO_PREFIX, hash);
+}
+
+/* Count the automatic vlv indexes of the backend and tell if 'name' is one of them */
+static int
+vlv_auto_count_indexes(backend *be, const char *name, int *exists)
+{
+    struct vlvSearch *p;
+    struct vlvIndex *pi;
+    int count = 0;
+
+    slapi_rwlock_rdlock(be->vlvSearchList_lock);
+    for (p = (struct vlvSearch *)be->vlvSearchList; p != NULL; p = p->vlv_next) {
+        for (pi = p->vlv_index; pi != NULL; pi = pi->vlv_next) {
+            if (vlv_auto_isauto(pi)) {
+                count++;
+                if (strcasecmp(pi->vlv_name, name) == 0) {
+                    *exists = 1;
+                }
+            }
+        }
+    }
+    slapi_rwlock_unlock(be->vlvSearchList_lock);
+    return count;
+}
+
+static int
+vlv_auto_add_entry(struct ldbminfo *li, Slapi_Entry *e)
+{
+    Slapi_PBlock *pb = slapi_pblock_new();
+    char *dn = slapi_ch_strdup(slapi_entry_get_dn_const(e));
+    int rc = LDAP_SUCCESS;
+
+    /* the entry is consumed by the add */
+    slapi_add_entry_internal_set_pb(pb, e, NULL, li->li_identity, 0);
+    slapi_add_internal_pb(pb);
+    slapi_pblock_get(pb, SLAPI_PLUGIN_INTOP_RESULT, &rc);
+    if (rc != LDAP_SUCCESS && rc != LDAP_ALREADY_EXISTS) {
+        slapi_log_err(SLAPI_LOG_ERR, "vlv_auto_add_entry", "Can't add dse entry '%s' error %d\n", dn, rc);
+    } else {
+        rc = LDAP_SUCCESS;
+    }
+    slapi_pblock_destroy(pb);
+    slapi_ch_free_string(&dn);
+    return rc;
+}
+
+static void
+vlv_auto_create_free(struct vlv_auto_create **pac)
+{
+    struct vlv_auto_create *ac = *pac;
+
+    slapi_ch_free_string(&ac->inst_name);
+    slapi_ch_free_string(&ac->name);
+    slapi_ch_free_string(&ac->base);
+    slapi_ch_free_string(&ac->filter);
+    slapi_ch_free_string(&ac->sort);
+    slapi_ch_free((void **)pac);
+}
+
+/*
+ * Event queue callback adding the vlvSearch and vlvIndex entries of an
+ * automatic index, then the task building it.
+ * This is done out of the search operation which triggered it because the
+ * dse adds and the task need the vlv lock and the backend.
+ */
+static void
+vlv_auto_create(time_t when __attribute__((unused)), void *arg)
+{
+    struct vlv_auto_create *ac = (struct vlv_auto_create *)arg;
+    struct ldbminfo *li = ac->li;
+    ldbm_instance *inst = ldbm_instance_find_by_name(li, ac->inst_name);
+    char *searchcn = NULL;
+    char *searchdn = NULL;
+    char *indexdn = NULL;
+    char *taskcn = NULL;
+    char *taskdn = NULL;
+    Slapi_Entry *e = NULL;
+    int rc = LDAP_SUCCESS;
+
+    if (inst == NULL || inst->inst_vlv_auto == NULL) {
+        vlv_auto_create_free(&ac);
+        return;
+    }
+    searchcn = slapi_ch_smprintf("%sSearch", ac->name);
+    searchdn = slapi_create_dn_string("cn=%s,cn=%s,cn=%s,cn=plugins,cn=config",
+                                      searchcn, inst->inst_name, li->li_plugin->plg_name);
+    indexdn = slapi_create_dn_string("cn=%s,%s", ac->name, searchdn);
+    taskcn = slapi_ch_smprintf("%s_%ld", ac->name, (long)slapi_current_utc_time());
+    taskdn = slapi_create_dn_string("cn=%s,cn=index,cn=tasks,cn=config", taskcn);
+
+    slapi_log_err(SLAPI_LOG_INFO, "vlv_auto_create",
+                  "Creating vlv index %s for base \"%s\" scope %d filter \"%s\" sort \"%s\" in backend %s\n",
+                  ac->name, ac->base, ac->scope, ac->filter, ac->sort, inst->inst_name);
+
+    e = slapi_entry_alloc();
+    slapi_entry_init(e, slapi_ch_strdup(searchdn), NULL);
+    slapi_entry_add_string(e, SLAPI_ATTR_OBJECTCLASS, "top");
+    slapi_entry_add_string(e, SLAPI_ATTR_OBJECTCLASS, "vlvSearch");
+    slapi_entry_add_string(e, type_vlvName, searchcn);
+    slapi_entry_add_string(e, type_vlvBase, ac->base);
+    slapi_entry_attr_set_int(e, type_vlvScope, ac->scope);
+    slapi_entry_add_string(e, type_vlvFilter, ac->filter);
+    rc = vlv_auto_add_entry(li, e);
+
+    if (rc == LDAP_SUCCESS) {
+        e = slapi_entry_alloc();
+        slapi_entry_init(e, slapi_ch_strdup(indexdn), NULL);
+        slapi_entry_add_string(e, SLAPI_ATTR_OBJECTCLASS, "top");
+        slapi_entry_add_string(e, SLAPI_ATTR_OBJECTCLASS, "vlvIndex");
+        slapi_entry_add_string(e, type_vlvName, ac->name);
+        slapi_entry_add_string(e, type_vlvSort, ac->sort);
+        rc = vlv_auto_add_entry(li, e);
+    }
+    if (rc == LDAP_SUCCESS) {
+        e = slapi_entry_alloc();
+        slapi_entry_init(e, slapi_ch_strdup(taskdn), NULL);
+        slapi_entry_add_string(e, SLAPI_ATTR_OBJECTCLASS, "top");
+        slapi_entry_add_string(e, SLAPI_ATTR_OBJECTCLASS, "extensibleObject");
+        slapi_entry_add_string(e, "cn", taskcn);
+        slapi_entry_add_string(e, "nsInstance", inst->inst_name);
+        slapi_entry_add_string(e, "nsIndexVlvAttribute", ac->name);
+        rc = vlv_auto_add_entry(li, e);
+    }
+
+    PR_Lock(inst->inst_vlv_auto->lock);
+    inst->inst_vlv_auto->pending--;
+    PR_Unlock(inst->inst_vlv_auto->lock);
+
+    slapi_ch_free_string(&searchcn);
+    slapi_ch_free_string(&searchdn);
+    slapi_ch_free_string(&indexdn);
+    slapi_ch_free_string(&taskcn);
+    slapi_ch_free_string(&taskdn);
+    vlv_auto_create_free(&ac);
+}
+
+/* Remove the vlvIndex entry, then the vlvSearch entry, of an automatic index */
+static void
+vlv_auto_remove(time_t when __attribute__((unused)), void *arg)
+{
+    struct vlv_auto_create *ac = (struct vlv_auto_create *)arg;
+    struct ldbminfo *li = ac->li;
+    ldbm_instance *inst = ldbm_instance_find_by_name(li, ac->inst_name);
+    const char *dns[2] = {NULL, NULL};
+    char *searchdn = NULL;
+    char *indexdn = NULL;
+    struct vlvSearch *p;
+    struct vlvIndex *pi;
+    int rc = LDAP_SUCCESS;
+    int i;
+
+    if (inst == NULL || inst->inst_be->vlvSearchList_lock == NULL) {
+        vlv_auto_create_free(&ac);
+        return;
+    }
+    slapi_rwlock_rdlock(inst->inst_be->vlvSearchList_lock);
+    for (p = (struct vlvSearch *)inst->inst_be->vlvSearchList; p != NULL && searchdn == NULL; p = p->vlv_next) {
+        for (pi = p->vlv_index; pi != NULL; pi = pi->vlv_next) {
+            if (strcasecmp(pi->vlv_name, ac->name) == 0) {
+                searchdn = slapi_ch_strdup(slapi_sdn_get_dn(p->vlv_dn));
+                break;
+            }
+        }
+    }
+    slapi_rwlock_unlock(inst->inst_be->vlvSearchList_lock);
+    if (searchdn == NULL) {
+        vlv_auto_create_free(&ac);
+        return;
+    }
+    indexdn = slapi_create_dn_string("cn=%s,%s", ac->name, searchdn);
+    dns[0] = indexdn;
+    dns[1] = searchdn;
+
+    slapi_log_err(SLAPI_LOG_INFO, "vlv_auto_remove",
+                  "Removing the unused vlv index %s from backend %s\n", ac->name, inst->inst_name);
+    for (i = 0; i < 2 && rc == LDAP_SUCCESS; i++) {
+        Slapi_PBlock *pb = slapi_pblock_new();
+
+        slapi_delete_internal_set_pb(pb, dns[i], NULL, NULL, li->li_identity, 0);
+        slapi_delete_internal_pb(pb);
+        slapi_pblock_get(pb, SLAPI_PLUGIN_INTOP_RESULT, &rc);
+        if (rc != LDAP_SUCCESS) {
+            slapi_log_err(SLAPI_LOG_ERR, "vlv_auto_remove", "Can't delete dse entry '%s' error %d\n", dns[i], rc);
+        }
+        slapi_pblock_destroy(pb);
+    }
+    slapi_ch_free_string(&searchdn);
+    slapi_ch_free_string(&indexdn);
+    vlv_auto_create_free(&ac);
+}
+
+/*
+ * Age the automatic vlv indexes by the number of searches they served since
+ * the previous aging. An index that served none is unused and is removed.
+ * If the shape 'wanted' waits for a free slot, the least used index is
+ * removed too when it served fewer searches than the shape was seen.
+ * Then half of the recent uses are forgotten, so that an index that is no
+ * longer used is eventually removed.
+ * An index is only judged once it has been enabled for a whole interval.
+ * Returns the names of the indexes to remove.
+ */
+static char **
+vlv_auto_age(backend *be, const struct vlv_auto_shape *wanted)
+{
+    struct vlvSearch *p;
+    struct vlvIndex *pi;
+    struct vlvIndex *least = NULL;
+    uint64_t least_uses = 0;
+    char **names = NULL;
+
+    slapi_rwlock_rdlock(be->vlvSearchList_lock);
+    for (p = (struct vlvSearch *)be->vlvSearchList; p != NULL; p = p->vlv_next) {
+        for (pi = p->vlv_index; pi != NULL; pi = pi->vlv_next) {
+            uint64_t uses;
+
+            if (!vlv_auto_isauto(pi) || !vlvIndex_enabled(pi)) {
+                continue;
+            }
+            if (!pi->vlv_auto_aged) {
+                pi->vlv_auto_uses = pi->vlv_uses;
+                pi->vlv_auto_aged = 1;
+                continue;
+            }
+            uses = pi->vlv_uses - pi->vlv_auto_uses;
+            if (uses == 0) {
+                charray_add(&names, slapi_ch_strdup(pi->vlv_name));
+                continue;
+            }
+            if (least == NULL || uses < least_uses) {
+                least = pi;
+                least_uses = uses;
+            }
+            pi->vlv_auto_uses += (uses + 1) / 2;
+        }
+    }
+    if (wanted && least && least_uses < wanted->count) {
+        charray_add(&names, slapi_ch_strdup(least->vlv_name));
+    }
+    slapi_rwlock_unlock(be->vlvSearchList_lock);
+    return names;
+}
+
+/*
+ * Count a sorted search by its shape, and schedule the creation of a vlv
+ * index for it when it is frequent enough. Called before the candidates
+ * are sorted.
+ */
+void
+vlv_auto_record(Slapi_PBlock *pb, const Slapi_DN *base, const sort_spec *sort_control, const IDList *candidates)
+{
+    backend *be = NULL;
+    Operation *op = NULL;
+    ldbm_instance *inst;
+    struct ldbminfo *li;
+    struct vlv_auto *va;
+    struct vlv_auto_shape *shape = NULL;
+    struct vlv_auto_shape *victim = NULL;
+    struct vlv_auto_create *ac = NULL;
+    const char *ndn = slapi_sdn_get_ndn(base);
+    time_t now = slapi_current_rel_time_t();
+    char **removed = NULL;
+    char *fstr = NULL;
+    char *sort = NULL;
+    int scope = 0;
+    int exists = 0;
+    int i;
+
+    slapi_pblock_get(pb, SLAPI_BACKEND, &be);
+    slapi_pblock_get(pb, SLAPI_OPERATION, &op);
+    inst = (ldbm_instance *)be->be_instance_info;
+    li = inst->inst_li;
+    va = inst->inst_vlv_auto;
+    if (va == NULL || li->li_vlv_auto_threshold <= 0 || !li->li_use_vlv ||
+        candidates == NULL || candidates->b_nids < (NIDS)li->li_vlv_auto_min_candidates ||
+        operation_is_flag_set(op, OP_FLAG_INTERNAL)) {
+        return;
+    }
+    slapi_pblock_get(pb, SLAPI_SEARCH_SCOPE, &scope);
+    slapi_pblock_get(pb, SLAPI_SEARCH_STRFILTER, &fstr);
+    if (fstr == NULL || ndn == NULL || (sort = vlv_auto_sort_string(sort_control)) == NULL) {
+        return;
+    }
+
+    PR_Lock(va->lock);
+    for (i = 0; i < va->nshapes; i++) {
+        struct vlv_auto_shape *s = &va->shapes[i];
+        if (s->scope == scope && strcmp(s->base, ndn) == 0 &&
+            strcasecmp(s->filter, fstr) == 0 && strcasecmp(s->sort, sort) == 0) {
+            shape = s;
+            break;
+        }
+        if (victim == NULL || s->count < victim->count) {
+            victim = s;
+        }
+    }
+    if (shape == NULL) {
+        if (va->nshapes < VLV_AUTO_MAX_SHAPES) {
+            shape = &va->shapes[va->nshapes++];
+        } else {
+            /* Replace the least seen shape, and age the other ones so
+             * that the new shapes get a chance to reach the threshold */
+            shape = victim;
+            vlv_auto_shape_done(shape);
+            for (i = 0; i < va->nshapes; i++) {
+                va->shapes[i].count /= 2;
+            }
+        }
+        shape->name = vlv_auto_name(ndn, scope, fstr, sort);
+        shape->base = slapi_ch_strdup(ndn);
+        shape->scope = scope;
+        shape->filter = slapi_ch_strdup(fstr);
+        shape->sort = sort;
+        sort = NULL;
+    }
+    shape->count++;
+    if (now >= va->next_aging) {
+        int waiting = !shape->scheduled && shape->count >= (uint64_t)li->li_vlv_auto_threshold &&
+                      vlv_auto_count_indexes(be, shape->name, &exists) + va->pending >= li->li_vlv_auto_max_indexes;
+
+        va->next_aging = now + VLV_AUTO_AGING_INTERVAL;
+        removed = vlv_auto_age(be, waiting ? shape : NULL);
+        for (i = 0; removed && removed[i]; i++) {
+            /* Its shape has to reach the threshold again to get a new index */
+            for (int j = 0; j < va->nshapes; j++) {
+                if (va->shapes[j].name && strcasecmp(va->shapes[j].name, removed[i]) == 0) {
+                    va->shapes[j].scheduled = 0;
+                    va->shapes[j].count = 0;
+                }
+            }
+        }
+    }
+    if (!shape->scheduled && shape->count >= (uint64_t)li->li_vlv_auto_threshold &&
+        vlv_auto_count_indexes(be, shape->name, &exists) + va->pending < li->li_vlv_auto_max_indexes) {
+        shape->scheduled = 1;
+        if (!exists) {
+            /* else it is being built */
+            ac = (struct vlv_auto_create *)slapi_ch_calloc(1, sizeof(struct vlv_auto_create));
+            ac->li = li;
+            ac->inst_name = slapi_ch_strdup(inst->inst_name);
+            ac->name = slapi_ch_strdup(shape->name);
+            ac->base = slapi_ch_strdup(slapi_sdn_get_dn(base));
+            ac->scope = scope;
+            ac->filter = slapi_ch_strdup(fstr);
+            ac->sort = slapi_ch_strdup(shape->sort);
+            va->pending++;
+        }
+    }
+    PR_Unlock(va->lock);
+    slapi_ch_free_string(&sort);
+
+    if (ac) {
+        slapi_eq_once_rel(vlv_auto_create, ac, now);
+    }
+    for (i = 0; removed && removed[i]; i++) {
+        ac = (struct vlv_auto_create *)slapi_ch_calloc(1, sizeof(struct vlv_auto_create));
+        ac->li = li;
+        ac->inst_name = slapi_ch_strdup(inst->inst_name);
+        ac->name = removed[i];
+        removed[i] = NULL;
+        slapi_eq_once_rel(vlv_auto_remove, ac, now);
+    }
+    slapi_ch_free((void **)&removed);
+}
+
+/*
+ * Get the candidates of a sorted search without vlv control from an enabled
+ * automatic vlv index built for the same base, scope, filter and sort keys
+ * (matching rules included): it holds the entries matching the search,
+ * already sorted.
+ * The reverse orders are left to the server side sorting, see
+ * vlv_auto_sort_string.
+ * The candidates are dropped if there are more than the lookthrough limit
+ * or if the time limit is reached, so that the server side sorting applies
+ * and reports the limits.
+ * Returns LDAP_SUCCESS when the candidates come from a vlv index.
+ */
+int
+vlv_search_sorted_candidates(Slapi_PBlock *pb, const Slapi_DN *base, const sort_spec *sort_control, int lookthrough_limit, struct timespec *expire_time, IDList **candidates)
+{
+    struct vlvIndex *pi = NULL;
+    const sort_spec *s;
+    backend *be = NULL;
+    struct ldbminfo *li = NULL;
+    int scope = 0;
+    char *fstr = NULL;
+    back_txn txn = {NULL};
+    int rc;
+
+    for (s = sort_control; s != NULL; s = s->next) {
+        if (s->order) {
+            return LDAP_UNWILLING_TO_PERFORM;
+        }
+    }
+    slapi_pblock_get(pb, SLAPI_TXN, &txn.back_txn_txn);
+    slapi_pblock_get(pb, SLAPI_BACKEND, &be);
+    slapi_pblock_get(pb, SLAPI_SEARCH_SCOPE, &scope);
+    slapi_pblock_get(pb, SLAPI_SEARCH_STRFILTER, &fstr);
+    li = (struct ldbminfo *)be->be_database->plg_private;
+    if (fstr == NULL || li->li_vlv_auto_threshold <= 0) {
+        return LDAP_UNWILLING_TO_PERFORM;
+    }
+    slapi_rwlock_rdlock(be->vlvSearchList_lock);
+    if ((pi = vlv_find_search(be, base, scope, fstr, sort_control)) == NULL ||
+        !vlv_auto_isauto(pi) || vlvIndex_accessallowed(pi, pb) != LDAP_SUCCESS) {
+        slapi_rwlock_unlock(be->vlvSearchList_lock);
+        return LDAP_UNWILLING_TO_PERFORM;
+    }
+    /* The lock is released by vlv_build_candidate_list */
+    rc = vlv_build_candidate_list(be, pi, NULL, candidates, NULL, 1, &txn);
+    if (rc == LDAP_SUCCESS && *candidates != NULL) {
+        if (lookthrough_limit != -1 && (*candidates)->b_nids > (NIDS)lookthrough_limit) {
+            rc = LDAP_ADMINLIMIT_EXCEEDED;
+        } else if (slapi_timespec_expire_check(expire_time) == TIMER_EXPIRED) {
+            rc = LDAP_TIMELIMIT_EXCEEDED;
+        }
+    }
+    if (rc != LDAP_SUCCESS) {
+        idl_free(candidates);
+    }
+    return rc;
+}
+
+/* Add the automatic vlv indexes and their number of uses to the monitor entry of the instance */
+void
+vlv_auto_monitor(ldbm_instance *inst, Slapi_Entry *e)
+{
+    backend *be = inst->inst_be;
+    struct vlvSearch *p;
+    struct vlvIndex *pi;
+    char type[64];
+    int count = 0;
+
+    if (be->vlvSearchList_lock == NULL) {
+        return;
+    }
+    slapi_rwlock_rdlock(be->vlvSearchList_lock);
+    for (p = (struct vlvSearch *)be->vlvSearchList; p != NULL; p = p->vlv_next) {
+        for (pi = p->vlv_index; pi != NULL; pi = pi->vlv_next) {
+            if (!vlv_auto_isauto(pi)) {
+                continue;
+            }
+            PR_snprintf(type, sizeof(type), "autoVlvIndexName-%d", count);
+            slapi_entry_attr_set_charptr(e, type, pi->vlv_name);
+            PR_snprintf(type, sizeof(type), "autoVlvIndexUses-%d", count);
+            slapi_entry_attr_set_ulong(e, type, pi->vlv_uses);
+            PR_snprintf(type, sizeof(type), "autoVlvIndexEnabled-%d", count);
+            slapi_entry_attr_set_charptr(e, type, vlvIndex_enabled(pi) ? "on" : "off");
+            count++;
+        }
+    }
+    slapi_rwlock_unlock(be->vlvSearchList_lock);
+    slapi_entry_attr_set_int(e, "autoVlvIndexes", count);
+    if (inst->inst_vlv_auto) {
+        PR_Lock(inst->inst_vlv_auto->lock);
+        slapi_entry_attr_set_int(e, "autoVlvSortedSearchShapes", inst->inst_vlv_auto->nshapes);
+        PR_Unlock(inst->inst_vlv_auto->lock);
+    }
+}
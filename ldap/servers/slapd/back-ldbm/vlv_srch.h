@@ -93,6 +93,10 @@ struct vlvIndex
     /* The number of uses this search has received since start up */
     uint64_t vlv_uses;
 
+    /* Automatic indexes: vlv_uses minus the recent uses, once aged (see vlv_auto_age) */
+    uint64_t vlv_auto_uses;
+    int vlv_auto_aged;
+
     struct backend *vlv_be; /* need backend to remove the index when done */
 
     /* The parent Search Specification for this Index */
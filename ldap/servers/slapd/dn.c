@@ -24,10 +24,9 @@
 
 #ifdef RUST_ENABLE
 #include <rust-slapi-private.h>
-#else
+#endif
 /* For the ndn cache - this gives up siphash13 */
 uint64_t sds_siphash13(const void *src, size_t src_sz, const char key[16]);
-#endif
 
 #undef SDN_DEBUG
 
@@ -42,15 +41,11 @@ static int does_cn_uses_dn_syntax_in_dns(char *type, char *dn);
 struct ndn_cache_stats {
     Slapi_Counter *cache_hits;
     Slapi_Counter *cache_tries;
-    Slapi_Counter *cache_count;
-    Slapi_Counter *cache_size;
-    Slapi_Counter *cache_evicts;
     uint64_t max_size;
     uint64_t thread_max_size;
     uint64_t slots;
 };
 
-#ifndef RUST_ENABLE
 struct ndn_cache_value {
     uint64_t size;
     uint64_t slot;
@@ -60,7 +55,6 @@ struct ndn_cache_value {
     struct ndn_cache_value *prev;
     struct ndn_cache_value *child;
 };
-#endif
 
 /*
  * This uses a similar alloc trick to IDList to keep
@@ -70,40 +64,63 @@ struct ndn_cache {
     /*
      * We keep per thread stats and flush them occasionally
      */
-#ifdef RUST_ENABLE
-    ARCacheChar *cache;
-#else
-    /* Need to track this because we need to provide diffs to counter */
-    uint64_t last_count;
-    uint64_t count;
     /* Number of ops */
     uint64_t tries;
-    /* hit vs miss. in theroy miss == tries - hits.*/
+    /* hit vs miss (in the front or the shared cache). miss == tries - hits.*/
     uint64_t hits;
-    /* How many values we kicked out */
-    uint64_t evicts;
-    /* Need to track this because we need to provide diffs to counter */
-    uint64_t last_size;
+    uint64_t count;
     uint64_t size;
     uint64_t slots;
     /* The per-thread max size */
     uint64_t max_size;
-    /*
-     * This is used by siphash to prevent hash bucket attacks
-     */
-    char key[16];
 
     struct ndn_cache_value *head;
     struct ndn_cache_value *tail;
     struct ndn_cache_value *table[1];
-#endif
 };
 
+#ifndef RUST_ENABLE
+/*
+ * Value of the shared cache. Readers only ever set "referenced",
+ * everything else is changed under the partition write lock.
+ */
+struct ndn_shared_value {
+    uint64_t size;
+    uint64_t hash;
+    int32_t referenced;
+    char *dn;
+    char *ndn;
+    struct ndn_shared_value *child; /* next value of the same slot */
+    struct ndn_shared_value *next;  /* next (younger) value of the clock queue */
+};
+
+struct ndn_shared_partition {
+    Slapi_RWLock *lock;
+    uint64_t size;
+    uint64_t max_size;
+    uint64_t count;
+    uint64_t evicts;
+    uint64_t slots;
+    struct ndn_shared_value *head; /* oldest value, next eviction candidate */
+    struct ndn_shared_value *tail; /* youngest value */
+    struct ndn_shared_value **table;
+};
+#endif
+
 /*
- * This means we need 1 MB minimum per thread
- * 
+ * This means we need 1 MB minimum for the shared cache
  */
 #define NDN_CACHE_MINIMUM_CAPACITY 1048576
+/*
+ * Size of the per thread front cache. It only has to keep the few DNs a
+ * thread keeps normalizing, the bulk of the memory goes to the shared cache.
+ */
+#define NDN_CACHE_FRONT_CAPACITY 131072
+/*
+ * Number of independently locked partitions of the shared cache (a power
+ * of two), so that concurrent inserts rarely wait for each other.
+ */
+#define NDN_SHARED_PARTITIONS 64
 /*
  * This helps us define the number of hashtable slots
  * to create. We assume an average DN is 64 chars long
@@ -2892,11 +2909,30 @@ slapi_sdn_get_size(const Slapi_DN *sdn)
  */
 
 
-#ifndef RUST_ENABLE
+/*
+ * On top of these per thread front caches sits a shared cache, bounded by
+ * nsslapd-ndn-cache-max-size, that every thread fills and reads when its
+ * front cache misses. So a DN normalized by one worker is a hit for all
+ * the others, while the front caches stay small and need no locking.
+ *
+ * With rust the shared cache is the concurrently readable ARCache, so readers
+ * never block. Otherwise it is a hashtable split in NDN_SHARED_PARTITIONS
+ * partitions, each one under its own rwlock. Readers only take the read lock
+ * and flag the value as referenced; eviction is a second chance (CLOCK)
+ * queue so that a hit never has to reorder anything.
+ *
+ * Tries and hits (front or shared) are accounted per thread and committed
+ * every NDN_STAT_COMMIT_FREQUENCY lookups. Size, count and evictions are the
+ * ones of the shared cache.
+ */
+
 static pthread_key_t ndn_cache_key;
 static pthread_once_t ndn_cache_key_once = PTHREAD_ONCE_INIT;
 static struct ndn_cache_stats t_cache_stats = {0};
-#endif
+/*
+ * This is used by siphash to prevent hash bucket attacks
+ */
+static char ndn_cache_hash_key[16] = {0};
 /*
  * WARNING: For some reason we try to use the NDN cache *before*
  * we have a chance to configure it. As a result, we need to rely
@@ -2910,11 +2946,30 @@ static struct ndn_cache_stats t_cache_stats = {0};
 static int32_t ndn_enabled = 0;
 #ifdef RUST_ENABLE
 static ARCacheChar *cache = NULL;
+#else
+static struct ndn_shared_partition *shared_cache = NULL;
 #endif
 
+/*
+ * Slots *must* be a power of two, even if the number of entries
+ * we store will be *less* than this.
+ */
+static uint64_t
+ndn_cache_slots(uint64_t max_size)
+{
+    size_t possible_elements = max_size / NDN_ENTRY_AVG_SIZE;
+    /*
+     * So this is like 1048576 / 168, so we get 6241. Now we need to
+     * shift this to get the number of bits.
+     */
+    size_t shifts = 0;
+    while (possible_elements > 0) {
+        shifts++;
+        possible_elements = possible_elements >> 1;
+    }
+    return (uint64_t)1 << shifts;
+}
 
-#ifdef RUST_ENABLE
-#else
 static void
 ndn_thread_cache_commit_status(struct ndn_cache *t_cache) {
     /*
@@ -2923,43 +2978,18 @@ ndn_thread_cache_commit_status(struct ndn_cache *t_cache) {
      */
     if (t_cache->tries % NDN_STAT_COMMIT_FREQUENCY == 0) {
         /* We can just add tries and hits. */
-        slapi_counter_add(t_cache_stats.cache_evicts, t_cache->evicts);
         slapi_counter_add(t_cache_stats.cache_tries, t_cache->tries);
         slapi_counter_add(t_cache_stats.cache_hits, t_cache->hits);
         t_cache->hits = 0;
         t_cache->tries = 0;
-        t_cache->evicts = 0;
-        /* Count and size need diff */
-        // Get the size from the main cache.
-        int64_t diff = (t_cache->size - t_cache->last_size);
-        if (diff > 0) {
-            // We have more ....
-            slapi_counter_add(t_cache_stats.cache_size, (uint64_t)diff);
-        } else if (diff < 0) {
-            slapi_counter_subtract(t_cache_stats.cache_size, (uint64_t)llabs(diff));
-        }
-        t_cache->last_size = t_cache->size;
-
-        diff = (t_cache->count - t_cache->last_count);
-        if (diff > 0) {
-            // We have more ....
-            slapi_counter_add(t_cache_stats.cache_count, (uint64_t)diff);
-        } else if (diff < 0) {
-            slapi_counter_subtract(t_cache_stats.cache_count, (uint64_t)llabs(diff));
-        }
-        t_cache->last_count = t_cache->count;
-
     }
 }
-#endif
 
-#ifndef RUST_ENABLE
 static void
 ndn_thread_cache_value_destroy(struct ndn_cache *t_cache, struct ndn_cache_value *v) {
     /* Update stats */
     t_cache->size = t_cache->size - v->size;
     t_cache->count--;
-    t_cache->evicts++;
 
     if (v == t_cache->head) {
         t_cache->head = v->prev;
@@ -2994,10 +3024,7 @@ ndn_thread_cache_value_destroy(struct ndn_cache *t_cache, struct ndn_cache_value
     slapi_ch_free((void **)&(v->ndn));
     slapi_ch_free((void **)&v);
 }
-#endif
 
-
-#ifndef RUST_ENABLE
 static void
 ndn_thread_cache_destroy(void *v_cache) {
     struct ndn_cache *t_cache = (struct ndn_cache *)v_cache;
@@ -3021,292 +3048,78 @@ ndn_cache_key_init(void) {
         slapi_log_err(SLAPI_LOG_ERR, "ndn_cache_init", "Failed to create pthread key, aborting.\n");
     }
 }
-#endif
-
-int32_t
-ndn_cache_init()
-{
-    ndn_enabled = config_get_ndn_cache_enabled();
-    if (ndn_enabled == 0) {
-        /*
-         * Don't configure the keys or anything, need a restart
-         * to enable. We'll just never use ndn cache in this
-         * run.
-         */
-        return 0;
-    }
-
-#ifdef RUST_ENABLE
-    uint64_t max_size = config_get_ndn_cache_size();
-    if (max_size < NDN_CACHE_MINIMUM_CAPACITY) {
-        max_size = NDN_CACHE_MINIMUM_CAPACITY;
-    }
-    uintptr_t max_estimate = max_size / NDN_ENTRY_AVG_SIZE;
-    /*
-     * Since we currently only do one op per read, we set 0 because there
-     * is no value in having the read thread cache.
-     */
-    uintptr_t max_thread_read = 0;
-    /* Setup the main cache which all other caches will inherit. */
-    cache = cache_char_create(max_estimate, max_thread_read);
-#else
-    /* Create the pthread key */
-    (void)pthread_once(&ndn_cache_key_once, ndn_cache_key_init);
-    /* Get thread numbers and calc the per thread size */
-    int32_t maxthreads = (int32_t)config_get_threadnumber();
-    size_t tentative_size = t_cache_stats.max_size / maxthreads;
-    if (tentative_size < NDN_CACHE_MINIMUM_CAPACITY) {
-        tentative_size = NDN_CACHE_MINIMUM_CAPACITY;
-        t_cache_stats.max_size = NDN_CACHE_MINIMUM_CAPACITY * maxthreads;
-    }
-    t_cache_stats.thread_max_size = tentative_size;
-
-    /*
-     * Slots *must* be a power of two, even if the number of entries
-     * we store will be *less* than this.
-     */
-    size_t possible_elements = tentative_size / NDN_ENTRY_AVG_SIZE;
-    /*
-     * So this is like 1048576 / 168, so we get 6241. Now we need to
-     * shift this to get the number of bits.
-     */
-    size_t shifts = 0;
-    while (possible_elements > 0) {
-        shifts++;
-        possible_elements = possible_elements >> 1;
-    }
-    /*
-     * So now we can use this to make the slot count.
-     */
-    t_cache_stats.slots = 1 << shifts;
-    /* Create the global stats. */
-    t_cache_stats.max_size = config_get_ndn_cache_size();
-    t_cache_stats.cache_evicts = slapi_counter_new();
-    t_cache_stats.cache_tries = slapi_counter_new();
-    t_cache_stats.cache_hits = slapi_counter_new();
-    t_cache_stats.cache_count = slapi_counter_new();
-    t_cache_stats.cache_size = slapi_counter_new();
-#endif
-    /* Done? */
-    return 0;
-}
-
-void
-ndn_cache_destroy()
-{
-    if (ndn_enabled == 0) {
-        return;
-    }
-#ifdef RUST_ENABLE
-    cache_char_free(cache);
-#else
-    slapi_counter_destroy(&(t_cache_stats.cache_tries));
-    slapi_counter_destroy(&(t_cache_stats.cache_hits));
-    slapi_counter_destroy(&(t_cache_stats.cache_count));
-    slapi_counter_destroy(&(t_cache_stats.cache_size));
-    slapi_counter_destroy(&(t_cache_stats.cache_evicts));
-#endif
-}
-
-int
-ndn_cache_started()
-{
-    return ndn_enabled;
-}
-
-/*
- *  Look up this dn in the ndn cache
- */
-#ifdef RUST_ENABLE
-/* This is the rust version of the ndn cache */
-
-static int32_t
-ndn_cache_lookup(char *dn, size_t dn_len, char **ndn, char **udn, int32_t *rc)
-{
-    if (ndn_enabled == 0 || NULL == udn) {
-        return 0;
-    }
-    *udn = NULL;
-
-    if (dn_len == 0) {
-        *ndn = dn;
-        *rc = 0;
-        return 1;
-    }
-
-    /* Look for it */
-    ARCacheCharRead *read_txn = cache_char_read_begin(cache);
-    PR_ASSERT(read_txn);
-
-    const char *cache_ndn = cache_char_read_get(read_txn, dn);
-    if (cache_ndn != NULL) {
-        *ndn = slapi_ch_strdup(cache_ndn);
-        /*
-         * We have to complete the read after the strdup else it's
-         * not safe to access the pointer.
-         */
-        cache_char_read_complete(read_txn);
-        *rc = 1;
-        return 1;
-    } else {
-        cache_char_read_complete(read_txn);
-        /* If we miss, we need to duplicate dn to udn here. */
-        *udn = slapi_ch_strdup(dn);
-        *rc = 0;
-        return 0;
-    }
-}
 
-static void
-ndn_cache_add(char *dn, size_t dn_len, char *ndn, size_t ndn_len)
-{
-    if (ndn_enabled == 0) {
-        return;
-    }
-    if (dn_len == 0) {
-        return;
-    }
-    if (strlen(ndn) > ndn_len) {
-        /* we need to null terminate the ndn */
-        *(ndn + ndn_len) = '\0';
-    }
-
-    ARCacheCharRead *read_txn = cache_char_read_begin(cache);
-    PR_ASSERT(read_txn);
-    cache_char_read_include(read_txn, dn, ndn);
-    cache_char_read_complete(read_txn);
-    /*
-     * We need to free dn - in the original ndn cache, the dn is added to the
-     * hashmap, but in the rust one, it's cloned to a cstring, so we no longer
-     * need it now.
-     */
-    slapi_ch_free_string(&dn);
-}
-
-#else
 static struct ndn_cache *
-ndn_thread_cache_create(size_t thread_max_size, size_t slots) {
-    size_t t_cache_size = sizeof(struct ndn_cache) + (slots * sizeof(struct ndn_cache_value *));
-    struct ndn_cache *t_cache = (struct ndn_cache *)slapi_ch_calloc(1, t_cache_size);
-
-#ifdef RUST_ENABLE
-    t_cache->cache = cache;
-#else
-    t_cache->max_size = thread_max_size;
-    t_cache->slots = slots;
-#endif
-
-    return t_cache;
-}
-
-static int
-ndn_cache_lookup(char *dn, size_t dn_len, char **ndn, char **udn, int *rc)
-{
-    if (ndn_enabled == 0 || NULL == udn) {
-        return 0;
-    }
-    *udn = NULL;
-
-    if (dn_len == 0) {
-        *ndn = dn;
-        *rc = 0;
-        return 1;
-    }
-
+ndn_thread_cache_get(void) {
     struct ndn_cache *t_cache = pthread_getspecific(ndn_cache_key);
+
     if (t_cache == NULL) {
-        t_cache = ndn_thread_cache_create(t_cache_stats.thread_max_size, t_cache_stats.slots);
+        size_t t_cache_size = sizeof(struct ndn_cache) + (t_cache_stats.slots * sizeof(struct ndn_cache_value *));
+        t_cache = (struct ndn_cache *)slapi_ch_calloc(1, t_cache_size);
+        t_cache->max_size = t_cache_stats.thread_max_size;
+        t_cache->slots = t_cache_stats.slots;
         pthread_setspecific(ndn_cache_key, t_cache);
-        /* If we have no cache, we can't look up ... */
-        return 0;
     }
+    return t_cache;
+}
 
-    t_cache->tries++;
-
-    /*
-     * Hash our DN ...
-     */
-    uint64_t dn_hash = sds_siphash13(dn, dn_len, t_cache->key);
+/*
+ * Find a dn in the front cache and make it the most recently used.
+ */
+static struct ndn_cache_value *
+ndn_thread_cache_find(struct ndn_cache *t_cache, char *dn, uint64_t dn_hash) {
     /* Where should it be? */
     size_t expect_slot = dn_hash % t_cache->slots;
 
     /*
-     * Is it there?
+     * Check it really matches, could be collision.
      */
-    if (t_cache->table[expect_slot] != NULL) {
-        /*
-         * Check it really matches, could be collision.
-         */
-        struct ndn_cache_value *node = t_cache->table[expect_slot];
-        while (node != NULL) {
-            if (strcmp(dn, node->dn) == 0) {
+    struct ndn_cache_value *node = t_cache->table[expect_slot];
+    while (node != NULL) {
+        if (strcmp(dn, node->dn) == 0) {
+            /*
+             * Update LRU
+             * Are we already the tail? If so, we can just skip.
+             * remember, this means in a set of 1, we will always be tail
+             */
+            if (t_cache->tail != node) {
                 /*
-                 * Update LRU
-                 * Are we already the tail? If so, we can just skip.
-                 * remember, this means in a set of 1, we will always be tail
+                 * Okay, we are *not* the tail. We could be anywhere between
+                 * tail -> ... -> x -> head
+                 * or even, we are the head ourself.
                  */
-                if (t_cache->tail != node) {
-                    /*
-                     * Okay, we are *not* the tail. We could be anywhere between
-                     * tail -> ... -> x -> head
-                     * or even, we are the head ourself.
-                     */
-                    if (t_cache->head == node) {
-                        /* We are the head, update head to our predecessor */
-                        t_cache->head = node->prev;
-                        /* Remember, the head has no next. */
-                        t_cache->head->next = NULL;
-                    } else {
-                        /* Right, we aren't the head, so we have a next node. */
-                        node->next->prev = node->prev;
-                    }
-                    /* Because we must be in the middle somewhere, we can assume next and prev exist. */
-                    node->prev->next = node->next;
-                    /*
-                     * Tail can't be NULL if we have a value in the cache, so we can
-                     * just deref this.
-                     */
-                    node->next = t_cache->tail;
-                    t_cache->tail->prev = node;
-                    t_cache->tail = node;
-                    node->prev = NULL;
+                if (t_cache->head == node) {
+                    /* We are the head, update head to our predecessor */
+                    t_cache->head = node->prev;
+                    /* Remember, the head has no next. */
+                    t_cache->head->next = NULL;
+                } else {
+                    /* Right, we aren't the head, so we have a next node. */
+                    node->next->prev = node->prev;
                 }
-
-                /* Update that we have a hit.*/
-                t_cache->hits++;
-                /* Cope the NDN to the caller. */
-                *ndn = slapi_ch_strdup(node->ndn);
-                /* Indicate to the caller to free this. */
-                *rc = 1;
-                ndn_thread_cache_commit_status(t_cache);
-                return 1;
+                /* Because we must be in the middle somewhere, we can assume next and prev exist. */
+                node->prev->next = node->next;
+                /*
+                 * Tail can't be NULL if we have a value in the cache, so we can
+                 * just deref this.
+                 */
+                node->next = t_cache->tail;
+                t_cache->tail->prev = node;
+                t_cache->tail = node;
+                node->prev = NULL;
             }
-            node = node->child;
+            return node;
         }
+        node = node->child;
     }
-    /* If we miss, we need to duplicate dn to udn here. */
-    *udn = slapi_ch_strdup(dn);
-    *rc = 0;
-    ndn_thread_cache_commit_status(t_cache);
-    return 0;
+    return NULL;
 }
 
 /*
- *  Add a ndn to the cache.  Try and do as much as possible before taking the write lock.
+ * Add a dn to the front cache. The dn is consumed, the ndn is copied.
  */
 static void
-ndn_cache_add(char *dn, size_t dn_len, char *ndn, size_t ndn_len)
-{
-    if (ndn_enabled == 0) {
-        return;
-    }
-    if (dn_len == 0) {
-        return;
-    }
-    if (strlen(ndn) > ndn_len) {
-        /* we need to null terminate the ndn */
-        *(ndn + ndn_len) = '\0';
-    }
+ndn_thread_cache_insert(struct ndn_cache *t_cache, char *dn, size_t dn_len, char *ndn, size_t ndn_len, uint64_t dn_hash) {
     /*
      *  Calculate the approximate memory footprint of the hash entry, key, and lru entry.
      */
@@ -3317,18 +3130,6 @@ ndn_cache_add(char *dn, size_t dn_len, char *ndn, size_t ndn_len)
     /* But we need to copy ndn */
     new_value->ndn = slapi_ch_strdup(ndn);
 
-    /*
-     * Get our local cache out.
-     */
-    struct ndn_cache *t_cache = pthread_getspecific(ndn_cache_key);
-    if (t_cache == NULL) {
-        t_cache = ndn_thread_cache_create(t_cache_stats.thread_max_size, t_cache_stats.slots);
-        pthread_setspecific(ndn_cache_key, t_cache);
-    }
-    /*
-     * Hash the DN
-     */
-    uint64_t dn_hash = sds_siphash13(new_value->dn, dn_len, t_cache->key);
     /*
      * Get the insert slot: This works because the number spaces of dn_hash is
      * a 64bit int, and slots is a power of two. As a result, we end up with
@@ -3378,16 +3179,65 @@ ndn_cache_add(char *dn, size_t dn_len, char *ndn, size_t ndn_len)
      */
     t_cache->size = t_cache->size + new_value->size;
     t_cache->count++;
+}
 
+#ifdef RUST_ENABLE
+/* This is the rust version of the shared cache */
+
+static int32_t
+ndn_shared_cache_init(uint64_t max_size)
+{
+    uintptr_t max_estimate = max_size / NDN_ENTRY_AVG_SIZE;
+    /*
+     * The front caches already absorb the repeated reads of a thread, so
+     * we set 0 because there is no value in having the read thread cache.
+     */
+    uintptr_t max_thread_read = 0;
+    /* Setup the main cache which all other caches will inherit. */
+    cache = cache_char_create(max_estimate, max_thread_read);
+    return (cache == NULL) ? -1 : 0;
 }
-#endif
-/* end rust_enable */
 
-/* stats for monitor */
-void
-ndn_cache_get_stats(uint64_t *hits, uint64_t *tries, uint64_t *size, uint64_t *max_size, uint64_t *thread_size, uint64_t *evicts, uint64_t *slots, uint64_t *count)
+static void
+ndn_shared_cache_destroy(void)
+{
+    cache_char_free(cache);
+    cache = NULL;
+}
+
+/* Returns a copy of the cached ndn, or NULL */
+static char *
+ndn_shared_cache_get(char *dn, uint64_t dn_hash __attribute__((unused)))
+{
+    char *ndn = NULL;
+    ARCacheCharRead *read_txn = cache_char_read_begin(cache);
+    PR_ASSERT(read_txn);
+
+    const char *cache_ndn = cache_char_read_get(read_txn, dn);
+    if (cache_ndn != NULL) {
+        ndn = slapi_ch_strdup(cache_ndn);
+    }
+    /*
+     * We have to complete the read after the strdup else it's
+     * not safe to access the pointer.
+     */
+    cache_char_read_complete(read_txn);
+    return ndn;
+}
+
+/* dn and ndn are cloned to a cstring by the ARCache */
+static void
+ndn_shared_cache_add(char *dn, size_t dn_len __attribute__((unused)), char *ndn, size_t ndn_len __attribute__((unused)), uint64_t dn_hash __attribute__((unused)))
+{
+    ARCacheCharRead *read_txn = cache_char_read_begin(cache);
+    PR_ASSERT(read_txn);
+    cache_char_read_include(read_txn, dn, ndn);
+    cache_char_read_complete(read_txn);
+}
+
+static void
+ndn_shared_cache_get_stats(uint64_t *size, uint64_t *evicts, uint64_t *count)
 {
-#ifdef RUST_ENABLE
     /*
      * A pretty big note here - the ARCache stores things by slot, not size, because
      * getting the real byte size is expensive in some cases (that are beyond this
@@ -3399,42 +3249,359 @@ ndn_cache_get_stats(uint64_t *hits, uint64_t *tries, uint64_t *size, uint64_t *m
     uint64_t reader_includes;
     uint64_t write_hits;
     uint64_t write_inc_or_mod;
+    uint64_t shared_max;
     uint64_t freq;
     uint64_t recent;
     uint64_t freq_evicts;
     uint64_t recent_evicts;
     uint64_t p_weight;
-    cache_char_stats(cache, 
+    uint64_t all_seen_keys;
+    cache_char_stats(cache,
         &reader_hits,
         &reader_includes,
         &write_hits,
         &write_inc_or_mod,
-        max_size,
+        &shared_max,
         &freq,
         &recent,
         &freq_evicts,
         &recent_evicts,
         &p_weight,
-        slots
+        &all_seen_keys
     );
     /* ARCache stores by key count not size, so we recombine with the avg entry size */
-    *max_size = *max_size * NDN_ENTRY_AVG_SIZE;
-    *thread_size = 0;
     *evicts = freq_evicts + recent_evicts;
-    *hits = write_hits + reader_hits;
-    *tries = *hits + reader_includes + write_inc_or_mod;
     *size = (freq + recent) * NDN_ENTRY_AVG_SIZE;
     *count = (freq + recent);
+}
+
 #else
+/* This is the C version of the shared cache */
+
+static int32_t
+ndn_shared_cache_init(uint64_t max_size)
+{
+    shared_cache = (struct ndn_shared_partition *)slapi_ch_calloc(NDN_SHARED_PARTITIONS, sizeof(struct ndn_shared_partition));
+    for (size_t i = 0; i < NDN_SHARED_PARTITIONS; i++) {
+        struct ndn_shared_partition *part = &shared_cache[i];
+        part->lock = slapi_new_rwlock();
+        if (part->lock == NULL) {
+            slapi_log_err(SLAPI_LOG_ERR, "ndn_cache_init", "Failed to create the shared cache lock.\n");
+            return -1;
+        }
+        part->max_size = max_size / NDN_SHARED_PARTITIONS;
+        part->slots = ndn_cache_slots(part->max_size);
+        part->table = (struct ndn_shared_value **)slapi_ch_calloc(part->slots, sizeof(struct ndn_shared_value *));
+    }
+    return 0;
+}
+
+static void
+ndn_shared_cache_value_free(struct ndn_shared_value **v)
+{
+    slapi_ch_free_string(&((*v)->dn));
+    slapi_ch_free_string(&((*v)->ndn));
+    slapi_ch_free((void **)v);
+}
+
+static void
+ndn_shared_cache_destroy(void)
+{
+    if (shared_cache == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < NDN_SHARED_PARTITIONS; i++) {
+        struct ndn_shared_partition *part = &shared_cache[i];
+        struct ndn_shared_value *v = part->head;
+        while (v) {
+            struct ndn_shared_value *next = v->next;
+            ndn_shared_cache_value_free(&v);
+            v = next;
+        }
+        slapi_ch_free((void **)&(part->table));
+        if (part->lock) {
+            slapi_destroy_rwlock(part->lock);
+        }
+    }
+    slapi_ch_free((void **)&shared_cache);
+}
+
+static struct ndn_shared_partition *
+ndn_shared_cache_partition(uint64_t dn_hash, size_t *slot)
+{
+    struct ndn_shared_partition *part = &shared_cache[dn_hash % NDN_SHARED_PARTITIONS];
+    /* The low bits chose the partition, use the others for the slot */
+    *slot = (dn_hash / NDN_SHARED_PARTITIONS) % part->slots;
+    return part;
+}
+
+/* Returns a copy of the cached ndn, or NULL */
+static char *
+ndn_shared_cache_get(char *dn, uint64_t dn_hash)
+{
+    size_t slot;
+    struct ndn_shared_partition *part = ndn_shared_cache_partition(dn_hash, &slot);
+    char *ndn = NULL;
+
+    slapi_rwlock_rdlock(part->lock);
+    for (struct ndn_shared_value *v = part->table[slot]; v; v = v->child) {
+        if ((v->hash == dn_hash) && (strcmp(dn, v->dn) == 0)) {
+            /* Avoid dirtying the cache line when it is already set */
+            if (slapi_atomic_load_32(&(v->referenced), __ATOMIC_RELAXED) == 0) {
+                slapi_atomic_store_32(&(v->referenced), 1, __ATOMIC_RELAXED);
+            }
+            ndn = slapi_ch_strdup(v->ndn);
+            break;
+        }
+    }
+    slapi_rwlock_unlock(part->lock);
+
+    return ndn;
+}
+
+/*
+ * Evict the oldest value that was not read since the hand last passed
+ * on it. Called with the partition write lock.
+ */
+static void
+ndn_shared_cache_evict(struct ndn_shared_partition *part)
+{
+    struct ndn_shared_value *v = NULL;
+
+    for (;;) {
+        v = part->head;
+        part->head = v->next;
+        if (part->head == NULL) {
+            part->tail = NULL;
+        }
+        v->next = NULL;
+        if (v->referenced == 0) {
+            break;
+        }
+        /* Second chance: requeue it as the youngest value */
+        v->referenced = 0;
+        if (part->tail) {
+            part->tail->next = v;
+        } else {
+            part->head = v;
+        }
+        part->tail = v;
+    }
+
+    /* Now unlink it from its slot */
+    size_t slot = (v->hash / NDN_SHARED_PARTITIONS) % part->slots;
+    struct ndn_shared_value **link = &(part->table[slot]);
+    while (*link != v) {
+        link = &((*link)->child);
+    }
+    *link = v->child;
+
+    part->size -= v->size;
+    part->count--;
+    part->evicts++;
+    ndn_shared_cache_value_free(&v);
+}
+
+/* dn and ndn are copied */
+static void
+ndn_shared_cache_add(char *dn, size_t dn_len, char *ndn, size_t ndn_len, uint64_t dn_hash)
+{
+    size_t slot;
+    struct ndn_shared_partition *part = ndn_shared_cache_partition(dn_hash, &slot);
+    struct ndn_shared_value *new_value = (struct ndn_shared_value *)slapi_ch_calloc(1, sizeof(struct ndn_shared_value));
+
+    new_value->size = sizeof(struct ndn_shared_value) + dn_len + ndn_len;
+    new_value->hash = dn_hash;
+    new_value->dn = slapi_ch_strdup(dn);
+    new_value->ndn = slapi_ch_strdup(ndn);
+
+    slapi_rwlock_wrlock(part->lock);
+    /* Another thread may have normalized the same dn meanwhile */
+    for (struct ndn_shared_value *v = part->table[slot]; v; v = v->child) {
+        if ((v->hash == dn_hash) && (strcmp(dn, v->dn) == 0)) {
+            slapi_rwlock_unlock(part->lock);
+            ndn_shared_cache_value_free(&new_value);
+            return;
+        }
+    }
+    while (part->head && (part->size + new_value->size) > part->max_size) {
+        ndn_shared_cache_evict(part);
+    }
+    new_value->child = part->table[slot];
+    part->table[slot] = new_value;
+    if (part->tail) {
+        part->tail->next = new_value;
+    } else {
+        part->head = new_value;
+    }
+    part->tail = new_value;
+    part->size += new_value->size;
+    part->count++;
+    slapi_rwlock_unlock(part->lock);
+}
+
+static void
+ndn_shared_cache_get_stats(uint64_t *size, uint64_t *evicts, uint64_t *count)
+{
+    *size = 0;
+    *evicts = 0;
+    *count = 0;
+    for (size_t i = 0; i < NDN_SHARED_PARTITIONS; i++) {
+        struct ndn_shared_partition *part = &shared_cache[i];
+        slapi_rwlock_rdlock(part->lock);
+        *size += part->size;
+        *evicts += part->evicts;
+        *count += part->count;
+        slapi_rwlock_unlock(part->lock);
+    }
+}
+#endif
+/* end rust_enable */
+
+int32_t
+ndn_cache_init()
+{
+    ndn_enabled = config_get_ndn_cache_enabled();
+    if (ndn_enabled == 0) {
+        /*
+         * Don't configure the keys or anything, need a restart
+         * to enable. We'll just never use ndn cache in this
+         * run.
+         */
+        return 0;
+    }
+
+    uint64_t max_size = config_get_ndn_cache_size();
+    if (max_size < NDN_CACHE_MINIMUM_CAPACITY) {
+        max_size = NDN_CACHE_MINIMUM_CAPACITY;
+    }
+    if (ndn_shared_cache_init(max_size) != 0) {
+        ndn_shared_cache_destroy();
+        ndn_enabled = 0;
+        return 0;
+    }
+
+    /* Create the pthread key for the front caches */
+    (void)pthread_once(&ndn_cache_key_once, ndn_cache_key_init);
+    t_cache_stats.thread_max_size = NDN_CACHE_FRONT_CAPACITY;
+    t_cache_stats.slots = ndn_cache_slots(NDN_CACHE_FRONT_CAPACITY);
+
+    /* Create the global stats. */
+    t_cache_stats.max_size = max_size;
+    t_cache_stats.cache_tries = slapi_counter_new();
+    t_cache_stats.cache_hits = slapi_counter_new();
+    /* Done? */
+    return 0;
+}
+
+void
+ndn_cache_destroy()
+{
+    if (ndn_enabled == 0) {
+        return;
+    }
+    ndn_shared_cache_destroy();
+    slapi_counter_destroy(&(t_cache_stats.cache_tries));
+    slapi_counter_destroy(&(t_cache_stats.cache_hits));
+}
+
+int
+ndn_cache_started()
+{
+    return ndn_enabled;
+}
+
+/*
+ *  Look up this dn in the ndn cache, the front cache of the thread first
+ *  then the shared cache.
+ */
+static int
+ndn_cache_lookup(char *dn, size_t dn_len, char **ndn, char **udn, int *rc)
+{
+    if (ndn_enabled == 0 || NULL == udn) {
+        return 0;
+    }
+    *udn = NULL;
+
+    if (dn_len == 0) {
+        *ndn = dn;
+        *rc = 0;
+        return 1;
+    }
+
+    struct ndn_cache *t_cache = ndn_thread_cache_get();
+    char *cache_ndn = NULL;
+
+    t_cache->tries++;
+
+    /*
+     * Hash our DN once, for both caches
+     */
+    uint64_t dn_hash = sds_siphash13(dn, dn_len, ndn_cache_hash_key);
+
+    struct ndn_cache_value *node = ndn_thread_cache_find(t_cache, dn, dn_hash);
+    if (node != NULL) {
+        /* Copy the NDN to the caller. */
+        cache_ndn = slapi_ch_strdup(node->ndn);
+    } else {
+        cache_ndn = ndn_shared_cache_get(dn, dn_hash);
+        if (cache_ndn != NULL) {
+            /* Keep it close for the next time */
+            ndn_thread_cache_insert(t_cache, slapi_ch_strdup(dn), dn_len, cache_ndn, strlen(cache_ndn), dn_hash);
+        }
+    }
+
+    if (cache_ndn != NULL) {
+        /* Update that we have a hit.*/
+        t_cache->hits++;
+        *ndn = cache_ndn;
+        /* Indicate to the caller to free this. */
+        *rc = 1;
+        ndn_thread_cache_commit_status(t_cache);
+        return 1;
+    }
+
+    /* If we miss, we need to duplicate dn to udn here. */
+    *udn = slapi_ch_strdup(dn);
+    *rc = 0;
+    ndn_thread_cache_commit_status(t_cache);
+    return 0;
+}
+
+/*
+ *  Add a ndn to the cache. dn is consumed by the front cache, the shared
+ *  cache keeps its own copy.
+ */
+static void
+ndn_cache_add(char *dn, size_t dn_len, char *ndn, size_t ndn_len)
+{
+    if (ndn_enabled == 0) {
+        return;
+    }
+    if (dn_len == 0) {
+        return;
+    }
+    if (strlen(ndn) > ndn_len) {
+        /* we need to null terminate the ndn */
+        *(ndn + ndn_len) = '\0';
+    }
+
+    uint64_t dn_hash = sds_siphash13(dn, dn_len, ndn_cache_hash_key);
+
+    ndn_shared_cache_add(dn, dn_len, ndn, ndn_len, dn_hash);
+    ndn_thread_cache_insert(ndn_thread_cache_get(), dn, dn_len, ndn, ndn_len, dn_hash);
+}
+
+/* stats for monitor */
+void
+ndn_cache_get_stats(uint64_t *hits, uint64_t *tries, uint64_t *size, uint64_t *max_size, uint64_t *thread_size, uint64_t *evicts, uint64_t *slots, uint64_t *count)
+{
     *max_size = t_cache_stats.max_size;
     *thread_size = t_cache_stats.thread_max_size;
     *slots = t_cache_stats.slots;
-    *evicts = slapi_counter_get_value(t_cache_stats.cache_evicts);
     *hits = slapi_counter_get_value(t_cache_stats.cache_hits);
     *tries = slapi_counter_get_value(t_cache_stats.cache_tries);
-    *size = slapi_counter_get_value(t_cache_stats.cache_size);
-    *count = slapi_counter_get_value(t_cache_stats.cache_count);
-#endif
+    ndn_shared_cache_get_stats(size, evicts, count);
 }
 
 /* Common ancestor sdn is allocated.
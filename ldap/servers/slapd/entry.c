@@ -1912,6 +1912,7 @@ slapi_entry_free(Slapi_Entry *e) /* JCM - Should be ** so that we can NULL the p
         slapi_ch_free((void **)&e->e_uniqueid);
         attrlist_free(e->e_attrs);
         attrlist_free(e->e_deleted_attrs);
+        entry_summary_free(e);
         VATTR_WRITE_LOCK(e);
         entry_vattr_free_nolock(e);
         VATTR_WRITE_UNLOCK(e);
@@ -1970,6 +1971,7 @@ slapi_entry_size(Slapi_Entry *e)
     size += slapi_attrlist_size(e->e_deleted_attrs);
     size += slapi_attrlist_size(e->e_aux_attrs);
     size += entry_vattr_size(e);
+    size += entry_summary_size(e);
     if (e->e_extension) {
         struct attrs_in_extension *aiep;
         int cnt;
@@ -2282,6 +2284,12 @@ slapi_entrycache_vattrcache_watermark_invalidate()
     }
 }
 
+int32_t
+slapi_entrycache_vattrcache_watermark_get()
+{
+    return slapi_atomic_load_32(&g_virtual_watermark, __ATOMIC_ACQUIRE);
+}
+
 /* The following functions control the virtual attribute cache
  * stored in each entry (e_virtual_attrs). Access to that cache
  * requires holding a lock (e_virtual_lock)
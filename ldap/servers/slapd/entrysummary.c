@@ -0,0 +1,225 @@
+/** BEGIN COPYRIGHT BLOCK
+ * Copyright (C) 2026 Red Hat, Inc.
+ * All rights reserved.
+ *
+ * License: GPL (version 3 or any later version).
+ * See LICENSE for details.
+ * END COPYRIGHT BLOCK **/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/*
+ * entrysummary.c - equality summaries of the entries
+ *
+ * A summary is a small Bloom filter of the equality keys of the present
+ * values of an entry, each key being hashed with the base type of its
+ * attribute. A backend attaches it to the entries of its entry cache
+ * and sets the hash of the equality assertions of the search filter
+ * (ava_summary), then test_ava_filter() rejects in a few instructions
+ * the entries whose summary does not hold the assertion, without
+ * walking their attributes and comparing their values.
+ *
+ * The keys are the ones of the equality index: a value matching an
+ * assertion has the key of the assertion, so a summary never rejects
+ * an entry that matches. If the keys of an attribute can not be
+ * generated the entry has no summary.
+ *
+ * The entries of the entry cache are not modified (a modify works on
+ * a copy that replaces the entry in the cache), so a summary is built
+ * once. slapi_entry_dup() does not copy it.
+ */
+
+#include "slap.h"
+
+/* Larger entries (big groups...) are not worth a summary */
+#define ENTRY_SUMMARY_MAX_KEYS 4096
+/* About 3% of false positives with 3 probes */
+#define ENTRY_SUMMARY_BITS_PER_KEY 8
+#define ENTRY_SUMMARY_PROBES 3
+
+struct slapi_entry_summary
+{
+    uint32_t es_mask;   /* number of bits - 1, the number of bits is a power of 2 */
+    uint64_t es_bits[]; /* the Bloom filter */
+};
+
+/* FNV-1a of the base type, in lower case */
+static uint64_t
+entry_summary_hash_type(const char *type)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (; *type && *type != ';'; type++) {
+        unsigned char c = (unsigned char)*type;
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Never 0: 0 is the hash of the assertions that can not use the summaries */
+static uint64_t
+entry_summary_hash_key(uint64_t hash, const struct berval *key)
+{
+    /* The separator keeps "a" + "bc" apart from "ab" + "c" */
+    hash ^= 0xff;
+    hash *= 1099511628211ULL;
+    for (ber_len_t i = 0; i < key->bv_len; i++) {
+        hash ^= (unsigned char)key->bv_val[i];
+        hash *= 1099511628211ULL;
+    }
+    /* FNV mixes the high bits poorly, finish it (murmur3 fmix64) */
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash ? hash : 1;
+}
+
+#define ENTRY_SUMMARY_BIT(h, i, mask) (((uint32_t)(h) + (i) * ((uint32_t)((h) >> 32) | 1)) & (mask))
+
+static void
+entry_summary_set(struct slapi_entry_summary *s, uint64_t hash)
+{
+    for (uint32_t i = 0; i < ENTRY_SUMMARY_PROBES; i++) {
+        uint32_t bit = ENTRY_SUMMARY_BIT(hash, i, s->es_mask);
+        s->es_bits[bit >> 6] |= 1ULL << (bit & 63);
+    }
+}
+
+static int
+entry_summary_has(const struct slapi_entry_summary *s, uint64_t hash)
+{
+    for (uint32_t i = 0; i < ENTRY_SUMMARY_PROBES; i++) {
+        uint32_t bit = ENTRY_SUMMARY_BIT(hash, i, s->es_mask);
+        if (!(s->es_bits[bit >> 6] & (1ULL << (bit & 63)))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Build the summary of an entry, if it has none yet.
+ * The entry must not be shared yet: call it before adding the entry to a cache.
+ */
+void
+entry_summary_build(Slapi_Entry *e)
+{
+    Slapi_PBlock *pb = NULL;
+    struct slapi_entry_summary *s = NULL;
+    uint64_t *hashes = NULL;
+    size_t nhashes = 0;
+    size_t nbits = 64;
+
+    if (e == NULL || e->e_summary != NULL) {
+        return;
+    }
+    pb = slapi_pblock_new();
+    hashes = (uint64_t *)slapi_ch_malloc(ENTRY_SUMMARY_MAX_KEYS * sizeof(uint64_t));
+    for (Slapi_Attr *a = e->e_attrs; a != NULL; a = a->a_next) {
+        Slapi_Value **va = valueset_get_valuearray(&a->a_present_values);
+        Slapi_Value **keys = NULL;
+        uint64_t typehash;
+        size_t i;
+
+        if (va == NULL || va[0] == NULL) {
+            continue;
+        }
+        if (slapi_attr_values2keys_sv_pb(a, va, &keys, LDAP_FILTER_EQUALITY, pb) != 0 || keys == NULL) {
+            /* The assertions on this type could not be checked */
+            valuearray_free(&keys);
+            goto done;
+        }
+        typehash = entry_summary_hash_type(a->a_type);
+        for (i = 0; keys[i] && nhashes < ENTRY_SUMMARY_MAX_KEYS; i++) {
+            hashes[nhashes++] = entry_summary_hash_key(typehash, slapi_value_get_berval(keys[i]));
+        }
+        if (keys[i]) {
+            valuearray_free(&keys);
+            goto done;
+        }
+        valuearray_free(&keys);
+    }
+
+    while (nbits < nhashes * ENTRY_SUMMARY_BITS_PER_KEY) {
+        nbits <<= 1;
+    }
+    s = (struct slapi_entry_summary *)slapi_ch_calloc(1, sizeof(struct slapi_entry_summary) + nbits / 8);
+    s->es_mask = nbits - 1;
+    for (size_t i = 0; i < nhashes; i++) {
+        entry_summary_set(s, hashes[i]);
+    }
+    e->e_summary = s;
+
+done:
+    slapi_ch_free((void **)&hashes);
+    slapi_pblock_destroy(pb);
+}
+
+void
+entry_summary_free(Slapi_Entry *e)
+{
+    slapi_ch_free((void **)&e->e_summary);
+}
+
+size_t
+entry_summary_size(const Slapi_Entry *e)
+{
+    if (e->e_summary == NULL) {
+        return 0;
+    }
+    return sizeof(struct slapi_entry_summary) + (e->e_summary->es_mask + 1) / 8;
+}
+
+/*
+ * Returns the hash to store in ava_summary for an equality assertion,
+ * 0 if the summaries can not be used for it. The assertion value may be
+ * normalized already. attr is an attribute initialized with the type of
+ * the assertion, or NULL.
+ */
+uint64_t
+entry_summary_ava_hash(const struct ava *ava, const Slapi_Attr *attr)
+{
+    Slapi_Attr *a = NULL;
+    Slapi_Value **keys = NULL;
+    Slapi_Value sv;
+    uint64_t hash = 0;
+
+    /* The subtypes do not match all the values of the base type */
+    if (ava->ava_type == NULL || strchr(ava->ava_type, ';')) {
+        return 0;
+    }
+    if (attr == NULL) {
+        a = slapi_attr_new();
+        slapi_attr_init(a, ava->ava_type);
+        attr = a;
+    }
+    slapi_value_init_berval(&sv, (struct berval *)&ava->ava_value);
+    if (slapi_attr_assertion2keys_ava_sv(attr, &sv, &keys, LDAP_FILTER_EQUALITY) == 0 &&
+        keys && keys[0] && !keys[1]) {
+        hash = entry_summary_hash_key(entry_summary_hash_type(ava->ava_type),
+                                      slapi_value_get_berval(keys[0]));
+    }
+    valuearray_free(&keys);
+    value_done(&sv);
+    slapi_attr_free(&a);
+    return hash;
+}
+
+/*
+ * Returns 1 if no attribute of attrs can match the assertion: attrs is the
+ * attribute list of e and the summary of e does not hold the assertion.
+ */
+int
+entry_summary_reject(const Slapi_Entry *e, const Slapi_Attr *attrs, const struct ava *ava)
+{
+    return ava->ava_summary && e && e->e_summary && attrs == e->e_attrs &&
+           !entry_summary_has(e->e_summary, ava->ava_summary);
+}
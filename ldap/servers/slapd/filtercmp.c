@@ -66,6 +66,7 @@ get_normalized_value(const Slapi_Attr *sattr, struct ava *ava)
 
     sv.bv = ava->ava_value;
     sv.v_csnset = NULL;
+    sv.v_norm = NULL;
     sv.v_flags = 0;
     svlist[0] = &sv;
     svlist[1] = NULL;
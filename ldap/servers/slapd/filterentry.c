@@ -239,6 +239,45 @@ slapi_filter_test_ext(
     return rc;
 }
 
+/*
+ * Returns non-zero if the attribute a is type or one of its subtypes.
+ * typeid is the interned id of type (attr_typeid_get): if both types
+ * are interned neither has options, so the ids are enough.
+ */
+static inline int
+filter_type_matches(const char *type, uint32_t typeid, const Slapi_Attr *a)
+{
+    if (typeid && a->a_typeid) {
+        return typeid == a->a_typeid;
+    }
+    return slapi_attr_type_cmp(type, a->a_type, SLAPI_TYPE_CMP_SUBTYPE) == 0;
+}
+
+/*
+ * Returns 0 if a value of the attributes a of e matches the assertion.
+ * The equality assertions of the backend searches are first looked up
+ * in the summary of the entry (see entrysummary.c).
+ */
+static int
+filter_ava_test_attrs(Slapi_Entry *e, Slapi_Attr *a, struct ava *ava, int ftype)
+{
+    uint32_t typeid;
+    int rc = -1;
+
+    if (ftype == LDAP_FILTER_EQUALITY && entry_summary_reject(e, a, ava)) {
+        return rc;
+    }
+    typeid = attr_typeid_get(ava->ava_type);
+    for (; a != NULL; a = a->a_next) {
+        if (filter_type_matches(ava->ava_type, typeid, a)) {
+            rc = plugin_call_syntax_filter_ava(a, ftype, ava);
+            if (rc == 0) {
+                break;
+            }
+        }
+    }
+    return rc;
+}
 
 int
 test_ava_filter(
@@ -261,15 +300,7 @@ test_ava_filter(
         rc = 0;
 
         if (!only_check_access) {
-            rc = -1;
-            for (; a != NULL; a = a->a_next) {
-                if (slapi_attr_type_cmp(ava->ava_type, a->a_type, SLAPI_TYPE_CMP_SUBTYPE) == 0) {
-                    rc = plugin_call_syntax_filter_ava(a, ftype, ava);
-                    if (rc == 0) {
-                        break;
-                    }
-                }
-            }
+            rc = filter_ava_test_attrs(e, a, ava, ftype);
         }
 
         if (rc == 0 && verify_access && pb != NULL) {
@@ -293,15 +324,7 @@ test_ava_filter(
             }
         }
 
-        rc = -1;
-        for (; a != NULL; a = a->a_next) {
-            if (slapi_attr_type_cmp(ava->ava_type, a->a_type, SLAPI_TYPE_CMP_SUBTYPE) == 0) {
-                rc = plugin_call_syntax_filter_ava(a, ftype, ava);
-                if (rc == 0) {
-                    break;
-                }
-            }
-        }
+        rc = filter_ava_test_attrs(e, a, ava, ftype);
     }
 
     slapi_log_err(SLAPI_LOG_FILTER, "test_ava_filter", "<= %d\n", rc);
@@ -447,6 +470,7 @@ test_extensible_filter(
                 a.ava_value.bv_len = mrf->mrf_value.bv_len;
                 a.ava_value.bv_val = mrf->mrf_value.bv_val;
                 a.ava_private = NULL;
+                a.ava_summary = 0;
                 rc = test_ava_filter(callers_pb, e, e->e_attrs, &a, LDAP_FILTER_EQUALITY, 0 /* Don't Verify Access */, 0 /* don't just verify access */, access_check_done);
                 if (rc != LDAP_SUCCESS && mrf->mrf_dnAttrs) {
                     /* B) Also check the DN attributes for the attribute value */
@@ -506,6 +530,7 @@ test_extensible_filter(
                 a.ava_value.bv_len = mrf->mrf_value.bv_len;
                 a.ava_value.bv_val = mrf->mrf_value.bv_val;
                 a.ava_private = NULL;
+                a.ava_summary = 0;
                 rc = test_ava_filter(callers_pb, e, e->e_attrs, &a, LDAP_FILTER_EQUALITY, 0 /* Don't Verify Access */, 0 /* don't just verify access */, access_check_done);
                 if (rc != LDAP_SUCCESS && mrf->mrf_dnAttrs) {
                     /* B) Also check the DN attributes for the attribute value */
@@ -630,6 +655,7 @@ test_substring_filter(
 {
     Slapi_Attr *a;
     int rc;
+    uint32_t typeid = attr_typeid_get(f->f_sub_type);
 
     slapi_log_err(SLAPI_LOG_FILTER, "test_substring_filter", "<=\n");
 
@@ -641,7 +667,7 @@ test_substring_filter(
         if (!only_check_access) {
             rc = -1;
             for (a = e->e_attrs; a != NULL; a = a->a_next) {
-                if (slapi_attr_type_cmp(f->f_sub_type, a->a_type, SLAPI_TYPE_CMP_SUBTYPE) == 0) {
+                if (filter_type_matches(f->f_sub_type, typeid, a)) {
                     rc = plugin_call_syntax_filter_sub(pb, a, &f->f_sub);
                     if (rc == 0) {
                         break;
@@ -672,7 +698,7 @@ test_substring_filter(
 
         rc = -1;
         for (a = e->e_attrs; a != NULL; a = a->a_next) {
-            if (slapi_attr_type_cmp(f->f_sub_type, a->a_type, SLAPI_TYPE_CMP_SUBTYPE) == 0) {
+            if (filter_type_matches(f->f_sub_type, typeid, a)) {
                 rc = plugin_call_syntax_filter_sub(pb, a, &f->f_sub);
                 if (rc == 0 || rc == LDAP_TIMELIMIT_EXCEEDED) {
                     break;
@@ -943,6 +969,33 @@ test_filter_access(Slapi_PBlock *pb,
     return (rc);
 }
 
+/*
+ * Returns 1 if an equality component of the AND filter flist is false
+ * according to the summary of e: the AND is false, whatever the other
+ * components are. The access to the attribute of the component must be
+ * granted for it to be false rather than undefined.
+ * The backend only sets ava_summary on the components on stored types.
+ */
+static int
+vattr_test_filter_list_summary(Slapi_PBlock *pb, Slapi_Entry *e, struct slapi_filter *flist, int verify_access, int *access_check_done)
+{
+    if (e == NULL || e->e_summary == NULL) {
+        return 0;
+    }
+    for (struct slapi_filter *f = flist; f != NULL; f = f->f_next) {
+        if (f->f_choice == LDAP_FILTER_EQUALITY && entry_summary_reject(e, e->e_attrs, &f->f_ava)) {
+            if (!verify_access) {
+                return 1;
+            }
+            if (test_filter_access(pb, e, f->f_ava.ava_type, &f->f_ava.ava_value) == LDAP_SUCCESS) {
+                *access_check_done = 1;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
 static int
 vattr_test_filter_list_and(
     Slapi_PBlock *pb,
@@ -960,6 +1013,11 @@ vattr_test_filter_list_and(
 
     slapi_log_err(SLAPI_LOG_FILTER, "vattr_test_filter_list_and", "=>\n");
 
+    if (!only_check_access && vattr_test_filter_list_summary(pb, e, flist, verify_access, access_check_done)) {
+        slapi_log_err(SLAPI_LOG_FILTER, "vattr_test_filter_list_and", "<= -1 (entry summary)\n");
+        return -1;
+    }
+
     for (f = flist; f != NULL; f = f->f_next) {
         rc = slapi_vattr_filter_test_ext_internal(pb, e, f, verify_access, only_check_access, access_check_done);
         if (rc > 0) {
@@ -89,6 +89,7 @@ struct main_config
     char **db2index_attrs;
     int ldif_printkey;
     char *archive_name;
+    int archive_compact;
     int db2ldif_dump_replica;
     int db2ldif_dump_uniqueid;
     int ldif_include_changelog;
@@ -358,10 +359,10 @@ usage(char *name, char *extraname, int slapd_exemode)
                    "Note: either \"-n backend_instance_name\" or \"-s includesuffix\" is required.\n";
         break;
     case SLAPD_EXEMODE_DB2ARCHIVE:
-        usagestr = "usage: %s %s%s-D configdir [-q] [-d debuglevel] -a archivedir\n";
+        usagestr = "usage: %s %s%s-D configdir [-q] [-d debuglevel] [-C] -a archivedir|-\n";
         break;
     case SLAPD_EXEMODE_ARCHIVE2DB:
-        usagestr = "usage: %s %s%s-D configdir [-q] [-d debuglevel] -a archivedir\n";
+        usagestr = "usage: %s %s%s-D configdir [-q] [-d debuglevel] -a archivedir|-\n";
         break;
     case SLAPD_EXEMODE_DB2INDEX:
         usagestr = "usage: %s %s%s-D configdir -n backend-instance-name "
@@ -1277,7 +1278,7 @@ process_command_line(int argc, char **argv, struct main_config *mcfg)
         {0, 0, 0}};
 
 
-    char *opts_db2archive = "vd:i:a:SD:qV";
+    char *opts_db2archive = "vd:i:a:SD:qVC";
     struct opt_ext long_options_db2archive[] = {
         {"version", ArgNone, 'v'},
         {"debug", ArgRequired, 'd'},
@@ -1287,6 +1288,7 @@ process_command_line(int argc, char **argv, struct main_config *mcfg)
         {"configDir", ArgRequired, 'D'},
         {"quiet", ArgNone, 'q'},
         {"verbose", ArgNone, 'V'},
+        {"compact", ArgNone, 'C'},
         {0, 0, 0}};
 
     char *opts_db2index = "vd:a:t:T:SD:n:s:x:";
@@ -1667,6 +1669,11 @@ process_command_line(int argc, char **argv, struct main_config *mcfg)
                 mcfg->ldif_printkey |= EXPORT_ID2ENTRY_ONLY;
                 break;
             }
+            if (mcfg->slapd_exemode == SLAPD_EXEMODE_DB2ARCHIVE) {
+                /* compact the database of a streamed backup */
+                mcfg->archive_compact = 1;
+                break;
+            }
             usage(mcfg->myname, mcfg->extraname, mcfg->slapd_exemode);
             exit(1);
 
@@ -2491,6 +2498,7 @@ slapd_exemode_db2archive(struct main_config *mcfg)
     slapi_pblock_set(pb, SLAPI_BACKEND, NULL);
     slapi_pblock_set(pb, SLAPI_PLUGIN, backend_plugin);
     slapi_pblock_set(pb, SLAPI_SEQ_VAL, mcfg->archive_name);
+    slapi_pblock_set(pb, SLAPI_DB2ARCHIVE_COMPACT, &(mcfg->archive_compact));
     int32_t task_flags = SLAPI_TASK_RUNNING_FROM_COMMANDLINE;
     slapi_pblock_set(pb, SLAPI_TASK_FLAGS, &task_flags);
     return_value = (backend_plugin->plg_db2archive)(pb);
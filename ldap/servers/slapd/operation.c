@@ -164,6 +164,7 @@ operation_init(Slapi_Operation *o, int flags)
         o->o_flags = flags;
         o->o_reverse_search_state = 0;
         o->o_pagedresults_sizelimit = -1;
+        o->o_pagedresults_pagesize = -1;
     }
 }
 
@@ -173,6 +173,7 @@ pagedresults_parse_control_value(Slapi_PBlock *pb,
     }
     /* reset sizelimit */
     op->o_pagedresults_sizelimit = -1;
+    op->o_pagedresults_pagesize = *pagesize;
 
     if ((*index > -1) && (*index < conn->c_pagedresults.prl_maxlen)) {
         if (conn->c_pagedresults.prl_list[*index].pr_flags & CONN_FLAG_PAGEDRESULTS_ABANDONED) {
@@ -724,6 +725,19 @@ pagedresults_get_sizelimit(Connection *conn __attribute__((unused)), Operation *
     return sizelimit;
 }
 
+int
+pagedresults_get_pagesize(Connection *conn __attribute__((unused)), Operation *op, int index)
+{
+    int pagesize = -1;
+    if (!op_is_pagedresults(op)) {
+        return pagesize; /* noop */
+    }
+    slapi_log_err(SLAPI_LOG_TRACE, "pagedresults_get_pagesize", "=> idx=%d\n", index);
+    pagesize = op->o_pagedresults_pagesize;
+    slapi_log_err(SLAPI_LOG_TRACE, "pagedresults_get_pagesize", "<=\n");
+    return pagesize;
+}
+
 /*
  * pagedresults_cleanup cleans up the pagedresults list;
  * it does not free the list.
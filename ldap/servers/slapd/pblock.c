@@ -2106,6 +2106,21 @@ slapi_pblock_get(Slapi_PBlock *pblock, int arg, void *value)
         }
         break;
 
+    case SLAPI_DB2ARCHIVE_BASE:
+        if (pblock->pb_task != NULL) {
+            (*(char **)value) = pblock->pb_task->archive_base;
+        } else {
+            (*(char **)value) = NULL;
+        }
+        break;
+    case SLAPI_DB2ARCHIVE_COMPACT:
+        if (pblock->pb_task != NULL) {
+            (*(int *)value) = pblock->pb_task->archive_compact;
+        } else {
+            (*(int *)value) = 0;
+        }
+        break;
+
     /* dbverify */
     case SLAPI_DBVERIFY_DBDIR:
         if (pblock->pb_task != NULL) {
@@ -3910,6 +3925,14 @@ slapi_pblock_set(Slapi_PBlock *pblock, int arg, void *value)
         _pblock_assert_pb_task(pblock);
         pblock->pb_task->ldif_encrypt = *((int *)value);
         break;
+    case SLAPI_DB2ARCHIVE_BASE:
+        _pblock_assert_pb_task(pblock);
+        pblock->pb_task->archive_base = (char *)value;
+        break;
+    case SLAPI_DB2ARCHIVE_COMPACT:
+        _pblock_assert_pb_task(pblock);
+        pblock->pb_task->archive_compact = *((int *)value);
+        break;
     /* dbverify */
     case SLAPI_DBVERIFY_DBDIR:
         _pblock_assert_pb_task(pblock);
@@ -45,6 +45,7 @@ typedef struct _slapi_pblock_task
     Slapi_Task *task;
     char *seq_attrname;
     char *seq_val;
+    char *archive_base;
     char *dbverify_dbdir;
     char *ldif_file;
     char **db2index_attrs;
@@ -63,6 +64,7 @@ typedef struct _slapi_pblock_task
     int ldif_include_changelog;     /* include changelog for import/export */
     int ldif_generate_uniqueid; /* generate uniqueid during db2ldif */
     int ldif_encrypt;           /* used to enable encrypt/decrypt on import and export */
+    int archive_compact;        /* compact the database in a streamed backup */
     int seq_type;
     int removedupvals;
     int ldif2db_noattrindexes;
@@ -101,7 +103,8 @@ typedef struct _slapi_pblock_intplugin
 
     void *pb_syntax_filter_data; /* extra data to pass to a syntax plugin function */
     int *pb_substrlens;          /* user specified minimum substr search key lengths:
-                             * nsSubStrBegin, nsSubStrMiddle, nsSubStrEnd
+                             * nsSubStrBegin, nsSubStrMiddle, nsSubStrEnd,
+                             * nsSubStrPrefix
                              */
     char *pb_slapd_configdir;    /* the config directory passed to slapd on the command line */
     IFP pb_destroy_fn;
@@ -435,6 +435,13 @@ plugin_call_entrystore_plugins(char **entrystr, uint *size)
     }
 }
 
+/* Tell whether some entry fetch plugins are registered */
+int
+plugin_has_entryfetch_plugins(void)
+{
+    return global_plugin_list[PLUGIN_LIST_LDBM_ENTRY_FETCH_STORE] != NULL;
+}
+
 void
 plugin_call_entryfetch_plugins(char **entrystr, uint *size)
 {
@@ -115,6 +115,10 @@ void attr_syntax_return(struct asyntaxinfo *asi);
 void attr_syntax_return_locking_optional(struct asyntaxinfo *asi, PRBool use_lock);
 void attr_syntax_delete_all(void);
 void attr_syntax_delete_all_for_schemareload(unsigned long flag);
+uint32_t attr_typeid_intern(const char *name);
+uint32_t attr_typeid_get(const char *type);
+const char *attr_typeid_name(uint32_t typeid);
+uint64_t attr_syntax_generation(void);
 
 /*
  * value.c
@@ -955,6 +959,7 @@ struct slapdplugin *plugin_get_pwd_storage_scheme(char *name, int len, int index
 char *plugin_get_pwd_storage_scheme_list(int index);
 int plugin_add_descriptive_attributes(Slapi_Entry *e,
                                       struct slapdplugin *plugin);
+int plugin_has_entryfetch_plugins(void);
 void plugin_call_entryfetch_plugins(char **entrystr, uint *size);
 void plugin_call_entrystore_plugins(char **entrystr, uint *size);
 void plugin_print_versions(void);
@@ -1573,6 +1578,7 @@ int pagedresults_set_sort_result_code(Connection *conn, Operation *op, int code,
 int pagedresults_set_timelimit(Connection *conn, Operation *op, time_t timelimit, int index);
 int pagedresults_get_sizelimit(Connection *conn, Operation *op, int index);
 int pagedresults_set_sizelimit(Connection *conn, Operation *op, int sizelimit, int index);
+int pagedresults_get_pagesize(Connection *conn, Operation *op, int index);
 int pagedresults_cleanup(Connection *conn, int needlock);
 int pagedresults_is_timedout_nolock(Connection *conn);
 int pagedresults_reset_timedout_nolock(Connection *conn);
@@ -256,3 +256,127 @@ slapi_re_free(Slapi_Regex *re_handle)
         slapi_ch_free((void **)&re_handle);
     }
 }
+
+/*
+ * Substring assertions.
+ *
+ * A substring filter (initial*any*...*final) only needs plain byte
+ * comparisons: the initial component at the start of the value, each any
+ * component found after the previous one, and the final component at the
+ * end, not overlapping the any components.  Finding each any component at
+ * its leftmost position never misses a match, so memmem (vectorized by the
+ * C library) is enough and no regular expression is involved.
+ */
+struct slapi_substring
+{
+    char *ss_initial;
+    size_t ss_initial_len;
+    char **ss_any;
+    size_t *ss_any_len;
+    int ss_nany;
+    char *ss_final;
+    size_t ss_final_len;
+};
+
+/**
+ * Compiles a substring assertion.
+ *
+ * \param initial The initial component, or NULL.
+ * \param any The NULL terminated array of the any components, or NULL.
+ * \param final The final component, or NULL.
+ * \return The compiled assertion, to be released by slapi_substring_free().
+ * \warning The components must be normalized like the values they are
+ * matched against.
+ */
+Slapi_Substring *
+slapi_substring_comp(const char *initial, char **any, const char *final)
+{
+    Slapi_Substring *ss = (Slapi_Substring *)slapi_ch_calloc(1, sizeof(Slapi_Substring));
+    int i;
+
+    if (initial) {
+        ss->ss_initial = slapi_ch_strdup(initial);
+        ss->ss_initial_len = strlen(initial);
+    }
+    for (i = 0; any && any[i]; i++)
+        ;
+    if (i > 0) {
+        ss->ss_nany = i;
+        ss->ss_any = (char **)slapi_ch_calloc(i, sizeof(char *));
+        ss->ss_any_len = (size_t *)slapi_ch_calloc(i, sizeof(size_t));
+        for (i = 0; i < ss->ss_nany; i++) {
+            ss->ss_any[i] = slapi_ch_strdup(any[i]);
+            ss->ss_any_len[i] = strlen(any[i]);
+        }
+    }
+    if (final) {
+        ss->ss_final = slapi_ch_strdup(final);
+        ss->ss_final_len = strlen(final);
+    }
+    return ss;
+}
+
+/**
+ * Matches a compiled substring assertion against a value.
+ *
+ * \param ss The assertion returned from slapi_substring_comp.
+ * \param value The value, normalized like the assertion.
+ * \param len The length of the value.
+ * \return 1 if the value matches, 0 if it does not.
+ */
+int
+slapi_substring_exec(const Slapi_Substring *ss, const char *value, size_t len)
+{
+    size_t pos = 0;
+    int i;
+
+    if (ss->ss_initial) {
+        if (len < ss->ss_initial_len || memcmp(value, ss->ss_initial, ss->ss_initial_len) != 0) {
+            return 0;
+        }
+        pos = ss->ss_initial_len;
+    }
+    for (i = 0; i < ss->ss_nany; i++) {
+        const char *found = NULL;
+
+        if (ss->ss_any_len[i] == 0) {
+            continue;
+        }
+        found = memmem(value + pos, len - pos, ss->ss_any[i], ss->ss_any_len[i]);
+        if (found == NULL) {
+            return 0;
+        }
+        pos = (found - value) + ss->ss_any_len[i];
+    }
+    if (ss->ss_final) {
+        if (len - pos < ss->ss_final_len ||
+            memcmp(value + len - ss->ss_final_len, ss->ss_final, ss->ss_final_len) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Releases a compiled substring assertion.
+ *
+ * \param ss The assertion returned from slapi_substring_comp.
+ * \return nothing
+ */
+void
+slapi_substring_free(Slapi_Substring **ss)
+{
+    int i;
+
+    if (ss == NULL || *ss == NULL) {
+        return;
+    }
+    slapi_ch_free_string(&(*ss)->ss_initial);
+    for (i = 0; i < (*ss)->ss_nany; i++) {
+        slapi_ch_free_string(&(*ss)->ss_any[i]);
+    }
+    slapi_ch_free((void **)&(*ss)->ss_any);
+    slapi_ch_free((void **)&(*ss)->ss_any_len);
+    slapi_ch_free_string(&(*ss)->ss_final);
+    slapi_ch_free((void **)ss);
+}
@@ -568,6 +568,7 @@ struct slapi_value
     struct berval bv;
     CSNSet *v_csnset;
     unsigned long v_flags;
+    struct slapi_value_norm *v_norm; /* cached normalized value, see value_get_norm() */
 };
 
 /*
@@ -632,6 +633,7 @@ struct slapi_attr
     struct slapdplugin *a_mr_eq_plugin;  /* for the attribute EQUALITY matching rule, if any */
     struct slapdplugin *a_mr_ord_plugin; /* for the attribute ORDERING matching rule, if any */
     struct slapdplugin *a_mr_sub_plugin; /* for the attribute SUBSTRING matching rule, if any */
+    uint32_t a_typeid;                   /* interned id of a_type (see attr_typeid_get), 0 if none */
 };
 
 typedef struct oid_item
@@ -671,6 +673,7 @@ typedef struct asyntaxinfo
     struct slapdplugin *asi_mr_eq_plugin;  /* EQUALITY matching rule plugin */
     struct slapdplugin *asi_mr_sub_plugin; /* SUBSTR matching rule plugin */
     struct slapdplugin *asi_mr_ord_plugin; /* ORDERING matching rule plugin */
+    uint32_t asi_typeid;                   /* interned id of asi_name */
     struct asyntaxinfo *asi_next;
     struct asyntaxinfo *asi_prev;
 } asyntaxinfo;
@@ -826,6 +829,7 @@ struct slapi_entry
                                     to global watermark */
     Slapi_RWLock *e_virtual_lock; /* for access to cached vattrs */
     void *e_extension;            /* A list of entry object extensions */
+    struct slapi_entry_summary *e_summary; /* equality summary, see entrysummary.c */
     unsigned char e_flags;
     Slapi_Attr *e_aux_attrs; /* Attr list used for upgrade */
 };
@@ -1596,6 +1600,7 @@ typedef struct op
     struct slapi_operation_parameters o_params;
     struct slapi_operation_results o_results;
     int o_pagedresults_sizelimit;
+    int o_pagedresults_pagesize;
     int o_reverse_search_state;
 } Operation;
 
@@ -1887,7 +1892,8 @@ void slapi_pblock_set_op_stack_elem(Slapi_PBlock *pb, void *stack_elem);
 #define INDEX_SUBSTRBEGIN  0
 #define INDEX_SUBSTRMIDDLE 1
 #define INDEX_SUBSTREND    2
-#define INDEX_SUBSTRLEN    3 /* size of the substrlens */
+#define INDEX_SUBSTRPREFIX 3
+#define INDEX_SUBSTRLEN    4 /* size of the substrlens */
 
 /* The referral element */
 typedef struct ref
@@ -2344,6 +2344,16 @@ int slapi_entry_apply_mod_extension(Slapi_Entry *e, const LDAPMod *mod, int modc
  */
 void slapi_entrycache_vattrcache_watermark_invalidate(void);
 
+/**
+ * Get the current virtual attribute cache watermark.
+ *
+ * Providers keeping their own cache of computed values can record
+ * this value and treat their cache as stale once it changes.
+ *
+ * \return The current global watermark (never \c 0 once invalidated).
+ */
+int32_t slapi_entrycache_vattrcache_watermark_get(void);
+
 
 /*
  * Slapi_DN routines
@@ -7475,6 +7485,10 @@ typedef enum _slapi_op_note_t {
 #define SLAPI_BACKEND_INSTANCE_NAME 178
 #define SLAPI_BACKEND_TASK          179
 #define SLAPI_TASK_FLAGS            181
+/* db2bak: previous backup an incremental backup is based on */
+#define SLAPI_DB2ARCHIVE_BASE       1762
+/* db2bak: compact the database when streaming it */
+#define SLAPI_DB2ARCHIVE_COMPACT    1763
 
 /* bulk import (online wire import) */
 #define SLAPI_BULK_IMPORT_ENTRY 182
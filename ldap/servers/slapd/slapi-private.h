@@ -59,6 +59,8 @@ typedef enum _slapi_filter_flags_t {
     SLAPI_FILTER_NORMALIZED_VALUE = 16,
     SLAPI_FILTER_INVALID_ATTR_UNDEFINE = 32,
     SLAPI_FILTER_INVALID_ATTR_WARN = 64,
+    SLAPI_FILTER_VIRTUAL_CANDIDATES = 128, /* candidates were supplied by a vattr provider */
+    SLAPI_FILTER_REALATTRS_ONLY = 256,     /* do not ask vattr providers for candidates */
 } slapi_filter_flags;
 
 #define SLAPI_ENTRY_LDAPSUBENTRY 2
@@ -368,6 +370,8 @@ const CSNSet *value_get_csnset(const Slapi_Value *value);
 Slapi_Value *value_remove_csn(Slapi_Value *value, CSNType t);
 int value_contains_csn(const Slapi_Value *value, CSN *csn);
 int value_dn_normalize_value(Slapi_Value *value);
+const struct berval *value_get_norm(Slapi_Value *value, int key);
+const struct berval *value_set_norm(Slapi_Value *value, int key, const char *norm, size_t len);
 
 /* dn.c */
 /* this functions should only be used for dns allocated on the stack */
@@ -394,6 +398,12 @@ int filter_flag_is_set(const Slapi_Filter *f, unsigned char flag);
 char *slapi_filter_to_string(const Slapi_Filter *f, char *buffer, size_t bufsize);
 char *slapi_filter_to_string_internal(const struct slapi_filter *f, char *buf, size_t *bufsize);
 
+/* regex.c */
+typedef struct slapi_substring Slapi_Substring;
+Slapi_Substring *slapi_substring_comp(const char *initial, char **any, const char *final);
+int slapi_substring_exec(const Slapi_Substring *ss, const char *value, size_t len);
+void slapi_substring_free(Slapi_Substring **ss);
+
 /* operation.c */
 
 #define OP_FLAG_PS 0x000001
@@ -488,6 +498,7 @@ struct ava
     char *ava_type;
     struct berval ava_value; /* JCM SLAPI_VALUE! */
     void *ava_private;       /* data private to syntax handler */
+    uint64_t ava_summary;    /* hash of the assertion in the entry summaries, 0 if none */
 };
 
 typedef enum {
@@ -496,6 +507,13 @@ typedef enum {
     FILTER_TYPE_PRES
 } filter_type_t;
 
+/* entrysummary.c */
+void entry_summary_build(Slapi_Entry *e);
+void entry_summary_free(Slapi_Entry *e);
+size_t entry_summary_size(const Slapi_Entry *e);
+uint64_t entry_summary_ava_hash(const struct ava *ava, const Slapi_Attr *attr);
+int entry_summary_reject(const Slapi_Entry *e, const Slapi_Attr *attrs, const struct ava *ava);
+
 /*
  * vattr entry routines.
  * vattrcache private (for the moment)
@@ -525,6 +543,8 @@ int vattr_test_filter(Slapi_PBlock *pb,
                       Slapi_Filter *f,
                       filter_type_t filter_type,
                       char *type);
+int slapi_vattr_filter_candidates(Slapi_PBlock *pb, const Slapi_DN *namespace_dn, Slapi_Filter *f, Slapi_Filter **candidate_filter);
+int vattr_type_is_virtual(const Slapi_DN *namespace_dn, const char *type);
 
 /* filter routines */
 
@@ -1214,6 +1234,8 @@ struct slapi_td_log_op_state_t * slapi_td_get_log_op_state(void);
 void slapi_td_internal_op_start(void);
 void slapi_td_internal_op_finish(void);
 void slapi_td_reset_internal_logging(uint64_t conn_id, int32_t op_id);
+void slapi_td_set_norm_size(size_t *size);
+void slapi_td_add_norm_size(size_t size);
 
 /*  Thread Local Storage Index Types - thread_data.c */
 
@@ -1502,8 +1502,11 @@ task_backup_thread(void *arg)
 
     slapi_task_finish(task, rv);
     char *seq_val = NULL;
+    char *archive_base = NULL;
     slapi_pblock_get(pb, SLAPI_SEQ_VAL, &seq_val);
+    slapi_pblock_get(pb, SLAPI_DB2ARCHIVE_BASE, &archive_base);
     slapi_ch_free((void **)&seq_val);
+    slapi_ch_free_string(&archive_base);
     slapi_pblock_destroy(pb);
     g_decr_active_threadcnt();
 }
@@ -1591,6 +1594,12 @@ task_backup_add(Slapi_PBlock *pb __attribute__((unused)),
     }
     char *seq_val = slapi_ch_strdup(archive_dir);
     slapi_pblock_set(mypb, SLAPI_SEQ_VAL, seq_val);
+    /* optional: only back up what changed since this previous backup */
+    char *archive_base = slapi_ch_strdup(slapi_entry_attr_get_ref(e, "nsBackupBase"));
+    slapi_pblock_set(mypb, SLAPI_DB2ARCHIVE_BASE, archive_base);
+    /* compaction of the database when the backup is streamed */
+    int archive_compact = slapi_entry_attr_get_bool(e, "nsBackupCompact");
+    slapi_pblock_set(mypb, SLAPI_DB2ARCHIVE_COMPACT, &archive_compact);
     slapi_pblock_set(mypb, SLAPI_PLUGIN, (be->be_database));
     slapi_pblock_set(mypb, SLAPI_BACKEND_TASK, task);
     int32_t task_flags = SLAPI_TASK_RUNNING_AS_TASK;
@@ -1606,6 +1615,7 @@ task_backup_add(Slapi_PBlock *pb __attribute__((unused)),
         *returncode = LDAP_OPERATIONS_ERROR;
         rv = SLAPI_DSE_CALLBACK_ERROR;
         slapi_ch_free((void **)&seq_val);
+        slapi_ch_free_string(&archive_base);
         slapi_pblock_destroy(mypb);
         goto out;
     }
@@ -18,6 +18,8 @@
 static pthread_key_t td_requestor_dn; /* TD_REQUESTOR_DN */
 static pthread_key_t td_plugin_list;  /* SLAPI_TD_PLUGIN_LIST_LOCK - integer set to 1 or zero */
 static pthread_key_t td_op_state;
+static pthread_key_t td_norm_size; /* size_t counting the normalized values stored, see value_set_norm */
+static int td_norm_size_created;
 
 /*
  *   Destructor Functions
@@ -52,6 +54,12 @@ slapi_td_init(void)
         return PR_FAILURE;
     }
 
+    if (pthread_key_create(&td_norm_size, NULL) != 0) {
+        slapi_log_err(SLAPI_LOG_CRIT, "slapi_td_init", "Failed it create private thread index for td_norm_size\n");
+        return PR_FAILURE;
+    }
+    td_norm_size_created = 1;
+
     return PR_SUCCESS;
 }
 
@@ -115,6 +123,28 @@ slapi_td_get_dn(char **value)
     }
 }
 
+/*
+ * Normalized values: count in *size the memory of the normalized values
+ * the thread stores with their values until it is called with NULL.
+ */
+void
+slapi_td_set_norm_size(size_t *size)
+{
+    if (td_norm_size_created) {
+        pthread_setspecific(td_norm_size, size);
+    }
+}
+
+void
+slapi_td_add_norm_size(size_t size)
+{
+    size_t *total = td_norm_size_created ? pthread_getspecific(td_norm_size) : NULL;
+
+    if (total) {
+        *total += size;
+    }
+}
+
 /* Worker op-state */
 struct slapi_td_log_op_state_t *
 slapi_td_get_log_op_state() {
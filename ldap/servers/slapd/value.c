@@ -79,6 +79,47 @@ PR_DEFINE_COUNTER(slapi_value_counter_created);
 PR_DEFINE_COUNTER(slapi_value_counter_deleted);
 PR_DEFINE_COUNTER(slapi_value_counter_exist);
 
+/*
+ * The normalized form of a value, as computed by a syntax plugin.
+ */
+struct slapi_value_norm
+{
+    int key;
+    struct berval bv;
+};
+
+/*
+ * v_norm of the values allocated by value_new, which can store their
+ * normalized form. The values initialized in place (on the stack...) have
+ * a NULL v_norm and do not store it, they may never be passed to value_done.
+ */
+static struct slapi_value_norm value_norm_empty;
+
+/*
+ * v_norm of the values whose normalized form is the value itself, for the
+ * keys up to VALUE_NORM_SAME_KEYS: these values take no memory. The other
+ * keys allocate a norm with a NULL bv_val.
+ */
+#define VALUE_NORM_SAME_KEYS 256
+static struct slapi_value_norm value_norm_same[VALUE_NORM_SAME_KEYS];
+
+static int
+value_norm_is_same(const struct slapi_value_norm *norm)
+{
+    return norm >= value_norm_same && norm < value_norm_same + VALUE_NORM_SAME_KEYS;
+}
+
+static void
+value_norm_done(Slapi_Value *v)
+{
+    if (v->v_norm != NULL && v->v_norm != &value_norm_empty) {
+        if (!value_norm_is_same(v->v_norm)) {
+            slapi_ch_free((void **)&v->v_norm);
+        }
+        v->v_norm = &value_norm_empty;
+    }
+}
+
 Slapi_Value *
 slapi_value_new()
 {
@@ -156,6 +197,7 @@ value_new(const struct berval *bval, CSNType t, const CSN *csn)
     Slapi_Value *v;
     v = (Slapi_Value *)slapi_ch_malloc(sizeof(Slapi_Value));
     value_init(v, bval, t, csn);
+    v->v_norm = &value_norm_empty;
     if (!counters_created) {
         PR_CREATE_COUNTER(slapi_value_counter_created, "Slapi_Value", "created", "");
         PR_CREATE_COUNTER(slapi_value_counter_deleted, "Slapi_Value", "deleted", "");
@@ -224,6 +266,7 @@ value_done(Slapi_Value *v)
         if (NULL != v->v_csnset) {
             csnset_free(&(v->v_csnset));
         }
+        value_norm_done(v);
         ber_bvdone(&v->bv);
     }
 }
@@ -317,6 +360,7 @@ Slapi_Value *
 slapi_value_set_berval(Slapi_Value *value, const struct berval *bval)
 {
     if (value != NULL) {
+        value_norm_done(value);
         ber_bvdone(&value->bv);
         if (bval != NULL) {
             ber_bvcpy(&value->bv, bval);
@@ -336,6 +380,7 @@ slapi_value_set_string_passin(Slapi_Value *value, char *strVal)
 {
     int rc = -1;
     if (NULL != value) {
+        value_norm_done(value);
         ber_bvdone(&value->bv);
         value->bv.bv_val = strVal;
         value->bv.bv_len = strlen(strVal);
@@ -350,6 +395,7 @@ slapi_value_set_int(Slapi_Value *value, int intVal)
     int rc = -1;
     if (NULL != value) {
         char valueBuf[80];
+        value_norm_done(value);
         ber_bvdone(&value->bv);
         sprintf(valueBuf, "%d", intVal);
         value->bv.bv_val = slapi_ch_strdup(valueBuf);
@@ -542,9 +588,91 @@ value_size(const Slapi_Value *v)
     size_t s = v->bv.bv_len;
     s += csnset_size(v->v_csnset);
     s += sizeof(Slapi_Value);
+    if (v->v_norm != NULL && v->v_norm != &value_norm_empty && !value_norm_is_same(v->v_norm)) {
+        s += sizeof(struct slapi_value_norm) + v->v_norm->bv.bv_len;
+    }
     return s;
 }
 
+/*
+ * The values of the entries in the entry cache are tested against
+ * the search filters again and again, so a syntax plugin can keep the
+ * normalized form of a value with it instead of normalizing it each time.
+ * key tells how the value was normalized (e.g. the syntax flags); a value
+ * keeps only the first normalized form stored. Only the values allocated
+ * with value_new (the values of the entries) can store it.
+ * The entries of the cache are read by several threads at the same time,
+ * so the normalized value is stored once and never changed until the value
+ * itself is changed or freed.
+ */
+
+/* Return the normalized value stored with key, or NULL */
+const struct berval *
+value_get_norm(Slapi_Value *value, int key)
+{
+    struct slapi_value_norm *norm = __atomic_load_n(&value->v_norm, __ATOMIC_ACQUIRE);
+
+    if (norm == NULL || norm == &value_norm_empty) {
+        return NULL;
+    }
+    if (value_norm_is_same(norm)) {
+        return (norm - value_norm_same == key) ? &value->bv : NULL;
+    }
+    if (norm->key != key) {
+        return NULL;
+    }
+    return norm->bv.bv_val ? &norm->bv : &value->bv;
+}
+
+/*
+ * Store a copy of the normalized value and return it, or NULL if the value
+ * cannot store it or already has a normalized form for another key.
+ * A normalized value equal to the value is not copied: the value only
+ * points to a shared marker of the key and the value itself is returned.
+ * The memory of the copies is counted with slapi_td_add_norm_size, for
+ * the entry cache.
+ */
+const struct berval *
+value_set_norm(Slapi_Value *value, int key, const char *val, size_t len)
+{
+    struct slapi_value_norm *norm = NULL;
+    struct slapi_value_norm *current = __atomic_load_n(&value->v_norm, __ATOMIC_ACQUIRE);
+
+    size_t size = 0;
+
+    if (current != &value_norm_empty) {
+        return current ? value_get_norm(value, key) : NULL;
+    }
+    if (len == value->bv.bv_len && memcmp(val, value->bv.bv_val, len) == 0) {
+        if (key >= 0 && key < VALUE_NORM_SAME_KEYS) {
+            norm = &value_norm_same[key];
+        } else {
+            size = sizeof(struct slapi_value_norm);
+            norm = (struct slapi_value_norm *)slapi_ch_calloc(1, size);
+            norm->key = key;
+        }
+    } else {
+        size = sizeof(struct slapi_value_norm) + len;
+        norm = (struct slapi_value_norm *)slapi_ch_malloc(size + 1);
+        norm->bv.bv_val = (char *)(norm + 1);
+        norm->bv.bv_len = len;
+        memcpy(norm->bv.bv_val, val, len);
+        norm->bv.bv_val[len] = '\0';
+        norm->key = key;
+    }
+    if (!__atomic_compare_exchange_n(&value->v_norm, &current, norm, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        /* Another thread was faster */
+        if (size) {
+            slapi_ch_free((void **)&norm);
+        }
+        return value_get_norm(value, key);
+    }
+    if (size) {
+        slapi_td_add_norm_size(size);
+    }
+    return value_get_norm(value, key);
+}
+
 
 #ifdef VALUE_DEBUG
 static void
@@ -567,6 +695,7 @@ value_dn_normalize_value(Slapi_Value *value)
 
     sdn = slapi_sdn_new_dn_passin(value->bv.bv_val);
     if (slapi_sdn_get_dn(sdn)) {
+        value_norm_done(value);
         value->bv.bv_val = slapi_ch_strdup(slapi_sdn_get_dn(sdn));
         value->bv.bv_len = slapi_sdn_get_ndn_len(sdn);
         slapi_sdn_free(&sdn);
@@ -97,6 +97,7 @@ int vattr_call_sp_get_value(vattr_sp_handle *handle, vattr_context *c, Slapi_Ent
 int vattr_call_sp_get_batch_values(vattr_sp_handle *handle, vattr_context *c, Slapi_Entry *e, vattr_get_thang *my_get, char **type, Slapi_ValueSet ***results, int **type_name_disposition, char ***actual_type_name, int flags, int *buffer_flags, void **hint);
 int vattr_call_sp_compare_value(vattr_sp_handle *handle, vattr_context *c, Slapi_Entry *e, vattr_get_thang *my_get, const char *type, Slapi_Value *test_this, int *result, int flags, void *hint);
 int vattr_call_sp_get_types(vattr_sp_handle *handle, Slapi_Entry *e, vattr_type_list_context *type_context, int flags);
+int vattr_call_sp_get_candidates(vattr_sp_handle *handle, Slapi_PBlock *pb, Slapi_Filter *f, Slapi_Filter **candidate_filter, void *hint);
 void schema_changed_callback(Slapi_Entry *e, char *dn, int modtype, Slapi_PBlock *pb, void *caller_data);
 int slapi_vattrspi_register_internal(vattr_sp_handle **h, vattr_get_fn_type get_fn, vattr_get_ex_fn_type get_ex_fn, vattr_compare_fn_type compare_fn, vattr_types_fn_type types_fn, void *options);
 
@@ -737,6 +738,109 @@ vattr_test_filter(Slapi_PBlock *pb,
     }
     return rc;
 }
+
+/*
+ * vattr_candidates_realattrs_only
+ * . slapi_filter_apply callback flagging the components of a candidate
+ * . filter so that the backend does not ask the providers for them again.
+ * . A component on a virtual type would only be looked up in the index of
+ * . the stored values, the candidates would no longer be a superset: the
+ * . scan is stopped in that case.
+ */
+static int
+vattr_candidates_realattrs_only(Slapi_Filter *f, void *arg)
+{
+    char *type = NULL;
+
+    if ((slapi_filter_get_attribute_type(f, &type) == 0) && type &&
+        vattr_map_namespace_sp_getlist(NULL, type)) {
+        *(int *)arg = 1;
+        return SLAPI_FILTER_SCAN_STOP;
+    }
+    f->f_flags |= SLAPI_FILTER_REALATTRS_ONLY;
+    return SLAPI_FILTER_SCAN_CONTINUE;
+}
+
+/*
+ * vattr_type_is_virtual
+ * . returns 1 if a service provider may supply values of type to the
+ * . entries of the namespace namespace_dn (NULL for the global providers).
+ */
+int
+vattr_type_is_virtual(const Slapi_DN *namespace_dn, const char *type)
+{
+    return vattr_map_namespace_sp_getlist((Slapi_DN *)namespace_dn, type) != NULL;
+}
+
+/*
+ * slapi_vattr_filter_candidates
+ * . asks the service providers of the type of an equality or presence
+ * . filter component for a filter on stored attributes that selects (at
+ * . least) the entries the component matches, so that the backend can
+ * . build the candidate list from its indexes instead of using ALLIDS.
+ * . namespace_dn is the suffix of the backend being searched, resolved
+ * . once by the caller (NULL for the global providers only).
+ *
+ * returns: 0    *candidate_filter is set, free it with slapi_filter_free()
+ *          SLAPI_VIRTUALATTRS_NOT_FOUND    the type is not virtual, or one
+ *                                          of its providers can not tell
+ */
+int
+slapi_vattr_filter_candidates(Slapi_PBlock *pb, const Slapi_DN *namespace_dn, Slapi_Filter *f, Slapi_Filter **candidate_filter)
+{
+    vattr_sp_handle_list *list = NULL;
+    vattr_sp_handle *current_handle = NULL;
+    Slapi_Filter *result = NULL;
+    char *type = NULL;
+    void *hint = NULL;
+    int error_code = 0;
+    int failed = 0;
+
+    *candidate_filter = NULL;
+
+    if ((f->f_flags & SLAPI_FILTER_REALATTRS_ONLY) ||
+        ((f->f_choice != LDAP_FILTER_EQUALITY) && (f->f_choice != LDAP_FILTER_PRESENT)) ||
+        (slapi_filter_get_attribute_type(f, &type) != 0) || (type == NULL)) {
+        return SLAPI_VIRTUALATTRS_NOT_FOUND;
+    }
+
+    list = vattr_map_namespace_sp_getlist((Slapi_DN *)namespace_dn, type);
+    if (list == NULL) {
+        return SLAPI_VIRTUALATTRS_NOT_FOUND;
+    }
+
+    for (current_handle = vattr_map_sp_first(list, &hint);
+         current_handle;
+         current_handle = vattr_map_sp_next(current_handle, &hint)) {
+        Slapi_Filter *sp_filter = NULL;
+        int rc;
+
+        rc = vattr_call_sp_get_candidates(current_handle, pb, f, &sp_filter, hint);
+        if (rc == SLAPI_VIRTUALATTRS_NOT_FOUND) {
+            /* not serving that type */
+            continue;
+        }
+        if ((rc != 0) || (sp_filter == NULL)) {
+            slapi_filter_free(sp_filter, 1);
+            failed = 1;
+            break;
+        }
+        result = slapi_filter_join_ex(LDAP_FILTER_OR, result, sp_filter, 0);
+    }
+
+    if (failed || (result == NULL)) {
+        slapi_filter_free(result, 1);
+        return SLAPI_VIRTUALATTRS_NOT_FOUND;
+    }
+
+    slapi_filter_apply(result, vattr_candidates_realattrs_only, &failed, &error_code);
+    if (failed) {
+        slapi_filter_free(result, 1);
+        return SLAPI_VIRTUALATTRS_NOT_FOUND;
+    }
+    *candidate_filter = result;
+    return 0;
+}
 /*
  * deprecated in favour of slapi_vattr_values_get_sp_ex() which
  * returns subtypes too.
@@ -1664,6 +1768,7 @@ struct _vattr_sp
     vattr_get_ex_fn_type sp_get_ex_fn;
     vattr_compare_fn_type sp_compare_fn;
     vattr_types_fn_type sp_types_fn;
+    vattr_candidates_fn_type sp_candidates_fn;
     void *sp_data; /* Pointer for use by the Service Provider */
 };
 typedef struct _vattr_sp vattr_sp;
@@ -1728,6 +1833,17 @@ slapi_vattrspi_register_internal(vattr_sp_handle **h, vattr_get_fn_type get_fn,
     return 0;
 }
 
+int
+slapi_vattrspi_register_candidates(vattr_sp_handle *h, vattr_candidates_fn_type candidates_fn)
+{
+    if ((h == NULL) || (h->sp == NULL)) {
+        return -1;
+    }
+    /* the sp is shared by every handle made for that provider */
+    h->sp->sp_candidates_fn = candidates_fn;
+    return 0;
+}
+
 vattr_sp_handle_list *
 vattr_map_sp_get_complete_list(void)
 {
@@ -1877,6 +1993,16 @@ vattr_call_sp_get_types(vattr_sp_handle *handle, Slapi_Entry *e, vattr_type_list
     return ((handle->sp->sp_types_fn)(handle, e, type_context, flags));
 }
 
+int
+vattr_call_sp_get_candidates(vattr_sp_handle *handle, Slapi_PBlock *pb, Slapi_Filter *f, Slapi_Filter **candidate_filter, void *hint)
+{
+    if (handle->sp->sp_candidates_fn == NULL) {
+        /* that provider can not tell which entries get the type */
+        return -1;
+    }
+    return ((handle->sp->sp_candidates_fn)(handle, pb, f, candidate_filter, hint));
+}
+
 /* Service provider entry point prototypes */
 
 /* Call which allows a SP to say what attributes can be used to define a given attribute, used for loop detection */
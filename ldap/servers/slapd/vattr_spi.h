@@ -26,6 +26,16 @@ typedef int (*vattr_get_fn_type)(vattr_sp_handle *handle, vattr_context *c, Slap
 typedef int (*vattr_get_ex_fn_type)(vattr_sp_handle *handle, vattr_context *c, Slapi_Entry *e, char **type, Slapi_ValueSet ***results, int **type_name_disposition, char ***actual_type_name, int flags, int *free_flags, void **hint);
 typedef int (*vattr_compare_fn_type)(vattr_sp_handle *handle, vattr_context *c, Slapi_Entry *e, char *type, Slapi_Value *test_this, int *result, int flags, void *hint);
 typedef int (*vattr_types_fn_type)(vattr_sp_handle *handle, Slapi_Entry *e, vattr_type_list_context *type_context, int flags);
+/* Candidate generation: given an equality or presence filter component on a
+   type the provider serves, return in *candidate_filter a filter on stored
+   attributes matching at least every entry the component can match (including
+   entries storing the type itself, if the provider lets them through).
+   The backend only uses it to build the candidate list, entries are still
+   tested against the original filter.
+   Return 0 if *candidate_filter was set (the caller frees it),
+   SLAPI_VIRTUALATTRS_NOT_FOUND if the provider does not serve the type,
+   anything else if it cannot tell (the component is then unindexed) */
+typedef int (*vattr_candidates_fn_type)(vattr_sp_handle *handle, Slapi_PBlock *pb, Slapi_Filter *f, Slapi_Filter **candidate_filter, void *hint);
 
 vattr_context *vattr_context_new(Slapi_PBlock *pb);
 
@@ -34,6 +44,8 @@ int slapi_vattrspi_register(vattr_sp_handle **h, vattr_get_fn_type get_fn, vattr
 /* options must be set to null */
 int slapi_vattrspi_register_ex(vattr_sp_handle **h, vattr_get_ex_fn_type get_fn, vattr_compare_fn_type compare_fn, vattr_types_fn_type types_fn, void *options);
 int slapi_vattrspi_regattr(vattr_sp_handle *h, char *type_name_to_register, char *DN /* Is there a DN type ?? */, void *hint);
+/* Optional, to be called after slapi_vattrspi_register*() */
+int slapi_vattrspi_register_candidates(vattr_sp_handle *h, vattr_candidates_fn_type candidates_fn);
 
 /* Type thang structure used by slapi_vattrspi_add_type() */
 struct _vattr_type_thang
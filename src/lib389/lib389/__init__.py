@@ -3101,9 +3101,10 @@ class DirSrv(SimpleLDAPObject, object):
 
         return output
 
-    def dbverify(self, bename):
+    def dbverify(self, bename, backup_dir=None):
         """
         @param bename - the backend name to verify
+        @param backup_dir - verify the backup in this directory instead of the database
         @return - True if the verify succeded
         """
         prog = os.path.join(self.ds_paths.sbin_dir, 'ns-slapd')
@@ -3118,6 +3119,8 @@ class DirSrv(SimpleLDAPObject, object):
             '-D', self.get_config_dir(),
             '-n', bename
         ]
+        if backup_dir is not None:
+            cmd.extend(['-a', backup_dir])
 
         try:
             subprocess.check_output(cmd, encoding='utf-8')
@@ -3457,8 +3460,17 @@ class DirSrv(SimpleLDAPObject, object):
             self.log.debug("Delete entry children %s", ent.dn)
             self.delete_ext_s(ent.dn, serverctrls=serverctrls, clientctrls=clientctrls, escapehatch='i am sure')
 
-    def backup_online(self, archive=None, db_type=None):
-        """Creates a backup of the database"""
+    def backup_online(self, archive=None, db_type=None, base=None, compact=False):
+        """Creates a backup of the database
+
+        :param archive: Directory where to store the backup files, or a named
+                        pipe or a unix socket where to stream the backup
+        :param db_type: Database type
+        :param base: Previous backup, only the changes since that backup are
+                     saved (incremental backup). Not supported by all the
+                     database implementations.
+        :param compact: Compact the database of a streamed backup
+        """
 
         if archive is None:
             # Use the instance name and date/time as the default backup name
@@ -3476,12 +3488,23 @@ class DirSrv(SimpleLDAPObject, object):
         task_properties = {'nsArchiveDir': archive}
         if db_type is not None:
             task_properties['nsDatabaseType'] = db_type
+        if base is not None:
+            if base[0] != "/":
+                base = os.path.join(self.ds_paths.backup_dir, base)
+            task_properties['nsBackupBase'] = base
+        if compact:
+            task_properties['nsBackupCompact'] = 'on'
         task.create(properties=task_properties)
 
         return task
 
     def restore_online(self, archive, db_type=None):
-        """Restores a database from a backup"""
+        """Restores a database from a backup
+
+        :param archive: Directory of the backup, or a named pipe or a unix
+                        socket from where the backup is streamed
+        :param db_type: Database type
+        """
 
         # Relative path, append it to the bak directory
         if archive[0] != "/":
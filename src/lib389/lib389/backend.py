@@ -1040,6 +1040,11 @@ class DatabaseConfig(DSLdapObject):
             'nsslapd-idl-switch',
             'nsslapd-search-bypass-filter-test',
             'nsslapd-search-use-vlv-index',
+            'nsslapd-vlv-auto-threshold',
+            'nsslapd-vlv-auto-min-candidates',
+            'nsslapd-vlv-auto-max-indexes',
+            'nsslapd-search-entry-summary',
+            'nsslapd-search-filter-plans',
             'nsslapd-exclude-from-export',
             'nsslapd-serial-lock',
             'nsslapd-subtree-rename-switch',
@@ -1082,6 +1087,8 @@ class DatabaseConfig(DSLdapObject):
                     'nsslapd-mdb-max-size',
                     'nsslapd-mdb-max-readers',
                     'nsslapd-mdb-max-dbs',
+                    'nsslapd-db-transaction-batch-val',
+                    'nsslapd-db-transaction-batch-max-wait',
                 ]
         }
         self._create_objectclasses = ['top', 'extensibleObject']
@@ -10,7 +10,8 @@
 def backup_create(inst, basedn, log, args):
     log = log.getChild('backup_create')
 
-    task = inst.backup_online(archive=args.archive, db_type=args.db_type)
+    task = inst.backup_online(archive=args.archive, db_type=args.db_type, base=args.base,
+                              compact=args.compact)
     task.wait()
     result = task.get_exit_code()
 
@@ -42,14 +43,21 @@ def create_parser(subparsers):
     create_parser = subcommands.add_parser('create', help="Creates a backup of the database")
     create_parser.set_defaults(func=backup_create)
     create_parser.add_argument('archive', nargs='?', default=None,
-                               help="Sets the directory where to store the backup files. "
+                               help="Sets the directory where to store the backup files, "
+                                    "or a named pipe or a unix socket where to stream the backup. "
                                     "Format: instance_name-year_month_date_hour_minutes_seconds. "
                                     "Default: /var/lib/dirsrv/slapd-instance/bak/ ")
     create_parser.add_argument('-t', '--db-type', default="ldbm database",
                                help="Sets the database type. Default: ldbm database")
+    create_parser.add_argument('-b', '--base', default=None,
+                               help="Only saves the changes since this previous backup (incremental backup). "
+                                    "Restoring the backup requires all the backups it is based on.")
+    create_parser.add_argument('--compact', action='store_true', default=False,
+                               help="Compacts the database when the backup is streamed")
 
     restore_parser = subcommands.add_parser('restore', help="Restores a database from a backup")
     restore_parser.set_defaults(func=backup_restore)
-    restore_parser.add_argument('archive', help="Set the directory that contains the backup files")
+    restore_parser.add_argument('archive', help="Set the directory that contains the backup files, "
+                                                "or a named pipe or a unix socket from where the backup is streamed")
     restore_parser.add_argument('-t', '--db-type', default="ldbm database",
                                 help="Sets the database type. Default: ldbm database")
@@ -248,12 +248,14 @@ class MonitorDatabase(DSLdapObject):
                 'activerwtxn',
                 'abortrwtxn',
                 'commitrwtxn',
+                'groupsyncrwtxn',
                 'granttimerwtxn',
                 'lifetimerwtxn',
                 'waitingrotxn',
                 'activerotxn',
                 'abortrotxn',
                 'commitrotxn',
+                'renewrotxn',
                 'granttimerotxn',
                 'lifetimerotxn',
            ]
@@ -35,6 +35,8 @@ def test_basic(topology_st):
     # Create the backup
     args.archive = BACKUP_DIR
     args.db_type = None
+    args.base = None
+    args.compact = False
     backup_create(topology_st.standalone, None, topology_st.logcap.log, args)
     assert os.listdir(BACKUP_DIR)
 
@@ -0,0 +1,59 @@
+/** BEGIN COPYRIGHT BLOCK
+ * Copyright (C) 2026 Red Hat, Inc.
+ * All rights reserved.
+ *
+ * License: GPL (version 3 or any later version).
+ * See LICENSE for details.
+ * END COPYRIGHT BLOCK **/
+
+#include "../../test_slapd.h"
+
+#include <slap.h>
+#include <string.h>
+
+static int
+substring_match(const char *initial, char **any, const char *final, const char *value)
+{
+    Slapi_Substring *ss = slapi_substring_comp(initial, any, final);
+    int rc = slapi_substring_exec(ss, value, strlen(value));
+
+    slapi_substring_free(&ss);
+    assert_null(ss);
+    return rc;
+}
+
+void
+test_libslapd_filter_substring(void **state __attribute__((unused)))
+{
+    char *any_b[] = {"b", NULL};
+    char *any_bc[] = {"b", "c", NULL};
+    char *any_cb[] = {"c", "b", NULL};
+    char *any_aa[] = {"aa", "aa", NULL};
+
+    /* initial */
+    assert_int_equal(substring_match("abc", NULL, NULL, "abcdef"), 1);
+    assert_int_equal(substring_match("abc", NULL, NULL, "abc"), 1);
+    assert_int_equal(substring_match("abc", NULL, NULL, "ab"), 0);
+    assert_int_equal(substring_match("abc", NULL, NULL, "xabc"), 0);
+    /* final */
+    assert_int_equal(substring_match(NULL, NULL, "def", "abcdef"), 1);
+    assert_int_equal(substring_match(NULL, NULL, "def", "defx"), 0);
+    assert_int_equal(substring_match(NULL, NULL, "def", "ef"), 0);
+    /* any, in order */
+    assert_int_equal(substring_match(NULL, any_b, NULL, "abc"), 1);
+    assert_int_equal(substring_match(NULL, any_b, NULL, "ac"), 0);
+    assert_int_equal(substring_match(NULL, any_bc, NULL, "abxc"), 1);
+    assert_int_equal(substring_match(NULL, any_cb, NULL, "abxc"), 0);
+    assert_int_equal(substring_match(NULL, any_aa, NULL, "aaa"), 0);
+    assert_int_equal(substring_match(NULL, any_aa, NULL, "aaaa"), 1);
+    /* the components do not overlap */
+    assert_int_equal(substring_match("ab", NULL, "bc", "abc"), 0);
+    assert_int_equal(substring_match("ab", NULL, "bc", "abbc"), 1);
+    assert_int_equal(substring_match("a", any_b, "b", "ab"), 0);
+    assert_int_equal(substring_match("a", any_b, "b", "abb"), 1);
+    assert_int_equal(substring_match("a", any_bc, "d", "abcd"), 1);
+    assert_int_equal(substring_match("a", any_bc, "d", "acbd"), 0);
+    /* no special characters */
+    assert_int_equal(substring_match("a.", NULL, "$", "a.$"), 1);
+    assert_int_equal(substring_match("a.", NULL, NULL, "ab"), 0);
+}
@@ -0,0 +1,105 @@
+/** BEGIN COPYRIGHT BLOCK
+ * Copyright (C) 2026 Red Hat, Inc.
+ * All rights reserved.
+ *
+ * License: GPL (version 3 or any later version).
+ * See LICENSE for details.
+ * END COPYRIGHT BLOCK **/
+
+#include "../../test_slapd.h"
+
+#include <slap.h>
+#include <proto-slap.h>
+#include <string.h>
+
+static struct asyntaxinfo *
+attr_syntax_add_with_alias(char *name, char *alias, char *oid)
+{
+    char *names[3] = {0};
+    struct asyntaxinfo *asi = NULL;
+
+    names[0] = name;
+    names[1] = alias;
+
+    attr_syntax_create(
+        oid, // attr_oid
+        names, // attr_names
+        "testing attribute type",
+        NULL, // attr_supe
+        NULL, // attr eq
+        NULL, // attr order
+        NULL, // attr sub
+        NULL, // exten
+        DIRSTRING_SYNTAX_OID, // attr_syntax
+        SLAPI_SYNTAXLENGTH_NONE,// syntaxlen
+        SLAPI_ATTR_FLAG_STD_ATTR | SLAPI_ATTR_FLAG_OPATTR, // flags
+        &asi
+    );
+
+    assert_true(attr_syntax_add(asi, 0) == 0);
+
+    return asi;
+}
+
+void
+test_libslapd_schema_typeid_intern(void **state __attribute__((unused)))
+{
+    attr_syntax_write_lock();
+    struct asyntaxinfo *a = attr_syntax_add_with_alias("test_typeid_a", "test_typeid_alias", "1.1.0.0.0.1.1");
+    attr_syntax_unlock_write();
+
+    uint32_t id = attr_typeid_get("test_typeid_a");
+    uint32_t alias_id = attr_typeid_get("test_typeid_alias");
+
+    /* Stable, case insensitive, and the same as the one of the schema */
+    assert_true(id != 0);
+    assert_int_equal(id, a->asi_typeid);
+    assert_int_equal(id, attr_typeid_get("TEST_TypeID_A"));
+    assert_int_equal(id, attr_typeid_intern("test_typeid_a"));
+    assert_string_equal(attr_typeid_name(id), "test_typeid_a");
+
+    /* An alias is a different name */
+    assert_true(alias_id != 0);
+    assert_true(alias_id != id);
+
+    /* Subtypes and unknown types are not interned */
+    assert_int_equal(attr_typeid_get("test_typeid_a;lang-en"), 0);
+    assert_int_equal(attr_typeid_get("test_typeid_not_in_schema"), 0);
+    assert_int_equal(attr_typeid_get(NULL), 0);
+    assert_null(attr_typeid_name(0));
+
+    /* Attributes carry the id of their type */
+    Slapi_Entry *e = slapi_entry_alloc();
+    slapi_entry_add_string(e, "test_typeid_a", "value");
+    slapi_entry_add_string(e, "test_typeid_a;lang-en", "value");
+    slapi_entry_add_string(e, "test_typeid_not_in_schema", "value");
+
+    Slapi_Attr *attr = attrlist_find(e->e_attrs, "Test_TypeId_A");
+    assert_non_null(attr);
+    assert_int_equal(attr->a_typeid, id);
+    assert_string_equal(attr->a_type, "test_typeid_a");
+    /* Found by name, as the alias is not the type of the attribute */
+    assert_null(attrlist_find(e->e_attrs, "test_typeid_alias"));
+
+    attr = attrlist_find(e->e_attrs, "test_typeid_a;lang-en");
+    assert_non_null(attr);
+    assert_int_equal(attr->a_typeid, 0);
+    assert_non_null(attrlist_find(e->e_attrs, "TEST_TYPEID_NOT_IN_SCHEMA"));
+
+    /* Subtype matching still falls back on the names */
+    void *hint = NULL;
+    int count = 0;
+    while (attrlist_find_ex(e->e_attrs, "test_typeid_a", NULL, NULL, &hint) != NULL) {
+        count++;
+    }
+    assert_int_equal(count, 2);
+
+    slapi_entry_free(e);
+
+    attr_syntax_write_lock();
+    attr_syntax_delete(a, 0);
+    attr_syntax_unlock_write();
+
+    /* Ids survive the removal of the schema definition */
+    assert_int_equal(attr_typeid_get("test_typeid_a"), id);
+}
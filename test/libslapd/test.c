@@ -27,6 +27,9 @@ run_libslapd_tests(void)
         cmocka_unit_test(test_libslapd_pblock_v3c_original_target_dn),
         cmocka_unit_test(test_libslapd_pblock_v3c_target_uniqueid),
         cmocka_unit_test(test_libslapd_schema_filter_validate_simple),
+        cmocka_unit_test(test_libslapd_filter_substring),
+        cmocka_unit_test(test_libslapd_value_norm),
+        cmocka_unit_test(test_libslapd_schema_typeid_intern),
         cmocka_unit_test(test_libslapd_operation_v3c_target_spec),
         cmocka_unit_test(test_libslapd_counters_atomic_usage),
         cmocka_unit_test(test_libslapd_counters_atomic_overflow),
@@ -0,0 +1,49 @@
+/** BEGIN COPYRIGHT BLOCK
+ * Copyright (C) 2026 Red Hat, Inc.
+ * All rights reserved.
+ *
+ * License: GPL (version 3 or any later version).
+ * See LICENSE for details.
+ * END COPYRIGHT BLOCK **/
+
+#include "../../test_slapd.h"
+
+#include <slap.h>
+#include <string.h>
+
+void
+test_libslapd_value_norm(void **state __attribute__((unused)))
+{
+    Slapi_Value *v = slapi_value_new_string("Barbara Jensen");
+    Slapi_Value sv;
+    const struct berval *bv = NULL;
+
+    /* Nothing stored yet */
+    assert_null(value_get_norm(v, 1));
+
+    bv = value_set_norm(v, 1, "barbara jensen", 14);
+    assert_non_null(bv);
+    assert_string_equal(bv->bv_val, "barbara jensen");
+    assert_true(value_get_norm(v, 1) == bv);
+    /* Only one normalized form is kept */
+    assert_null(value_get_norm(v, 2));
+    assert_null(value_set_norm(v, 2, "barbarajensen", 13));
+    assert_true(value_set_norm(v, 1, "barbara jensen", 14) == bv);
+
+    /* Changing the value drops its normalized form */
+    slapi_value_set_string(v, "bjensen");
+    assert_null(value_get_norm(v, 1));
+    /* A normalized value is not copied, the value is returned */
+    bv = value_set_norm(v, 1, "bjensen", 7);
+    assert_true(bv == slapi_value_get_berval(v));
+    assert_true(value_get_norm(v, 1) == slapi_value_get_berval(v));
+    assert_null(value_get_norm(v, 2));
+    assert_null(value_set_norm(v, 2, "bjensen", 7));
+    slapi_value_free(&v);
+
+    /* The values initialized in place do not keep it */
+    slapi_value_init_string(&sv, "Barbara Jensen");
+    assert_null(value_set_norm(&sv, 1, "barbara jensen", 14));
+    assert_null(value_get_norm(&sv, 1));
+    value_done(&sv);
+}
@@ -0,0 +1,135 @@
+/** BEGIN COPYRIGHT BLOCK
+ * Copyright (C) 2026 Red Hat, Inc.
+ * All rights reserved.
+ *
+ * License: GPL (version 3 or any later version).
+ * See LICENSE for details.
+ * END COPYRIGHT BLOCK **/
+
+#include "../../test_slapd.h"
+
+#include <string.h>
+#include <syntax.h>
+
+/*
+ * The character by character normalization, as done before the ASCII
+ * fast path, for the string syntaxes. It is the reference of the tests.
+ */
+static int
+reference_isspace(char *s)
+{
+    unsigned char c = *(unsigned char *)s;
+    if (c & 0x80) {
+        return ldap_utf8isspace(s);
+    }
+    return c == ' ' || (c >= 0x09 && c <= 0x0D);
+}
+
+static void
+reference_normalize(char *s, int syntax)
+{
+    char *head = s;
+    char *d = s;
+    int prevspace = 0;
+    int curspace;
+
+    while (reference_isspace(s)) {
+        LDAP_UTF8INC(s);
+    }
+    if (*s == '\0' && s != d) {
+        if (!(syntax & SYNTAX_SI)) {
+            *d++ = ' ';
+        }
+        *d = '\0';
+        return;
+    }
+    while (*s) {
+        curspace = reference_isspace(s);
+        if (((syntax & SYNTAX_TEL) && (curspace || *s == '-')) ||
+            ((syntax & SYNTAX_SI) && curspace) ||
+            (prevspace && curspace)) {
+            LDAP_UTF8INC(s);
+            continue;
+        }
+        prevspace = curspace;
+        if (syntax & SYNTAX_CIS) {
+            int ssz, dsz;
+            slapi_utf8ToLower((unsigned char *)s, (unsigned char *)d, &ssz, &dsz);
+            s += ssz;
+            d += dsz;
+        } else {
+            char *np = ldap_utf8next(s);
+            memmove(d, s, np - s);
+            d += np - s;
+            s = np;
+        }
+    }
+    *d = '\0';
+    if (prevspace) {
+        char *nd = ldap_utf8prev(d);
+        while (nd && nd >= head && reference_isspace(nd)) {
+            d = nd;
+            nd = ldap_utf8prev(d);
+            *d = '\0';
+        }
+    }
+}
+
+static void
+check_normalize(const char *value, int syntax, const char *expected)
+{
+    char buf[256];
+    char *alt = NULL;
+
+    strcpy(buf, value);
+    value_normalize_ext(buf, syntax, 1, &alt);
+    assert_null(alt);
+    assert_string_equal(buf, expected);
+
+    strcpy(buf, value);
+    reference_normalize(buf, syntax);
+    assert_string_equal(buf, expected);
+}
+
+void
+test_plugin_syntaxes_normalize(void **state __attribute__((unused)))
+{
+    char value[64];
+    char fast[64];
+    char reference[64];
+    const char chars[] = "aZ- \t09Mm.@";
+    int syntaxes[] = {SYNTAX_CIS, SYNTAX_CES, SYNTAX_CIS | SYNTAX_TEL, SYNTAX_CIS | SYNTAX_SI};
+    char *alt = NULL;
+
+    check_normalize("Barbara Jensen", SYNTAX_CIS, "barbara jensen");
+    check_normalize("  Barbara   JENSEN  ", SYNTAX_CIS, "barbara jensen");
+    check_normalize("  Barbara   JENSEN  ", SYNTAX_CES, "Barbara JENSEN");
+    check_normalize("AbCdEfGhIjKlMnOpQrStUvWxYz@[`{", SYNTAX_CIS, "abcdefghijklmnopqrstuvwxyz@[`{");
+    check_normalize("bjensen@EXAMPLE.COM", SYNTAX_CIS, "bjensen@example.com");
+    check_normalize("+1 408-555-1862", SYNTAX_CIS | SYNTAX_TEL, "+14085551862");
+    check_normalize("A long   value\twith\n\ntabs", SYNTAX_CIS | SYNTAX_SI, "alongvaluewithtabs");
+    check_normalize("   ", SYNTAX_CIS, " ");
+    check_normalize("   ", SYNTAX_CIS | SYNTAX_SI, "");
+    /* Non ASCII characters go through the UTF-8 path */
+    check_normalize("\xC3\x85ngstr\xC3\xB6m \xC3\x89RIC", SYNTAX_CIS, "\xC3\xA5ngstr\xC3\xB6m \xC3\xA9ric");
+    check_normalize("ABCDEFGH\xC3\x89IJKLMNOP", SYNTAX_CIS, "abcdefgh\xC3\xA9ijklmnop");
+    check_normalize("ABCDEFGH\xC3\x89IJKLMNOP", SYNTAX_CES, "ABCDEFGH\xC3\x89IJKLMNOP");
+
+    /* Random ASCII values */
+    srand(389);
+    for (size_t i = 0; i < 10000; i++) {
+        size_t len = rand() % (sizeof(value) - 1);
+        int syntax = syntaxes[rand() % (sizeof(syntaxes) / sizeof(syntaxes[0]))];
+
+        for (size_t j = 0; j < len; j++) {
+            value[j] = chars[rand() % (sizeof(chars) - 1)];
+        }
+        value[len] = '\0';
+        strcpy(fast, value);
+        strcpy(reference, value);
+        value_normalize_ext(fast, syntax, 1, &alt);
+        reference_normalize(reference, syntax);
+        assert_null(alt);
+        assert_string_equal(fast, reference);
+    }
+}
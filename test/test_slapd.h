@@ -39,6 +39,15 @@ void test_libslapd_pblock_v3c_target_uniqueid(void **state);
 /* libslapd-schema-filter-validate */
 void test_libslapd_schema_filter_validate_simple(void **state);
 
+/* libslapd-filter-substring */
+void test_libslapd_filter_substring(void **state);
+
+/* libslapd-value-norm */
+void test_libslapd_value_norm(void **state);
+
+/* libslapd-schema-typeid */
+void test_libslapd_schema_typeid_intern(void **state);
+
 /* libslapd-operation-v3_compat */
 void test_libslapd_operation_v3c_target_spec(void **state);
 
@@ -63,3 +72,7 @@ int test_plugin_pwdstorage_nss_stop(void **state);
 
 void test_plugin_pwdstorage_pbkdf2_auth(void **state);
 void test_plugin_pwdstorage_pbkdf2_rounds(void **state);
+
+/* plugin-syntaxes-normalize */
+
+void test_plugin_syntaxes_normalize(void **state);